@@ -3,6 +3,7 @@
 #include "WavefrontFile.hpp"
 #include "BinaryFile.hpp"
 #include "Sound.hpp"
+#include "Pack.hpp"
 
 using namespace small3d;
 
@@ -11,11 +12,44 @@ bool isSound = false;
 
 int main(int argc, char** argv) {
   try {
-    if (argc > 2) {
+    if (argc == 4 && std::string(argv[1]) == "--pack") {
+
+      // All the files in a directory are packed in a single file
+      uint32_t numFiles = Pack::create(argv[2], argv[3]);
+
+      try {
+        Pack pack(argv[3]);
+        for (auto& name : pack.getEntryNames()) {
+          std::vector<char> buffer;
+          pack.getEntry(name, buffer);
+        }
+        std::cout << "Packed " << numFiles << " files." << std::endl;
+        std::cout << "ok" << std::endl;
+      }
+      catch (const std::exception& ex) {
+        std::cout << "Something went wrong while testing the file " << argv[3] << ": " << ex.what() << std::endl;
+      }
+    }
+    else if (argc > 2) {
 
       std::string modelpath = (argv[1]);
       std::string binpath = (argv[2]);
 
+      // Optionally, bounding box sets can be saved with the model, for
+      // each number of subdivisions given after the file paths. Models
+      // are saved in the mapped binary format instead of the compressed
+      // one if --mapped is given.
+      std::vector<uint32_t> boundingBoxSubdivisions;
+      Model::BinaryFormat format = Model::BinaryFormat::compressed;
+      for (int idx = 3; idx < argc; ++idx) {
+        if (std::string(argv[idx]) == "--mapped") {
+          format = Model::BinaryFormat::mapped;
+        }
+        else {
+          boundingBoxSubdivisions.push_back(static_cast<uint32_t>(std::stoul(argv[idx])));
+        }
+      }
+
       Model model;
       Sound sound;
 
@@ -42,7 +76,7 @@ int main(int argc, char** argv) {
       }
 
       if (!isSound) {
-        model.saveBinary(binpath);
+        model.saveBinary(binpath, boundingBoxSubdivisions, format);
         
       }
       else {
@@ -63,7 +97,11 @@ int main(int argc, char** argv) {
       }
     }
     else {
-      std::cout << "Please provide source and target filename / path." << std::endl;
+      std::cout << "Please provide source and target filename / path, optionally followed by" << std::endl;
+      std::cout << "the bounding box subdivisions to save bounding box sets for and / or" << std::endl;
+      std::cout << "--mapped, to save models in the mapped (faster to load) binary format." << std::endl;
+      std::cout << "Alternatively, provide --pack, a directory and a target filename / path," << std::endl;
+      std::cout << "to pack all the files in the directory in a single file." << std::endl;
     }
   }
   catch (const std::exception& ex) {
@@ -0,0 +1,163 @@
+/**
+ * @file  AssetManager.hpp
+ * @brief Loader of models, images and sounds on background threads
+ *
+ *  Created on: 2026/10/18
+ *      Author: Dimitri Kourkoulis
+ *     License: BSD 3-Clause License (see LICENSE file)
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+namespace small3d {
+
+  class Model;
+  class Image;
+  class Sound;
+  class Pack;
+  class Renderer;
+
+  /**
+   * @class AssetManager
+   * @brief Loads models, images and sounds on background (worker) threads,
+   *        so that the game can keep rendering while they are being loaded,
+   *        for example during level transitions. Each load returns a
+   *        future, from which the loaded asset can be retrieved once it is
+   *        ready (or the exception thrown while loading it, if it could not
+   *        be loaded):
+   *
+   *        auto goat = assetManager.loadModel("resources/models/goat.glb", "Cube");
+   *        ...
+   *        if (goat.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+   *          renderer->render(*goat.get(), ...);
+   *        }
+   *
+   *        Only files are read and parsed on the worker threads. If the
+   *        AssetManager is given a Renderer, the loaded models, as well as
+   *        the images loaded with a texture name, are queued to be sent to
+   *        the GPU by the Renderer (see Renderer::queueUpload), which does
+   *        so on its own thread, a little at a time, every time its
+   *        swapBuffers function is called.
+   */
+  class AssetManager {
+
+  private:
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex jobsMutex;
+    std::condition_variable jobsCondition;
+    bool stopping = false;
+
+    Renderer* renderer;
+
+    void work();
+    void addJob(std::function<void()> job);
+
+    template <typename T>
+    std::shared_future<std::shared_ptr<T>> run(std::function<std::shared_ptr<T>()> load);
+
+    AssetManager(const AssetManager&) = delete;
+    AssetManager& operator=(const AssetManager&) = delete;
+    AssetManager(AssetManager&&) = delete;
+    AssetManager& operator=(AssetManager&&) = delete;
+
+  public:
+
+    /**
+     * @brief Constructor
+     * @param renderer   The renderer that the loaded models and textures will
+     *                   be queued to be sent to the GPU by. If it is nullptr,
+     *                   they will be sent to the GPU as usual, when first
+     *                   rendered or generated.
+     * @param numThreads The number of worker threads (if 0, one less than the
+     *                   number of hardware threads, but at least one)
+     */
+    explicit AssetManager(Renderer* renderer = nullptr, uint32_t numThreads = 0);
+
+    /**
+     * @brief Destructor. Assets that have started loading are loaded before
+     *        the worker threads are stopped. The futures of the ones that
+     *        have not started throw std::future_error (broken promise).
+     */
+    ~AssetManager();
+
+    /**
+     * @brief Load a model from a .glb, a Wavefront .obj or a native binary
+     *        model file (see BinaryFile), depending on its extension.
+     * @param fileLocation Location of the file
+     * @param meshName     The name of the mesh to load (for .glb files and
+     *                     binary files containing many meshes)
+     * @return The future model
+     */
+    std::shared_future<std::shared_ptr<Model>> loadModel(const std::string& fileLocation,
+      const std::string& meshName = "");
+
+    /**
+     * @brief Load a model from a Pack (see PackFile)
+     * @param pack      The pack, which must exist until the model is loaded
+     * @param entryName The name of the entry in the pack
+     * @param meshName  The name of the mesh to load
+     * @return The future model
+     */
+    std::shared_future<std::shared_ptr<Model>> loadModel(const Pack& pack,
+      const std::string& entryName, const std::string& meshName = "");
+
+    /**
+     * @brief Load an image from a .png file
+     * @param fileLocation Location of the file
+     * @param textureName  If not empty and the AssetManager has a Renderer,
+     *                     a texture will be generated from the image with
+     *                     this name (see Renderer::generateTexture)
+     * @return The future image
+     */
+    std::shared_future<std::shared_ptr<Image>> loadImage(const std::string& fileLocation,
+      const std::string& textureName = "");
+
+    /**
+     * @brief Load an image from a Pack
+     * @param pack        The pack, which must exist until the image is loaded
+     * @param entryName   The name of the entry in the pack
+     * @param textureName If not empty and the AssetManager has a Renderer,
+     *                    a texture will be generated from the image with
+     *                    this name (see Renderer::generateTexture)
+     * @return The future image
+     */
+    std::shared_future<std::shared_ptr<Image>> loadImage(const Pack& pack,
+      const std::string& entryName, const std::string& textureName = "");
+
+    /**
+     * @brief Load a sound from an .ogg or a native binary sound file
+     * @param fileLocation Location of the file
+     * @return The future sound
+     */
+    std::shared_future<std::shared_ptr<Sound>> loadSound(const std::string& fileLocation);
+
+    /**
+     * @brief Load a sound from a Pack
+     * @param pack      The pack, which must exist until the sound is loaded
+     * @param entryName The name of the entry in the pack
+     * @return The future sound
+     */
+    std::shared_future<std::shared_ptr<Sound>> loadSound(const Pack& pack,
+      const std::string& entryName);
+
+    /**
+     * @brief Get the number of worker threads
+     * @return The number of worker threads
+     */
+    uint32_t getNumThreads() const;
+
+  };
+}
@@ -14,6 +14,8 @@
 
 namespace small3d {
 
+  class BoundingBoxSet;
+
   /**
    * @class BinaryFile
    * @brief Native model file loader. The model file loaded has to have been
@@ -26,6 +28,21 @@ namespace small3d {
    *        ATTENTION: Unfortunately the native binary files have issues across
    *        architectures. So for example binaries created on Windows do not work
    *        on Linux. They need to be created and tested separately for each.
+   *
+   *        Two formats are supported (see Model::BinaryFormat) and told apart
+   *        by the first bytes of the file. The compressed format is the whole
+   *        Model, serialised after a header holding the version of the
+   *        format and then compressed with zlib. The mapped format
+   *        starts with a versioned header, protected by a checksum, followed
+   *        by a table of sections. The vertex, index, normals, texture
+   *        coordinates, joint, weight and packed vertex data are each stored
+   *        in a section of their own, uncompressed and aligned to 16 bytes,
+   *        so that they are copied out of the mapped file as they are, with
+   *        no decoding. Everything else (joints, animations, material,
+   *        texture image, bounding box sets) is serialised in one more
+   *        section. Sections of types that are not recognised are skipped,
+   *        so that files written by later versions of the format can still
+   *        be read as long as they do not change the existing sections.
    */
   class BinaryFile : public File {
 
@@ -34,6 +51,21 @@ namespace small3d {
 
     BinaryFile(); // No default constructor
 
+    // Set when the data is already in memory, rather than in a file
+    const char* memoryData = nullptr;
+    size_t memorySize = 0;
+
+    void loadCompressed(Model& model, const char* data, size_t size);
+
+    // The start of the uncompressed data of the compressed format, followed
+    // by its version (used by Model::saveBinary)
+    static const char COMPRESSED_MAGIC[4];
+    void loadMapped(Model& model, const char* data, size_t size);
+
+    // Save a model in the mapped format (used by Model::saveBinary)
+    static void saveMapped(const Model& model, const std::string& binaryFilePath,
+      const std::vector<BoundingBoxSet>& boxSets);
+
     // Forbid moving and copying
     BinaryFile(BinaryFile const&) = delete;
     void operator=(BinaryFile const&) = delete;
@@ -47,6 +79,16 @@ namespace small3d {
      */
     explicit BinaryFile(const std::string& fileLocation);
 
+    /**
+     * @brief Constructor, for binary model data that is already in memory
+     *        (e.g. an entry of a Pack). The data is not copied, so it must
+     *        remain available for as long as the BinaryFile exists.
+     * @param name The name of the data (used in messages)
+     * @param data The binary model data
+     * @param size The size of the data, in bytes
+     */
+    BinaryFile(const std::string& name, const char* data, size_t size);
+
     /**
      * @brief Load data from the Wavefront file into a Model
      * @param model The model to load the data to
@@ -61,5 +103,20 @@ namespace small3d {
      */
     std::vector<std::string> getMeshNames() override;
 
+    /**
+     * @brief The version of the mapped format written by this version of
+     *        small3d. Files of later versions cannot be read.
+     */
+    static const uint32_t MAPPED_FORMAT_VERSION = 1;
+
+    /**
+     * @brief The version of the compressed format written by this version
+     *        of small3d. Files of later versions cannot be read. Files saved
+     *        before the format was versioned are read as version 0.
+     */
+    static const uint32_t COMPRESSED_FORMAT_VERSION = 1;
+
+    friend class Model;
+
   };
 }
@@ -25,14 +25,58 @@ namespace small3d {
    */
 
   class BoundingBoxSet {
+  public:
+    struct extremes;
+
   private:
 
+    // A box enclosing either other tree nodes or boxes of the set.
+    // The children of a node are stored one after the other.
+    struct TreeNode {
+      float min[3] = { 0.0f, 0.0f, 0.0f };
+      float max[3] = { 0.0f, 0.0f, 0.0f };
+      uint32_t first = 0;
+      uint32_t count = 0;
+      bool boxChildren = false;
+    };
+
+    // The boxes as arrays of centres and half sizes (structure of arrays),
+    // and a tree of the boxes enclosing them (root first), used by the
+    // queries, so that only the boxes near a point or another box are
+    // tested. The tree follows the subdivisions the boxes were created
+    // by, each node enclosing the boxes its subdivision has kept.
+    struct BoxArrays {
+      std::vector<float> centreX, centreY, centreZ, halfX, halfY, halfZ;
+      std::vector<TreeNode> tree;
+      void fill(const std::vector<extremes>& boxExtremes);
+      void buildTree(const std::vector<std::vector<uint32_t>>& childCounts);
+    };
+
+    BoxArrays boxArrays;
+    // The extremes the box arrays and tree were produced from. The public
+    // extremes may have been modified since, in which case the queries
+    // check every box.
+    std::vector<extremes> treeExtremes;
+    bool hasCurrentTree() const;
+    // The number of boxes kept from the division of each box, on each
+    // subdivision, from which the tree of boxes is built
+    std::vector<std::vector<uint32_t>> subdivisionCounts;
     uint32_t numBoxes = 0;
     void triangulate();
     void calcExtremes();
     void generateBoxesFromExtremes();
     void generateExtremes(const std::vector<float>& vertexData, const Vec3& scale, uint32_t subdivisions);
-    void generateSubExtremes(const std::vector<float>& vertexData, const Vec3& scale);
+    void generateSubExtremes(const std::vector<float>& scaledVertexData, std::vector<uint32_t>& vertexRefs,
+      std::vector<uint32_t>& vertexBoxes, std::vector<uint32_t>& childCounts);
+    bool boxesContain(float x, float y, float z) const;
+    bool nodeContains(uint32_t node, float x, float y, float z) const;
+    static void nodeSweep(const BoxArrays& boxes, uint32_t node, const float* centre,
+      const float* halfSize, const float* velocity, const float* otherHalfSize,
+      const float (*r)[3], const float (*absR)[3], float& timeOfImpact, bool& hit);
+    void nodeRaycast(uint32_t node, const float* origin, const float* inverseDirection,
+      float& distance, bool& hit) const;
+    static bool nodeIntersects(const BoxArrays& boxes, uint32_t node, const float* centre,
+      const float* halfSize, const float* otherHalfSize, const float (*r)[3], const float (*absR)[3]);
 
   public:
 
@@ -43,6 +87,11 @@ namespace small3d {
     
       float minZ = 0.0f, maxZ = 0.0f, minX = 0.0f, maxX = 0.0f, minY = 0.0f, maxY = 0.0f;
       bool tagged = false;
+
+      template <class Archive>
+      void serialize(Archive& archive) {
+        archive(minZ, maxZ, minX, maxX, minY, maxY, tagged);
+      }
     
     };
 
@@ -51,6 +100,14 @@ namespace small3d {
      */
     std::vector<extremes> boxExtremes;
 
+    /**
+     * @brief Produce the box vertices, faces and tree again, after the
+     *        extremes have been modified. Until then, the queries notice
+     *        the modification and check every box, rather than only the
+     *        ones near what they are looking for.
+     */
+    void refreshTree();
+
     /**
      * @brief Get the number of boxes contained in the set.
      */
@@ -126,11 +183,138 @@ namespace small3d {
       const Vec3& otherOffset,
       const Mat4& otherRotation) const;
 
+    /**
+     * @brief Check if any of the boxes of this set intersects any of the
+     *        boxes of another set, testing the boxes as oriented boxes on
+     *        the separating axes. Unlike containsCorners, this also detects
+     *        boxes that cross each other without either containing a corner
+     *        of the other.
+     * @param otherBoxSet   The other box set
+     * @param thisOffset    The offset (location) of this box set
+     * @param thisRotation  The rotation transformation of this box set
+     * @param otherOffset   The offset (location) of the other box set
+     * @param otherRotation The rotation transformation of the other box set
+     * @return True if the two sets intersect, False otherwise.
+     */
+
+    bool intersects(const BoundingBoxSet& otherBoxSet,
+      const Vec3& thisOffset,
+      const Mat4& thisRotation,
+      const Vec3& otherOffset,
+      const Mat4& otherRotation) const;
+
+    /**
+     * @brief Check if another set of bounding boxes, moving in a straight
+     *        line from one offset to another, touches this set at any point
+     *        along the way, and find when it does first. This way fast
+     *        moving objects are not missed by moving past other objects from
+     *        one check to the next. The rotations of both sets are taken to
+     *        remain the same during the motion.
+     * @param otherBoxSet       The other box set
+     * @param thisOffset        The offset (location) of this box set
+     * @param thisRotation      The rotation transformation of this box set
+     * @param otherStartOffset  The offset of the other box set when the motion
+     *                          starts
+     * @param otherEndOffset    The offset of the other box set when the motion
+     *                          ends
+     * @param otherRotation     The rotation transformation of the other box set
+     * @param timeOfImpact      Set to the fraction of the motion (0 - 1) after
+     *                          which the sets first touch (0 if they intersect
+     *                          at the start), if they do
+     * @return True if the sets touch during the motion, False otherwise.
+     */
+
+    bool sweep(const BoundingBoxSet& otherBoxSet,
+      const Vec3& thisOffset,
+      const Mat4& thisRotation,
+      const Vec3& otherStartOffset,
+      const Vec3& otherEndOffset,
+      const Mat4& otherRotation,
+      float& timeOfImpact) const;
+
+    /**
+     * @brief Cast a ray against the boxes of the set, finding the closest
+     *        point at which it hits one of them.
+     * @param origin       The origin of the ray
+     * @param direction    The direction of the ray (it does not need to be
+     *                     normalised)
+     * @param maxDistance  How far from the origin to look for a hit
+     * @param thisOffset   The offset (location) of the box set
+     * @param thisRotation The rotation transformation of the box set
+     * @param distance     Set to the distance of the closest hit from the
+     *                     origin (0 if the origin is inside a box), if there
+     *                     is a hit
+     * @return True if the ray hits a box within maxDistance, False if not.
+     */
+
+    bool raycast(const Vec3& origin, const Vec3& direction, float maxDistance,
+      const Vec3& thisOffset, const Mat4& thisRotation, float& distance) const;
+
     /**
      * @brief Get the bounding boxes in a set of Models that can be rendered
      * @return The set of bounding boxes as Models
      */
     std::vector<Model> getModels();
 
+    /**
+     * @brief Get the number of times the initially created box has been
+     *        subdivided to create this set.
+     */
+    uint32_t getNumSubdivisions() const;
+
+    /**
+     * @brief Get a box set for a Model from the cache, creating it and adding
+     *        it to the cache if it is not there yet. Box sets are found by the
+     *        version of the model's data (a model and its copies share it,
+     *        until their data is marked as changed, see
+     *        Model::markDataChanged), its original scale and the number of
+     *        subdivisions, so creating many SceneObjects from the same model
+     *        only creates its bounding boxes once. The same box set is
+     *        returned to all of them. The cache does not keep the box sets:
+     *        they are destroyed when they are no longer used. Box sets without
+     *        subdivisions are not cached, since they only contain one box.
+     * @param model        The model
+     * @param subdivisions How many times to subdivide the initially one created
+     *                     bounding box.
+     * @return The box set
+     */
+    static std::shared_ptr<BoundingBoxSet> getCached(const Model& model, uint32_t subdivisions);
+
+    /**
+     * @brief Add a box set that has been created for a Model (for example
+     *        loaded from a binary file) to the cache, replacing any box set it
+     *        contains for the same version of the model's data, scale and
+     *        subdivisions. The model keeps the box set for as long as it
+     *        exists, so that it stays in the cache.
+     * @param model  The model the box set has been created for
+     * @param boxSet The box set
+     */
+    static void addToCache(Model& model, std::shared_ptr<BoundingBoxSet> boxSet);
+
+    /**
+     * @brief Remove all box sets from the cache. Box sets still used by
+     *        SceneObjects are not destroyed.
+     */
+    static void clearCache();
+
+    /**
+     * @brief Get the number of box sets in the cache
+     * @return The number of box sets (not counting the ones that have been
+     *         destroyed)
+     */
+    static size_t getCacheSize();
+
+    template <class Archive>
+    void save(Archive& archive) const {
+      archive(boxExtremes, subdivisionCounts);
+    }
+
+    template <class Archive>
+    void load(Archive& archive) {
+      archive(boxExtremes, subdivisionCounts);
+      generateBoxesFromExtremes();
+      boxArrays.buildTree(subdivisionCounts);
+    }
+
   };
 }
@@ -0,0 +1,226 @@
+/**
+ *  @file  CollisionWorld.hpp
+ *  @brief Broad phase collision detection for many SceneObjects
+ *
+ *  Created on: 2026/10/18
+ *      Author: Dimitri Kourkoulis
+ *     License: BSD 3-Clause License (see LICENSE file)
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <limits>
+#include "Math.hpp"
+#include "SceneObject.hpp"
+
+namespace small3d {
+
+  /**
+   * @class CollisionWorld
+   * @brief Finds the SceneObjects that may be colliding, without testing
+   *        every pair of them. The axis aligned box enclosing each object
+   *        (at its position, with its transformation) is kept in a dynamic
+   *        AABB tree. The boxes are stored in the tree somewhat enlarged, so
+   *        that objects moving by small amounts do not need to be reinserted.
+   *        Only the candidate pairs found this way need to be checked with
+   *        the bounding box sets of the objects (narrow phase).
+   */
+  class CollisionWorld {
+
+  private:
+
+    struct AABB {
+      float min[3] = { 0.0f, 0.0f, 0.0f };
+      float max[3] = { 0.0f, 0.0f, 0.0f };
+    };
+
+    struct Node {
+      AABB box;
+      int32_t parent = -1;
+      int32_t child1 = -1;
+      int32_t child2 = -1;
+      // 0 for leaves, -1 for nodes that are not in use
+      int32_t height = -1;
+      int32_t proxy = -1;
+    };
+
+    struct Proxy {
+      SceneObject* object = nullptr;
+      int32_t leaf = -1;
+      // The object's current box, not enlarged
+      AABB box;
+      // Centre and half size of the box enclosing the bounding
+      // box set of the object, before it is positioned
+      Vec3 localCentre;
+      Vec3 localHalfSize;
+      // Where the object was on the previous findSweptCollisions call,
+      // and the box it has covered since (see updateProxies)
+      Vec3 sweepStart;
+      AABB sweptBox;
+    };
+
+    std::vector<Node> nodes;
+    int32_t root = -1;
+    int32_t freeNode = -1;
+
+    std::vector<Proxy> proxies;
+    std::vector<uint32_t> freeProxies;
+
+    std::vector<std::pair<int32_t, int32_t>> pairStack;
+    std::vector<std::pair<int32_t, int32_t>> proxyPairs;
+    std::vector<std::pair<SceneObject*, SceneObject*>> candidatePairs;
+    std::vector<std::pair<SceneObject*, SceneObject*>> collisions;
+
+    void updateProxies(bool swept);
+    void findProxyPairs(bool swept);
+    int32_t allocateNode();
+    void freeNodeAt(int32_t node);
+    void insertLeaf(int32_t leaf);
+    void removeLeaf(int32_t leaf);
+    int32_t balance(int32_t node);
+    AABB calculateBox(const Proxy& proxy) const;
+    void enlargeBox(int32_t leaf, const AABB& box, const AABB& previousBox);
+    int32_t buildNode(std::vector<Node>& leaves, size_t begin, size_t end, int32_t parent);
+
+  public:
+
+    /**
+     * @brief A ray to cast, with a direction that does not need to be
+     *        normalised, looking for hits up to maxDistance from its origin
+     */
+    struct Ray {
+      Vec3 origin;
+      Vec3 direction;
+      float maxDistance = std::numeric_limits<float>::max();
+    };
+
+    /**
+     * @brief What a ray has hit first (object is nullptr if the ray has
+     *        not hit anything)
+     */
+    struct RaycastHit {
+      SceneObject* object = nullptr;
+      float distance = 0.0f;
+      Vec3 point;
+    };
+
+    /**
+     * @brief Two objects that have touched while moving, and the fraction
+     *        of their motion (0 - 1) after which they first touched
+     */
+    struct SweptCollision {
+      SceneObject* first = nullptr;
+      SceneObject* second = nullptr;
+      float timeOfImpact = 0.0f;
+    };
+
+  private:
+
+    std::vector<SweptCollision> sweptCollisions;
+
+    RaycastHit castRay(const Ray& ray, std::vector<int32_t>& stack) const;
+
+  public:
+
+    /**
+     * @brief How much the boxes stored in the tree are enlarged in each
+     *        direction (they are also extended in the direction moving
+     *        objects are going). Larger values mean fewer reinsertions of
+     *        moving objects, but a slower search for overlapping boxes.
+     */
+    float margin = 0.1f;
+
+    /**
+     * @brief Add an object. The object is not copied, so it must not be
+     *        destroyed or moved in memory before it is removed from the world.
+     * @param object The object
+     * @return The id of the object in the world, used to remove it
+     */
+    uint32_t add(SceneObject& object);
+
+    /**
+     * @brief Remove an object
+     * @param id The id returned when the object was added
+     */
+    void remove(uint32_t id);
+
+    /**
+     * @brief Get the number of objects in the world
+     * @return The number of objects
+     */
+    size_t getNumObjects() const;
+
+    /**
+     * @brief Update the tree with the current position and transformation
+     *        of each object. Only objects that have moved out of their
+     *        enlarged boxes are reinserted. This is also done by
+     *        findCandidatePairs, so it does not need to be called separately.
+     */
+    void update();
+
+    /**
+     * @brief Find the pairs of objects whose boxes overlap, after
+     *        updating the tree.
+     * @return The candidate pairs (valid until the next call)
+     */
+    const std::vector<std::pair<SceneObject*, SceneObject*>>& findCandidatePairs();
+
+    /**
+     * @brief Find the pairs of objects that collide, checking each
+     *        candidate pair with SceneObject::intersects.
+     * @return The colliding pairs (valid until the next call)
+     */
+    const std::vector<std::pair<SceneObject*, SceneObject*>>& findCollisions();
+
+    /**
+     * @brief Find the pairs of objects that have touched while moving in a
+     *        straight line from where they were on the previous call of this
+     *        function (or where they were added) to where they are now. Fast
+     *        objects (like projectiles) moving past others from one call to
+     *        the next are detected this way. The rotations of the objects
+     *        are taken to be their current ones throughout their motion.
+     * @return The pairs of objects that have touched and when they first
+     *         did (valid until the next call)
+     */
+    const std::vector<SweptCollision>& findSweptCollisions();
+
+    /**
+     * @brief Find the object whose bounding boxes a ray hits first, after
+     *        updating the tree (for picking, line of sight checks, etc).
+     * @param origin      The origin of the ray
+     * @param direction   The direction of the ray
+     * @param maxDistance How far from the origin to look for a hit
+     * @return The object hit, the distance from the origin and the point
+     *         at which it has been hit
+     */
+    RaycastHit raycast(const Vec3& origin, const Vec3& direction,
+      float maxDistance = std::numeric_limits<float>::max());
+
+    /**
+     * @brief Cast many rays at once, updating the tree only once. The rays
+     *        are divided among the threads of the ThreadPool, if there
+     *        are enough of them.
+     * @param rays The rays
+     * @param hits Set to what each ray has hit first, in the same order
+     */
+    void raycast(const std::vector<Ray>& rays, std::vector<RaycastHit>& hits);
+
+    /**
+     * @brief Rebuild the tree from scratch, splitting the objects in half
+     *        recursively. Inserting objects one by one produces a worse tree
+     *        than this, so it is worth calling after adding many objects.
+     */
+    void rebuild();
+
+    /**
+     * @brief Get the height of the tree (for diagnostics)
+     * @return The height of the tree, 0 if it is empty
+     */
+    int32_t getTreeHeight() const;
+
+  };
+}
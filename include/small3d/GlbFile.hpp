@@ -11,13 +11,15 @@
 
 #include <fstream>
 #include <string>
-#include <stack>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <memory>
 #include <cstring>
 #include "Math.hpp"
 #include "Model.hpp"
 #include "File.hpp"
+#include "MappedFile.hpp"
 
 namespace small3d {
 
@@ -31,13 +33,19 @@ namespace small3d {
 
   private:
 
-    enum class ValueType { number = 0, charstring, character, MARKER };
-
-    struct Token {
-      ValueType valueType = ValueType::charstring;
-      std::string value;
-      std::shared_ptr<Token> next;
-      std::string name;
+    enum class ValueType { number = 0, charstring, boolean, null, object, array };
+
+    // A value of the parsed json. All values are stored in a single vector
+    // (jsonValues), the root being the first one. The text of names, strings
+    // and numbers is not copied but points into the json text.
+    // The indexes of the values contained in an object or array are stored
+    // consecutively in jsonChildren, starting at firstChild.
+    struct JsonValue {
+      ValueType valueType = ValueType::null;
+      std::string_view name;
+      std::string_view value;
+      uint32_t firstChild = 0;
+      uint32_t numChildren = 0;
     };
 
     struct Node {
@@ -83,68 +91,117 @@ namespace small3d {
       std::vector<AnimationSampler> samplers;
     };
 
+    // A part of the binary buffer, read in place (not copied)
+    struct BufferView {
+      const char* data = nullptr;
+      size_t size = 0;
+    };
+
+    // The elements of an accessor, read in place from the binary buffer.
+    // Elements can be interleaved with other data (stride larger than
+    // their size).
+    struct AccessorView {
+      const char* data = nullptr;
+      size_t count = 0;
+      uint32_t numComponents = 1;
+      int componentType = 0;
+      size_t stride = 0;
+    };
+
     const uint32_t CHUNK_TYPE_JSON = 0x4E4F534A;
     const uint32_t CHUNK_TYPE_BIN = 0x004E4942;
 
-    std::shared_ptr<Token> jsonRootToken;
-    std::vector<char> binBuffer;
+    // The file stays mapped in memory while the GlbFile exists. The json
+    // and the binary chunk are read in place, without being copied.
+    std::unique_ptr<MappedFile> mappedFile;
+    std::string_view json;
+    const char* binData = nullptr;
+    size_t binSize = 0;
+
+    void readChunks(const char* data, size_t size);
+
+    std::vector<JsonValue> jsonValues;
+    std::vector<uint32_t> jsonChildren;
+
+    // Built once after parsing, so that the scene graph can be
+    // navigated without searching all nodes (-1 where there is none)
+    std::vector<int32_t> parentNodes;
+    std::vector<int32_t> meshNodes;
+    std::unordered_map<std::string_view, uint32_t> namedNodes;
 
-    // The result of parsing json is a series of token queues,
-    // each queue being one of the found maps or lists. Some
-    // of the nodes in the queues are references to other
-    // queues.
-    std::vector<std::shared_ptr<Token>> token_queues;
+    // The nodes, skins and animations, read once after parsing and shared
+    // by all the meshes loaded from the file
+    std::vector<Node> nodes;
+    std::vector<Skin> skins;
+    std::vector<Animation> animations;
 
-    std::shared_ptr<Token> getToken(const std::string&, size_t);
-    void printTokensRecursive(std::shared_ptr<Token>);
-    void lexJson(const std::vector<char>&, uint32_t);
-    std::shared_ptr<Token> createToken(ValueType, const std::string&);
-    void parseJson(std::shared_ptr<Token>);
-    std::vector<std::shared_ptr<Token>> getTokens(uint32_t);
+    void parseJson();
+    uint32_t parseJsonValue(size_t& pos, std::vector<uint32_t>& childStack, uint32_t depth);
+    void indexNodes();
+    void resolveScene();
+    Node readNode(const uint32_t index) const;
+    Skin readSkin(const uint32_t index) const;
+    Animation readAnimation(const uint32_t index) const;
 
-    void printToken(const std::shared_ptr<Token>& token);
+    void printJsonValue(const JsonValue& jsonValue, bool recursive);
 
-    std::shared_ptr<Token> getToken(const std::string& name);
+    // Get a member of the root json object (nullptr if it does not exist)
+    const JsonValue* getJsonValue(const char* name) const;
 
-    std::vector<std::shared_ptr<Token>> getChildTokens(const std::shared_ptr<Token>& token);
+    // Get a member of a json object (nullptr if it does not exist)
+    const JsonValue* getChildJsonValue(const JsonValue& jsonValue, const char* name) const;
 
-    std::shared_ptr<Token> getChildToken(const std::shared_ptr<GlbFile::Token>& token, const std::string& name);
+    // Get an element of a json array (or object)
+    const JsonValue& getJsonElement(const JsonValue& jsonValue, size_t index) const;
 
-    std::vector<char> getBufferByView(const size_t index);
+    // Get an element of an array that is a member of the root json object,
+    // or the number of its elements (0 if the array does not exist)
+    const JsonValue& getJsonElement(const char* arrayName, size_t index) const;
+    size_t getNumJsonElements(const char* arrayName) const;
 
-    std::vector<char> getBufferByAccessor(const size_t index, int& componentType);
+    static std::string toString(const JsonValue* jsonValue);
+    static uint32_t toUint(const JsonValue* jsonValue);
+    static float toFloat(const JsonValue* jsonValue);
 
-    std::vector<char> getBufferByAccessor(const size_t index);
+    BufferView getBufferView(const size_t index);
+
+    AccessorView getAccessorView(const size_t index);
+
+    // Read the elements of an accessor into destination, converting each
+    // component to T. Each element is written destinationStride Ts after
+    // the previous one.
+    template <typename T>
+    static void readAccessor(const AccessorView& accessor, T* destination, size_t destinationStride);
 
     bool existNode(const uint32_t index);
 
-    Node getNode(const uint32_t index);
+    const Node& getNode(const uint32_t index);
 
     bool existNode(const std::string& name);
 
-    Node getNode(const std::string& name);
+    const Node& getNode(const std::string& name);
 
     bool existParentNode(const uint32_t index);
 
-    Node getParentNode(const uint32_t index);
+    const Node& getParentNode(const uint32_t index);
 
     bool existNodeForMesh(const uint32_t meshIndex);
 
-    Node getNodeForMesh(const uint32_t meshIndex);
+    const Node& getNodeForMesh(const uint32_t meshIndex);
 
     bool existSkin(const uint32_t index);
 
-    Skin getSkin(const uint32_t index);
+    const Skin& getSkin(const uint32_t index);
 
     bool existSkin(const std::string& name);
 
-    Skin getSkin(const std::string& name);
+    const Skin& getSkin(const std::string& name);
 
     bool existAnimation(const uint32_t index);
 
-    Animation getAnimation(const uint32_t index);
+    const Animation& getAnimation(const uint32_t index);
 
-    Animation getAnimation(const std::string& name);
+    const Animation& getAnimation(const std::string& name);
 
     GlbFile(); // No default constructor
 
@@ -163,14 +220,24 @@ namespace small3d {
     explicit GlbFile(const std::string& fileLocation);
 
     /**
-     * @brief Recursively print all tokens, starting from the head
-     * of the first token queue, dereferencing queue references.
+     * @brief Constructor, for GLB data that is already in memory (e.g. an
+     *        entry of a Pack). The data is not copied, so it must remain
+     *        available for as long as the GlbFile exists.
+     * @param name The name of the data (used in messages)
+     * @param data The GLB data
+     * @param size The size of the data, in bytes
+     */
+    GlbFile(const std::string& name, const char* data, size_t size);
+
+    /**
+     * @brief Recursively print the whole json content of the file.
      */
     void printTokensRecursive();
 
     /**
-     * @brief Print tokens as found in the token queues, without
-     * dereferencing queue references.
+     * @brief Print the json content of the file one object or array per
+     * line, showing only the position of the objects and arrays each one
+     * contains.
      */
     void printTokensSerial();
 
@@ -182,6 +249,17 @@ namespace small3d {
      */
     void load(Model& model, const std::string& meshName = "") override;
 
+    /**
+     * @brief Load several meshes from the file at once, dividing them among
+     *        the threads of the ThreadPool. The file is parsed and its nodes,
+     *        skins and animations are resolved only once, for all meshes.
+     *        If a mesh cannot be loaded, the exception thrown names it.
+     * @param meshNames The names of the meshes to load (all the meshes of
+     *                  the file if empty)
+     * @return The Models, in the order of meshNames (or getMeshNames())
+     */
+    std::vector<Model> loadMeshes(const std::vector<std::string>& meshNames = {});
+
     /**
      * @brief Get a list of the names of the meshes contained in the
      *        file.
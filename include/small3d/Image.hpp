@@ -18,6 +18,8 @@
 
 namespace small3d {
 
+  class Pack;
+
   /**
    * @class Image
    *
@@ -69,6 +71,14 @@ namespace small3d {
      */
     explicit Image(std::vector<char>& data);
 
+    /**
+     * @brief Constructor, loading a png image packed in a Pack
+     *
+     * @param pack      The pack
+     * @param entryName The name of the image in the pack
+     */
+    Image(const Pack& pack, const std::string& entryName);
+
     /**
      * @brief Destructor
      */
@@ -0,0 +1,74 @@
+/**
+ *  @file  MappedFile.hpp
+ *  @brief Read-only access to the contents of a file, mapped in memory
+ *
+ *  Created on: 2026/10/18
+ *      Author: Dimitri Kourkoulis
+ *     License: BSD 3-Clause License (see LICENSE file)
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace small3d {
+
+  /**
+   * @class MappedFile
+   * @brief The contents of a file, mapped in memory on Linux (and Android),
+   *        so that they are read in place from the page cache rather than
+   *        copied into the process. On other platforms the file is read
+   *        into memory instead. The contents stay available for as long
+   *        as the MappedFile exists.
+   */
+  class MappedFile {
+
+  private:
+
+    const char* mappedData = nullptr;
+    size_t mappedSize = 0;
+
+    // Used where mapping is not supported
+    std::vector<char> readData;
+
+    MappedFile(); // No default constructor
+
+    // Forbid moving and copying
+    MappedFile(MappedFile const&) = delete;
+    void operator=(MappedFile const&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    void operator=(MappedFile&&) = delete;
+
+  public:
+
+    /**
+     * @brief Constructor (throws if the file cannot be opened)
+     * @param path       The full path of the file
+     * @param sequential Whether the contents will be read from start to end
+     *                   once (e.g. decompressed), rather than accessed in
+     *                   any order. This is passed on to the kernel as advice.
+     */
+    MappedFile(const std::string& path, bool sequential);
+
+    /**
+     * @brief Destructor (unmaps the file)
+     */
+    ~MappedFile();
+
+    /**
+     * @brief Get the contents of the file
+     * @return Pointer to the first byte of the file
+     */
+    const char* data() const;
+
+    /**
+     * @brief Get the size of the file
+     * @return The size in bytes
+     */
+    size_t size() const;
+
+  };
+}
@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include <cstddef>
+
 namespace small3d {
 
   struct Vec4;
@@ -147,7 +149,7 @@ namespace small3d {
     float w;
 
     Mat4 toMatrix() const;
-    Quat operator*(const Quat& other);
+    Quat operator*(const Quat& other) const;
     template <class Archive>
     void serialize(Archive& archive) {
       archive(w, x, y, z);
@@ -174,6 +176,98 @@ namespace small3d {
 
   float length(const Vec3& vec);
 
+  Vec3 lerp(const Vec3& vec1, const Vec3& vec2, float t);
+
+  Quat slerp(const Quat& quat1, const Quat& quat2, float t);
+
+  /**
+   * @brief Transform a number of points by the same matrix, in one call.
+   *        The coordinates are given as separate arrays of x, y and z
+   *        values (structure of arrays) and w is taken to be 1. The
+   *        results are the same as those of Mat4 * Vec4.
+   * @param mat   The transformation matrix
+   * @param inX   The x coordinates of the points
+   * @param inY   The y coordinates of the points
+   * @param inZ   The z coordinates of the points
+   * @param outX  The x coordinates of the transformed points (can be inX)
+   * @param outY  The y coordinates of the transformed points (can be inY)
+   * @param outZ  The z coordinates of the transformed points (can be inZ)
+   * @param count The number of points
+   * @param multithreaded Split large batches among the threads of the
+   *                      ThreadPool
+   */
+  void transformPoints(const Mat4& mat, const float* inX, const float* inY,
+    const float* inZ, float* outX, float* outY, float* outZ, size_t count,
+    bool multithreaded = false);
+
+  /**
+   * @brief Transform a number of 4 component vectors, stored one after the
+   *        other (x, y, z, w, x, y, z, w, ...), like the vertex data of a
+   *        Model, by the same matrix, in one call.
+   * @param mat   The transformation matrix
+   * @param in    The vectors (4 * count floats)
+   * @param out   The transformed vectors (4 * count floats, can be in)
+   * @param count The number of vectors
+   * @param multithreaded Split large batches among the threads of the
+   *                      ThreadPool
+   */
+  void transformPoints(const Mat4& mat, const float* in, float* out, size_t count,
+    bool multithreaded = false);
+
+  /**
+   * @brief Multiply two arrays of matrices, element by element
+   *        (out[i] = mats1[i] * mats2[i]).
+   * @param mats1 The matrices on the left side of the multiplications
+   * @param mats2 The matrices on the right side of the multiplications
+   * @param out   The products (can be mats1 or mats2)
+   * @param count The number of matrices in each array
+   * @param multithreaded Split large batches among the threads of the
+   *                      ThreadPool
+   */
+  void multiplyMatrices(const Mat4* mats1, const Mat4* mats2, Mat4* out, size_t count,
+    bool multithreaded = false);
+
+  /**
+   * @brief Compose translation * rotation * scale matrices, without
+   *        multiplying full matrices. The results are the same as those of
+   *        translate(Mat4(1.0f), t) * r.toMatrix() * scale(Mat4(1.0f), s).
+   * @param translations The translations
+   * @param rotations    The rotations
+   * @param scales       The scales
+   * @param out          The composed matrices
+   * @param count        The number of matrices to compose
+   * @param multithreaded Split large batches among the threads of the
+   *                      ThreadPool
+   */
+  void composeTRS(const Vec3* translations, const Quat* rotations,
+    const Vec3* scales, Mat4* out, size_t count, bool multithreaded = false);
+
+  /**
+   * @brief Scalar implementations of the matrix operations that use SIMD
+   *        instructions (SSE on x86, NEON on ARM) where these are available.
+   *        They are used instead on other platforms, or if SMALL3D_NO_SIMD
+   *        is defined, and both produce the same results.
+   */
+  namespace scalar {
+
+    Mat4 multiply(const Mat4& mat1, const Mat4& mat2);
+
+    Vec4 multiply(const Mat4& mat, const Vec4& vec);
+
+    Mat4 toMatrix(const Quat& quat);
+
+    Mat4 rotate(const Mat4& mat, const float angle, const Vec3& vec);
+
+    Mat4 inverse(const Mat4& mat);
+
+  }
+
+  /**
+   * @brief Get the SIMD instruction set used by the matrix operations
+   * @return "SSE", "NEON" or "none"
+   */
+  const char* simdInstructionSet();
+
   float* Value_ptr(Mat4& mat);
 
   float* Value_ptr(Vec3& vec);
@@ -10,6 +10,7 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include "Math.hpp"
 #include "Image.hpp"
 #include "File.hpp"
@@ -23,6 +24,8 @@ namespace glm {
 
 namespace small3d {
 
+  class BoundingBoxSet;
+
   /**
    * @class	Model
    *
@@ -41,6 +44,39 @@ namespace small3d {
     uint32_t uvBufferObjectId = 0;
     uint32_t jointBufferObjectId = 0;
     uint32_t weightBufferObjectId = 0;
+    uint32_t vertexArrayObjectId = 0;
+
+    // Identifies the version of the model's data. It is taken from a
+    // counter shared by all models when the model is created and whenever
+    // its data is marked as changed, so a model and its copies have the
+    // same generation until one of them is changed.
+    uint64_t dataGeneration = nextDataGeneration();
+
+    // The data generation last sent to the GPU (0 if the data is not
+    // on the GPU)
+    uint64_t gpuGeneration = 0;
+
+    // Layout of the packed vertex data (offsets in bytes, 0 for
+    // attributes that are not included)
+    uint32_t packedVertexStride = 0;
+    uint32_t packedUVOffset = 0;
+    uint32_t packedJointOffset = 0;
+    uint32_t packedWeightOffset = 0;
+
+    // Bounds of the vertex data in model space (before any transformation)
+    // and the data generation they were calculated for (0 if they have not
+    // been calculated)
+    Vec3 boundsMin = Vec3(0.0f, 0.0f, 0.0f);
+    Vec3 boundsMax = Vec3(0.0f, 0.0f, 0.0f);
+    float boundsRadius = 0.0f;
+    uint64_t boundsGeneration = 0;
+
+    // Bounding box sets loaded with the model (see BinaryFile). The cache
+    // of bounding box sets does not keep them (see BoundingBoxSet::getCached),
+    // so they are kept here for as long as the model exists.
+    std::vector<std::shared_ptr<BoundingBoxSet>> loadedBoundingBoxSets;
+
+    static uint64_t nextDataGeneration();
 
     uint32_t currentAnimation = 0;
     std::vector<uint64_t> numPoses;
@@ -59,6 +95,33 @@ namespace small3d {
     // brief Original scale, as read from a file
     Vec3 origScale = Vec3(1.0f, 1.0f, 1.0f);
 
+    // Index of the parent of each joint in the joints vector
+    // (-1 for joints without a parent joint)
+    std::vector<int32_t> jointParents;
+
+    // Joint indexes, ordered so that each parent comes before
+    // its children
+    std::vector<size_t> jointOrder;
+
+    // The inverse bind matrices of the joints that fit in a palette,
+    // gathered so that the palette can be multiplied in one call
+    std::vector<Mat4> inverseBindMatrices;
+
+    // Final joint transformations (joint transform * inverse bind matrix),
+    // MAX_JOINTS_SUPPORTED per entry, keyed by animation and pose
+    std::unordered_map<uint64_t, std::vector<Mat4>> jointPalettes;
+
+    void resolveJointHierarchy();
+
+    float getJointSeconds(size_t joint, uint32_t animationIdx, uint64_t currentPose);
+
+    Mat4 getJointLocalTransform(size_t joint, uint32_t animationIdx, uint64_t currentPose, float seconds);
+
+    // Joint transformations sampled at a given moment of an animation
+    // (not cached, reused to avoid allocating on every sampling)
+    std::vector<Mat4> sampledJointPalette;
+    std::vector<Mat4> sampledJointTransforms;
+
 
   public:
 
@@ -152,7 +215,15 @@ namespace small3d {
     std::vector<uint16_t> indexData;
 
     /**
-     * @brief Size of the index data, in bytes
+     * @brief The index data, in 32 bits. This is used instead of indexData
+     *        (which is then empty) for models with more vertices than can be
+     *        indexed in 16 bits.
+     */
+    std::vector<uint32_t> indexData32;
+
+    /**
+     * @brief Size of the index data (indexData or indexData32, whichever is
+     *        used), in bytes
      */
     uint32_t indexDataByteSize = 0;
 
@@ -204,6 +275,18 @@ namespace small3d {
      */
     uint32_t weightDataByteSize = 0;
 
+    /**
+     * @brief The vertex data above, interleaved in a compact form, as it is
+     *        sent to the GPU (in a single buffer). For each vertex it contains
+     *        the position (3 floats), the normal (3 snorm16 values and 2 bytes
+     *        of padding), the texture coordinates (2 unorm16 values), if there
+     *        are any, and the joints (4 uint8 values) and weights (4 unorm8
+     *        values), if there are any. It is produced by packVertexData()
+     *        and, if it is empty, the separate arrays are sent to the GPU
+     *        instead.
+     */
+    std::vector<uint8_t> packedVertexData;
+
     /**
      * @brief The model's joints
      */
@@ -286,6 +369,144 @@ namespace small3d {
      */
     Mat4 getJointTransform(size_t jointIdx, uint32_t animationIdx, uint64_t currentPose, float seconds = 0.0f);
 
+    /**
+     * @brief Get the final transformations of all the joints (each joint transform
+     *        multiplied by the joint's inverse bind matrix), as they are sent to
+     *        the shader. They are calculated the first time they are requested for
+     *        a given animation and pose and then cached.
+     *  @param animationIdx The index of the animation to use
+     *  @param currentPose The pose of the animation to get the transformations for
+     *  @return Array of MAX_JOINTS_SUPPORTED transformations (the ones beyond the
+     *          number of joints are zero matrices)
+     */
+    const Mat4* getJointPalette(uint32_t animationIdx, uint64_t currentPose);
+
+    /**
+     * @brief Clear the cached joint transformations and joint hierarchy. Call this
+     *        if the joints or their animations are modified after the Model has
+     *        been rendered.
+     */
+    void clearJointPaletteCache();
+
+    /**
+     * @brief Get the duration of an animation
+     * @param animationIdx The index of the animation
+     * @return The time of the last keyframe of the animation, in seconds
+     */
+    float getAnimationDuration(uint32_t animationIdx);
+
+    /**
+     * @brief Get a transform of the model at a moment of an animation,
+     *        interpolating between the keyframes found before and after
+     *        that moment.
+     *  @param animationIdx The index of the animation to use
+     *  @param seconds The animation moment (in seconds)
+     *  @return The transform
+     */
+    Mat4 getTransformAt(uint32_t animationIdx, float seconds);
+
+    /**
+     * @brief Get the final transformations of all the joints at a moment of an
+     *        animation, interpolating between the keyframes found before and
+     *        after that moment. The result is overwritten on the next call.
+     *  @param animationIdx The index of the animation to use
+     *  @param seconds The animation moment (in seconds)
+     *  @return Array of MAX_JOINTS_SUPPORTED transformations (the ones beyond the
+     *          number of joints are zero matrices)
+     */
+    const Mat4* getJointPaletteAt(uint32_t animationIdx, float seconds);
+
+    /**
+     * @brief Indicate that the vertex, index, normals, texture coordinates,
+     *        joint or weight data of the model have been modified, so that
+     *        they are sent to the GPU again the next time the model is
+     *        rendered. The cached joint transformations are cleared too
+     *        (see clearJointPaletteCache).
+     */
+    void markDataChanged();
+
+    /**
+     * @brief Set the index data, storing it in 16 bits (indexData) if all
+     *        indices fit, or in 32 bits (indexData32) otherwise.
+     * @param indices The indices
+     */
+    void setIndexData(const std::vector<uint32_t>& indices);
+
+    /**
+     * @brief Get the number of indices of the model (in indexData or
+     *        indexData32, whichever is used)
+     * @return The number of indices
+     */
+    size_t getNumIndices() const;
+
+    /**
+     * @brief Split the model into meshlets, each one referencing at most
+     *        maxVertices vertices, so that they can all be indexed in 16
+     *        bits. The triangles are kept in their original order and the
+     *        vertices of each meshlet are ordered by first use, so that
+     *        consecutive triangles read nearby vertices. Each meshlet keeps
+     *        the joints, animations, material and transformations of the
+     *        model.
+     * @param maxVertices The maximum number of vertices per meshlet
+     *                    (at least 3 and at most 65536)
+     * @return The meshlets
+     */
+    std::vector<Model> splitIntoMeshlets(uint32_t maxVertices = 65536) const;
+
+    /**
+     * @brief Produce the packedVertexData from the vertex, normals, texture
+     *        coordinates, joint and weight data. The model loaders call this
+     *        after loading a model. It only needs to be called for models
+     *        constructed procedurally, if packed data is desired for them.
+     * @return True if the data was packed, False if it cannot be represented
+     *         in the packed form (e.g. texture coordinates outside [0, 1]),
+     *         in which case packedVertexData is left empty.
+     */
+    bool packVertexData();
+
+    /**
+     * @brief Get the size of each vertex in the packed vertex data
+     * @return The size in bytes (0 if the data has not been packed)
+     */
+    uint32_t getPackedVertexStride() const;
+
+    /**
+     * @brief Calculate the axis-aligned box and sphere enclosing the vertex
+     *        data. This happens when a model is loaded and, after its data
+     *        has been marked as changed, the next time the bounds are
+     *        requested, so it does not normally need to be called.
+     */
+    void calculateBounds();
+
+    /**
+     * @brief Get the minimum corner of the axis-aligned box enclosing the
+     *        vertex data, in model space (before any transformation)
+     * @return The corner
+     */
+    const Vec3& getBoundsMin();
+
+    /**
+     * @brief Get the maximum corner of the axis-aligned box enclosing the
+     *        vertex data, in model space (before any transformation)
+     * @return The corner
+     */
+    const Vec3& getBoundsMax();
+
+    /**
+     * @brief Get the radius of the sphere enclosing the vertex data, which
+     *        is centred at the centre of the axis-aligned bounding box.
+     *        Animation of joints is not taken into account.
+     * @return The radius
+     */
+    float getBoundingRadius();
+
+    /**
+     * @brief Check if the current data of the model has been sent to the GPU
+     * @return True if the model has been sent to the GPU since the last time
+     *         its data were marked as changed, False otherwise.
+     */
+    bool isInGPU() const;
+
     /**
      * @brief Get the Model's original scale (usually the one read from the file
      *        the Model was loaded from.
@@ -293,11 +514,28 @@ namespace small3d {
     Vec3 getOriginalScale();
 
     /**
-     * @brief Save model data in binary format
-     * @param binaryFilePath Path of file to save binary data to.
+     * @brief The formats in which model data can be saved in binary form
+     *        (see BinaryFile). compressed produces smaller files and mapped
+     *        files that are faster to load.
      */
-    void saveBinary(const std::string& binaryFilePath);
+    enum class BinaryFormat { compressed = 0, mapped };
 
+    /**
+     * @brief Save model data in binary format
+     * @param binaryFilePath Path of file to save binary data to.
+     * @param boundingBoxSubdivisions The subdivisions to also save bounding box
+     *                                sets for, so that they do not need to be
+     *                                created when SceneObjects are created from
+     *                                the loaded model (none by default).
+     * @param format The format to save the data in
+     */
+    void saveBinary(const std::string& binaryFilePath,
+      const std::vector<uint32_t>& boundingBoxSubdivisions = std::vector<uint32_t>(),
+      BinaryFormat format = BinaryFormat::compressed);
+
+    // The layout is that of the binary files saved before their format was
+    // versioned, so that they can still be read. Data added since, like
+    // the 32-bit indices, is stored after it (see BinaryFile).
     template <class Archive>
     void serialize(Archive& archive) {
       archive(currentAnimation,
@@ -327,7 +565,17 @@ namespace small3d {
     }
 
     friend class GlbFile;
+    friend class BinaryFile;
     friend class Renderer;
+    friend class SceneObject;
+    friend class BoundingBoxSet;
+
+  private:
+
+    // Apply the translation, rotation and scale found in the animation
+    // components at the given moment, interpolating between keyframes
+    static void sampleAnimation(const std::vector<AnimationComponent>& animationComponents,
+      float seconds, Mat4& translation, Mat4& rotation, Mat4& scale);
    
   };
 }
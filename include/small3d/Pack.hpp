@@ -0,0 +1,131 @@
+/**
+ *  @file  Pack.hpp
+ *  @brief A bundle of asset files, packed in a single file
+ *
+ *  Created on: 2026/10/18
+ *      Author: Dimitri Kourkoulis
+ *     License: BSD 3-Clause License (see LICENSE file)
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "MappedFile.hpp"
+
+namespace small3d {
+
+  /**
+   * @class Pack
+   * @brief Many asset files (models, images, sounds), packed in one file, so
+   *        that they can be loaded without opening each one of them
+   *        separately. The pack is mapped in memory once (see MappedFile) and
+   *        each file in it (entry) is found through a hash table, by the
+   *        path it had relative to the directory the pack was created from
+   *        (e.g. "models/goat.glb"). Entries are compressed with zlib,
+   *        unless that does not make them significantly smaller (e.g. png
+   *        images and ogg sounds, which are already compressed), in which
+   *        case they are stored as they are and can be read in place.
+   *        Packs are created with Pack::create or with the format converter
+   *        program, s3dfc, for example by running
+   *        s3dfc --pack assets assets.pak
+   *        Models are loaded from packs with PackFile, images and sounds
+   *        with the Image and Sound constructors that take a Pack.
+   */
+  class Pack {
+
+  private:
+
+    struct Entry {
+      uint64_t hash = 0;
+      uint64_t offset = 0;
+      uint64_t storedSize = 0;
+      uint64_t size = 0;
+      uint32_t nameOffset = 0;
+      uint32_t nameLength = 0;
+      uint32_t compressed = 0;
+      uint32_t reserved = 0;
+    };
+
+    std::unique_ptr<MappedFile> mappedFile;
+    std::string fullPath;
+
+    const Entry* entries = nullptr;
+    uint32_t numEntries = 0;
+    const uint32_t* buckets = nullptr;
+    uint32_t numBuckets = 0;
+    const char* names = nullptr;
+
+    const Entry* findEntry(std::string_view name) const;
+    static uint64_t hashName(std::string_view name);
+
+    Pack(); // No default constructor
+
+    // Forbid moving and copying
+    Pack(Pack const&) = delete;
+    void operator=(Pack const&) = delete;
+    Pack(Pack&&) = delete;
+    void operator=(Pack&&) = delete;
+
+  public:
+
+    /**
+     * @brief Constructor (throws if the pack cannot be opened or read)
+     * @param fileLocation Path to the pack file
+     */
+    explicit Pack(const std::string& fileLocation);
+
+    /**
+     * @brief Check if the pack contains an entry
+     * @param name The name of the entry
+     * @return True if the entry exists, False otherwise
+     */
+    bool contains(const std::string& name) const;
+
+    /**
+     * @brief Get the names of all the entries in the pack
+     * @return The names of the entries
+     */
+    std::vector<std::string> getEntryNames() const;
+
+    /**
+     * @brief Get the contents of an entry (throws if it does not exist).
+     *        Entries stored uncompressed are returned in place, in the
+     *        mapped pack, so nothing is copied. Compressed entries are
+     *        decompressed into the buffer provided.
+     * @param name   The name of the entry
+     * @param buffer Where compressed entries are decompressed to
+     * @return The contents, valid for as long as both the pack and the
+     *         buffer exist (and the buffer is not modified)
+     */
+    std::string_view getEntry(const std::string& name, std::vector<char>& buffer) const;
+
+    /**
+     * @brief Get a copy of the contents of an entry (throws if it does
+     *        not exist).
+     * @param name The name of the entry
+     * @return The contents
+     */
+    std::vector<char> read(const std::string& name) const;
+
+    /**
+     * @brief Create a pack from all the files in a directory and its
+     *        subdirectories
+     * @param directory The directory
+     * @param packPath  The path of the pack file to create
+     * @return The number of files packed
+     */
+    static uint32_t create(const std::string& directory, const std::string& packPath);
+
+    /**
+     * @brief The version of the pack format written by this version of
+     *        small3d. Packs of later versions cannot be read.
+     */
+    static const uint32_t FORMAT_VERSION = 1;
+
+  };
+}
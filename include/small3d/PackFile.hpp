@@ -0,0 +1,69 @@
+/**
+ * @file  PackFile.hpp
+ * @brief Loader of models packed in a Pack
+ *
+ *  Created on: 2026/10/18
+ *      Author: Dimitri Kourkoulis
+ *     License: BSD 3-Clause License (see LICENSE file)
+ */
+
+#pragma once
+#include <vector>
+#include <memory>
+#include "File.hpp"
+#include "Pack.hpp"
+
+namespace small3d {
+
+  /**
+   * @class PackFile
+   * @brief Loads models from an entry of a Pack, which can be a gltf (.glb)
+   *        file or a native binary model file (see BinaryFile), for example
+   *        Model goat(PackFile(pack, "models/goat.glb"), "Cube");
+   *        The entry is read in place if it is stored uncompressed in the
+   *        pack, otherwise it is decompressed once, when the PackFile is
+   *        constructed.
+   */
+  class PackFile : public File {
+
+  private:
+
+    // Where the entry is decompressed to, if it is compressed
+    std::vector<char> buffer;
+
+    // The GlbFile or BinaryFile reading the entry
+    std::unique_ptr<File> file;
+
+    PackFile(); // No default constructor
+
+    // Forbid moving and copying
+    PackFile(PackFile const&) = delete;
+    void operator=(PackFile const&) = delete;
+    PackFile(PackFile&&) = delete;
+    void operator=(PackFile&&) = delete;
+
+  public:
+
+    /**
+     * @brief Constructor. The pack must exist for as long as the PackFile does.
+     * @param pack      The pack
+     * @param entryName The name of the entry in the pack
+     */
+    PackFile(const Pack& pack, const std::string& entryName);
+
+    /**
+     * @brief Load data from the entry into a Model
+     * @param model The model to load the data to
+     * @param meshName The name of the mesh to load
+     */
+    void load(Model& model, const std::string& meshName) override;
+
+    /**
+     * @brief Get a list of the names of the meshes contained in the
+     *        entry.
+     * @return The list of mesh names
+     */
+    std::vector<std::string> getMeshNames() override;
+
+  };
+}
@@ -19,6 +19,10 @@
 #include "Model.hpp"
 #include "SceneObject.hpp"
 #include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <mutex>
+#include <memory>
 #include "Math.hpp"
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -33,14 +37,71 @@ namespace small3d
   class Renderer
   {
 
+  public:
+
+    /**
+     * @brief Numbers of render calls drawn and culled during a frame
+     */
+    struct RenderStatistics {
+      /**
+       * @brief Render calls drawn
+       */
+      uint32_t drawn = 0;
+
+      /**
+       * @brief Render calls not drawn, because they were out of view
+       */
+      uint32_t culled = 0;
+
+      /**
+       * @brief Render calls drawn on the shadow map
+       */
+      uint32_t shadowDrawn = 0;
+
+      /**
+       * @brief Render calls that would produce a shadow, not drawn on the
+       *        shadow map, because they were outside the shadow space
+       */
+      uint32_t shadowCulled = 0;
+    };
+
   private:
 
     Windowing windowing;
 
+    // Locations of the uniforms of a shader program. They are looked up
+    // once, when the program is linked, rather than on every draw.
+    struct UniformLocations {
+      int32_t perspectiveMatrix = -1;
+      int32_t lightDirection = -1;
+      int32_t lightIntensity = -1;
+      int32_t cameraTransformation = -1;
+      int32_t cameraOffset = -1;
+      int32_t lightSpaceMatrix = -1;
+      int32_t orthographicMatrix = -1;
+      int32_t modelTransformation = -1;
+      int32_t jointTransformations = -1;
+      int32_t hasJoints = -1;
+      int32_t modelOffset = -1;
+      int32_t modelColour = -1;
+      int32_t textureImage = -1;
+      int32_t shadowMap = -1;
+    };
+
     uint32_t shaderProgram = 0;
+    UniformLocations shaderUniforms;
+    uint32_t instancedShaderProgram = 0;
+    UniformLocations instancedShaderUniforms;
+
+    // The uniforms that are being set, for the draw currently being
+    // prepared (those of one of the two programs above).
+    const UniformLocations* activeUniforms = &shaderUniforms;
 
     uint32_t vao = 0;
 
+    uint32_t instanceBufferObjectId = 0;
+    std::vector<float> instanceData;
+
     uint32_t renderOrientation = 0;
     uint32_t cameraOrientation = 0;
     uint32_t worldDetails = 0;
@@ -57,6 +118,8 @@ namespace small3d
     Vec4 clearColour = Vec4(0.0f, 0.0f, 0.0f, 1.0f);
 
     std::unordered_map<std::string, uint32_t> textures;
+    // Handles of the textures that have texels which are not fully opaque
+    std::unordered_set<uint32_t> translucentTextures;
 
     FT_Library library = 0;
     std::vector<uint8_t> textMemory;
@@ -71,13 +134,15 @@ namespace small3d
       const uint32_t shaderType) const;
     std::string getProgramInfoLog(const uint32_t linkedProgram) const;
     std::string getShaderInfoLog(const uint32_t shader) const;
+    uint32_t createProgram(const std::string& vertexShaderFile,
+      const std::string& fragmentShaderFile,
+      UniformLocations& uniformLocations) const;
     void initOpenGL();
     void checkForOpenGLErrors(const std::string& when, const bool abort) const;
 
     void transform(Model& model, Vec3& offset,
-      const Mat4& rotation, uint64_t currentPose) const;
+      const Mat4& rotation, uint64_t currentPose, float animationSeconds) const;
 
-    uint32_t getTextureHandle(const std::string& name) const;
     uint32_t generateTexture(const std::string& name, const uint8_t* data,
       const unsigned long width,
       const unsigned long height,
@@ -88,7 +153,9 @@ namespace small3d
 
     void setWorldDetails(bool perspective);
 
-    void bindTexture(const std::string& name);
+    void bindTexture(const uint32_t textureHandle);
+
+    void sendToGPU(Model& model);
 
     void clearScreen() const;
 
@@ -100,9 +167,91 @@ namespace small3d
 
     Renderer();
 
-    std::vector<std::tuple< Model*, Vec3, Mat4, Vec4, std::string, bool, uint64_t>> renderList;
-
-    void renderTuple(std::tuple< Model*, Vec3, Mat4, Vec4, std::string, bool, uint64_t> tuple);
+    // A render call, queued until the buffers are swapped
+    struct RenderRecord {
+      Model* model = nullptr;
+      Vec3 offset;
+      Mat4 rotation;
+      Vec4 colour;
+      // 0 if the model is rendered with a colour rather than a texture
+      uint32_t textureHandle = 0;
+      bool perspective = true;
+      uint64_t currentPose = 0;
+      // If negative, currentPose is used instead
+      float animationSeconds = -1.0f;
+      // Results of culling, for the camera and the shadow map
+      bool inView = true;
+      bool inShadowView = true;
+      // Set if the colour or texture is not fully opaque, so that the
+      // record is blended with what has been drawn before it
+      bool blended = false;
+    };
+
+    // Per frame arena holding the render records. It is reset (not freed)
+    // when the buffers are swapped and grows by objectsPerFrameInc records
+    // whenever it runs out of space, so frames that do not submit more
+    // records than previous ones do not allocate any memory.
+    std::vector<RenderRecord> renderList;
+    size_t renderListSize = 0;
+    uint32_t objectsPerFrameInc = 1000;
+
+    void addRenderRecord(Model& model, const Vec3& position,
+      const Mat4& rotation, const Vec4& colour, const uint32_t textureHandle,
+      const uint64_t currentPose, const bool perspective,
+      const float animationSeconds = -1.0f);
+
+    uint32_t getTextureHandleChecked(const std::string& textureName) const;
+
+    // Sort keys of the render list entries and the order in which the
+    // entries are to be drawn (with temporary space for sorting)
+    std::vector<uint64_t> renderKeys;
+    std::vector<uint64_t> renderKeysTmp;
+    std::vector<uint32_t> renderOrder;
+    std::vector<uint32_t> renderOrderTmp;
+
+    uint32_t blankTextureHandle = 0;
+
+    // GL state set by the draws of the current pass, so that binding it
+    // again can be avoided
+    struct DrawState {
+      const UniformLocations* uniforms = nullptr;
+      uint32_t vao = 0;
+      uint32_t textureHandle = 0;
+      bool worldDetailsSet = false;
+      bool perspective = false;
+    } drawState;
+
+    RenderStatistics renderStatistics;
+
+    // Models and images waiting to be sent to the GPU (see queueUpload).
+    // They can be queued from any thread, so the queue is locked.
+    struct Upload {
+      std::shared_ptr<Model> model;
+      std::string textureName;
+      std::shared_ptr<Image> image;
+    };
+    std::deque<Upload> uploadQueue;
+    mutable std::mutex uploadMutex;
+
+    // Send queued uploads to the GPU, for up to uploadTimeBudget seconds
+    void processUploads();
+
+    Mat4 getProjectionMatrix(bool perspective, bool depthMap) const;
+
+    Mat4 getModelTransformation(Model& model, const Mat4& rotation,
+      uint64_t currentPose, float animationSeconds) const;
+
+    // Determines which records are in view of the camera and of the shadow
+    // map, counting the ones culled
+    void cullRenderList();
+
+    void sortRenderList();
+
+    // If instanceCount is above 0, the record's model is drawn once for each
+    // instance placed in instanceData, using the instanced program.
+    void renderRecord(const RenderRecord& record, const uint32_t instanceCount = 0);
+
+    void drawRenderList();
 
     GLuint depthMapFramebuffer = 0;
     GLuint depthMapTexture = 0;
@@ -164,6 +313,77 @@ namespace small3d
      */
     float shadowSpaceSize = 20.0f;
 
+    /**
+     * @brief If true (default), perspective render calls for the same
+     *        Model, with the same texture and animation pose, that are
+     *        submitted during a frame, are drawn together with a single
+     *        instanced draw call when the buffers are swapped. Perspective
+     *        render calls are drawn sorted by texture and Model rather than
+     *        in the order they were submitted. Those with a colour or texture
+     *        that is not fully opaque are not, since they are blended with
+     *        what has been drawn before them. They are drawn after the other
+     *        perspective render calls, one by one, in the order they were
+     *        submitted. Orthographic render calls are always drawn last, in
+     *        the order they were submitted.
+     */
+    bool instancing = true;
+
+    /**
+     * @brief If true (default), perspective render calls for Models whose
+     *        bounding sphere lies outside the camera's view are not drawn
+     *        when the buffers are swapped. Neither are the ones lying outside
+     *        the shadow space (see shadowSpaceSize) drawn on the shadow map.
+     *        Models with joints are never culled, since their animation can
+     *        move their vertices beyond their bounds.
+     */
+    bool culling = true;
+
+    /**
+     * @brief The time (in seconds) that swapBuffers can spend on each frame
+     *        sending queued models and images to the GPU (see queueUpload).
+     *        At least one queued upload is sent per frame, even if it takes
+     *        longer than that.
+     */
+    double uploadTimeBudget = 0.002;
+
+    /**
+     * @brief Queue a Model to be sent to the GPU during the following
+     *        swapBuffers calls, within uploadTimeBudget, rather than when it
+     *        is first rendered. This can be called from any thread (e.g. one
+     *        that has loaded the model in the background, see AssetManager).
+     *        Models rendered before their turn comes are sent to the GPU
+     *        when they are rendered, as usual. Models that are no longer
+     *        used anywhere else by the time their turn comes are not sent
+     *        at all, since their buffers would never be cleared.
+     * @param model The model
+     */
+    void queueUpload(const std::shared_ptr<Model>& model);
+
+    /**
+     * @brief Queue an Image to be turned into a texture during the following
+     *        swapBuffers calls, within uploadTimeBudget. This can be called
+     *        from any thread. Until then, getTextureHandle returns 0 for the
+     *        texture.
+     * @param textureName The name by which the texture will be known
+     * @param image       The image (kept alive until it has been sent to
+     *                    the GPU)
+     */
+    void queueUpload(const std::string& textureName, const std::shared_ptr<Image>& image);
+
+    /**
+     * @brief Get the number of models and images queued to be sent to the
+     *        GPU that have not been sent yet
+     * @return The number of queued uploads
+     */
+    size_t getNumQueuedUploads() const;
+
+    /**
+     * @brief Get the numbers of render calls drawn and culled during the
+     *        last frame (up to the last swapBuffers call).
+     * @return The numbers
+     */
+    const RenderStatistics& getRenderStatistics() const;
+
     /**
      * @brief Shadow camera transformation.
      */
@@ -252,10 +472,11 @@ namespace small3d
      *                           provided. The shader code can be changed,
      *                           provided that their inputs and outputs are
      *                           maintained the same.
-     * @param objectsPerFrame    Ignored parameter (used for compatibility with
-     *                           Vulkan edition).
-     * @param objectsPerFrameInc Ignored parameter (used for compatibility with
-     *                           Vulkan edition).
+     * @param objectsPerFrame    The number of render calls per frame for which
+     *                           space is reserved at startup.
+     * @param objectsPerFrameInc The number of render calls by which the
+     *                           reserved space grows, whenever more are made
+     *                           in a single frame.
      * @return                   The Renderer object. It can only be assigned to
      *                           a pointer by its address (Renderer *r =
      *                           &Renderer::getInstance(...), since declaring
@@ -285,8 +506,10 @@ namespace small3d
      * @brief Generate a texture on the GPU from the given image
      * @param name The name by which the texture will be known
      * @param image The image from which the texture will be generated
+     * @return      The handle of the texture, which can be used for
+     *              rendering instead of its name
      */
-    void generateTexture(const std::string& name, const Image& image);
+    uint32_t generateTexture(const std::string& name, const Image& image);
 
     /**
      * @brief Generate a texture on the GPU that contains the given text
@@ -298,8 +521,10 @@ namespace small3d
      * @param replace  If true, an exception will be thrown if a texture
      *                 with the same name already exists. Otherwise it will
      *                 be overwritten.
+     * @return         The handle of the texture, which can be used for
+     *                 rendering instead of its name
      */
-    void generateTexture(const std::string& name, const std::string& text,
+    uint32_t generateTexture(const std::string& name, const std::string& text,
       const Vec3& colour,
       const int fontSize = 48,
       const std::string& fontPath =
@@ -308,6 +533,14 @@ namespace small3d
 
       const bool replace = true);
 
+    /**
+     * @brief Get the handle of a texture that has been generated
+     * @param name The name of the texture
+     * @return     The handle of the texture, or 0 if no texture has been
+     *             generated with the given name
+     */
+    uint32_t getTextureHandle(const std::string& name) const;
+
     /**
      * @brief Deletes the texture indicated by the given name.
      *
@@ -394,6 +627,26 @@ namespace small3d
     void render(Model& model, const Vec3& position, const Mat4& rotation,
       const std::string& textureName, const uint64_t currentPose = 0);
 
+    /**
+     * @brief Render a Model, with a texture indicated by its handle. This
+     *        avoids looking up the texture by name on every call.
+     * @param model         The model
+     * @param position      The position of the model (x, y, z)
+     * @param rotation      Rotation transformation matrix
+     * @param textureHandle The handle of the texture to attach to the model,
+     *                      as returned by generateTexture or
+     *                      getTextureHandle.
+     * @param currentPose   The current animation pose
+     * @param perspective   True = perspective drawing, otherwise orthographic
+     *                      If false, the depth buffer is cleared.
+     *                      Do not intermingle perspective and orthographic
+     *                      rendering. Perform all the orthographic rendering in the
+     *                      end.
+     */
+    void render(Model& model, const Vec3& position, const Mat4& rotation,
+      const uint32_t textureHandle, const uint64_t currentPose = 0,
+      const bool perspective = true);
+
     /**
      * @brief Render a Model.
      * @param model       The model
@@ -438,6 +691,15 @@ namespace small3d
      */
     void render(SceneObject& sceneObject, const std::string& textureName);
 
+    /**
+     * @brief Render a SceneObject
+     * @param sceneObject   The object
+     * @param textureHandle The handle of the texture to attach to the object,
+     *                      as returned by generateTexture or
+     *                      getTextureHandle.
+     */
+    void render(SceneObject& sceneObject, const uint32_t textureHandle);
+
     /**
      * @brief Clear a Model from the GPU buffers (the Model itself remains
      *        intact).
@@ -43,6 +43,8 @@ namespace small3d
     int frameDelay;
     uint64_t currentPose;
     int framesWaited;
+    float animationTime = 0.0f;
+    bool timeBasedAnimation = false;
     uint64_t getNumPoses();
     std::string name;
     Mat4 transformation = Mat4(1);
@@ -50,7 +52,7 @@ namespace small3d
     bool rotationByMatrix = false;
     std::vector<std::shared_ptr<Model>> models;
     std::shared_ptr<BoundingBoxSet> boundingBoxSet = std::shared_ptr<BoundingBoxSet>(new BoundingBoxSet());
-    void init(const std::string& name, const uint32_t boundingBoxSubdivisions);
+    void init(const std::string& name, const Model& model, const uint32_t boundingBoxSubdivisions);
   public:
 
     /** 
@@ -117,11 +119,25 @@ namespace small3d
     std::vector<Model> getBoundingBoxSetModels();
 
     /**
-     * @brief Get the bounding box set extremes (min and max coords)
+     * @brief Get the bounding box set extremes (min and max coords), in
+     *        order to modify them. The bounding box set is shared by all the
+     *        objects created from the same model with the same subdivisions
+     *        (see BoundingBoxSet::getCached), so the object gets its own copy
+     *        of it the first time this is called. After the extremes are
+     *        modified, the collision checks test every box, rather than only
+     *        the ones near what they are looking for (see
+     *        BoundingBoxSet::refreshTree).
      * @return The bounding box set extremes
      */
     std::vector<BoundingBoxSet::extremes>& getBoundingBoxSetExtremes();
 
+    /**
+     * @brief Get the bounding box set extremes (min and max coords), without
+     *        modifying them.
+     * @return The bounding box set extremes
+     */
+    const std::vector<BoundingBoxSet::extremes>& getBoundingBoxSetExtremes() const;
+
     /**
      * @brief Get the name of the object
      * @return The name of the object
@@ -191,7 +207,8 @@ namespace small3d
     void stopAnimating();
 
     /**
-     * @brief Reset the animation sequence (go to the first frame)
+     * @brief Reset the animation sequence (go to the first frame). The object
+     *        is then animated based on frames, until animate(float) is called.
      */
     void resetAnimation();
 
@@ -203,10 +220,30 @@ namespace small3d
     void setFrameDelay(const int delay);
 
     /**
-     * @brief Process animation (progress current frame if necessary)
+     * @brief Process animation (progress current frame if necessary). If the
+     *        object was animated based on time (see animate(float)), it is
+     *        animated based on frames again, from the start of the animation
+     *        time.
      */
     void animate();
 
+    /**
+     * @brief Process animation based on time rather than on frames. The
+     *        object will then be rendered by sampling its animation at the
+     *        accumulated time, interpolating between keyframes, so the animation
+     *        speed does not depend on the frame rate. Only supported for
+     *        skeletal animation.
+     * @param elapsedSeconds The time elapsed since the last call, in seconds
+     */
+    void animate(float elapsedSeconds);
+
+    /**
+     * @brief Get the moment of the current animation the object is at, when
+     *        animating based on time.
+     * @return The animation time, in seconds
+     */
+    float getAnimationTime() const;
+
     /**
      * @brief  Check if the bounding boxes of this object contain
      *         a given point.
@@ -229,7 +266,50 @@ namespace small3d
 
     bool containsCorners(const SceneObject& otherObject) const;
 
+    /**
+     * @brief  Check if the bounding boxes of this object intersect
+     *         the bounding boxes of another object. This also detects
+     *         boxes crossing each other without either one containing
+     *         a corner of the other, which containsCorners misses.
+     * @param  otherObject The other object.
+     * @return True if the bounding boxes of the two objects intersect,
+     *         False otherwise.
+     */
+
+    bool intersects(const SceneObject& otherObject) const;
+
+    /**
+     * @brief  Check if this object, having moved in a straight line from a
+     *         previous position to its current one, has touched another
+     *         object on the way (so that fast objects do not pass through
+     *         others unnoticed between two checks). The rotation of this
+     *         object is taken to have been its current one all along.
+     * @param  previousPosition The position this object has moved from
+     * @param  otherObject      The other object (taken not to have moved)
+     * @param  timeOfImpact     Set to the fraction of the motion (0 - 1) after
+     *                          which the objects first touched, if they did
+     * @return True if the objects have touched, False otherwise.
+     */
+
+    bool sweep(const Vec3& previousPosition, const SceneObject& otherObject,
+      float& timeOfImpact) const;
+
+    /**
+     * @brief  Cast a ray against the bounding boxes of this object.
+     * @param  origin      The origin of the ray
+     * @param  direction   The direction of the ray
+     * @param  maxDistance How far from the origin to look for a hit
+     * @param  distance    Set to the distance from the origin at which
+     *                     the ray hits the bounding boxes, if it does
+     * @return True if the ray hits the bounding boxes within maxDistance,
+     *         False otherwise.
+     */
+
+    bool raycast(const Vec3& origin, const Vec3& direction, float maxDistance,
+      float& distance) const;
+
     friend class Renderer;
+    friend class CollisionWorld;
 
   };
 
@@ -29,6 +29,8 @@
 
 namespace small3d {
 
+  class Pack;
+
   /**
    * @class Sound
    *
@@ -142,6 +144,7 @@ static ALCcontext *openalContext;
 #endif
 
     void load(const std::string& soundFilePath);
+    void decode(const char* data, size_t size, const std::string& name);
     void openStream();
 
   public:
@@ -156,6 +159,14 @@ static ALCcontext *openalContext;
      */
     explicit Sound(const std::string& soundFilePath);
 
+    /**
+     * @brief Constructor, loading an ogg or native binary sound packed
+     *        in a Pack
+     * @param pack      The pack
+     * @param entryName The name of the sound in the pack
+     */
+    Sound(const Pack& pack, const std::string& entryName);
+
     /**
      * @brief Destructor
      */
@@ -0,0 +1,105 @@
+/**
+ *  @file  ThreadPool.hpp
+ *  @brief Worker threads shared by the parts of small3d that split work
+ *
+ *  Created on: 2026/10/18
+ *      Author: Dimitri Kourkoulis
+ *     License: BSD 3-Clause License (see LICENSE file)
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+namespace small3d {
+
+  /**
+   * @class ThreadPool
+   * @brief A set of worker threads, started once and shared by the parts of
+   *        small3d that split work among threads (batch math operations,
+   *        bounding box set generation, ray casting, loading the meshes of a
+   *        gltf file), so that they do not start and stop threads every
+   *        time they are called. The calling thread takes part in the work
+   *        and the calls return when all of it is done. Calls can be made
+   *        from many threads at the same time, as well as from within the
+   *        work itself.
+   */
+  class ThreadPool {
+
+  private:
+
+    struct Batch;
+
+    std::vector<std::thread> workers;
+    std::deque<std::shared_ptr<Batch>> queue;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping = false;
+
+    ThreadPool();
+
+    void work();
+    static void runTasks(Batch& batch);
+
+    // Forbid moving and copying
+    ThreadPool(ThreadPool const&) = delete;
+    void operator=(ThreadPool const&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    void operator=(ThreadPool&&) = delete;
+
+  public:
+
+    /**
+     * @brief Get the pool. Its threads are started the first time this
+     *        is called (one less than the number of hardware threads, since
+     *        the calling thread also works).
+     * @return The pool
+     */
+    static ThreadPool& getInstance();
+
+    /**
+     * @brief Destructor (stops the worker threads)
+     */
+    ~ThreadPool();
+
+    /**
+     * @brief Get the number of threads that work on each call, including
+     *        the calling thread
+     * @return The number of threads
+     */
+    uint32_t getNumThreads() const;
+
+    /**
+     * @brief Run a number of tasks. Each thread takes the next task that
+     *        has not been started yet, so tasks can differ in size. If any
+     *        of the tasks throws, the exception of the first one of them
+     *        (by index) is rethrown, after all of them have finished.
+     * @param numTasks The number of tasks
+     * @param task     The function running a task, given its index
+     */
+    void run(size_t numTasks, const std::function<void(size_t)>& task);
+
+    /**
+     * @brief Process a range of elements, split in one part per thread, as
+     *        long as each part has at least minPerThread elements (so small
+     *        ranges are processed on the calling thread only).
+     * @param count        The number of elements
+     * @param minPerThread The minimum number of elements worth giving to
+     *                     a thread
+     * @param process      The function processing the elements from begin
+     *                     (inclusive) to end (exclusive)
+     */
+    void parallelFor(size_t count, size_t minPerThread,
+      const std::function<void(size_t, size_t)>& process);
+
+  };
+}
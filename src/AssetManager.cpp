@@ -0,0 +1,166 @@
+/**
+ *  AssetManager.cpp
+ *
+ *  Created on: 2026/10/18
+ *      Author: Dimitri Kourkoulis
+ *     License: BSD 3-Clause License (see LICENSE file)
+ */
+
+#include "AssetManager.hpp"
+#include "Renderer.hpp"
+#include "Sound.hpp"
+#include "GlbFile.hpp"
+#include "WavefrontFile.hpp"
+#include "BinaryFile.hpp"
+#include "PackFile.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <cctype>
+
+namespace small3d {
+
+  namespace {
+
+    std::string lowerCaseExtension(const std::string& fileLocation) {
+      auto dot = fileLocation.find_last_of('.');
+      if (dot == std::string::npos) return "";
+      std::string extension = fileLocation.substr(dot + 1);
+      std::transform(extension.begin(), extension.end(), extension.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+      return extension;
+    }
+  }
+
+  AssetManager::AssetManager(Renderer* renderer, uint32_t numThreads) : renderer(renderer) {
+    if (numThreads == 0) {
+      auto hardwareThreads = std::thread::hardware_concurrency();
+      numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+    workers.reserve(numThreads);
+    for (uint32_t i = 0; i < numThreads; ++i) {
+      workers.emplace_back(&AssetManager::work, this);
+    }
+    LOGDEBUG("AssetManager started " + std::to_string(numThreads) + " worker threads.");
+  }
+
+  AssetManager::~AssetManager() {
+    std::deque<std::function<void()>> discarded;
+    {
+      std::lock_guard<std::mutex> lock(jobsMutex);
+      stopping = true;
+      discarded.swap(jobs);
+    }
+    jobsCondition.notify_all();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    // The promises of the discarded jobs are destroyed here, breaking them.
+  }
+
+  void AssetManager::work() {
+    while (true) {
+      std::function<void()> job;
+      {
+        std::unique_lock<std::mutex> lock(jobsMutex);
+        jobsCondition.wait(lock, [this] { return stopping || !jobs.empty(); });
+        if (jobs.empty()) return;
+        job = std::move(jobs.front());
+        jobs.pop_front();
+      }
+      job();
+    }
+  }
+
+  void AssetManager::addJob(std::function<void()> job) {
+    {
+      std::lock_guard<std::mutex> lock(jobsMutex);
+      jobs.push_back(std::move(job));
+    }
+    jobsCondition.notify_one();
+  }
+
+  template <typename T>
+  std::shared_future<std::shared_ptr<T>> AssetManager::run(std::function<std::shared_ptr<T>()> load) {
+    auto promise = std::make_shared<std::promise<std::shared_ptr<T>>>();
+    std::shared_future<std::shared_ptr<T>> future = promise->get_future().share();
+    addJob([promise, load] {
+      try {
+        promise->set_value(load());
+      }
+      catch (...) {
+        promise->set_exception(std::current_exception());
+      }
+    });
+    return future;
+  }
+
+  std::shared_future<std::shared_ptr<Model>> AssetManager::loadModel(const std::string& fileLocation,
+    const std::string& meshName) {
+    auto rndr = renderer;
+    return run<Model>([fileLocation, meshName, rndr] {
+      std::shared_ptr<Model> model;
+      auto extension = lowerCaseExtension(fileLocation);
+      if (extension == "glb") {
+        model = std::make_shared<Model>(GlbFile(fileLocation), meshName);
+      }
+      else if (extension == "obj") {
+        model = std::make_shared<Model>(WavefrontFile(fileLocation), meshName);
+      }
+      else {
+        model = std::make_shared<Model>(BinaryFile(fileLocation), meshName);
+      }
+      if (rndr != nullptr) rndr->queueUpload(model);
+      return model;
+    });
+  }
+
+  std::shared_future<std::shared_ptr<Model>> AssetManager::loadModel(const Pack& pack,
+    const std::string& entryName, const std::string& meshName) {
+    auto rndr = renderer;
+    const Pack* pck = &pack;
+    return run<Model>([pck, entryName, meshName, rndr] {
+      auto model = std::make_shared<Model>(PackFile(*pck, entryName), meshName);
+      if (rndr != nullptr) rndr->queueUpload(model);
+      return model;
+    });
+  }
+
+  std::shared_future<std::shared_ptr<Image>> AssetManager::loadImage(const std::string& fileLocation,
+    const std::string& textureName) {
+    auto rndr = renderer;
+    return run<Image>([fileLocation, textureName, rndr] {
+      auto image = std::make_shared<Image>(fileLocation);
+      if (rndr != nullptr && !textureName.empty()) rndr->queueUpload(textureName, image);
+      return image;
+    });
+  }
+
+  std::shared_future<std::shared_ptr<Image>> AssetManager::loadImage(const Pack& pack,
+    const std::string& entryName, const std::string& textureName) {
+    auto rndr = renderer;
+    const Pack* pck = &pack;
+    return run<Image>([pck, entryName, textureName, rndr] {
+      auto image = std::make_shared<Image>(*pck, entryName);
+      if (rndr != nullptr && !textureName.empty()) rndr->queueUpload(textureName, image);
+      return image;
+    });
+  }
+
+  std::shared_future<std::shared_ptr<Sound>> AssetManager::loadSound(const std::string& fileLocation) {
+    return run<Sound>([fileLocation] {
+      return std::make_shared<Sound>(fileLocation);
+    });
+  }
+
+  std::shared_future<std::shared_ptr<Sound>> AssetManager::loadSound(const Pack& pack,
+    const std::string& entryName) {
+    const Pack* pck = &pack;
+    return run<Sound>([pck, entryName] {
+      return std::make_shared<Sound>(*pck, entryName);
+    });
+  }
+
+  uint32_t AssetManager::getNumThreads() const {
+    return static_cast<uint32_t>(workers.size());
+  }
+}
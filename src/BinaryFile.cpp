@@ -9,82 +9,405 @@
 #include <cereal/archives/binary.hpp>
 
 #include <fstream>
+#include <sstream>
+#include <cstddef>
 
 #include <cereal/types/vector.hpp>
 #include <cereal/types/string.hpp>
 #include <cereal/types/memory.hpp>
 
 #include "BinaryFile.hpp"
+#include "BoundingBoxSet.hpp"
+#include "MappedFile.hpp"
+#include <streambuf>
+#include <memory>
+#include <cstring>
+#include <algorithm>
 #include <zlib.h>
 
 using namespace small3d;
+
+const char BinaryFile::COMPRESSED_MAGIC[4] = { 'S', '3', 'D', 'Z' };
+
 BinaryFile::BinaryFile(const std::string& fileLocation) : File(fileLocation) {
 
 }
 
+BinaryFile::BinaryFile(const std::string& name, const char* data, size_t size) : File(name) {
+  memoryData = data;
+  memorySize = size;
+}
+
 
-void BinaryFile::load(Model& model, const std::string& meshName) {
+namespace {
+
+  // Lets cereal read from memory, without copying the data into an
+  // std::istringstream first.
+  class MemoryBuffer : public std::streambuf {
+  public:
+    MemoryBuffer(char* data, size_t size) {
+      setg(data, data, data + size);
+    }
+  };
+
+  // The mapped format (see BinaryFile.hpp). The header and the section
+  // table are written as they are in memory, with a fixed layout.
+  const char MAPPED_MAGIC[4] = { 'S', '3', 'D', 'M' };
+  const uint32_t BYTE_ORDER_MARK = 0x01020304;
+  const uint64_t SECTION_ALIGNMENT = 16;
+  const uint32_t MAX_SECTIONS = 1024;
+
+  enum : uint32_t {
+    SECTION_PROPERTIES = 1,
+    SECTION_VERTICES,
+    SECTION_INDICES,
+    SECTION_INDICES32,
+    SECTION_NORMALS,
+    SECTION_TEXTURE_COORDS,
+    SECTION_JOINTS,
+    SECTION_WEIGHTS,
+    SECTION_PACKED_VERTICES
+  };
+
+  struct MappedHeader {
+    char magic[4] = { MAPPED_MAGIC[0], MAPPED_MAGIC[1], MAPPED_MAGIC[2], MAPPED_MAGIC[3] };
+    uint32_t version = BinaryFile::MAPPED_FORMAT_VERSION;
+    uint32_t byteOrder = BYTE_ORDER_MARK;
+    uint32_t numSections = 0;
+    uint64_t fileSize = 0;
+    // CRC-32 of the header (with this set to 0) and the section table
+    uint32_t checksum = 0;
+    uint32_t reserved = 0;
+  };
+
+  struct MappedSection {
+    uint32_t type = 0;
+    uint32_t reserved = 0;
+    // From the start of the file, in bytes
+    uint64_t offset = 0;
+    uint64_t size = 0;
+  };
 
+  static_assert(sizeof(MappedHeader) == 32 && sizeof(MappedSection) == 24,
+    "The layout of the mapped binary format has changed.");
 
-  std::ifstream is;
-  is.open(fullPath, std::ios::in | std::ios::binary);
-  if (!is.is_open()) {
-    throw std::runtime_error("Could not open file " + fullPath);
+  uint64_t alignOffset(uint64_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
   }
 
+  uint32_t calculateChecksum(const char* data, size_t size) {
+    // The checksum itself is taken to be 0
+    std::vector<char> checked(data, data + size);
+    memset(checked.data() + offsetof(MappedHeader, checksum), 0, sizeof(uint32_t));
+    return static_cast<uint32_t>(crc32(crc32(0L, Z_NULL, 0),
+      reinterpret_cast<const Bytef*>(checked.data()), static_cast<uInt>(checked.size())));
+  }
+
+  template <typename T>
+  void copySection(const char* data, const MappedSection& section, std::vector<T>& dest,
+    const std::string& fullPath) {
+    if (section.size % sizeof(T) != 0) {
+      throw std::runtime_error("Section of type " + std::to_string(section.type) + " in file " + fullPath +
+        " has a size of " + std::to_string(section.size) + " bytes, which is not a multiple of " +
+        std::to_string(sizeof(T)) + ".");
+    }
+    dest.resize(static_cast<size_t>(section.size / sizeof(T)));
+    if (!dest.empty()) {
+      memcpy(dest.data(), data, dest.size() * sizeof(T));
+    }
+  }
+}
+
+void BinaryFile::load(Model& model, const std::string& meshName) {
 
-  std::string readData = "";
-  const uint32_t CHUNK = 16384;
+  // The file is mapped in memory and read from there directly, rather
+  // than being read into memory first.
+  std::unique_ptr<MappedFile> file;
+  const char* data = memoryData;
+  size_t size = memorySize;
 
-  char rd[CHUNK];
-  while (!is.eof()) {
-    memset(rd, 0, CHUNK);
-    is.read(rd, CHUNK);
-    for (uint32_t idx = 0; idx < is.gcount(); ++idx) {
-      readData += rd[idx];
+  if (data == nullptr) {
+    try {
+      file = std::make_unique<MappedFile>(fullPath, true);
     }
+    catch (const std::runtime_error&) {
+      throw std::runtime_error("Could not open file " + fullPath);
+    }
+    data = file->data();
+    size = file->size();
   }
 
-  is.close();
+  if (size >= sizeof(MappedHeader) && memcmp(data, MAPPED_MAGIC, 4) == 0) {
+    loadMapped(model, data, size);
+  }
+  else {
+    loadCompressed(model, data, size);
+    model.packVertexData();
+  }
+
+  LOGDEBUG("Loaded model from binary file " + fullPath);
+}
+
+void BinaryFile::loadCompressed(Model& model, const char* data, size_t size) {
 
-  unsigned char out[CHUNK];
   z_stream strm;
 
   strm.zalloc = Z_NULL;
   strm.zfree = Z_NULL;
   strm.opaque = Z_NULL;
+  strm.avail_in = 0;
+  strm.next_in = Z_NULL;
 
   if (inflateInit(&strm) != Z_OK) {
     throw std::runtime_error("Failed to initialise inflate stream.");
   }
 
-  strm.avail_in = readData.length();
-  strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(readData.c_str()));
-  std::string uncompressedData = "";
+  strm.avail_in = static_cast<uInt>(size);
+  strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
 
-  do {
-    strm.avail_out = CHUNK;
-    strm.next_out = out;
-    if (inflate(&strm, Z_NO_FLUSH) == Z_STREAM_ERROR) {
-      LOGERROR("Stream error");
+  // Inflated straight into one buffer, which grows as needed. It is not
+  // initialised, so that the memory it reserves but does not use is
+  // never touched.
+  const size_t CHUNK = 16384;
+  size_t capacity = std::max(size * 4, CHUNK);
+  std::unique_ptr<char[]> uncompressedData(new char[capacity]);
+  size_t uncompressedSize = 0;
+  int result = Z_OK;
+
+  while (result != Z_STREAM_END) {
+    if (uncompressedSize == capacity) {
+      std::unique_ptr<char[]> largerData(new char[capacity * 2]);
+      memcpy(largerData.get(), uncompressedData.get(), uncompressedSize);
+      uncompressedData = std::move(largerData);
+      capacity *= 2;
     }
-    uint32_t have = CHUNK - strm.avail_out;
-    for (uint32_t idx = 0; idx < have; ++idx) {
-      uncompressedData += out[idx];
+    strm.avail_out = static_cast<uInt>(std::min(capacity - uncompressedSize, static_cast<size_t>(UINT32_MAX)));
+    strm.next_out = reinterpret_cast<Bytef*>(uncompressedData.get() + uncompressedSize);
+    uInt availableBefore = strm.avail_out;
+
+    result = inflate(&strm, Z_NO_FLUSH);
+    uncompressedSize += availableBefore - strm.avail_out;
+
+    if (result == Z_STREAM_ERROR || result == Z_DATA_ERROR || result == Z_MEM_ERROR || result == Z_NEED_DICT ||
+      (result == Z_BUF_ERROR && strm.avail_in == 0)) {
+      LOGERROR("Stream error");
+      break;
     }
-  } while (strm.avail_out == 0);
-  deflateEnd(&strm);
+  }
+  inflateEnd(&strm);
 
-  std::istringstream iss(uncompressedData, std::ios::binary | std::ios::in);
+  MemoryBuffer buffer(uncompressedData.get(), uncompressedSize);
+  std::istream iss(&buffer);
 
   cereal::BinaryInputArchive iarchive(iss);
+
+  // Files saved before the format was versioned start with the model
+  // right away. Its first value (the current animation) never matches
+  // the header.
+  uint32_t version = 0;
+  if (uncompressedSize >= sizeof(COMPRESSED_MAGIC) + sizeof(uint32_t) &&
+    memcmp(uncompressedData.get(), COMPRESSED_MAGIC, sizeof(COMPRESSED_MAGIC)) == 0) {
+    iss.ignore(sizeof(COMPRESSED_MAGIC));
+    iarchive(version);
+    if (version > COMPRESSED_FORMAT_VERSION) {
+      throw std::runtime_error("File " + fullPath + " is of version " + std::to_string(version) +
+        " of the binary format, which is not supported.");
+    }
+  }
+
   iarchive(model);
-  iss.clear();
-  uncompressedData.clear();
+  if (version >= 1) {
+    iarchive(model.indexData32);
+  }
 
-  is.close();
+  // Any bounding box sets saved with the model are added to the cache,
+  // to be used by the SceneObjects created from it.
+  if (iss.peek() != std::char_traits<char>::eof()) {
+    std::vector<BoundingBoxSet> boxSets;
+    iarchive(boxSets);
+    for (auto& boxSet : boxSets) {
+      BoundingBoxSet::addToCache(model, std::make_shared<BoundingBoxSet>(std::move(boxSet)));
+    }
+  }
+}
 
-  LOGDEBUG("Loaded model from binary file " + fullPath);
+void BinaryFile::loadMapped(Model& model, const char* data, size_t size) {
+
+  MappedHeader header;
+  memcpy(&header, data, sizeof(MappedHeader));
+
+  if (header.byteOrder != BYTE_ORDER_MARK) {
+    throw std::runtime_error("File " + fullPath + " has been written on a machine with a different byte order.");
+  }
+
+  size_t tableEnd = sizeof(MappedHeader) + static_cast<size_t>(header.numSections) * sizeof(MappedSection);
+  if (header.numSections > MAX_SECTIONS || tableEnd > size || header.fileSize != size) {
+    throw std::runtime_error("File " + fullPath + " is truncated or corrupted.");
+  }
+
+  if (calculateChecksum(data, tableEnd) != header.checksum) {
+    throw std::runtime_error("The checksum of the header of file " + fullPath + " does not match.");
+  }
+
+  if (header.version > MAPPED_FORMAT_VERSION) {
+    throw std::runtime_error("File " + fullPath + " is of version " + std::to_string(header.version) +
+      " of the binary format, which is not supported.");
+  }
+
+  std::vector<MappedSection> sections(header.numSections);
+  memcpy(sections.data(), data + sizeof(MappedHeader), header.numSections * sizeof(MappedSection));
+
+  bool hasPackedData = false;
+  std::vector<BoundingBoxSet> boxSets;
+
+  for (auto& section : sections) {
+    if (section.offset < tableEnd || section.offset > size || section.offset % SECTION_ALIGNMENT != 0 ||
+      section.size > size - section.offset) {
+      throw std::runtime_error("Section out of bounds in file " + fullPath + ".");
+    }
+
+    const char* sectionData = data + section.offset;
+
+    switch (section.type) {
+    case SECTION_PROPERTIES: {
+      MemoryBuffer buffer(const_cast<char*>(sectionData), static_cast<size_t>(section.size));
+      std::istream iss(&buffer);
+      cereal::BinaryInputArchive iarchive(iss);
+      iarchive(model.currentAnimation, model.numPoses, model.origTransformation, model.origRotation,
+        model.origTranslation, model.origScale, model.material, model.scale, model.defaultTextureImage,
+        model.vertexDataByteSize, model.indexDataByteSize, model.normalsDataByteSize,
+        model.textureCoordsDataByteSize, model.jointDataByteSize, model.weightDataByteSize,
+        model.packedVertexStride, model.packedUVOffset, model.packedJointOffset, model.packedWeightOffset,
+        model.joints, model.animations, boxSets);
+      break;
+    }
+    case SECTION_VERTICES:
+      copySection(sectionData, section, model.vertexData, fullPath);
+      break;
+    case SECTION_INDICES:
+      copySection(sectionData, section, model.indexData, fullPath);
+      break;
+    case SECTION_INDICES32:
+      copySection(sectionData, section, model.indexData32, fullPath);
+      break;
+    case SECTION_NORMALS:
+      copySection(sectionData, section, model.normalsData, fullPath);
+      break;
+    case SECTION_TEXTURE_COORDS:
+      copySection(sectionData, section, model.textureCoordsData, fullPath);
+      break;
+    case SECTION_JOINTS:
+      copySection(sectionData, section, model.jointData, fullPath);
+      break;
+    case SECTION_WEIGHTS:
+      copySection(sectionData, section, model.weightData, fullPath);
+      break;
+    case SECTION_PACKED_VERTICES:
+      copySection(sectionData, section, model.packedVertexData, fullPath);
+      hasPackedData = true;
+      break;
+    default:
+      // Added by a later version of the format
+      break;
+    }
+  }
+
+  // The sizes in the properties are used when sending the data to the GPU,
+  // so they must be those of the data read.
+  size_t indexByteSize = model.indexData32.empty() ? model.indexData.size() * sizeof(uint16_t) :
+    model.indexData32.size() * sizeof(uint32_t);
+  if (model.vertexDataByteSize != model.vertexData.size() * sizeof(float) ||
+    model.indexDataByteSize != indexByteSize ||
+    model.normalsDataByteSize != model.normalsData.size() * sizeof(float) ||
+    model.textureCoordsDataByteSize != model.textureCoordsData.size() * sizeof(float) ||
+    model.jointDataByteSize != model.jointData.size() * sizeof(uint8_t) ||
+    model.weightDataByteSize != model.weightData.size() * sizeof(float)) {
+    throw std::runtime_error("The sizes of the data in file " + fullPath + " do not match its properties.");
+  }
+
+  // The packed data is stored when the saved model had it, so that it
+  // does not need to be produced again.
+  if (!hasPackedData) {
+    model.packedVertexStride = 0;
+    model.packVertexData();
+  }
+
+  for (auto& boxSet : boxSets) {
+    BoundingBoxSet::addToCache(model, std::make_shared<BoundingBoxSet>(std::move(boxSet)));
+  }
+}
+
+void BinaryFile::saveMapped(const Model& model, const std::string& binaryFilePath,
+  const std::vector<BoundingBoxSet>& boxSets) {
+
+  std::stringstream properties(std::ios::out | std::ios::binary | std::ios::trunc);
+  {
+    cereal::BinaryOutputArchive oarchive(properties);
+    oarchive(model.currentAnimation, model.numPoses, model.origTransformation, model.origRotation,
+      model.origTranslation, model.origScale, model.material, model.scale, model.defaultTextureImage,
+      model.vertexDataByteSize, model.indexDataByteSize, model.normalsDataByteSize,
+      model.textureCoordsDataByteSize, model.jointDataByteSize, model.weightDataByteSize,
+      model.packedVertexStride, model.packedUVOffset, model.packedJointOffset, model.packedWeightOffset,
+      model.joints, model.animations, boxSets);
+  }
+  std::string propertiesData = properties.str();
+
+  struct SectionData {
+    uint32_t type;
+    const void* data;
+    size_t size;
+  };
+
+  std::vector<SectionData> sectionData = {
+    { SECTION_PROPERTIES, propertiesData.data(), propertiesData.size() },
+    { SECTION_VERTICES, model.vertexData.data(), model.vertexData.size() * sizeof(float) },
+    { SECTION_INDICES, model.indexData.data(), model.indexData.size() * sizeof(uint16_t) },
+    { SECTION_INDICES32, model.indexData32.data(), model.indexData32.size() * sizeof(uint32_t) },
+    { SECTION_NORMALS, model.normalsData.data(), model.normalsData.size() * sizeof(float) },
+    { SECTION_TEXTURE_COORDS, model.textureCoordsData.data(), model.textureCoordsData.size() * sizeof(float) },
+    { SECTION_JOINTS, model.jointData.data(), model.jointData.size() },
+    { SECTION_WEIGHTS, model.weightData.data(), model.weightData.size() * sizeof(float) }
+  };
+
+  if (!model.packedVertexData.empty()) {
+    sectionData.push_back({ SECTION_PACKED_VERTICES, model.packedVertexData.data(),
+      model.packedVertexData.size() });
+  }
+
+  MappedHeader header;
+  header.numSections = static_cast<uint32_t>(sectionData.size());
+
+  std::vector<MappedSection> sections(sectionData.size());
+  uint64_t offset = alignOffset(sizeof(MappedHeader) + sections.size() * sizeof(MappedSection));
+  for (size_t idx = 0; idx < sections.size(); ++idx) {
+    sections[idx].type = sectionData[idx].type;
+    sections[idx].offset = offset;
+    sections[idx].size = sectionData[idx].size;
+    offset = alignOffset(offset + sectionData[idx].size);
+  }
+  header.fileSize = offset;
+
+  std::vector<char> table(sizeof(MappedHeader) + sections.size() * sizeof(MappedSection));
+  memcpy(table.data(), &header, sizeof(MappedHeader));
+  memcpy(table.data() + sizeof(MappedHeader), sections.data(), sections.size() * sizeof(MappedSection));
+  header.checksum = calculateChecksum(table.data(), table.size());
+  memcpy(table.data(), &header, sizeof(MappedHeader));
+
+  std::ofstream ofstr(binaryFilePath, std::ios::out | std::ios::binary);
+  if (!ofstr) {
+    throw std::runtime_error("Could not open file " + binaryFilePath + " for writing.");
+  }
+
+  const char padding[SECTION_ALIGNMENT] = {};
+  ofstr.write(table.data(), table.size());
+  uint64_t written = table.size();
+  for (size_t idx = 0; idx < sections.size(); ++idx) {
+    ofstr.write(padding, static_cast<std::streamsize>(sections[idx].offset - written));
+    ofstr.write(static_cast<const char*>(sectionData[idx].data), static_cast<std::streamsize>(sectionData[idx].size));
+    written = sections[idx].offset + sectionData[idx].size;
+  }
+  ofstr.write(padding, static_cast<std::streamsize>(header.fileSize - written));
+  ofstr.close();
 }
 
 
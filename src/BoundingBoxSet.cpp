@@ -10,10 +10,94 @@
 #include <fstream>
 #include <stdexcept>
 #include "BasePath.hpp"
+#include "ThreadPool.hpp"
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <map>
+#include <tuple>
 
 namespace small3d {
 
+  // The vertices are divided among the threads of the ThreadPool
+  // when subdividing boxes, if there are at least this many per thread.
+  static const size_t minVerticesPerThread = 16384;
+
+  // Box sets are found by the data generation of the model they have been
+  // created for (see Model::markDataChanged), its original scale and the
+  // number of subdivisions. The cache does not keep them alive. They are
+  // kept by the objects using them, and the entries of the ones that have
+  // been destroyed are removed whenever a box set is added.
+  using CacheKey = std::tuple<uint64_t, uint32_t, float, float, float>;
+
+  static std::mutex cacheMutex;
+  static std::map<CacheKey, std::weak_ptr<BoundingBoxSet>> cache;
+
+  // The distance along a ray at which it enters a box, or -1 if it does
+  // not enter it within maxDistance. Zero direction components are
+  // replaced by very small values (see raycast), so there are no
+  // divisions by zero.
+  static inline float rayEntry(const float* min, const float* max, const float* origin,
+    const float* inverseDirection, float maxDistance) {
+    float entryDistance = 0.0f, exitDistance = maxDistance;
+    for (int axis = 0; axis < 3; ++axis) {
+      float t1 = (min[axis] - origin[axis]) * inverseDirection[axis];
+      float t2 = (max[axis] - origin[axis]) * inverseDirection[axis];
+      if (t1 > t2) std::swap(t1, t2);
+      entryDistance = std::max(entryDistance, t1);
+      exitDistance = std::min(exitDistance, t2);
+      if (entryDistance > exitDistance) return -1.0f;
+    }
+    return entryDistance;
+  }
+
+  // Narrow the interval of time [enter, exit] to when the projection of
+  // the distance between two boxes (distance + time * velocity) on an axis
+  // is within radius. Returns false if it never is in the interval.
+  static inline bool sweepAxis(float distance, float velocity, float radius, float& enter, float& exit) {
+    if (velocity == 0.0f) {
+      return std::abs(distance) <= radius;
+    }
+    float t1 = (-radius - distance) / velocity;
+    float t2 = (radius - distance) / velocity;
+    if (t1 > t2) std::swap(t1, t2);
+    enter = std::max(enter, t1);
+    exit = std::min(exit, t2);
+    return enter <= exit;
+  }
+
+  // The time an axis aligned box (centre and half size), moving by velocity
+  // over one unit of time, first touches another (min and max), or -1 if
+  // it does not touch it before timeLimit
+  static inline float sweepBoxes(const float* centre, const float* halfSize, const float* velocity,
+    const float* min, const float* max, float timeLimit) {
+    float enter = 0.0f, exit = timeLimit;
+    for (int axis = 0; axis < 3; ++axis) {
+      if (!sweepAxis(centre[axis] - (min[axis] + max[axis]) / 2.0f, velocity[axis],
+        halfSize[axis] + (max[axis] - min[axis]) / 2.0f, enter, exit)) {
+        return -1.0f;
+      }
+    }
+    return enter;
+  }
+
+  // Must be called holding cacheMutex
+  static void removeDestroyedFromCache() {
+    for (auto entry = cache.begin(); entry != cache.end();) {
+      if (entry->second.expired()) {
+        entry = cache.erase(entry);
+      }
+      else {
+        ++entry;
+      }
+    }
+  }
+
+  static CacheKey cacheKey(uint64_t dataGeneration, const Vec3& scale, uint32_t subdivisions) {
+    return CacheKey(dataGeneration, subdivisions, scale.x, scale.y, scale.z);
+  }
+
   BoundingBoxSet::BoundingBoxSet() {
 
   }
@@ -24,11 +108,46 @@ namespace small3d {
 
   }
 
+  bool BoundingBoxSet::boxesContain(float x, float y, float z) const {
+    // If the extremes have been modified since the tree was last built,
+    // the tree no longer matches them, so they are all checked.
+    if (!hasCurrentTree()) {
+      return std::any_of(boxExtremes.begin(), boxExtremes.end(), [x, y, z](const auto& ex) {
+        return x > ex.minX && x < ex.maxX &&
+          y > ex.minY && y < ex.maxY &&
+          z > ex.minZ && z < ex.maxZ; });
+    }
+    return nodeContains(0, x, y, z);
+  }
+
+  bool BoundingBoxSet::nodeContains(uint32_t node, float x, float y, float z) const {
+    const TreeNode& treeNode = boxArrays.tree[node];
+    if (x < treeNode.min[0] || x > treeNode.max[0] ||
+      y < treeNode.min[1] || y > treeNode.max[1] ||
+      z < treeNode.min[2] || z > treeNode.max[2]) {
+      return false;
+    }
+
+    for (uint32_t idx = treeNode.first; idx < treeNode.first + treeNode.count; ++idx) {
+      if (treeNode.boxChildren) {
+        const auto& ex = boxExtremes[idx];
+        if (x > ex.minX && x < ex.maxX &&
+          y > ex.minY && y < ex.maxY &&
+          z > ex.minZ && z < ex.maxZ) {
+          return true;
+        }
+      }
+      else if (nodeContains(idx, x, y, z)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   bool BoundingBoxSet::contains(const Vec3& point,
     const Vec3& thisOffset,
     const Mat4& thisRotation) const {
 
-    bool doesContain = false;
     Mat4 reverseRotationMatrix = inverse(thisRotation);
 
     Vec4 pointInBoxSpace = Vec4(point, 1.0f) -
@@ -36,44 +155,523 @@ namespace small3d {
 
     pointInBoxSpace = reverseRotationMatrix * pointInBoxSpace;
 
+    return boxesContain(pointInBoxSpace.x, pointInBoxSpace.y, pointInBoxSpace.z);
+  }
+
+  bool BoundingBoxSet::containsCorners(const BoundingBoxSet& otherBoxSet,
+    const Vec3& thisOffset,
+    const Mat4& thisRotation,
+    const Vec3& otherOffset,
+    const Mat4& otherRotation) const {
+
+    // The corners of the other set are brought into the space of this
+    // set by a single matrix, transforming a chunk of them at a time.
+    Mat4 otherToThis = inverse(thisRotation) *
+      translate(Mat4(1.0f), otherOffset - thisOffset) * otherRotation;
+
+    const size_t chunkSize = 64;
+    float x[chunkSize], y[chunkSize], z[chunkSize];
+    size_t numCorners = otherBoxSet.vertices.size();
+
+    for (size_t begin = 0; begin < numCorners; begin += chunkSize) {
+      size_t count = std::min(chunkSize, numCorners - begin);
+
+      for (size_t idx = 0; idx < count; ++idx) {
+        const auto& vertex = otherBoxSet.vertices[begin + idx];
+        x[idx] = vertex.at(0);
+        y[idx] = vertex.at(1);
+        z[idx] = vertex.at(2);
+      }
+
+      transformPoints(otherToThis, x, y, z, x, y, z, count);
+
+      for (size_t idx = 0; idx < count; ++idx) {
+        if (boxesContain(x[idx], y[idx], z[idx])) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  void BoundingBoxSet::nodeSweep(const BoxArrays& boxes, uint32_t node, const float* centre,
+    const float* halfSize, const float* velocity, const float* otherHalfSize,
+    const float (*r)[3], const float (*absR)[3], float& timeOfImpact, bool& hit) {
 
-    if (std::any_of(boxExtremes.begin(), boxExtremes.end(), [&pointInBoxSpace](const auto& ex) {return pointInBoxSpace.x > ex.minX && pointInBoxSpace.x < ex.maxX &&
-      pointInBoxSpace.y > ex.minY && pointInBoxSpace.y < ex.maxY &&
-      pointInBoxSpace.z > ex.minZ && pointInBoxSpace.z < ex.maxZ; })) {
-      doesContain = true;
+    const TreeNode& treeNode = boxes.tree[node];
+    if (sweepBoxes(centre, halfSize, velocity, treeNode.min, treeNode.max, timeOfImpact) < 0.0f) {
+      return;
     }
 
-    return doesContain;
+    for (uint32_t idx = treeNode.first; idx < treeNode.first + treeNode.count; ++idx) {
+      if (!treeNode.boxChildren) {
+        nodeSweep(boxes, idx, centre, halfSize, velocity, otherHalfSize, r, absR, timeOfImpact, hit);
+        continue;
+      }
+
+      float thisHalfSize[3] = { boxes.halfX[idx], boxes.halfY[idx], boxes.halfZ[idx] };
+      float d[3] = { centre[0] - boxes.centreX[idx], centre[1] - boxes.centreY[idx],
+        centre[2] - boxes.centreZ[idx] };
+
+      // The same axes as in intersects, but finding the interval of time
+      // during which the boxes overlap on each one
+      float enter = 0.0f, exit = timeOfImpact;
+      bool overlapping = true;
+
+      // Axes of this box
+      for (int row = 0; row < 3 && overlapping; ++row) {
+        overlapping = sweepAxis(d[row], velocity[row], thisHalfSize[row] + halfSize[row], enter, exit);
+      }
+
+      // Axes of the other box
+      for (int col = 0; col < 3 && overlapping; ++col) {
+        float projection = d[0] * r[0][col] + d[1] * r[1][col] + d[2] * r[2][col];
+        float velocityProjection = velocity[0] * r[0][col] + velocity[1] * r[1][col] + velocity[2] * r[2][col];
+        float radius = thisHalfSize[0] * absR[0][col] + thisHalfSize[1] * absR[1][col] +
+          thisHalfSize[2] * absR[2][col] + otherHalfSize[col];
+        overlapping = sweepAxis(projection, velocityProjection, radius, enter, exit);
+      }
+
+      // Cross products of the axes of the two boxes
+      for (int row = 0; row < 3 && overlapping; ++row) {
+        int row1 = (row + 1) % 3;
+        int row2 = (row + 2) % 3;
+        for (int col = 0; col < 3 && overlapping; ++col) {
+          int col1 = (col + 1) % 3;
+          int col2 = (col + 2) % 3;
+          float projection = d[row2] * r[row1][col] - d[row1] * r[row2][col];
+          float velocityProjection = velocity[row2] * r[row1][col] - velocity[row1] * r[row2][col];
+          float radius = thisHalfSize[row1] * absR[row2][col] + thisHalfSize[row2] * absR[row1][col] +
+            otherHalfSize[col1] * absR[row][col2] + otherHalfSize[col2] * absR[row][col1];
+          overlapping = sweepAxis(projection, velocityProjection, radius, enter, exit);
+        }
+      }
+
+      if (overlapping) {
+        timeOfImpact = enter;
+        hit = true;
+      }
+    }
   }
 
-  bool BoundingBoxSet::containsCorners(const BoundingBoxSet& otherBoxSet,
+  bool BoundingBoxSet::sweep(const BoundingBoxSet& otherBoxSet,
+    const Vec3& thisOffset,
+    const Mat4& thisRotation,
+    const Vec3& otherStartOffset,
+    const Vec3& otherEndOffset,
+    const Mat4& otherRotation,
+    float& timeOfImpact) const {
+
+    if (boxExtremes.empty() || otherBoxSet.boxExtremes.empty()) {
+      return false;
+    }
+
+    BoxArrays thisRecalculated, otherRecalculated;
+    const BoxArrays* thisBoxes = &boxArrays;
+    const BoxArrays* otherBoxes = &otherBoxSet.boxArrays;
+    if (!hasCurrentTree()) {
+      thisRecalculated.fill(boxExtremes);
+      thisBoxes = &thisRecalculated;
+    }
+    if (!otherBoxSet.hasCurrentTree()) {
+      otherRecalculated.fill(otherBoxSet.boxExtremes);
+      otherBoxes = &otherRecalculated;
+    }
+
+    // The other set, at the start of the motion, and the motion itself,
+    // in the space of this set (see intersects)
+    Mat4 reverseRotationMatrix = inverse(thisRotation);
+    Mat4 otherToThis = reverseRotationMatrix *
+      translate(Mat4(1.0f), otherStartOffset - thisOffset) * otherRotation;
+    Vec4 motion = reverseRotationMatrix * Vec4(otherEndOffset - otherStartOffset, 0.0f);
+    float velocity[3] = { motion.x, motion.y, motion.z };
+
+    float r[3][3], absR[3][3], t[3];
+    for (int row = 0; row < 3; ++row) {
+      for (int col = 0; col < 3; ++col) {
+        r[row][col] = (&otherToThis.data[col].x)[row];
+        absR[row][col] = std::abs(r[row][col]) + 1e-6f;
+      }
+      t[row] = (&otherToThis.data[3].x)[row];
+    }
+
+    bool hit = false;
+    float closest = 1.0f;
+
+    // The nodes of the other tree are placed in the space of this set as
+    // axis aligned boxes, and skipped if they do not touch this set while
+    // moving, or only touch it after the earliest impact found so far.
+    const TreeNode& thisRoot = thisBoxes->tree[0];
+    std::vector<uint32_t> otherNodes(1, 0);
+    while (!otherNodes.empty()) {
+      const TreeNode& otherNode = otherBoxes->tree[otherNodes.back()];
+      otherNodes.pop_back();
+
+      float nodeCentre[3], nodeHalfSize[3];
+      for (int row = 0; row < 3; ++row) {
+        nodeCentre[row] = t[row];
+        nodeHalfSize[row] = 0.0f;
+        for (int col = 0; col < 3; ++col) {
+          nodeCentre[row] += r[row][col] * (otherNode.min[col] + otherNode.max[col]) / 2.0f;
+          nodeHalfSize[row] += absR[row][col] * (otherNode.max[col] - otherNode.min[col]) / 2.0f;
+        }
+      }
+      if (sweepBoxes(nodeCentre, nodeHalfSize, velocity, thisRoot.min, thisRoot.max, closest) < 0.0f) {
+        continue;
+      }
+
+      for (uint32_t child = otherNode.first; child < otherNode.first + otherNode.count; ++child) {
+        if (!otherNode.boxChildren) {
+          otherNodes.push_back(child);
+          continue;
+        }
+
+        float otherCentre[3] = { otherBoxes->centreX[child], otherBoxes->centreY[child],
+          otherBoxes->centreZ[child] };
+        float otherHalfSize[3] = { otherBoxes->halfX[child], otherBoxes->halfY[child],
+          otherBoxes->halfZ[child] };
+
+        float centre[3], halfSize[3];
+        for (int row = 0; row < 3; ++row) {
+          centre[row] = r[row][0] * otherCentre[0] + r[row][1] * otherCentre[1] +
+            r[row][2] * otherCentre[2] + t[row];
+          halfSize[row] = absR[row][0] * otherHalfSize[0] + absR[row][1] * otherHalfSize[1] +
+            absR[row][2] * otherHalfSize[2];
+        }
+
+        nodeSweep(*thisBoxes, 0, centre, halfSize, velocity, otherHalfSize, r, absR, closest, hit);
+      }
+    }
+
+    if (hit) {
+      timeOfImpact = closest;
+    }
+    return hit;
+  }
+
+  bool BoundingBoxSet::raycast(const Vec3& origin, const Vec3& direction, float maxDistance,
+    const Vec3& thisOffset, const Mat4& thisRotation, float& distance) const {
+
+    float directionLength = length(direction);
+    if (directionLength == 0.0f || boxExtremes.empty()) {
+      return false;
+    }
+
+    // The ray is brought into the space of the boxes, with a normalised
+    // direction, so that distances are the same in both spaces.
+    Mat4 reverseRotationMatrix = inverse(thisRotation);
+    Vec4 boxSpaceOrigin = reverseRotationMatrix * Vec4(origin - thisOffset, 1.0f);
+    Vec4 boxSpaceDirection = reverseRotationMatrix * Vec4(direction / directionLength, 0.0f);
+
+    float rayOrigin[3] = { boxSpaceOrigin.x, boxSpaceOrigin.y, boxSpaceOrigin.z };
+    float rayDirection[3] = { boxSpaceDirection.x, boxSpaceDirection.y, boxSpaceDirection.z };
+    float inverseDirection[3];
+    for (int axis = 0; axis < 3; ++axis) {
+      float component = rayDirection[axis] != 0.0f ? rayDirection[axis] : 1e-30f;
+      inverseDirection[axis] = 1.0f / component;
+    }
+
+    bool hit = false;
+    float closest = maxDistance;
+
+    if (!hasCurrentTree()) {
+      for (const auto& ex : boxExtremes) {
+        float min[3] = { ex.minX, ex.minY, ex.minZ };
+        float max[3] = { ex.maxX, ex.maxY, ex.maxZ };
+        float entry = rayEntry(min, max, rayOrigin, inverseDirection, closest);
+        if (entry >= 0.0f) {
+          closest = entry;
+          hit = true;
+        }
+      }
+    }
+    else {
+      nodeRaycast(0, rayOrigin, inverseDirection, closest, hit);
+    }
+
+    if (hit) {
+      distance = closest;
+    }
+    return hit;
+  }
+
+  void BoundingBoxSet::nodeRaycast(uint32_t node, const float* origin, const float* inverseDirection,
+    float& distance, bool& hit) const {
+    const TreeNode& treeNode = boxArrays.tree[node];
+    if (rayEntry(treeNode.min, treeNode.max, origin, inverseDirection, distance) < 0.0f) {
+      return;
+    }
+
+    for (uint32_t idx = treeNode.first; idx < treeNode.first + treeNode.count; ++idx) {
+      if (treeNode.boxChildren) {
+        const auto& ex = boxExtremes[idx];
+        float min[3] = { ex.minX, ex.minY, ex.minZ };
+        float max[3] = { ex.maxX, ex.maxY, ex.maxZ };
+        float entry = rayEntry(min, max, origin, inverseDirection, distance);
+        if (entry >= 0.0f) {
+          distance = entry;
+          hit = true;
+        }
+      }
+      else {
+        nodeRaycast(idx, origin, inverseDirection, distance, hit);
+      }
+    }
+  }
+
+  void BoundingBoxSet::BoxArrays::fill(const std::vector<extremes>& boxExtremes) {
+    size_t numBoxes = boxExtremes.size();
+    centreX.resize(numBoxes);
+    centreY.resize(numBoxes);
+    centreZ.resize(numBoxes);
+    halfX.resize(numBoxes);
+    halfY.resize(numBoxes);
+    halfZ.resize(numBoxes);
+
+    // Until buildTree is called, the boxes are all children of the root.
+    tree.assign(1, TreeNode());
+    TreeNode& root = tree[0];
+    root.count = static_cast<uint32_t>(numBoxes);
+    root.boxChildren = true;
+
+    for (size_t idx = 0; idx < numBoxes; ++idx) {
+      const auto& ex = boxExtremes[idx];
+      centreX[idx] = (ex.minX + ex.maxX) / 2.0f;
+      centreY[idx] = (ex.minY + ex.maxY) / 2.0f;
+      centreZ[idx] = (ex.minZ + ex.maxZ) / 2.0f;
+      halfX[idx] = (ex.maxX - ex.minX) / 2.0f;
+      halfY[idx] = (ex.maxY - ex.minY) / 2.0f;
+      halfZ[idx] = (ex.maxZ - ex.minZ) / 2.0f;
+
+      float exMin[3] = { ex.minX, ex.minY, ex.minZ };
+      float exMax[3] = { ex.maxX, ex.maxY, ex.maxZ };
+      for (int axis = 0; axis < 3; ++axis) {
+        root.min[axis] = idx == 0 ? exMin[axis] : std::min(root.min[axis], exMin[axis]);
+        root.max[axis] = idx == 0 ? exMax[axis] : std::max(root.max[axis], exMax[axis]);
+      }
+    }
+  }
+
+  void BoundingBoxSet::BoxArrays::buildTree(const std::vector<std::vector<uint32_t>>& childCounts) {
+    if (childCounts.empty()) {
+      return;
+    }
+
+    // One level of nodes per subdivision, stored level after level. The
+    // children of the nodes of each level are the nodes of the next one
+    // (or the boxes, for the last level), in the same order.
+    std::vector<uint32_t> levelOffsets;
+    uint32_t numNodes = 0;
+    for (const auto& levelCounts : childCounts) {
+      levelOffsets.push_back(numNodes);
+      numNodes += static_cast<uint32_t>(levelCounts.size());
+    }
+    levelOffsets.push_back(numNodes);
+
+    std::vector<TreeNode> newTree(numNodes);
+    size_t numLevels = childCounts.size();
+
+    for (size_t level = 0; level < numLevels; ++level) {
+      bool boxChildren = level == numLevels - 1;
+      uint32_t child = boxChildren ? 0 : levelOffsets[level + 1];
+      for (size_t idx = 0; idx < childCounts[level].size(); ++idx) {
+        TreeNode& node = newTree[levelOffsets[level] + idx];
+        node.first = child;
+        node.count = childCounts[level][idx];
+        node.boxChildren = boxChildren;
+        child += node.count;
+      }
+      uint32_t expected = boxChildren ? static_cast<uint32_t>(centreX.size()) : levelOffsets[level + 2];
+      if (child != expected) {
+        // The counts do not match the boxes, so the flat tree is kept.
+        return;
+      }
+    }
+
+    // Each node encloses its children, from the last level up
+    for (size_t level = numLevels; level-- > 0;) {
+      for (uint32_t idx = levelOffsets[level]; idx < levelOffsets[level + 1]; ++idx) {
+        TreeNode& node = newTree[idx];
+        for (uint32_t child = node.first; child < node.first + node.count; ++child) {
+          float childMin[3], childMax[3];
+          if (node.boxChildren) {
+            childMin[0] = centreX[child] - halfX[child];
+            childMin[1] = centreY[child] - halfY[child];
+            childMin[2] = centreZ[child] - halfZ[child];
+            childMax[0] = centreX[child] + halfX[child];
+            childMax[1] = centreY[child] + halfY[child];
+            childMax[2] = centreZ[child] + halfZ[child];
+          }
+          else {
+            std::copy(newTree[child].min, newTree[child].min + 3, childMin);
+            std::copy(newTree[child].max, newTree[child].max + 3, childMax);
+          }
+          for (int axis = 0; axis < 3; ++axis) {
+            node.min[axis] = child == node.first ? childMin[axis] : std::min(node.min[axis], childMin[axis]);
+            node.max[axis] = child == node.first ? childMax[axis] : std::max(node.max[axis], childMax[axis]);
+          }
+        }
+      }
+    }
+
+    tree = std::move(newTree);
+  }
+
+  bool BoundingBoxSet::nodeIntersects(const BoxArrays& boxes, uint32_t node, const float* centre,
+    const float* halfSize, const float* otherHalfSize, const float (*r)[3], const float (*absR)[3]) {
+
+    const TreeNode& treeNode = boxes.tree[node];
+    for (int axis = 0; axis < 3; ++axis) {
+      if (centre[axis] - halfSize[axis] > treeNode.max[axis] ||
+        centre[axis] + halfSize[axis] < treeNode.min[axis]) {
+        return false;
+      }
+    }
+
+    if (!treeNode.boxChildren) {
+      for (uint32_t child = treeNode.first; child < treeNode.first + treeNode.count; ++child) {
+        if (nodeIntersects(boxes, child, centre, halfSize, otherHalfSize, r, absR)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    for (uint32_t idx = treeNode.first; idx < treeNode.first + treeNode.count; ++idx) {
+      float thisHalfSize[3] = { boxes.halfX[idx], boxes.halfY[idx], boxes.halfZ[idx] };
+      float d[3] = { centre[0] - boxes.centreX[idx], centre[1] - boxes.centreY[idx],
+        centre[2] - boxes.centreZ[idx] };
+
+      // Axes of this box
+      if (std::abs(d[0]) > thisHalfSize[0] + halfSize[0] ||
+        std::abs(d[1]) > thisHalfSize[1] + halfSize[1] ||
+        std::abs(d[2]) > thisHalfSize[2] + halfSize[2]) {
+        continue;
+      }
+
+      bool separated = false;
+
+      // Axes of the other box
+      for (int col = 0; col < 3 && !separated; ++col) {
+        float projection = d[0] * r[0][col] + d[1] * r[1][col] + d[2] * r[2][col];
+        float radius = thisHalfSize[0] * absR[0][col] + thisHalfSize[1] * absR[1][col] +
+          thisHalfSize[2] * absR[2][col] + otherHalfSize[col];
+        separated = std::abs(projection) > radius;
+      }
+
+      // Cross products of the axes of the two boxes
+      for (int row = 0; row < 3 && !separated; ++row) {
+        int row1 = (row + 1) % 3;
+        int row2 = (row + 2) % 3;
+        for (int col = 0; col < 3 && !separated; ++col) {
+          int col1 = (col + 1) % 3;
+          int col2 = (col + 2) % 3;
+          float projection = d[row2] * r[row1][col] - d[row1] * r[row2][col];
+          float radius = thisHalfSize[row1] * absR[row2][col] + thisHalfSize[row2] * absR[row1][col] +
+            otherHalfSize[col1] * absR[row][col2] + otherHalfSize[col2] * absR[row][col1];
+          separated = std::abs(projection) > radius;
+        }
+      }
+
+      if (!separated) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool BoundingBoxSet::intersects(const BoundingBoxSet& otherBoxSet,
     const Vec3& thisOffset,
     const Mat4& thisRotation,
     const Vec3& otherOffset,
     const Mat4& otherRotation) const {
-    bool collides = false;
 
-    for (auto vertex = otherBoxSet.vertices.begin();
-      vertex != otherBoxSet.vertices.end(); ++vertex) {
+    if (boxExtremes.empty() || otherBoxSet.boxExtremes.empty()) {
+      return false;
+    }
 
-      Vec4 otherCoords(vertex->at(0), vertex->at(1), vertex->at(2), 1.0f);
-      Vec4 rotatedOtherCoords;
+    // The box arrays are filled when the boxes are generated. If the
+    // extremes have been modified since, they are filled again here.
+    BoxArrays thisRecalculated, otherRecalculated;
+    const BoxArrays* thisBoxes = &boxArrays;
+    const BoxArrays* otherBoxes = &otherBoxSet.boxArrays;
+    if (!hasCurrentTree()) {
+      thisRecalculated.fill(boxExtremes);
+      thisBoxes = &thisRecalculated;
+    }
+    if (!otherBoxSet.hasCurrentTree()) {
+      otherRecalculated.fill(otherBoxSet.boxExtremes);
+      otherBoxes = &otherRecalculated;
+    }
 
-      rotatedOtherCoords = otherRotation * otherCoords;
+    // The other set is placed in the space of this one once. r[i][j] is
+    // the dot product of axis i of this set and axis j of the other set.
+    // A small value is added to the absolute values, so that the cross
+    // products of nearly parallel axes do not cause false separations.
+    Mat4 otherToThis = inverse(thisRotation) *
+      translate(Mat4(1.0f), otherOffset - thisOffset) * otherRotation;
+
+    float r[3][3], absR[3][3], t[3];
+    for (int row = 0; row < 3; ++row) {
+      for (int col = 0; col < 3; ++col) {
+        r[row][col] = (&otherToThis.data[col].x)[row];
+        absR[row][col] = std::abs(r[row][col]) + 1e-6f;
+      }
+      t[row] = (&otherToThis.data[3].x)[row];
+    }
 
-      rotatedOtherCoords.x += otherOffset.x;
-      rotatedOtherCoords.y += otherOffset.y;
-      rotatedOtherCoords.z += otherOffset.z;
+    // The box enclosing this set, in the space of the other one. The
+    // nodes of the other tree outside it are skipped.
+    const TreeNode& thisRoot = thisBoxes->tree[0];
+    float thisSetMin[3], thisSetMax[3];
+    for (int col = 0; col < 3; ++col) {
+      float centre = 0.0f, halfSize = 0.0f;
+      for (int row = 0; row < 3; ++row) {
+        centre += r[row][col] * ((thisRoot.min[row] + thisRoot.max[row]) / 2.0f - t[row]);
+        halfSize += absR[row][col] * (thisRoot.max[row] - thisRoot.min[row]) / 2.0f;
+      }
+      thisSetMin[col] = centre - halfSize;
+      thisSetMax[col] = centre + halfSize;
+    }
 
-      if (contains(Vec3(rotatedOtherCoords.x, rotatedOtherCoords.y,
-        rotatedOtherCoords.z),
-        thisOffset, thisRotation)) {
+    std::vector<uint32_t> otherNodes(1, 0);
+    while (!otherNodes.empty()) {
+      const TreeNode& otherNode = otherBoxes->tree[otherNodes.back()];
+      otherNodes.pop_back();
 
-        collides = true;
-        break;
+      bool outside = false;
+      for (int axis = 0; axis < 3; ++axis) {
+        outside = outside || otherNode.max[axis] < thisSetMin[axis] || otherNode.min[axis] > thisSetMax[axis];
+      }
+      if (outside) continue;
+
+      for (uint32_t child = otherNode.first; child < otherNode.first + otherNode.count; ++child) {
+        if (!otherNode.boxChildren) {
+          otherNodes.push_back(child);
+          continue;
+        }
+
+        float otherCentre[3] = { otherBoxes->centreX[child], otherBoxes->centreY[child],
+          otherBoxes->centreZ[child] };
+        float otherHalfSize[3] = { otherBoxes->halfX[child], otherBoxes->halfY[child],
+          otherBoxes->halfZ[child] };
+
+        // The other box in the space of this set: its centre and the half
+        // size of the axis aligned box enclosing it
+        float centre[3], halfSize[3];
+        for (int row = 0; row < 3; ++row) {
+          centre[row] = r[row][0] * otherCentre[0] + r[row][1] * otherCentre[1] +
+            r[row][2] * otherCentre[2] + t[row];
+          halfSize[row] = absR[row][0] * otherHalfSize[0] + absR[row][1] * otherHalfSize[1] +
+            absR[row][2] * otherHalfSize[2];
+        }
+
+        if (nodeIntersects(*thisBoxes, 0, centre, halfSize, otherHalfSize, r, absR)) {
+          return true;
+        }
       }
     }
-    return collides;
+    return false;
   }
 
   void BoundingBoxSet::triangulate()
@@ -158,6 +756,8 @@ namespace small3d {
       ++numBoxes;
     }
     triangulate();
+    boxArrays.fill(boxExtremes);
+    treeExtremes = boxExtremes;
   }
 
   void BoundingBoxSet::generateExtremes(const std::vector<float>& vertexData, const Vec3& scale, uint32_t subdivisions) {
@@ -167,154 +767,150 @@ namespace small3d {
     boxExtremes.clear();
     extremes ex;
 
-    Vec4 vertex(0.0f, 0.0f, 0.0f, 0.0f);
-
-    for (uint32_t idx = 0; idx < vertexData.size(); ++idx) {
+    // Scale all the vertices once, rather than on every subdivision
+    size_t numVertices = vertexData.size() / 4;
+    std::vector<float> scaledVertexData(numVertices * 4);
+    transformPoints(small3d::scale(Mat4(1.0f), scale), vertexData.data(),
+      scaledVertexData.data(), numVertices, true);
 
-      switch (idx % 4) {
-      case 0:
-        vertex.x = vertexData[idx];
-        break;
-      case 1:
-        vertex.y = vertexData[idx];
-        break;
-      case 2:
-        vertex.z = vertexData[idx];
-        break;
-      case 3:
-        vertex.w = vertexData[idx];
-        vertex = small3d::scale(Mat4(1.0f), scale) * vertex;
+    for (size_t idx = 0; idx < scaledVertexData.size(); idx += 4) {
+      float x = scaledVertexData[idx];
+      float y = scaledVertexData[idx + 1];
+      float z = scaledVertexData[idx + 2];
 
-        if (vertex.x < ex.minX) ex.minX = vertex.x;
-        else if (vertex.x > ex.maxX) ex.maxX = vertex.x;
+      if (x < ex.minX) ex.minX = x;
+      else if (x > ex.maxX) ex.maxX = x;
 
-        if (vertex.y < ex.minY) ex.minY = vertex.y;
-        else if (vertex.y > ex.maxY) ex.maxY = vertex.y;
+      if (y < ex.minY) ex.minY = y;
+      else if (y > ex.maxY) ex.maxY = y;
 
-        if (vertex.z < ex.minZ) ex.minZ = vertex.z;
-        else if (vertex.z > ex.maxZ) ex.maxZ = vertex.z;
-        
-      }
+      if (z < ex.minZ) ex.minZ = z;
+      else if (z > ex.maxZ) ex.maxZ = z;
     }
 
     boxExtremes.push_back(ex);
 
+    // The vertices in each box (as pairs of vertex and box indexes), so
+    // that only the vertices in a box are checked when it is divided
+    std::vector<uint32_t> vertexRefs(numVertices), vertexBoxes(numVertices, 0);
+    for (size_t idx = 0; idx < numVertices; ++idx) {
+      vertexRefs[idx] = static_cast<uint32_t>(idx);
+    }
+
+    subdivisionCounts.assign(subdivisions, std::vector<uint32_t>());
     for (uint32_t idx = 0; idx < subdivisions; ++idx) {
-      generateSubExtremes(vertexData, scale);
+      generateSubExtremes(scaledVertexData, vertexRefs, vertexBoxes, subdivisionCounts[idx]);
     }
     generateBoxesFromExtremes();
+    boxArrays.buildTree(subdivisionCounts);
   }
 
-  void BoundingBoxSet::generateSubExtremes(const std::vector<float>& vertexData, const Vec3& scale) {
+  void BoundingBoxSet::generateSubExtremes(const std::vector<float>& scaledVertexData,
+    std::vector<uint32_t>& vertexRefs, std::vector<uint32_t>& vertexBoxes,
+    std::vector<uint32_t>& childCounts) {
 
     // Move all extremes to a temporary buffer
     std::vector<extremes> extBuffer;
 
     std::move(boxExtremes.begin(), boxExtremes.end(), std::back_inserter(extBuffer));
     boxExtremes.clear();
+    size_t numParents = extBuffer.size();
+
     // Break each extreme into 8
-    for (const auto& ext : extBuffer) {
+    std::vector<extremes> newExtremes(numParents * 8);
+    for (size_t parent = 0; parent < numParents; ++parent) {
+      const auto& ext = extBuffer[parent];
 
       float xSplit = ext.minX + (ext.maxX - ext.minX) / 2.0f;
       float zSplit = ext.minZ + (ext.maxZ - ext.minZ) / 2.0f;
       float ySplit = ext.minY + (ext.maxY - ext.minY) / 2.0f;
 
-      std::vector<extremes> newExtremes;
-      newExtremes.resize(8);
-
-      newExtremes[0].minX = ext.minX;
-      newExtremes[0].maxX = xSplit;
-      newExtremes[0].minZ = ext.minZ;
-      newExtremes[0].maxZ = zSplit;
-      newExtremes[0].minY = ext.minY;
-      newExtremes[0].maxY = ySplit;
-
-      newExtremes[1].minX = ext.minX;
-      newExtremes[1].maxX = xSplit;
-      newExtremes[1].minZ = zSplit;
-      newExtremes[1].maxZ = ext.maxZ;
-      newExtremes[1].minY = ext.minY;
-      newExtremes[1].maxY = ySplit;
-
-      newExtremes[2].minX = xSplit;
-      newExtremes[2].maxX = ext.maxX;
-      newExtremes[2].minZ = zSplit;
-      newExtremes[2].maxZ = ext.maxZ;
-      newExtremes[2].minY = ext.minY;
-      newExtremes[2].maxY = ySplit;
-
-      newExtremes[3].minX = xSplit;
-      newExtremes[3].maxX = ext.maxX;
-      newExtremes[3].minZ = ext.minZ;
-      newExtremes[3].maxZ = zSplit;
-      newExtremes[3].minY = ext.minY;
-      newExtremes[3].maxY = ySplit;
-
-      newExtremes[4].minX = ext.minX;
-      newExtremes[4].maxX = xSplit;
-      newExtremes[4].minZ = ext.minZ;
-      newExtremes[4].maxZ = zSplit;
-      newExtremes[4].minY = ySplit;
-      newExtremes[4].maxY = ext.maxY;
-
-      newExtremes[5].minX = ext.minX;
-      newExtremes[5].maxX = xSplit;
-      newExtremes[5].minZ = zSplit;
-      newExtremes[5].maxZ = ext.maxZ;
-      newExtremes[5].minY = ySplit;
-      newExtremes[5].maxY = ext.maxY;
-
-      newExtremes[6].minX = xSplit;
-      newExtremes[6].maxX = ext.maxX;
-      newExtremes[6].minZ = zSplit;
-      newExtremes[6].maxZ = ext.maxZ;
-      newExtremes[6].minY = ySplit;
-      newExtremes[6].maxY = ext.maxY;
-
-      newExtremes[7].minX = xSplit;
-      newExtremes[7].maxX = ext.maxX;
-      newExtremes[7].minZ = ext.minZ;
-      newExtremes[7].maxZ = zSplit;
-      newExtremes[7].minY = ySplit;
-      newExtremes[7].maxY = ext.maxY;
-
-      Vec4 point;
-
-      // From the newly formed extremes keep only the ones that
-      // contain one of the model's vertices
-
-      for (uint32_t idx = 0; idx < vertexData.size(); ++idx) {
-
-        switch (idx % 4) {
-        case 0:
-          point.x = vertexData[idx];
-          break;
-        case 1:
-          point.y = vertexData[idx];
-          break;
-        case 2:
-          point.z = vertexData[idx];
-          break;
-        case 3:
-          point.w = vertexData[idx];
-
-          point = small3d::scale(Mat4(1.0f), scale) * point;
-
-          for (auto& ex : newExtremes) {
-
-            if (point.x >= ex.minX && point.x <= ex.maxX &&
-              point.y >= ex.minY && point.y <= ex.maxY &&
-              point.z >= ex.minZ && point.z <= ex.maxZ) ex.tagged = true;
-
-            
-          }
+      for (int child = 0; child < 8; ++child) {
+        extremes& ex = newExtremes[parent * 8 + child];
+        bool upperX = child == 2 || child == 3 || child == 6 || child == 7;
+        bool upperZ = child == 1 || child == 2 || child == 5 || child == 6;
+        bool upperY = child >= 4;
+
+        ex.minX = upperX ? xSplit : ext.minX;
+        ex.maxX = upperX ? ext.maxX : xSplit;
+        ex.minZ = upperZ ? zSplit : ext.minZ;
+        ex.maxZ = upperZ ? ext.maxZ : zSplit;
+        ex.minY = upperY ? ySplit : ext.minY;
+        ex.maxY = upperY ? ext.maxY : ySplit;
+      }
+    }
+
+    // Find which of the new extremes of its box each vertex is in. A
+    // vertex on a split is in more than one. The vertices are divided
+    // among threads, each one also noting which new extremes contain
+    // any of its vertices.
+    size_t numRefs = vertexRefs.size();
+    std::vector<uint8_t> vertexMasks(numRefs);
+
+    ThreadPool& threadPool = ThreadPool::getInstance();
+    size_t numThreads = std::max(static_cast<size_t>(1),
+      std::min(static_cast<size_t>(threadPool.getNumThreads()), numRefs / minVerticesPerThread));
+    size_t chunk = (numRefs + numThreads - 1) / numThreads;
+    std::vector<std::vector<uint8_t>> threadMasks(numThreads, std::vector<uint8_t>(numParents, 0));
+
+    auto binVertices = [&](size_t thread) {
+      std::vector<uint8_t>& parentMasks = threadMasks[thread];
+      size_t end = std::min(numRefs, (thread + 1) * chunk);
+      for (size_t ref = thread * chunk; ref < end; ++ref) {
+        float x = scaledVertexData[vertexRefs[ref] * 4];
+        float y = scaledVertexData[vertexRefs[ref] * 4 + 1];
+        float z = scaledVertexData[vertexRefs[ref] * 4 + 2];
+        uint32_t parent = vertexBoxes[ref];
+
+        uint8_t mask = 0;
+        for (int child = 0; child < 8; ++child) {
+          const extremes& ex = newExtremes[parent * 8 + child];
+          if (x >= ex.minX && x <= ex.maxX &&
+            y >= ex.minY && y <= ex.maxY &&
+            z >= ex.minZ && z <= ex.maxZ) mask |= static_cast<uint8_t>(1 << child);
         }
+        vertexMasks[ref] = mask;
+        parentMasks[parent] |= mask;
       }
+    };
 
-      std::copy_if(newExtremes.begin(), newExtremes.end(), std::back_inserter(boxExtremes),
-        [](const auto& ex) {return ex.tagged; });
+    threadPool.run(numThreads, binVertices);
 
+    // From the newly formed extremes keep only the ones that
+    // contain one of the model's vertices
+    std::vector<uint32_t> newIndexes(numParents * 8, 0);
+    for (size_t parent = 0; parent < numParents; ++parent) {
+      uint8_t mask = 0;
+      for (const auto& parentMasks : threadMasks) {
+        mask |= parentMasks[parent];
+      }
+
+      uint32_t numKept = 0;
+      for (int child = 0; child < 8; ++child) {
+        if (mask & (1 << child)) {
+          newIndexes[parent * 8 + child] = static_cast<uint32_t>(boxExtremes.size());
+          boxExtremes.push_back(newExtremes[parent * 8 + child]);
+          boxExtremes.back().tagged = true;
+          ++numKept;
+        }
+      }
+      childCounts.push_back(numKept);
+    }
+
+    // The vertices of the kept extremes, for the next subdivision
+    std::vector<uint32_t> newRefs, newBoxes;
+    newRefs.reserve(numRefs);
+    newBoxes.reserve(numRefs);
+    for (size_t ref = 0; ref < numRefs; ++ref) {
+      for (int child = 0; child < 8; ++child) {
+        if (vertexMasks[ref] & (1 << child)) {
+          newRefs.push_back(vertexRefs[ref]);
+          newBoxes.push_back(newIndexes[vertexBoxes[ref] * 8 + child]);
+        }
+      }
     }
+    vertexRefs.swap(newRefs);
+    vertexBoxes.swap(newBoxes);
 
   }
 
@@ -322,6 +918,86 @@ namespace small3d {
     return numBoxes;
   }
 
+  uint32_t BoundingBoxSet::getNumSubdivisions() const {
+    return static_cast<uint32_t>(subdivisionCounts.size());
+  }
+
+  void BoundingBoxSet::refreshTree() {
+    generateBoxesFromExtremes();
+    // If boxes have been added or removed, the counts of the subdivisions
+    // no longer match them and the boxes are all kept under the root.
+    boxArrays.buildTree(subdivisionCounts);
+  }
+
+  bool BoundingBoxSet::hasCurrentTree() const {
+    if (boxArrays.tree.empty() || treeExtremes.size() != boxExtremes.size()) {
+      return false;
+    }
+    // Copies of the extremes normally match byte for byte, so they are
+    // compared as a block first, and only coordinate by coordinate if
+    // that fails (the padding of the structure may differ).
+    if (std::memcmp(treeExtremes.data(), boxExtremes.data(),
+      boxExtremes.size() * sizeof(extremes)) == 0) {
+      return true;
+    }
+    return std::equal(boxExtremes.begin(), boxExtremes.end(), treeExtremes.begin(),
+      [](const extremes& ex, const extremes& treeEx) {
+        return ex.minX == treeEx.minX && ex.maxX == treeEx.maxX &&
+          ex.minY == treeEx.minY && ex.maxY == treeEx.maxY &&
+          ex.minZ == treeEx.minZ && ex.maxZ == treeEx.maxZ;
+      });
+  }
+
+  std::shared_ptr<BoundingBoxSet> BoundingBoxSet::getCached(const Model& model, uint32_t subdivisions) {
+
+    // A single box is not worth keeping in the cache
+    if (subdivisions == 0) {
+      return std::make_shared<BoundingBoxSet>(model.vertexData, model.origScale, subdivisions);
+    }
+
+    auto key = cacheKey(model.dataGeneration, model.origScale, subdivisions);
+
+    {
+      std::lock_guard<std::mutex> lock(cacheMutex);
+      auto entry = cache.find(key);
+      if (entry != cache.end()) {
+        if (auto boxSet = entry->second.lock()) return boxSet;
+      }
+    }
+
+    // The box set is created without holding the lock, so that box sets
+    // for different models can be created at the same time.
+    auto boxSet = std::make_shared<BoundingBoxSet>(model.vertexData, model.origScale, subdivisions);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto entry = cache.find(key);
+    if (entry != cache.end()) {
+      if (auto existing = entry->second.lock()) return existing;
+    }
+    removeDestroyedFromCache();
+    cache[key] = boxSet;
+    return boxSet;
+  }
+
+  void BoundingBoxSet::addToCache(Model& model, std::shared_ptr<BoundingBoxSet> boxSet) {
+    model.loadedBoundingBoxSets.push_back(boxSet);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    removeDestroyedFromCache();
+    cache[cacheKey(model.dataGeneration, model.origScale, boxSet->getNumSubdivisions())] = boxSet;
+  }
+
+  void BoundingBoxSet::clearCache() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cache.clear();
+  }
+
+  size_t BoundingBoxSet::getCacheSize() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    removeDestroyedFromCache();
+    return cache.size();
+  }
+
   std::vector<Model> BoundingBoxSet::getModels() {
 
     std::vector<Model> models;
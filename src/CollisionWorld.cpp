@@ -0,0 +1,677 @@
+/*
+ *  CollisionWorld.cpp
+ *
+ *  Created on: 2026/10/18
+ *      Author: Dimitri Kourkoulis
+ *     License: BSD 3-Clause License (see LICENSE file)
+ */
+
+#include "CollisionWorld.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace small3d {
+
+  // How many updates ahead the enlarged boxes of moving objects are
+  // extended, in the direction of their latest displacement
+  static const float displacementFactor = 4.0f;
+
+  static inline bool overlap(const float* min1, const float* max1, const float* min2, const float* max2) {
+    return min1[0] <= max2[0] && max1[0] >= min2[0] &&
+      min1[1] <= max2[1] && max1[1] >= min2[1] &&
+      min1[2] <= max2[2] && max1[2] >= min2[2];
+  }
+
+  static inline bool encloses(const float* outerMin, const float* outerMax, const float* min, const float* max) {
+    return outerMin[0] <= min[0] && outerMin[1] <= min[1] && outerMin[2] <= min[2] &&
+      outerMax[0] >= max[0] && outerMax[1] >= max[1] && outerMax[2] >= max[2];
+  }
+
+  // Half the surface area of the box enclosing two boxes, the cost
+  // used to decide where new leaves are placed in the tree
+  static inline float halfArea(const float* min1, const float* max1, const float* min2, const float* max2) {
+    float x = std::max(max1[0], max2[0]) - std::min(min1[0], min2[0]);
+    float y = std::max(max1[1], max2[1]) - std::min(min1[1], min2[1]);
+    float z = std::max(max1[2], max2[2]) - std::min(min1[2], min2[2]);
+    return x * y + y * z + z * x;
+  }
+
+  static inline float halfArea(const float* min, const float* max) {
+    return halfArea(min, max, min, max);
+  }
+
+  // Rays are cast by the threads of the ThreadPool, if there are at
+  // least this many per thread.
+  static const size_t minRaysPerThread = 256;
+
+  // The distance along a ray at which it enters a box, or -1 if it does
+  // not enter it within maxDistance
+  static inline float rayEntry(const float* min, const float* max, const float* origin,
+    const float* inverseDirection, float maxDistance) {
+    float entryDistance = 0.0f, exitDistance = maxDistance;
+    for (int axis = 0; axis < 3; ++axis) {
+      float t1 = (min[axis] - origin[axis]) * inverseDirection[axis];
+      float t2 = (max[axis] - origin[axis]) * inverseDirection[axis];
+      if (t1 > t2) std::swap(t1, t2);
+      entryDistance = std::max(entryDistance, t1);
+      exitDistance = std::min(exitDistance, t2);
+      if (entryDistance > exitDistance) return -1.0f;
+    }
+    return entryDistance;
+  }
+
+  static inline void enclose(const float* min1, const float* max1, const float* min2, const float* max2,
+    float* min, float* max) {
+    for (int axis = 0; axis < 3; ++axis) {
+      min[axis] = std::min(min1[axis], min2[axis]);
+      max[axis] = std::max(max1[axis], max2[axis]);
+    }
+  }
+
+  int32_t CollisionWorld::allocateNode() {
+    if (freeNode < 0) {
+      nodes.emplace_back();
+      nodes.back().height = 0;
+      return static_cast<int32_t>(nodes.size() - 1);
+    }
+    int32_t node = freeNode;
+    freeNode = nodes[node].parent;
+    nodes[node] = Node();
+    nodes[node].height = 0;
+    return node;
+  }
+
+  void CollisionWorld::freeNodeAt(int32_t node) {
+    nodes[node] = Node();
+    nodes[node].parent = freeNode;
+    freeNode = node;
+  }
+
+  void CollisionWorld::insertLeaf(int32_t leaf) {
+    if (root < 0) {
+      root = leaf;
+      nodes[leaf].parent = -1;
+      return;
+    }
+
+    // Descend towards the sibling that enlarges the tree the least
+    AABB leafBox = nodes[leaf].box;
+    int32_t index = root;
+    while (nodes[index].child1 >= 0) {
+      const Node& node = nodes[index];
+      float area = halfArea(node.box.min, node.box.max);
+      float combinedArea = halfArea(node.box.min, node.box.max, leafBox.min, leafBox.max);
+
+      // Cost of making the leaf and this node siblings
+      float cost = 2.0f * combinedArea;
+
+      // Cost that the leaf adds to every ancestor, if it goes further down
+      float inheritanceCost = 2.0f * (combinedArea - area);
+
+      auto descendCost = [&](int32_t child) {
+        const AABB& box = nodes[child].box;
+        float newArea = halfArea(box.min, box.max, leafBox.min, leafBox.max);
+        if (nodes[child].child1 < 0) {
+          return newArea + inheritanceCost;
+        }
+        return newArea - halfArea(box.min, box.max) + inheritanceCost;
+      };
+
+      float cost1 = descendCost(node.child1);
+      float cost2 = descendCost(node.child2);
+
+      if (cost < cost1 && cost < cost2) {
+        break;
+      }
+      index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    int32_t sibling = index;
+    int32_t oldParent = nodes[sibling].parent;
+    int32_t newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    enclose(leafBox.min, leafBox.max, nodes[sibling].box.min, nodes[sibling].box.max,
+      nodes[newParent].box.min, nodes[newParent].box.max);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent >= 0) {
+      if (nodes[oldParent].child1 == sibling) {
+        nodes[oldParent].child1 = newParent;
+      }
+      else {
+        nodes[oldParent].child2 = newParent;
+      }
+    }
+    else {
+      root = newParent;
+    }
+
+    // Fix the heights and boxes of the ancestors
+    index = nodes[leaf].parent;
+    while (index >= 0) {
+      index = balance(index);
+      Node& node = nodes[index];
+      node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+      enclose(nodes[node.child1].box.min, nodes[node.child1].box.max,
+        nodes[node.child2].box.min, nodes[node.child2].box.max, node.box.min, node.box.max);
+      index = node.parent;
+    }
+  }
+
+  void CollisionWorld::removeLeaf(int32_t leaf) {
+    if (leaf == root) {
+      root = -1;
+      return;
+    }
+
+    int32_t parent = nodes[leaf].parent;
+    int32_t grandParent = nodes[parent].parent;
+    int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    if (grandParent >= 0) {
+      if (nodes[grandParent].child1 == parent) {
+        nodes[grandParent].child1 = sibling;
+      }
+      else {
+        nodes[grandParent].child2 = sibling;
+      }
+      nodes[sibling].parent = grandParent;
+      freeNodeAt(parent);
+
+      int32_t index = grandParent;
+      while (index >= 0) {
+        index = balance(index);
+        Node& node = nodes[index];
+        node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+        enclose(nodes[node.child1].box.min, nodes[node.child1].box.max,
+          nodes[node.child2].box.min, nodes[node.child2].box.max, node.box.min, node.box.max);
+        index = node.parent;
+      }
+    }
+    else {
+      root = sibling;
+      nodes[sibling].parent = -1;
+      freeNodeAt(parent);
+    }
+    nodes[leaf].parent = -1;
+  }
+
+  // If one child of a node is more than one level taller than the other,
+  // rotate the taller child up. Returns the node now at the position
+  // of the given one.
+  int32_t CollisionWorld::balance(int32_t a) {
+    if (nodes[a].child1 < 0 || nodes[a].height < 2) {
+      return a;
+    }
+
+    int32_t b = nodes[a].child1;
+    int32_t c = nodes[a].child2;
+    int32_t heightDifference = nodes[c].height - nodes[b].height;
+
+    if (heightDifference > 1 || heightDifference < -1) {
+      // up: the taller child, which replaces a
+      // other: the shorter child, which stays under a
+      bool rightTaller = heightDifference > 1;
+      int32_t up = rightTaller ? c : b;
+      int32_t other = rightTaller ? b : c;
+      int32_t f = nodes[up].child1;
+      int32_t g = nodes[up].child2;
+
+      nodes[up].child1 = a;
+      nodes[up].parent = nodes[a].parent;
+      nodes[a].parent = up;
+
+      if (nodes[up].parent >= 0) {
+        if (nodes[nodes[up].parent].child1 == a) {
+          nodes[nodes[up].parent].child1 = up;
+        }
+        else {
+          nodes[nodes[up].parent].child2 = up;
+        }
+      }
+      else {
+        root = up;
+      }
+
+      // The taller grandchild stays with up, the other one moves under a,
+      // in the place up had.
+      int32_t keep = nodes[f].height > nodes[g].height ? f : g;
+      int32_t move = keep == f ? g : f;
+
+      nodes[up].child2 = keep;
+      if (rightTaller) {
+        nodes[a].child2 = move;
+      }
+      else {
+        nodes[a].child1 = move;
+      }
+      nodes[move].parent = a;
+
+      enclose(nodes[other].box.min, nodes[other].box.max, nodes[move].box.min, nodes[move].box.max,
+        nodes[a].box.min, nodes[a].box.max);
+      nodes[a].height = 1 + std::max(nodes[other].height, nodes[move].height);
+
+      enclose(nodes[a].box.min, nodes[a].box.max, nodes[keep].box.min, nodes[keep].box.max,
+        nodes[up].box.min, nodes[up].box.max);
+      nodes[up].height = 1 + std::max(nodes[a].height, nodes[keep].height);
+
+      return up;
+    }
+
+    return a;
+  }
+
+  CollisionWorld::AABB CollisionWorld::calculateBox(const Proxy& proxy) const {
+    const Mat4& transformation = proxy.object->getTransformation();
+    const Vec3& position = proxy.object->position;
+    const float* centre = &proxy.localCentre.x;
+    const float* halfSize = &proxy.localHalfSize.x;
+
+    // Transform the centre and project the rotated half size
+    // on each axis.
+    AABB box;
+    for (int axis = 0; axis < 3; ++axis) {
+      const float* column0 = &transformation.data[0].x;
+      const float* column1 = &transformation.data[1].x;
+      const float* column2 = &transformation.data[2].x;
+      const float* column3 = &transformation.data[3].x;
+
+      float worldCentre = column0[axis] * centre[0] + column1[axis] * centre[1] +
+        column2[axis] * centre[2] + column3[axis] + (&position.x)[axis];
+      float worldHalfSize = std::abs(column0[axis]) * halfSize[0] +
+        std::abs(column1[axis]) * halfSize[1] + std::abs(column2[axis]) * halfSize[2];
+
+      box.min[axis] = worldCentre - worldHalfSize;
+      box.max[axis] = worldCentre + worldHalfSize;
+    }
+    return box;
+  }
+
+  void CollisionWorld::enlargeBox(int32_t leaf, const AABB& box, const AABB& previousBox) {
+    AABB& enlarged = nodes[leaf].box;
+    for (int axis = 0; axis < 3; ++axis) {
+      float displacement = displacementFactor *
+        (box.min[axis] + box.max[axis] - previousBox.min[axis] - previousBox.max[axis]) / 2.0f;
+      enlarged.min[axis] = box.min[axis] - margin + std::min(displacement, 0.0f);
+      enlarged.max[axis] = box.max[axis] + margin + std::max(displacement, 0.0f);
+    }
+  }
+
+  uint32_t CollisionWorld::add(SceneObject& object) {
+    const auto& boxExtremes = object.boundingBoxSet->boxExtremes;
+    if (object.boundingBoxSet->vertices.size() == 0 || boxExtremes.empty()) {
+      throw std::runtime_error("No bounding boxes have been provided for " +
+        object.getName() +
+        ", so collision detection is not enabled.");
+    }
+
+    Proxy proxy;
+    proxy.object = &object;
+    proxy.sweepStart = object.position;
+
+    Vec3 localMin(boxExtremes[0].minX, boxExtremes[0].minY, boxExtremes[0].minZ);
+    Vec3 localMax(boxExtremes[0].maxX, boxExtremes[0].maxY, boxExtremes[0].maxZ);
+    for (const auto& ex : boxExtremes) {
+      localMin = Vec3(std::min(localMin.x, ex.minX), std::min(localMin.y, ex.minY),
+        std::min(localMin.z, ex.minZ));
+      localMax = Vec3(std::max(localMax.x, ex.maxX), std::max(localMax.y, ex.maxY),
+        std::max(localMax.z, ex.maxZ));
+    }
+    proxy.localCentre = (localMin + localMax) / 2.0f;
+    proxy.localHalfSize = (localMax - localMin) / 2.0f;
+    proxy.box = calculateBox(proxy);
+
+    uint32_t id;
+    if (freeProxies.empty()) {
+      id = static_cast<uint32_t>(proxies.size());
+      proxies.push_back(proxy);
+    }
+    else {
+      id = freeProxies.back();
+      freeProxies.pop_back();
+      proxies[id] = proxy;
+    }
+
+    int32_t leaf = allocateNode();
+    nodes[leaf].proxy = static_cast<int32_t>(id);
+    enlargeBox(leaf, proxy.box, proxy.box);
+    proxies[id].leaf = leaf;
+    insertLeaf(leaf);
+
+    return id;
+  }
+
+  void CollisionWorld::remove(uint32_t id) {
+    if (id >= proxies.size() || proxies[id].object == nullptr) {
+      throw std::runtime_error("Object " + std::to_string(id) + " is not in the collision world.");
+    }
+    int32_t leaf = proxies[id].leaf;
+    removeLeaf(leaf);
+    freeNodeAt(leaf);
+    proxies[id] = Proxy();
+    freeProxies.push_back(id);
+  }
+
+  size_t CollisionWorld::getNumObjects() const {
+    return proxies.size() - freeProxies.size();
+  }
+
+  void CollisionWorld::update() {
+    updateProxies(false);
+  }
+
+  void CollisionWorld::updateProxies(bool swept) {
+    for (auto& proxy : proxies) {
+      if (proxy.object == nullptr) continue;
+
+      AABB previousBox = proxy.box;
+      proxy.box = calculateBox(proxy);
+
+      // When sweeping, the box covered since the previous sweep (the
+      // current box and the same box at the previous position) must
+      // also be enclosed in the tree.
+      const AABB* requiredBox = &proxy.box;
+      if (swept) {
+        const float* start = &proxy.sweepStart.x;
+        const float* position = &proxy.object->position.x;
+        for (int axis = 0; axis < 3; ++axis) {
+          float displacement = position[axis] - start[axis];
+          proxy.sweptBox.min[axis] = proxy.box.min[axis] - std::max(displacement, 0.0f);
+          proxy.sweptBox.max[axis] = proxy.box.max[axis] - std::min(displacement, 0.0f);
+        }
+        requiredBox = &proxy.sweptBox;
+      }
+
+      const AABB& enlarged = nodes[proxy.leaf].box;
+      if (!encloses(enlarged.min, enlarged.max, requiredBox->min, requiredBox->max)) {
+        removeLeaf(proxy.leaf);
+        enlargeBox(proxy.leaf, *requiredBox, swept ? *requiredBox : previousBox);
+        insertLeaf(proxy.leaf);
+      }
+    }
+  }
+
+  void CollisionWorld::findProxyPairs(bool swept) {
+    proxyPairs.clear();
+
+    // Walk the tree against itself. A node paired with itself stands for
+    // the pairs among the leaves under it. Each pair of leaves is reached
+    // once, so each pair of objects is reported once.
+    auto pushIfOverlapping = [this](int32_t a, int32_t b) {
+      const AABB& boxA = nodes[a].box;
+      const AABB& boxB = nodes[b].box;
+      if (overlap(boxA.min, boxA.max, boxB.min, boxB.max)) {
+        pairStack.emplace_back(a, b);
+      }
+    };
+
+    pairStack.clear();
+    if (root >= 0 && nodes[root].child1 >= 0) pairStack.emplace_back(root, root);
+
+    while (!pairStack.empty()) {
+      int32_t a = pairStack.back().first;
+      int32_t b = pairStack.back().second;
+      pairStack.pop_back();
+
+      const Node& nodeA = nodes[a];
+      const Node& nodeB = nodes[b];
+
+      if (a == b) {
+        if (nodes[nodeA.child1].child1 >= 0) pairStack.emplace_back(nodeA.child1, nodeA.child1);
+        if (nodes[nodeA.child2].child1 >= 0) pairStack.emplace_back(nodeA.child2, nodeA.child2);
+        pushIfOverlapping(nodeA.child1, nodeA.child2);
+        continue;
+      }
+
+      bool leafA = nodeA.child1 < 0;
+      bool leafB = nodeB.child1 < 0;
+
+      if (leafA && leafB) {
+        // Compare the boxes of the objects, not the enlarged ones
+        const Proxy& proxyA = proxies[nodeA.proxy];
+        const Proxy& proxyB = proxies[nodeB.proxy];
+        const AABB& boxA = swept ? proxyA.sweptBox : proxyA.box;
+        const AABB& boxB = swept ? proxyB.sweptBox : proxyB.box;
+        if (overlap(boxA.min, boxA.max, boxB.min, boxB.max)) {
+          proxyPairs.emplace_back(nodeA.proxy, nodeB.proxy);
+        }
+      }
+      else if (leafB || (!leafA && nodeA.height >= nodeB.height)) {
+        pushIfOverlapping(nodeA.child1, b);
+        pushIfOverlapping(nodeA.child2, b);
+      }
+      else {
+        pushIfOverlapping(a, nodeB.child1);
+        pushIfOverlapping(a, nodeB.child2);
+      }
+    }
+  }
+
+  const std::vector<std::pair<SceneObject*, SceneObject*>>& CollisionWorld::findCandidatePairs() {
+    update();
+    findProxyPairs(false);
+
+    candidatePairs.clear();
+    for (const auto& pair : proxyPairs) {
+      candidatePairs.emplace_back(proxies[pair.first].object, proxies[pair.second].object);
+    }
+    return candidatePairs;
+  }
+
+  const std::vector<std::pair<SceneObject*, SceneObject*>>& CollisionWorld::findCollisions() {
+    findCandidatePairs();
+
+    collisions.clear();
+    for (const auto& pair : candidatePairs) {
+      if (pair.first->intersects(*pair.second)) {
+        collisions.push_back(pair);
+      }
+    }
+    return collisions;
+  }
+
+  const std::vector<CollisionWorld::SweptCollision>& CollisionWorld::findSweptCollisions() {
+    updateProxies(true);
+    findProxyPairs(true);
+
+    // Each pair is swept in the space of its first object, held at its
+    // starting position, with the second one moving relative to it.
+    sweptCollisions.clear();
+    for (const auto& pair : proxyPairs) {
+      const Proxy& proxyA = proxies[pair.first];
+      const Proxy& proxyB = proxies[pair.second];
+      const SceneObject& objectA = *proxyA.object;
+      const SceneObject& objectB = *proxyB.object;
+
+      Vec3 relativeMotion = (objectB.position - proxyB.sweepStart) - (objectA.position - proxyA.sweepStart);
+      float timeOfImpact = 0.0f;
+      if (objectA.boundingBoxSet->sweep(*objectB.boundingBoxSet, proxyA.sweepStart, objectA.transformation,
+        proxyB.sweepStart, proxyB.sweepStart + relativeMotion, objectB.transformation, timeOfImpact)) {
+        SweptCollision collision;
+        collision.first = proxyA.object;
+        collision.second = proxyB.object;
+        collision.timeOfImpact = timeOfImpact;
+        sweptCollisions.push_back(collision);
+      }
+    }
+
+    for (auto& proxy : proxies) {
+      if (proxy.object != nullptr) {
+        proxy.sweepStart = proxy.object->position;
+      }
+    }
+
+    return sweptCollisions;
+  }
+
+  CollisionWorld::RaycastHit CollisionWorld::castRay(const Ray& ray, std::vector<int32_t>& stack) const {
+    RaycastHit hit;
+    float directionLength = length(ray.direction);
+    if (root < 0 || directionLength == 0.0f) {
+      return hit;
+    }
+
+    Vec3 direction = ray.direction / directionLength;
+    float origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+    float inverseDirection[3];
+    for (int axis = 0; axis < 3; ++axis) {
+      // Very small values instead of zeros, to avoid dividing by zero
+      float component = (&direction.x)[axis];
+      inverseDirection[axis] = 1.0f / (component != 0.0f ? component : 1e-30f);
+    }
+
+    // Nodes further than the closest hit found so far are skipped, and
+    // the nearer child of each node is visited first.
+    float closest = ray.maxDistance;
+    stack.clear();
+    stack.push_back(root);
+
+    while (!stack.empty()) {
+      const Node& node = nodes[stack.back()];
+      stack.pop_back();
+
+      if (rayEntry(node.box.min, node.box.max, origin, inverseDirection, closest) < 0.0f) {
+        continue;
+      }
+
+      if (node.child1 >= 0) {
+        float entry1 = rayEntry(nodes[node.child1].box.min, nodes[node.child1].box.max,
+          origin, inverseDirection, closest);
+        float entry2 = rayEntry(nodes[node.child2].box.min, nodes[node.child2].box.max,
+          origin, inverseDirection, closest);
+        bool firstNearer = entry2 < 0.0f || (entry1 >= 0.0f && entry1 <= entry2);
+        if (entry1 >= 0.0f && entry2 >= 0.0f) {
+          stack.push_back(firstNearer ? node.child2 : node.child1);
+        }
+        if (entry1 >= 0.0f || entry2 >= 0.0f) {
+          stack.push_back(firstNearer ? node.child1 : node.child2);
+        }
+        continue;
+      }
+
+      const Proxy& proxy = proxies[node.proxy];
+      if (rayEntry(proxy.box.min, proxy.box.max, origin, inverseDirection, closest) < 0.0f) {
+        continue;
+      }
+
+      float distance = 0.0f;
+      const SceneObject* object = proxy.object;
+      if (object->boundingBoxSet->raycast(ray.origin, direction, closest, object->position,
+        object->transformation, distance)) {
+        closest = distance;
+        hit.object = proxy.object;
+      }
+    }
+
+    if (hit.object != nullptr) {
+      hit.distance = closest;
+      hit.point = ray.origin + direction * closest;
+    }
+    return hit;
+  }
+
+  CollisionWorld::RaycastHit CollisionWorld::raycast(const Vec3& origin, const Vec3& direction,
+    float maxDistance) {
+    update();
+
+    Ray ray;
+    ray.origin = origin;
+    ray.direction = direction;
+    ray.maxDistance = maxDistance;
+    std::vector<int32_t> stack;
+    return castRay(ray, stack);
+  }
+
+  void CollisionWorld::raycast(const std::vector<Ray>& rays, std::vector<RaycastHit>& hits) {
+    update();
+
+    size_t count = rays.size();
+    hits.resize(count);
+
+    auto castRays = [&](size_t begin, size_t end) {
+      std::vector<int32_t> stack;
+      for (size_t idx = begin; idx < end; ++idx) {
+        hits[idx] = castRay(rays[idx], stack);
+      }
+    };
+
+    ThreadPool::getInstance().parallelFor(count, minRaysPerThread, castRays);
+  }
+
+  int32_t CollisionWorld::buildNode(std::vector<Node>& leaves, size_t begin, size_t end, int32_t parent) {
+    int32_t index = static_cast<int32_t>(nodes.size());
+
+    if (end - begin == 1) {
+      nodes.push_back(leaves[begin]);
+      nodes[index].parent = parent;
+      proxies[nodes[index].proxy].leaf = index;
+      return index;
+    }
+
+    nodes.emplace_back();
+    nodes[index].parent = parent;
+
+    // Split the leaves in half, along the axis on which their centres
+    // are the most spread out
+    float centreMin[3], centreMax[3];
+    for (int axis = 0; axis < 3; ++axis) {
+      centreMin[axis] = centreMax[axis] = leaves[begin].box.min[axis] + leaves[begin].box.max[axis];
+    }
+    for (size_t idx = begin + 1; idx < end; ++idx) {
+      for (int axis = 0; axis < 3; ++axis) {
+        float centre = leaves[idx].box.min[axis] + leaves[idx].box.max[axis];
+        centreMin[axis] = std::min(centreMin[axis], centre);
+        centreMax[axis] = std::max(centreMax[axis], centre);
+      }
+    }
+    int splitAxis = 0;
+    for (int axis = 1; axis < 3; ++axis) {
+      if (centreMax[axis] - centreMin[axis] > centreMax[splitAxis] - centreMin[splitAxis]) {
+        splitAxis = axis;
+      }
+    }
+
+    size_t middle = begin + (end - begin) / 2;
+    std::nth_element(leaves.begin() + begin, leaves.begin() + middle, leaves.begin() + end,
+      [splitAxis](const Node& node1, const Node& node2) {
+        return node1.box.min[splitAxis] + node1.box.max[splitAxis] <
+          node2.box.min[splitAxis] + node2.box.max[splitAxis];
+      });
+
+    int32_t child1 = buildNode(leaves, begin, middle, index);
+    int32_t child2 = buildNode(leaves, middle, end, index);
+
+    Node& node = nodes[index];
+    node.child1 = child1;
+    node.child2 = child2;
+    node.height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+    enclose(nodes[child1].box.min, nodes[child1].box.max,
+      nodes[child2].box.min, nodes[child2].box.max, node.box.min, node.box.max);
+    return index;
+  }
+
+  void CollisionWorld::rebuild() {
+    std::vector<Node> leaves;
+    leaves.reserve(getNumObjects());
+    for (const auto& proxy : proxies) {
+      if (proxy.object != nullptr) {
+        leaves.push_back(nodes[proxy.leaf]);
+      }
+    }
+
+    nodes.clear();
+    freeNode = -1;
+    root = leaves.empty() ? -1 : buildNode(leaves, 0, leaves.size(), -1);
+  }
+
+  int32_t CollisionWorld::getTreeHeight() const {
+    return root >= 0 ? nodes[root].height + 1 : 0;
+  }
+
+}
@@ -8,628 +8,638 @@
 
 #include "GlbFile.hpp"
 #include "Logger.hpp"
+#include "ThreadPool.hpp"
 #include <algorithm>
+#include <type_traits>
+#include <cstdlib>
+#include <exception>
 
 namespace small3d {
 
-  std::shared_ptr<GlbFile::Token> GlbFile::getToken(const std::string& name, size_t index) {
-    std::shared_ptr<GlbFile::Token> foundToken = nullptr;
+  // Deeper nesting than this is not expected in glTF and is
+  // rejected, so that the recursive parsing cannot overflow the stack.
+  static const uint32_t MAX_JSON_DEPTH = 256;
 
-    std::shared_ptr<GlbFile::Token> currenttoken = token_queues[index];
-    do {
-      if (currenttoken->name == name) {
-        foundToken = currenttoken;
-        break;
-      }
-      else {
-        currenttoken = currenttoken->next;
-      }
-    } while (currenttoken != nullptr);
-
-    return foundToken;
+  static inline void skipWhitespace(std::string_view text, size_t& pos) {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' ||
+      text[pos] == '\r' || text[pos] == '\t')) {
+      ++pos;
+    }
   }
 
-  void GlbFile::printTokensRecursive(std::shared_ptr<Token> head_token) {
-    std::shared_ptr<GlbFile::Token> currenttoken = head_token;
-    do {
-      if (currenttoken->valueType == ValueType::MARKER) {
-        if (!currenttoken->name.empty()) {
-          printf("%s: ", currenttoken->name.c_str());
-        }
-        printTokensRecursive(token_queues[static_cast<uint32_t>(std::stoi(currenttoken->value))]);
-      }
-      else {
-        printToken(currenttoken);
-        printf(" ");
-      }
-      currenttoken = currenttoken->next;
-    } while (currenttoken != nullptr);
-    printf("\n\r");
+  // Returns the text of the string starting at pos (the opening quote),
+  // without the quotes. Escaped characters are skipped over, not unescaped.
+  static std::string_view parseJsonString(std::string_view text, size_t& pos) {
+    size_t start = ++pos;
+    while (pos < text.size() && text[pos] != '"') {
+      if (text[pos] == '\\') ++pos;
+      ++pos;
+    }
+    if (pos >= text.size()) {
+      throw std::runtime_error("Unterminated string in GLB json.");
+    }
+    std::string_view ret(text.data() + start, pos - start);
+    ++pos;
+    return ret;
   }
 
-  void GlbFile::lexJson(const std::vector<char>& json, uint32_t length)
-  {
-    uint32_t charsLeft = length;
-
-    std::string tokenString = "";
-    std::string tokenNumber = "";
-
-    bool inQuotes = false;
-    bool inNumber = false;
-    bool inTrueOrFalse = false;
-
-    jsonRootToken = std::make_shared<GlbFile::Token>();
-    jsonRootToken->next = nullptr;
-    jsonRootToken->valueType = GlbFile::ValueType::charstring;
-    jsonRootToken->value = "root";
-
-    std::shared_ptr<GlbFile::Token> current = jsonRootToken;
-
-    while (charsLeft != 0) {
-      char c = json[length - charsLeft];
-
-      // end number
-      if (inNumber && strchr("0123456789.-e", c) == nullptr) {
+  void GlbFile::parseJson() {
+    jsonValues.clear();
+    jsonChildren.clear();
 
-        current->next = createToken(GlbFile::ValueType::number, tokenNumber);
-        current = current->next;
+    // Roughly one value for every 8 characters of glTF json
+    jsonValues.reserve(json.size() / 8);
+    jsonChildren.reserve(json.size() / 8);
 
-        inNumber = false;
-        tokenNumber = "";
+    std::vector<uint32_t> childStack;
+    size_t pos = 0;
+    parseJsonValue(pos, childStack, 0);
 
-      }
+    if (jsonValues[0].valueType != ValueType::object) {
+      throw std::runtime_error("The json of " + fullPath + " is not an object.");
+    }
 
-      // end true or false
-      if (inTrueOrFalse && strchr("truefals", c) == nullptr) {
-        current->next = createToken(GlbFile::ValueType::charstring, tokenString);
-        current = current->next;
-        inTrueOrFalse = false;
-        tokenString = "";
-      }
+    indexNodes();
+    resolveScene();
+  }
 
-      switch (c) {
-      case '{': // begin map
+  uint32_t GlbFile::parseJsonValue(size_t& pos, std::vector<uint32_t>& childStack, uint32_t depth) {
 
-        current->next = createToken(GlbFile::ValueType::character, std::string(1, c));
-        current = current->next;
+    if (depth > MAX_JSON_DEPTH) {
+      throw std::runtime_error("The json of " + fullPath + " is nested too deeply.");
+    }
 
-        break;
-      case '}': // end map
-        current->next = createToken(GlbFile::ValueType::character, std::string(1, c));
-        current = current->next;
+    skipWhitespace(json, pos);
+    if (pos >= json.size()) {
+      throw std::runtime_error("Unexpected end of the json of " + fullPath);
+    }
 
-        break;
-      case '[': // begin list
-        current->next = createToken(GlbFile::ValueType::character, std::string(1, c));
-        current = current->next;
+    // Values are stored in the order they are found, so indexes (not
+    // references) are used, since the vector grows while parsing children.
+    uint32_t index = static_cast<uint32_t>(jsonValues.size());
+    jsonValues.emplace_back();
 
-        break;
-      case ']': // end list
-        current->next = createToken(GlbFile::ValueType::character, std::string(1, c));
-        current = current->next;
+    char c = json[pos];
 
-        break;
-      case '"':
-        inQuotes = !inQuotes;
-        if (!inQuotes) { // end string
+    if (c == '{' || c == '[') {
+      bool isObject = c == '{';
+      char closing = isObject ? '}' : ']';
+      jsonValues[index].valueType = isObject ? ValueType::object : ValueType::array;
+      ++pos;
 
-          current->next = createToken(GlbFile::ValueType::charstring, tokenString);
-          current = current->next;
+      // The children of this value are gathered at the end of the stack
+      // while parsing, so that they can be stored consecutively afterwards,
+      // after the children of any values they contain.
+      size_t stackStart = childStack.size();
 
-          tokenString = "";
-        }
-        break;
+      skipWhitespace(json, pos);
+      if (pos < json.size() && json[pos] == closing) {
+        ++pos;
+      }
+      else {
+        while (true) {
+          std::string_view name;
+          if (isObject) {
+            skipWhitespace(json, pos);
+            if (pos >= json.size() || json[pos] != '"') {
+              throw std::runtime_error("Expected a name in the json of " + fullPath +
+                " at position " + std::to_string(pos));
+            }
+            name = parseJsonString(json, pos);
+            skipWhitespace(json, pos);
+            if (pos >= json.size() || json[pos] != ':') {
+              throw std::runtime_error("Expected ':' in the json of " + fullPath +
+                " at position " + std::to_string(pos));
+            }
+            ++pos;
+          }
 
-      default:
-        if (inQuotes) { // begin or continue string
-          tokenString += c;
-        }
-        else if (strchr("0123456789-", c) != nullptr ||
-          (strchr(".e", c) != nullptr && inNumber)) { // begin number or in number
-          inNumber = true;
-          tokenNumber += c;
+          uint32_t child = parseJsonValue(pos, childStack, depth + 1);
+          jsonValues[child].name = name;
+          childStack.push_back(child);
 
+          skipWhitespace(json, pos);
+          if (pos < json.size() && json[pos] == ',') {
+            ++pos;
+          }
+          else if (pos < json.size() && json[pos] == closing) {
+            ++pos;
+            break;
+          }
+          else {
+            throw std::runtime_error("Expected ',' or '" + std::string(1, closing) +
+              "' in the json of " + fullPath + " at position " + std::to_string(pos));
+          }
         }
-        else if (strchr("truefals", c) != nullptr) { // begin or continue true or false indicator
-          inTrueOrFalse = true;
-          tokenString += c;
-        }
-
-        break;
       }
 
-      if (c == ':') {
-        current->next = createToken(GlbFile::ValueType::character, std::string(1, c));
-        current = current->next;
-
+      jsonValues[index].firstChild = static_cast<uint32_t>(jsonChildren.size());
+      jsonValues[index].numChildren = static_cast<uint32_t>(childStack.size() - stackStart);
+      jsonChildren.insert(jsonChildren.end(), childStack.begin() + stackStart, childStack.end());
+      childStack.resize(stackStart);
+    }
+    else if (c == '"') {
+      jsonValues[index].valueType = ValueType::charstring;
+      jsonValues[index].value = parseJsonString(json, pos);
+    }
+    else {
+      size_t start = pos;
+      while (pos < json.size() && strchr("0123456789+-.eEtruefalsn", json[pos]) != nullptr) {
+        ++pos;
       }
+      std::string_view text(json.data() + start, pos - start);
 
-      if (c == ',') {
-        current->next = createToken(GlbFile::ValueType::character, std::string(1, c));
-        current = current->next;
-
+      if (text == "true" || text == "false") {
+        jsonValues[index].valueType = ValueType::boolean;
       }
-
-      --charsLeft;
+      else if (text == "null") {
+        jsonValues[index].valueType = ValueType::null;
+      }
+      else if (!text.empty() && strchr("0123456789-", text[0]) != nullptr) {
+        jsonValues[index].valueType = ValueType::number;
+      }
+      else {
+        throw std::runtime_error("Unexpected character in the json of " + fullPath +
+          " at position " + std::to_string(start));
+      }
+      jsonValues[index].value = text;
     }
-  }
 
-  std::shared_ptr<GlbFile::Token> GlbFile::createToken(GlbFile::ValueType valueType, const std::string& value) {
-    auto newToken = std::make_shared<GlbFile::Token>();
-    newToken->next = nullptr;
-    newToken->name = "";
-    newToken->valueType = valueType;
-    newToken->value = value;
-    if (valueType == GlbFile::ValueType::character) newToken->value.resize(1);
-    return newToken;
+    return index;
   }
 
-  void GlbFile::parseJson(std::shared_ptr<GlbFile::Token> token) {
+  void GlbFile::indexNodes() {
+    size_t numNodes = getNumJsonElements("nodes");
+    parentNodes.assign(numNodes, -1);
+    meshNodes.assign(getNumJsonElements("meshes"), -1);
+    namedNodes.clear();
 
-    std::stack<std::shared_ptr<GlbFile::Token>> st;
+    for (uint32_t nodeIdx = 0; nodeIdx < numNodes; ++nodeIdx) {
+      const auto& nodeValue = getJsonElement("nodes", nodeIdx);
 
-    std::shared_ptr<GlbFile::Token> poppedToken;
-    std::shared_ptr<GlbFile::Token> prevToken;
-    std::shared_ptr<GlbFile::Token> antePrevToken;
-    std::shared_ptr<GlbFile::Token> origNextToken;
-
-    char poppedTokenFirstChar;
-
-    uint32_t markerPoint = 0;
-
-    while (true) {
-
-      // Commas are ignored
-      if (token->value == ",") {
-        token = token->next;
-        continue;
+      auto nameValue = getChildJsonValue(nodeValue, "name");
+      if (nameValue != nullptr) {
+        // The first node with a given name is the one that will be found
+        namedNodes.emplace(nameValue->value, nodeIdx);
       }
 
-      // The next token before breaking
-      // current token off from the
-      // original tokenisation queue
-      origNextToken = token->next;
-      st.push(token);
-
-      char matching_bracket = token->value == "}" ? '{' :
-        token->value == "]" ? '[' : ' ';
+      auto childrenValue = getChildJsonValue(nodeValue, "children");
+      if (childrenValue != nullptr) {
+        for (uint32_t idx = 0; idx < childrenValue->numChildren; ++idx) {
+          uint32_t child = toUint(&getJsonElement(*childrenValue, idx));
+          if (child < numNodes) {
+            parentNodes[child] = static_cast<int32_t>(nodeIdx);
+          }
+        }
+      }
 
-      if (matching_bracket != ' ') {
-        prevToken = nullptr;
-        antePrevToken = nullptr;
+      auto meshValue = getChildJsonValue(nodeValue, "mesh");
+      if (meshValue != nullptr) {
+        uint32_t mesh = toUint(meshValue);
+        if (mesh < meshNodes.size() && meshNodes[mesh] < 0) {
+          meshNodes[mesh] = static_cast<int32_t>(nodeIdx);
+        }
+      }
+    }
+  }
 
-        do {
-          poppedToken = st.top();
-          poppedTokenFirstChar = poppedToken->value[0];
-          st.pop();
+  const GlbFile::JsonValue* GlbFile::getJsonValue(const char* name) const {
+    return getChildJsonValue(jsonValues[0], name);
+  }
 
-          bool namedToken = false;
+  const GlbFile::JsonValue* GlbFile::getChildJsonValue(const JsonValue& jsonValue, const char* name) const {
+    if (jsonValue.valueType != ValueType::object) return nullptr;
+    for (uint32_t idx = 0; idx < jsonValue.numChildren; ++idx) {
+      const auto& child = jsonValues[jsonChildren[jsonValue.firstChild + idx]];
+      if (child.name == name) return &child;
+    }
+    return nullptr;
+  }
 
-          if (antePrevToken != nullptr) {
-            if (prevToken->valueType == GlbFile::ValueType::character && prevToken->value == ":" && poppedToken->valueType == GlbFile::ValueType::charstring) {
-              antePrevToken->name = poppedToken->value;
-              prevToken = antePrevToken;
-              antePrevToken = prevToken->next;
-              namedToken = true;
-            }
-          }
+  const GlbFile::JsonValue& GlbFile::getJsonElement(const JsonValue& jsonValue, size_t index) const {
+    if (index >= jsonValue.numChildren) {
+      throw std::runtime_error("Element " + std::to_string(index) + " of " + std::string(jsonValue.name) +
+        " not found in " + fullPath);
+    }
+    return jsonValues[jsonChildren[jsonValue.firstChild + index]];
+  }
 
-          if (!namedToken) {
-            poppedToken->next = prevToken;
-            antePrevToken = prevToken;
-            prevToken = poppedToken;
-          }
-        } while (poppedTokenFirstChar != matching_bracket);
+  const GlbFile::JsonValue& GlbFile::getJsonElement(const char* arrayName, size_t index) const {
+    auto arrayValue = getJsonValue(arrayName);
+    if (arrayValue == nullptr) {
+      throw std::runtime_error(std::string(arrayName) + " not found in " + fullPath);
+    }
+    return getJsonElement(*arrayValue, index);
+  }
 
-        token_queues.emplace_back(poppedToken);
-        std::shared_ptr<GlbFile::Token> marker = createToken(GlbFile::ValueType::MARKER, std::to_string(markerPoint));
-        ++markerPoint;
-        marker->next = jsonRootToken;
-        jsonRootToken = marker;
-        st.push(marker);
+  size_t GlbFile::getNumJsonElements(const char* arrayName) const {
+    auto arrayValue = getJsonValue(arrayName);
+    return arrayValue == nullptr ? 0 : arrayValue->numChildren;
+  }
 
-      }
+  std::string GlbFile::toString(const JsonValue* jsonValue) {
+    return jsonValue == nullptr ? "" : std::string(jsonValue->value);
+  }
 
-      if (origNextToken == nullptr) break;
-      token = origNextToken;
+  uint32_t GlbFile::toUint(const JsonValue* jsonValue) {
+    if (jsonValue == nullptr || jsonValue->valueType != ValueType::number) {
+      throw std::runtime_error("Expected number not found in GLB json.");
     }
+    // The text of the number is followed by a delimiter in the json, so
+    // it can be converted in place.
+    return static_cast<uint32_t>(strtoul(jsonValue->value.data(), nullptr, 10));
   }
 
-  std::vector<std::shared_ptr<GlbFile::Token>> GlbFile::getTokens(uint32_t index) {
-    std::vector<std::shared_ptr<GlbFile::Token>> ret;
-    std::shared_ptr<GlbFile::Token> currentToken = token_queues[index];
-    do {
-      if (currentToken->value != "[" && currentToken->value != "]" &&
-        currentToken->value != "{" && currentToken->value != "}") {
-        ret.emplace_back(currentToken);
-      }
-      currentToken = currentToken->next;
-    } while (currentToken != nullptr);
-    return ret;
+  float GlbFile::toFloat(const JsonValue* jsonValue) {
+    if (jsonValue == nullptr || jsonValue->valueType != ValueType::number) {
+      throw std::runtime_error("Expected number not found in GLB json.");
+    }
+    return strtof(jsonValue->value.data(), nullptr);
   }
 
   GlbFile::GlbFile(const std::string& fileLocation) : File(fileLocation) {
 
-
-    std::ifstream fileOnDisk;
-    fileOnDisk.open(fullPath, std::ios::binary);
-    if (!fileOnDisk.is_open()) {
+    try {
+      mappedFile = std::make_unique<MappedFile>(fullPath, false);
+    }
+    catch (const std::runtime_error&) {
       throw std::runtime_error("Could not open .glb file " + fullPath);
     }
 
-    std::string magic(4, '\0');
-    uint32_t version = 0, fileLength = 0;
-    fileOnDisk.read(&magic[0], 4);
-    fileOnDisk.read(reinterpret_cast<char*>(&version), 4);
+    readChunks(mappedFile->data(), mappedFile->size());
+  }
 
-    if (magic != "glTF" || version != 2) {
+  GlbFile::GlbFile(const std::string& name, const char* data, size_t size) : File(name) {
+    readChunks(data, size);
+  }
+
+  void GlbFile::readChunks(const char* data, size_t size) {
 
-      fileOnDisk.close();
+    std::string magic = size >= 4 ? std::string(data, 4) : std::string();
+    uint32_t version = 0, fileLength = 0;
+    if (size >= 12) {
+      memcpy(&version, data + 4, 4);
+      memcpy(&fileLength, data + 8, 4);
+    }
 
+    if (magic != "glTF" || version != 2) {
       throw std::runtime_error("Magic number found: '" + magic + "'. File " + fullPath + " cannot be read as glb.");
     }
 
-    fileOnDisk.read(reinterpret_cast<char*>(&fileLength), 4);
+    size_t end = std::min(size, static_cast<size_t>(fileLength));
+    size_t pos = 12;
+    uint32_t chunkLength, chunkType;
 
-    bool doneReading = false;
-    uint32_t chunkLength, chunkType, bytesLeft = fileLength - 12;
-    std::vector<char> bytes;
+    while (pos + 8 <= end) {
+      memcpy(&chunkLength, data + pos, 4);
+      memcpy(&chunkType, data + pos + 4, 4);
+      pos += 8;
 
-    while (!doneReading) {
-      chunkLength = 0;
-      chunkType = 0;
-      fileOnDisk.read(reinterpret_cast<char*>(&chunkLength), 4);
-      fileOnDisk.read(reinterpret_cast<char*>(&chunkType), 4);
+      if (chunkLength > end - pos) {
+        throw std::runtime_error("Truncated chunk in .glb file " + fullPath);
+      }
 
       if (chunkType == CHUNK_TYPE_BIN) {
-        binBuffer.resize(chunkLength, 0);
-        fileOnDisk.read(&binBuffer[0], chunkLength);
+        binData = data + pos;
+        binSize = chunkLength;
       }
       else if (chunkType == CHUNK_TYPE_JSON) {
-        bytes.resize(chunkLength, 0);
-        fileOnDisk.read(&bytes[0], chunkLength);
-        lexJson(bytes, chunkLength);
+        json = std::string_view(data + pos, chunkLength);
       }
       else {
 
         // Unknown .glb chunk type or padding reached. Done reading.
-        doneReading = true;
+        break;
       }
 
-      if (!doneReading) {
-        bytesLeft -= chunkLength;
-        if (fileOnDisk.eof() || bytesLeft == 0) doneReading = true;
-      }
+      pos += chunkLength;
     }
 
-    fileOnDisk.close();
-
-    parseJson(jsonRootToken);
+    parseJson();
 
   }
 
-  void GlbFile::printToken(const std::shared_ptr<GlbFile::Token>& token) {
-    if (!token->name.empty()) {
-      printf("%s: ", token->name.c_str());
+  void GlbFile::printJsonValue(const JsonValue& jsonValue, bool recursive) {
+    if (!jsonValue.name.empty()) {
+      printf("%.*s: ", static_cast<int>(jsonValue.name.size()), jsonValue.name.data());
     }
 
-    if (token->valueType == GlbFile::ValueType::MARKER) {
-      printf("M/%s", token->value.c_str());
+    if (jsonValue.valueType == ValueType::object || jsonValue.valueType == ValueType::array) {
+      if (!recursive) {
+        printf("M/%u", static_cast<uint32_t>(&jsonValue - &jsonValues[0]));
+        return;
+      }
+      printf("%c ", jsonValue.valueType == ValueType::object ? '{' : '[');
+      for (uint32_t idx = 0; idx < jsonValue.numChildren; ++idx) {
+        printJsonValue(getJsonElement(jsonValue, idx), true);
+        printf(" ");
+      }
+      printf("%c", jsonValue.valueType == ValueType::object ? '}' : ']');
+    }
+    else {
+      printf("%.*s", static_cast<int>(jsonValue.value.size()), jsonValue.value.data());
     }
-    else printf("%s", token->value.c_str());
   }
 
   void GlbFile::printTokensRecursive() {
-    printTokensRecursive(token_queues.back());
+    printJsonValue(jsonValues[0], true);
+    printf("\n\r");
   }
 
   void GlbFile::printTokensSerial() {
-    for (auto tokenQueue : token_queues) {
-      std::shared_ptr<GlbFile::Token> currenttoken = tokenQueue;
-      do {
-        printToken(currenttoken);
+    for (uint32_t valueIdx = 0; valueIdx < jsonValues.size(); ++valueIdx) {
+      const auto& jsonValue = jsonValues[valueIdx];
+      if (jsonValue.valueType != ValueType::object && jsonValue.valueType != ValueType::array) continue;
+      printf("%u: ", valueIdx);
+      for (uint32_t idx = 0; idx < jsonValue.numChildren; ++idx) {
+        printJsonValue(getJsonElement(jsonValue, idx), false);
         printf(" ");
-        currenttoken = currenttoken->next;
-      } while (currenttoken != nullptr);
+      }
       printf("\n\r");
     }
   }
 
-  std::shared_ptr<GlbFile::Token> GlbFile::getToken(const std::string& name) {
-    return getToken(name, token_queues.size() - 1);
-  }
+  // Convert the elements of an accessor from their component type (S) to the
+  // one of the destination (T), in a single pass. Data that is already tightly
+  // packed in the right type is copied as a block.
+  template <typename S, typename T>
+  static void convertElements(const char* data, size_t count, uint32_t numComponents, size_t stride,
+    T* destination, size_t destinationStride) {
+
+    if (std::is_same<S, T>::value && stride == sizeof(S) * numComponents &&
+      destinationStride == numComponents) {
+      memcpy(destination, data, count * stride);
+      return;
+    }
 
-  std::vector<std::shared_ptr<GlbFile::Token>> GlbFile::getChildTokens(const std::shared_ptr<GlbFile::Token>& token) {
-    return getTokens(std::stoi(token->value));
+    for (size_t idx = 0; idx < count; ++idx) {
+      const char* element = data + idx * stride;
+      T* output = destination + idx * destinationStride;
+      for (uint32_t component = 0; component < numComponents; ++component) {
+        S value;
+        memcpy(&value, element + component * sizeof(S), sizeof(S));
+        output[component] = static_cast<T>(value);
+      }
+    }
   }
 
-  std::shared_ptr<GlbFile::Token> GlbFile::getChildToken(const std::shared_ptr<GlbFile::Token>& token, const std::string& name) {
-    return getToken(name, std::stoi(token->value));
+  static size_t getComponentSize(int componentType) {
+    switch (componentType) {
+    case 5120:  // byte
+    case 5121:  // unsigned byte
+      return 1;
+    case 5122:  // short
+    case 5123:  // unsigned short
+      return 2;
+    case 5125:  // unsigned int
+    case 5126:  // float
+      return 4;
+    default:
+      throw std::runtime_error("Unrecognised componentType in GLB file: " + std::to_string(componentType));
+    }
   }
 
-  std::vector<char> GlbFile::getBufferByView(const size_t viewIndex) {
-    std::vector<std::shared_ptr<GlbFile::Token>> bufferViews = getChildTokens(getToken("bufferViews"));
-    uint32_t byteLength = std::stoi(getChildToken(bufferViews[viewIndex], "byteLength")->value);
-    auto offsetToken = getChildToken(bufferViews[viewIndex], "byteOffset");
-    uint32_t byteOffset = offsetToken == nullptr ? 0U : std::stoi(offsetToken->value);
-    return std::vector<char>(binBuffer.begin() + byteOffset, binBuffer.begin() + byteOffset + byteLength);
+  GlbFile::BufferView GlbFile::getBufferView(const size_t viewIndex) {
+    const auto& bufferViewValue = getJsonElement("bufferViews", viewIndex);
+    size_t byteLength = toUint(getChildJsonValue(bufferViewValue, "byteLength"));
+    auto offsetValue = getChildJsonValue(bufferViewValue, "byteOffset");
+    size_t byteOffset = offsetValue == nullptr ? 0U : toUint(offsetValue);
+
+    if (byteOffset + byteLength > binSize) {
+      throw std::runtime_error("Buffer view " + std::to_string(viewIndex) + " exceeds the binary data of " + fullPath);
+    }
+
+    BufferView view;
+    view.data = binData + byteOffset;
+    view.size = byteLength;
+    return view;
   }
 
-  std::vector<char> GlbFile::getBufferByAccessor(const size_t index, int& componentType) {
+  GlbFile::AccessorView GlbFile::getAccessorView(const size_t index) {
+
+    const auto& accessorValue = getJsonElement("accessors", index);
+    auto bufferViewNumber = toUint(getChildJsonValue(accessorValue, "bufferView"));
 
-    auto accessorToken = getChildTokens(getToken("accessors"))[index];
-    auto bufferViewNumber = std::stoi(getChildToken(accessorToken, "bufferView")->value);
+    auto byteOffsetValue = getChildJsonValue(accessorValue, "byteOffset");
+    auto countValue = getChildJsonValue(accessorValue, "count");
 
-    auto byteOffsetToken = getChildToken(accessorToken, "byteOffset");
-    auto countToken = getChildToken(accessorToken, "count");
+    AccessorView accessor;
+    accessor.componentType = static_cast<int>(toUint(getChildJsonValue(accessorValue, "componentType")));
+    size_t componentSize = getComponentSize(accessor.componentType);
 
-    if (byteOffsetToken == nullptr || countToken == nullptr) {
-      return getBufferByView(bufferViewNumber);
+    auto dataType = toString(getChildJsonValue(accessorValue, "type"));
+
+    if (dataType.substr(0, 3) == "VEC") {
+      accessor.numComponents = std::stoi(dataType.substr(3, 1));
+    }
+    else if (dataType.substr(0, 3) == "MAT") {
+      accessor.numComponents = std::stoi(dataType.substr(3, 1));
+      accessor.numComponents *= accessor.numComponents;
     }
-    else {
-      size_t cnt = 0;
 
-      componentType = std::stoi(getChildToken(accessorToken, "componentType")->value);
+    size_t elementSize = componentSize * accessor.numComponents;
 
-      switch (componentType) {
-      case 5120:  // byte
-        cnt = 1;
-        break;
-      case 5121:  // unsigned byte
-        cnt = 1;
-        break;
-      case 5122:  // short
-        cnt = 2;
-        break;
-      case 5123:  // unsigned short
-        cnt = 2;
-        break;
-      case 5125:  // unsigned int
-        cnt = 4;
-        break;
-      case 5126:  // float
-        cnt = 4;
-        break;
-      default:
+    auto bufferView = getBufferView(bufferViewNumber);
+    size_t byteOffset = byteOffsetValue == nullptr ? 0U : toUint(byteOffsetValue);
 
-        throw std::runtime_error("Unrecognised componentType in GLB file: " + std::to_string(componentType));
+    auto strideValue = getChildJsonValue(getJsonElement("bufferViews", bufferViewNumber), "byteStride");
+    accessor.stride = strideValue == nullptr ? elementSize : toUint(strideValue);
 
-      }
+    accessor.count = countValue == nullptr ? (bufferView.size - byteOffset) / accessor.stride :
+      toUint(countValue);
 
-      auto dataType = getChildToken(accessorToken, "type")->value;
+    if (accessor.count > 0 &&
+      byteOffset + (accessor.count - 1) * accessor.stride + elementSize > bufferView.size) {
+      throw std::runtime_error("Accessor " + std::to_string(index) + " exceeds its buffer view in " + fullPath);
+    }
 
-      if (dataType.substr(0, 3) == "VEC") {
-        cnt *= std::stoi(dataType.substr(3, 1));
-      }
-      else if (dataType == "MAT4") {
-        cnt *= 16;
-      }
+    accessor.data = bufferView.data + byteOffset;
+    return accessor;
+  }
 
-      cnt *= std::stoi(countToken->value);
+  template <typename T>
+  void GlbFile::readAccessor(const AccessorView& accessor, T* destination, size_t destinationStride) {
+    switch (accessor.componentType) {
+    case 5120:
+      convertElements<int8_t>(accessor.data, accessor.count, accessor.numComponents, accessor.stride,
+        destination, destinationStride);
+      break;
+    case 5121:
+      convertElements<uint8_t>(accessor.data, accessor.count, accessor.numComponents, accessor.stride,
+        destination, destinationStride);
+      break;
+    case 5122:
+      convertElements<int16_t>(accessor.data, accessor.count, accessor.numComponents, accessor.stride,
+        destination, destinationStride);
+      break;
+    case 5123:
+      convertElements<uint16_t>(accessor.data, accessor.count, accessor.numComponents, accessor.stride,
+        destination, destinationStride);
+      break;
+    case 5125:
+      convertElements<uint32_t>(accessor.data, accessor.count, accessor.numComponents, accessor.stride,
+        destination, destinationStride);
+      break;
+    case 5126:
+      convertElements<float>(accessor.data, accessor.count, accessor.numComponents, accessor.stride,
+        destination, destinationStride);
+      break;
+    default:
+      throw std::runtime_error("Unrecognised componentType in GLB file: " + std::to_string(accessor.componentType));
+    }
+  }
 
-      auto byteOffset = std::stoi(byteOffsetToken->value);
+  void GlbFile::resolveScene() {
+    nodes.clear();
+    for (uint32_t idx = 0; idx < getNumJsonElements("nodes"); ++idx) {
+      nodes.push_back(readNode(idx));
+    }
 
-      auto data = getBufferByView(bufferViewNumber);
-      return std::vector<char>(data.begin() + byteOffset, data.begin() + byteOffset + cnt);
+    skins.clear();
+    for (uint32_t idx = 0; idx < getNumJsonElements("skins"); ++idx) {
+      skins.push_back(readSkin(idx));
     }
 
+    animations.clear();
+    for (uint32_t idx = 0; idx < getNumJsonElements("animations"); ++idx) {
+      animations.push_back(readAnimation(idx));
+    }
   }
 
-  std::vector<char> GlbFile::getBufferByAccessor(const size_t index) {
-    int dummy = 0;
-    return getBufferByAccessor(index, dummy);
+  bool GlbFile::existNode(const uint32_t index) {
+    return nodes.size() > index;
   }
 
-  bool GlbFile::existNode(const uint32_t index) {
-    return getChildTokens(getToken("nodes")).size() > index;
+  const GlbFile::Node& GlbFile::getNode(const uint32_t index) {
+    if (!existNode(index)) throw std::runtime_error("Node " + std::to_string(index) + " not found.");
+    return nodes[index];
   }
 
-  GlbFile::Node GlbFile::getNode(const uint32_t index) {
-    auto nodeToken = getChildTokens(getToken("nodes"))[index];
+  GlbFile::Node GlbFile::readNode(const uint32_t index) const {
+    const auto& nodeValue = getJsonElement("nodes", index);
 
     Node ret;
 
     ret.index = index;
 
-    auto propToken = getChildToken(nodeToken, "name");
-    if (propToken != nullptr) {
-      ret.name = propToken->value;
+    auto propValue = getChildJsonValue(nodeValue, "name");
+    if (propValue != nullptr) {
+      ret.name = toString(propValue);
     }
 
-    propToken = getChildToken(nodeToken, "rotation");
-    if (propToken != nullptr) {
-      auto values = getChildTokens(propToken);
-      ret.rotation = { std::stof(values[0]->value),
-        std::stof(values[1]->value), std::stof(values[2]->value), std::stof(values[3]->value)};
+    propValue = getChildJsonValue(nodeValue, "rotation");
+    if (propValue != nullptr) {
+      ret.rotation = { toFloat(&getJsonElement(*propValue, 0)), toFloat(&getJsonElement(*propValue, 1)),
+        toFloat(&getJsonElement(*propValue, 2)), toFloat(&getJsonElement(*propValue, 3)) };
     }
 
-    propToken = getChildToken(nodeToken, "scale");
-    if (propToken != nullptr) {
-      auto values = getChildTokens(propToken);
-      ret.scale = Vec3(std::stof(values[0]->value), std::stof(values[1]->value),
-        std::stof(values[2]->value));
+    propValue = getChildJsonValue(nodeValue, "scale");
+    if (propValue != nullptr) {
+      ret.scale = Vec3(toFloat(&getJsonElement(*propValue, 0)), toFloat(&getJsonElement(*propValue, 1)),
+        toFloat(&getJsonElement(*propValue, 2)));
     }
 
-    propToken = getChildToken(nodeToken, "translation");
-    if (propToken != nullptr) {
-      auto values = getChildTokens(propToken);
-      ret.translation = Vec3(std::stof(values[0]->value), std::stof(values[1]->value),
-        std::stof(values[2]->value));
+    propValue = getChildJsonValue(nodeValue, "translation");
+    if (propValue != nullptr) {
+      ret.translation = Vec3(toFloat(&getJsonElement(*propValue, 0)), toFloat(&getJsonElement(*propValue, 1)),
+        toFloat(&getJsonElement(*propValue, 2)));
     }
 
-    propToken = getChildToken(nodeToken, "children");
-    if (propToken != nullptr) {
-      auto values = getChildTokens(propToken);
-      for (const auto& val : values) {
-        ret.children.emplace_back(std::stoi(val->value));
+    propValue = getChildJsonValue(nodeValue, "children");
+    if (propValue != nullptr) {
+      for (uint32_t idx = 0; idx < propValue->numChildren; ++idx) {
+        ret.children.emplace_back(toUint(&getJsonElement(*propValue, idx)));
       }
     }
 
-    propToken = getChildToken(nodeToken, "mesh");
-    if (propToken != nullptr) {
-      ret.mesh = std::stoi(propToken->value);
+    propValue = getChildJsonValue(nodeValue, "mesh");
+    if (propValue != nullptr) {
+      ret.mesh = toUint(propValue);
     }
 
-    propToken = getChildToken(nodeToken, "skin");
-    if (propToken != nullptr) {
-      ret.skin = std::stoi(propToken->value);
+    propValue = getChildJsonValue(nodeValue, "skin");
+    if (propValue != nullptr) {
+      ret.skin = toUint(propValue);
     }
     else {
       ret.noSkin = true;
     }
 
-    propToken = getChildToken(nodeToken, "matrix");
-    if (propToken != nullptr) {
-      auto values = getChildTokens(propToken);
-      uint32_t idx = 0;
-      for (const auto& val : values) {
-        ret.transformation[idx / 4][idx % 4] = std::stof(val->value);
-        ++idx;
+    propValue = getChildJsonValue(nodeValue, "matrix");
+    if (propValue != nullptr) {
+      for (uint32_t idx = 0; idx < propValue->numChildren && idx < 16; ++idx) {
+        ret.transformation[idx / 4][idx % 4] = toFloat(&getJsonElement(*propValue, idx));
       }
     }
     return ret;
   }
 
   bool GlbFile::existParentNode(const uint32_t index) {
-    bool found = false;
-    auto nodeTokens = getChildTokens(getToken("nodes"));
-    for (const auto& nodeToken : nodeTokens) {
-      auto childrenToken = getChildToken(nodeToken, "children");
-      if (childrenToken != nullptr) {
-        auto children = getChildTokens(childrenToken);
-
-        if (std::any_of(children.begin(), children.end(), [&index](const auto& childToken) {return std::stoi(childToken->value) == index; })) {
-          found = true;
-        }
-      }
-    }
-    return found;
+    return index < parentNodes.size() && parentNodes[index] >= 0;
   }
 
-  GlbFile::Node GlbFile::getParentNode(const uint32_t index) {
-
-    bool found = false;
-    GlbFile::Node ret;
-    uint32_t nodeIdx = 0;
-    auto nodeTokens = getChildTokens(getToken("nodes"));
-    for (const auto& nodeToken : nodeTokens) {
-      auto childrenToken = getChildToken(nodeToken, "children");
-      if (childrenToken != nullptr) {
-        auto children = getChildTokens(childrenToken);
-
-        if (std::any_of(children.begin(), children.end(), [&index](const auto& childToken) {return std::stoi(childToken->value) == index; })) {
-          found = true;
-          ret = getNode(nodeIdx);
-        }
-
-      }
-      ++nodeIdx;
-    }
-    if (!found) {
+  const GlbFile::Node& GlbFile::getParentNode(const uint32_t index) {
+    if (!existParentNode(index)) {
       throw std::runtime_error("Parent node of node " + std::to_string(index) + " not found.");
     }
-    return ret;
+    return getNode(static_cast<uint32_t>(parentNodes[index]));
   }
 
   bool GlbFile::existNodeForMesh(const uint32_t meshIndex) {
-    bool found = false;
-    for (const auto& nodeToken : getChildTokens(getToken("nodes"))) {
-      auto nodeMeshToken = getChildToken(nodeToken, "mesh");
-      if (nodeMeshToken != nullptr) {
-        if (meshIndex == std::stof(nodeMeshToken->value)) {
-          found = true;
-          break;
-        }
-      }
-    }
-    return found;
+    return meshIndex < meshNodes.size() && meshNodes[meshIndex] >= 0;
   }
 
-  GlbFile::Node GlbFile::getNodeForMesh(const uint32_t meshIndex) {
-    Node nodeForMesh;
-    uint32_t nodeIdx = 0;
-    bool found = false;
-    for (const auto& nodeToken : getChildTokens(getToken("nodes"))) {
-      auto nodeMeshToken = getChildToken(nodeToken, "mesh");
-      if (nodeMeshToken != nullptr) {
-        if (meshIndex == std::stof(nodeMeshToken->value)) {
-          found = true;
-          nodeForMesh = getNode(nodeIdx);
-          break;
-        }
-      }
-      ++nodeIdx;
-    }
-    if (!found) {
+  const GlbFile::Node& GlbFile::getNodeForMesh(const uint32_t meshIndex) {
+    if (!existNodeForMesh(meshIndex)) {
       throw std::runtime_error("Node for mesh " + std::to_string(meshIndex) + " not found.");
     }
-    return nodeForMesh;
+    return getNode(static_cast<uint32_t>(meshNodes[meshIndex]));
   }
 
   bool GlbFile::existNode(const std::string& name) {
-    auto nodeTokens = getChildTokens(getToken("nodes"));
-
-    if (std::any_of(nodeTokens.begin(), nodeTokens.end(), [this, &name](const auto& nodeToken) {
-      auto nameToken = getChildToken(nodeToken, "name");
-      return nameToken != nullptr && nameToken->value == name; })) {
-      return true;
-    }
-
-    return false;
+    return namedNodes.find(name) != namedNodes.end();
   }
 
-  GlbFile::Node GlbFile::getNode(const std::string& name) {
-
-    auto nodeTokens = getChildTokens(getToken("nodes"));
-
-    bool found = false;
-    uint32_t nodeIndex = 0;
-
-    for (const auto& nodeToken : nodeTokens) {
-      if (getChildToken(nodeToken, "name")->value == name) {
-        found = true;
-        break;
-      }
-      ++nodeIndex;
-    }
-
-    if (!found) throw std::runtime_error("Node " + name + " not found.");
-
-    return getNode(nodeIndex);
-
+  const GlbFile::Node& GlbFile::getNode(const std::string& name) {
+    auto namedNode = namedNodes.find(name);
+    if (namedNode == namedNodes.end()) throw std::runtime_error("Node " + name + " not found.");
+    return getNode(namedNode->second);
   }
 
   bool GlbFile::existSkin(const uint32_t index) {
-    if (getToken("skins") == nullptr) return false;
-    return getChildTokens(getToken("skins")).size() > index;
+    return skins.size() > index;
   }
 
-  GlbFile::Skin GlbFile::getSkin(const uint32_t index) {
-    auto skinToken = getChildTokens(getToken("skins"))[index];
+  const GlbFile::Skin& GlbFile::getSkin(const uint32_t index) {
+    if (!existSkin(index)) throw std::runtime_error("Skin " + std::to_string(index) + " not found.");
+    return skins[index];
+  }
+
+  GlbFile::Skin GlbFile::readSkin(const uint32_t index) const {
+    const auto& skinValue = getJsonElement("skins", index);
 
     Skin ret;
 
-    auto propToken = getChildToken(skinToken, "name");
-    if (propToken != nullptr) {
-      ret.name = propToken->value;
+    auto propValue = getChildJsonValue(skinValue, "name");
+    if (propValue != nullptr) {
+      ret.name = toString(propValue);
     }
 
-    propToken = getChildToken(skinToken, "inverseBindMatrices");
-    if (propToken != nullptr) {
-      ret.inverseBindMatrices = std::stoi(propToken->value);
+    propValue = getChildJsonValue(skinValue, "inverseBindMatrices");
+    if (propValue != nullptr) {
+      ret.inverseBindMatrices = toUint(propValue);
     }
 
-    propToken = getChildToken(skinToken, "joints");
-    if (propToken != nullptr) {
-      auto jointTokens = getChildTokens(propToken);
-      for (const auto& jointToken : jointTokens) {
-        ret.joints.emplace_back(std::stoi(jointToken->value));
+    propValue = getChildJsonValue(skinValue, "joints");
+    if (propValue != nullptr) {
+      for (uint32_t idx = 0; idx < propValue->numChildren; ++idx) {
+        ret.joints.emplace_back(toUint(&getJsonElement(*propValue, idx)));
       }
     }
 
-    propToken = getChildToken(skinToken, "skeleton");
-    if (propToken != nullptr) {
-      ret.skeleton = std::stoi(propToken->value);
+    propValue = getChildJsonValue(skinValue, "skeleton");
+    if (propValue != nullptr) {
+      ret.skeleton = toUint(propValue);
       ret.foundSkeleton = true;
     }
 
@@ -637,74 +647,55 @@ namespace small3d {
   }
 
   bool GlbFile::existSkin(const std::string& name) {
-    auto skinTokens = getChildTokens(getToken("skins"));
-
-
-    if (std::any_of(skinTokens.begin(), skinTokens.end(), [this, &name](const auto& skinToken) {
-      return getChildToken(skinToken, "name")->value == name;
-      })) {
-      return true;
-    }
-
-    return false;
+    return std::any_of(skins.begin(), skins.end(), [&name](const Skin& skin) { return skin.name == name; });
   }
 
-  GlbFile::Skin GlbFile::getSkin(const std::string& name) {
-
-    auto skinTokens = getChildTokens(getToken("skins"));
-
-    bool found = false;
-    uint32_t nodeIndex = 0;
-
-    for (const auto& skinToken : skinTokens) {
-      if (getChildToken(skinToken, "name")->value == name) {
-        found = true;
-        break;
-      }
-      ++nodeIndex;
+  const GlbFile::Skin& GlbFile::getSkin(const std::string& name) {
+    for (const auto& skin : skins) {
+      if (skin.name == name) return skin;
     }
-
-    if (!found) throw std::runtime_error("Skin " + name + " not found.");
-
-    return getSkin(nodeIndex);
-
+    throw std::runtime_error("Skin " + name + " not found.");
   }
 
   bool GlbFile::existAnimation(const uint32_t index) {
-    if (getToken("animations") == nullptr) return false;
-    return getChildTokens(getToken("animations")).size() > index;
+    return animations.size() > index;
+  }
+
+  const GlbFile::Animation& GlbFile::getAnimation(const uint32_t index) {
+    if (!existAnimation(index)) throw std::runtime_error("Animation " + std::to_string(index) + " not found.");
+    return animations[index];
   }
 
-  GlbFile::Animation GlbFile::getAnimation(const uint32_t index) {
-    auto animationToken = getChildTokens(getToken("animations"))[index];
+  GlbFile::Animation GlbFile::readAnimation(const uint32_t index) const {
+    const auto& animationValue = getJsonElement("animations", index);
 
     GlbFile::Animation ret;
 
-    auto propToken = getChildToken(animationToken, "name");
-    if (propToken != nullptr) {
-      ret.name = propToken->value;
+    auto propValue = getChildJsonValue(animationValue, "name");
+    if (propValue != nullptr) {
+      ret.name = toString(propValue);
     }
 
-    propToken = getChildToken(animationToken, "channels");
-    if (propToken != nullptr) {
-      auto channelTokens = getChildTokens(propToken);
-      for (const auto& channelToken : channelTokens) {
+    propValue = getChildJsonValue(animationValue, "channels");
+    if (propValue != nullptr) {
+      for (uint32_t idx = 0; idx < propValue->numChildren; ++idx) {
+        const auto& channelValue = getJsonElement(*propValue, idx);
         AnimationChannel channel;
-        auto samplerToken = getChildToken(channelToken, "sampler");
-        if (samplerToken != nullptr) {
-          channel.sampler = stoi(samplerToken->value);
+        auto samplerValue = getChildJsonValue(channelValue, "sampler");
+        if (samplerValue != nullptr) {
+          channel.sampler = toUint(samplerValue);
         }
 
-        auto targetToken = getChildToken(channelToken, "target");
-        if (targetToken != nullptr) {
+        auto targetValue = getChildJsonValue(channelValue, "target");
+        if (targetValue != nullptr) {
           ChannelTarget target;
-          auto nodeToken = getChildToken(targetToken, "node");
-          if (nodeToken != nullptr) {
-            target.node = std::stoi(nodeToken->value);
+          auto nodeValue = getChildJsonValue(*targetValue, "node");
+          if (nodeValue != nullptr) {
+            target.node = toUint(nodeValue);
           }
-          auto pathToken = getChildToken(targetToken, "path");
-          if (pathToken != nullptr) {
-            target.path = pathToken->value;
+          auto pathValue = getChildJsonValue(*targetValue, "path");
+          if (pathValue != nullptr) {
+            target.path = toString(pathValue);
           }
           channel.target = target;
         }
@@ -713,24 +704,24 @@ namespace small3d {
       }
     }
 
-    propToken = getChildToken(animationToken, "samplers");
-    if (propToken != nullptr) {
-      auto samplerTokens = getChildTokens(propToken);
-      for (const auto& samplerToken : samplerTokens) {
+    propValue = getChildJsonValue(animationValue, "samplers");
+    if (propValue != nullptr) {
+      for (uint32_t idx = 0; idx < propValue->numChildren; ++idx) {
+        const auto& samplerValue = getJsonElement(*propValue, idx);
         AnimationSampler sampler;
-        auto inputToken = getChildToken(samplerToken, "input");
-        if (inputToken != nullptr) {
-          sampler.input = std::stoi(inputToken->value);
+        auto inputValue = getChildJsonValue(samplerValue, "input");
+        if (inputValue != nullptr) {
+          sampler.input = toUint(inputValue);
         }
 
-        auto interpolationToken = getChildToken(samplerToken, "interpolation");
-        if (interpolationToken != nullptr) {
-          sampler.interpolation = interpolationToken->value;
+        auto interpolationValue = getChildJsonValue(samplerValue, "interpolation");
+        if (interpolationValue != nullptr) {
+          sampler.interpolation = toString(interpolationValue);
         }
 
-        auto outputToken = getChildToken(samplerToken, "output");
-        if (outputToken != nullptr) {
-          sampler.output = std::stoi(outputToken->value);
+        auto outputValue = getChildJsonValue(samplerValue, "output");
+        if (outputValue != nullptr) {
+          sampler.output = toUint(outputValue);
         }
 
         ret.samplers.emplace_back(sampler);
@@ -742,23 +733,11 @@ namespace small3d {
     return ret;
   }
 
-  GlbFile::Animation GlbFile::getAnimation(const std::string& name) {
-    auto animationTokens = getChildTokens(getToken("animations"));
-
-    bool found = false;
-    uint32_t nodeIndex = 0;
-
-    for (const auto& animationToken : animationTokens) {
-      if (getChildToken(animationToken, "name")->value == name) {
-        found = true;
-        break;
-      }
-      ++nodeIndex;
+  const GlbFile::Animation& GlbFile::getAnimation(const std::string& name) {
+    for (const auto& animation : animations) {
+      if (animation.name == name) return animation;
     }
-
-    if (!found) throw std::runtime_error("Animation " + name + " not found.");
-
-    return getAnimation(nodeIndex);
+    throw std::runtime_error("Animation " + name + " not found.");
   }
 
   void GlbFile::load(Model& model, const std::string& meshName) {
@@ -766,126 +745,131 @@ namespace small3d {
     bool loaded = false;
     std::string actualName = "";
     uint32_t meshIndex = 0;
-    for (const auto& meshToken : getChildTokens(getToken("meshes"))) {
+    for (; meshIndex < getNumJsonElements("meshes"); ++meshIndex) {
+      const auto& meshValue = getJsonElement("meshes", meshIndex);
 
-      actualName = getChildToken(meshToken, "name")->value;
+      actualName = toString(getChildJsonValue(meshValue, "name"));
       if (actualName == meshName || meshName == "") { // Just get the first mesh if no name is given.
-        auto primitives = getChildTokens(
-          getChildToken(meshToken, "primitives"));
-        auto attributes = getChildTokens(getChildToken(primitives[0], "attributes"));
+        auto primitivesValue = getChildJsonValue(meshValue, "primitives");
+        if (primitivesValue == nullptr) {
+          throw std::runtime_error("Mesh " + actualName + " has no primitives in " + fullPath);
+        }
+        const auto& primitive = getJsonElement(*primitivesValue, 0);
+        auto attributesValue = getChildJsonValue(primitive, "attributes");
+        if (attributesValue == nullptr) {
+          throw std::runtime_error("Mesh " + actualName + " has no attributes in " + fullPath);
+        }
 
-        for (auto attribute : attributes) {
+        for (uint32_t attributeIdx = 0; attributeIdx < attributesValue->numChildren; ++attributeIdx) {
+          const auto* attribute = &getJsonElement(*attributesValue, attributeIdx);
 
           if (attribute->name == "POSITION") {
+            auto accessor = getAccessorView(toUint(attribute));
 
-            auto data = getBufferByAccessor(std::stoi(attribute->value));
-
-            auto numFloatsInData = data.size() / 4;
-
-            model.vertexData.resize(numFloatsInData + numFloatsInData / 3); // Add 1 float for each 3 for 
-            // the w component of each vector
-
+            // The w component of each vector is 1 and only x, y and z are read
+            model.vertexData.assign(accessor.count * 4, 1.0f);
             model.vertexDataByteSize = static_cast<uint32_t>(model.vertexData.size() * 4); // Each vertex component is 4 bytes
-            size_t vertexPos = 0;
-
-            for (size_t idx = 0; idx < numFloatsInData; ++idx) {
-              memcpy(&model.vertexData[vertexPos], &data[idx * 4], 4);
-              ++vertexPos;
-              if (idx > 0 && (idx + 1) % 3 == 0) {
-                model.vertexData[vertexPos] = 1.0f;
-                ++vertexPos;
-              }
-            }
+            readAccessor(accessor, model.vertexData.data(), 4);
           }
 
           if (attribute->name == "NORMAL") {
-            auto data = getBufferByAccessor(std::stoi(attribute->value));
-            model.normalsData.resize(data.size() / 4);
-            model.normalsDataByteSize = static_cast<uint32_t>(data.size());
-            memcpy(&model.normalsData[0], &data[0], data.size());
-
+            auto accessor = getAccessorView(toUint(attribute));
+            model.normalsData.resize(accessor.count * accessor.numComponents);
+            model.normalsDataByteSize = static_cast<uint32_t>(model.normalsData.size() * 4);
+            readAccessor(accessor, model.normalsData.data(), accessor.numComponents);
           }
 
           if (attribute->name == "TEXCOORD_0") {
-            auto data = getBufferByAccessor(std::stoi(attribute->value));
-            model.textureCoordsData.resize(data.size() / 4);
-            model.textureCoordsDataByteSize = static_cast<uint32_t>(data.size());
-            memcpy(&model.textureCoordsData[0], &data[0], data.size());
+            auto accessor = getAccessorView(toUint(attribute));
+            model.textureCoordsData.resize(accessor.count * accessor.numComponents);
+            model.textureCoordsDataByteSize = static_cast<uint32_t>(model.textureCoordsData.size() * 4);
+            readAccessor(accessor, model.textureCoordsData.data(), accessor.numComponents);
           }
 
           if (attribute->name == "JOINTS_0") {
-            int componentType = 0;
-            auto data = getBufferByAccessor(std::stoi(attribute->value), componentType);
+            auto accessor = getAccessorView(toUint(attribute));
 
-            if (componentType < 5122) {
-              model.jointData.resize(data.size());
-              model.jointDataByteSize = static_cast<uint32_t>(data.size());
-              memcpy(&model.jointData[0], &data[0], data.size());
-            }
-            else if (componentType < 5125) {
-              model.jointData.resize(data.size() / 2);
-              model.jointDataByteSize = static_cast<uint32_t>(data.size() / 2);
-              uint32_t idx = 0;
-              uint16_t tmp = 0;
-              for (auto& d : model.jointData) {
-                memcpy(&tmp, &data[2 * idx], 2);
-                d = static_cast<uint8_t>(tmp);
-                ++idx;
-              }
-            }
-            else {
+            if (accessor.componentType >= 5125) {
               throw std::runtime_error("Unforeseen datatype for joint data.");
             }
+
+            // Joint indices are stored in bytes, even if they are in shorts in the file
+            model.jointData.resize(accessor.count * accessor.numComponents);
+            model.jointDataByteSize = static_cast<uint32_t>(model.jointData.size());
+            readAccessor(accessor, model.jointData.data(), accessor.numComponents);
           }
 
           if (attribute->name == "WEIGHTS_0") {
-            auto data = getBufferByAccessor(std::stoi(attribute->value));
-            model.weightData.resize(data.size() / 4);
-            model.weightDataByteSize = static_cast<uint32_t>(data.size());
-            memcpy(&model.weightData[0], &data[0], data.size());
+            auto accessor = getAccessorView(toUint(attribute));
+            model.weightData.resize(accessor.count * accessor.numComponents);
+            model.weightDataByteSize = static_cast<uint32_t>(model.weightData.size() * 4);
+            readAccessor(accessor, model.weightData.data(), accessor.numComponents);
           }
 
         }
 
-        auto indicesToken = getChildToken(primitives[0], "indices");
-        if (indicesToken == nullptr) {
+        auto indicesValue = getChildJsonValue(primitive, "indices");
+        if (indicesValue == nullptr) {
           // Just create indices that serially output the vertices
-          model.indexData.resize(model.vertexData.size() / 4);
+          std::vector<uint32_t> indices(model.vertexData.size() / 4);
           uint32_t cnt = 0;
-          for (auto& point : model.indexData) {
+          for (auto& point : indices) {
             point = cnt;
             cnt++;
           }
-          model.indexDataByteSize = static_cast<uint32_t>(model.indexData.size() * sizeof(uint16_t));
+          model.setIndexData(indices);
         }
         else {
-          auto data = getBufferByAccessor(std::stoi(indicesToken->value));
-          model.indexData.resize(data.size() / 2);
-          model.indexDataByteSize =
-            static_cast<uint32_t>(model.indexData.size() * sizeof(uint16_t)); // 4 because, even though each index is read in 16 bits,
-          // it is stored in 32 bits
-          uint16_t indexBuf = 0;
-          for (size_t idx = 0; idx < model.indexData.size(); ++idx) {
-            memcpy(&indexBuf, &data[2 * idx], 2);
-            model.indexData[idx] = static_cast<uint32_t>(indexBuf);
+          auto accessor = getAccessorView(toUint(indicesValue));
+
+          // Indices are read straight into the 16 or 32 bit index data of
+          // the model (see Model::setIndexData).
+          switch (accessor.componentType) {
+          case 5121: // unsigned byte
+          case 5123: // unsigned short
+            model.indexData.resize(accessor.count);
+            readAccessor(accessor, model.indexData.data(), 1);
+            model.indexData32.clear();
+            model.indexDataByteSize = static_cast<uint32_t>(model.indexData.size() * sizeof(uint16_t));
+            break;
+          case 5125: { // unsigned int
+            model.indexData32.resize(accessor.count);
+            readAccessor(accessor, model.indexData32.data(), 1);
+            uint32_t maxIndex = 0;
+            for (auto i : model.indexData32) if (i > maxIndex) maxIndex = i;
+            if (maxIndex <= UINT16_MAX) {
+              model.indexData.assign(model.indexData32.begin(), model.indexData32.end());
+              model.indexData32.clear();
+              model.indexData32.shrink_to_fit();
+              model.indexDataByteSize = static_cast<uint32_t>(model.indexData.size() * sizeof(uint16_t));
+            }
+            else {
+              model.indexData.clear();
+              model.indexDataByteSize = static_cast<uint32_t>(model.indexData32.size() * sizeof(uint32_t));
+            }
+            break;
+          }
+          default:
+            throw std::runtime_error("Unforeseen datatype for index data.");
           }
         }
-        auto materialsToken = getChildToken(primitives[0], "material");
-        if (materialsToken != nullptr) {
+        auto materialValue = getChildJsonValue(primitive, "material");
+        if (materialValue != nullptr) {
 
-          uint32_t materialIndex = std::stoi(materialsToken->value);
+          uint32_t materialIndex = toUint(materialValue);
 
-          auto materialToken = getChildTokens(getToken("materials"))[materialIndex];
+          const auto& material = getJsonElement("materials", materialIndex);
 
-          auto metallicRoughnessToken = getChildToken(materialToken, "pbrMetallicRoughness");
-          if (metallicRoughnessToken != nullptr) {
-            auto baseColorTextureToken = getChildToken(metallicRoughnessToken, "baseColorTexture");
-            if (baseColorTextureToken != nullptr) {
-              uint32_t textureIndex = std::stoi(getChildToken(baseColorTextureToken, "index")->value);
-              uint32_t sourceIndex = std::stoi(getChildToken(getChildTokens(getToken("textures"))[textureIndex], "source")->value);
-              auto imageToken = getChildTokens(getToken("images"))[sourceIndex];
-              if (getChildToken(imageToken, "mimeType")->value == "image/png") {
-                auto imageData = getBufferByView(std::stoi(getChildToken(imageToken, "bufferView")->value));
+          auto metallicRoughnessValue = getChildJsonValue(material, "pbrMetallicRoughness");
+          if (metallicRoughnessValue != nullptr) {
+            auto baseColorTextureValue = getChildJsonValue(*metallicRoughnessValue, "baseColorTexture");
+            if (baseColorTextureValue != nullptr) {
+              uint32_t textureIndex = toUint(getChildJsonValue(*baseColorTextureValue, "index"));
+              uint32_t sourceIndex = toUint(getChildJsonValue(getJsonElement("textures", textureIndex), "source"));
+              const auto& image = getJsonElement("images", sourceIndex);
+              if (toString(getChildJsonValue(image, "mimeType")) == "image/png") {
+                auto imageView = getBufferView(toUint(getChildJsonValue(image, "bufferView")));
+                std::vector<char> imageData(imageView.data, imageView.data + imageView.size);
 
                 try {
                   model.defaultTextureImage = std::make_shared<Image>(imageData);
@@ -903,14 +887,12 @@ namespace small3d {
                 LOGINFO("Warning! Only PNG images embedded in .glb files can be read. Texture ignored.");
               }
             }
-            auto baseColorFactorToken = getChildToken(metallicRoughnessToken, "baseColorFactor");
-            if (baseColorFactorToken != nullptr) {
-              auto colourTokens = getChildTokens(baseColorFactorToken);
-
-              model.material.ambientColour = Vec3(atof(colourTokens[0]->value.c_str()),
-                atof(colourTokens[1]->value.c_str()),
-                atof(colourTokens[2]->value.c_str()));
-              model.material.alpha = atof(colourTokens[3]->value.c_str());
+            auto baseColorFactorValue = getChildJsonValue(*metallicRoughnessValue, "baseColorFactor");
+            if (baseColorFactorValue != nullptr) {
+              model.material.ambientColour = Vec3(toFloat(&getJsonElement(*baseColorFactorValue, 0)),
+                toFloat(&getJsonElement(*baseColorFactorValue, 1)),
+                toFloat(&getJsonElement(*baseColorFactorValue, 2)));
+              model.material.alpha = toFloat(&getJsonElement(*baseColorFactorValue, 3));
             }
           }
         }
@@ -918,47 +900,42 @@ namespace small3d {
         loaded = true;
         break;
       }
-      ++meshIndex;
     }
 
     if (!loaded) throw std::runtime_error("Could not load mesh " + meshName + " from " + fullPath);
 
     LOGDEBUG("Loaded mesh " + actualName + " from " + fullPath);
 
+    model.packVertexData();
+
     if (existNode(actualName) || existNodeForMesh(meshIndex)) {
-      Node meshNode;
-      if (existNode(actualName)) {
-        meshNode = getNode(actualName);
-      }
-      else {
-        meshNode = getNodeForMesh(meshIndex);
-      }
+      const Node& meshNode = existNode(actualName) ? getNode(actualName) : getNodeForMesh(meshIndex);
 
       model.origTransformation = meshNode.transformation;
       model.origRotation = meshNode.rotation;
       model.origTranslation = meshNode.translation;
       model.origScale = meshNode.scale;
 
-      auto tmpNode = meshNode;
+      const Node* tmpNode = &meshNode;
 
       // Getting armature and z_up transformations if they exist
       uint32_t parentCount = 0;
-      while (existParentNode(tmpNode.index)) {
-        tmpNode = getParentNode(tmpNode.index);
+      while (existParentNode(tmpNode->index)) {
+        tmpNode = &getParentNode(tmpNode->index);
         ++parentCount;
-        LOGDEBUG("Parent of mesh found (" + std::to_string(parentCount) + "): " + tmpNode.name);
-        model.origRotation = tmpNode.rotation * model.origRotation;
-        model.origTranslation += tmpNode.translation;
-        model.origScale.x *= tmpNode.scale.x;
-        model.origScale.y *= tmpNode.scale.y;
-        model.origScale.z *= tmpNode.scale.z;
-        model.origTransformation = tmpNode.transformation * model.origTransformation;
+        LOGDEBUG("Parent of mesh found (" + std::to_string(parentCount) + "): " + tmpNode->name);
+        model.origRotation = tmpNode->rotation * model.origRotation;
+        model.origTranslation += tmpNode->translation;
+        model.origScale.x *= tmpNode->scale.x;
+        model.origScale.y *= tmpNode->scale.y;
+        model.origScale.z *= tmpNode->scale.z;
+        model.origTransformation = tmpNode->transformation * model.origTransformation;
       }
 
       // Get mesh animation
       uint32_t animationIdx = 0;
       while (existAnimation(animationIdx)) {
-        auto animation = getAnimation(animationIdx);
+        const auto& animation = getAnimation(animationIdx);
         for (const auto& channel : animation.channels) {
           if (meshNode.index == channel.target.node) {
             addAnimation(model.animations, animationIdx, animation, channel, model);
@@ -970,7 +947,7 @@ namespace small3d {
       // Get joints animation
       if (!meshNode.noSkin && existSkin(meshNode.skin)) {
 
-        auto skin = getSkin(meshNode.skin);
+        const auto& skin = getSkin(meshNode.skin);
 
         if (skin.joints.size() > Model::MAX_JOINTS_SUPPORTED) {
           LOGDEBUG("Found more than the maximum of " +
@@ -978,14 +955,20 @@ namespace small3d {
           return;
         }
 
-        auto inverseBindMatrices = getBufferByAccessor(skin.inverseBindMatrices);
+        auto inverseBindMatrices = getAccessorView(skin.inverseBindMatrices);
+        if (inverseBindMatrices.count < skin.joints.size() || inverseBindMatrices.numComponents != 16) {
+          throw std::runtime_error("Not enough inverse bind matrices for skin " + skin.name + " in " + fullPath);
+        }
+        AccessorView inverseBindMatrix = inverseBindMatrices;
+        inverseBindMatrix.count = 1;
         uint64_t idx = 0;
 
         for (auto jointIdx : skin.joints) {
           Model::Joint j;
 
-          memcpy(&j.inverseBindMatrix, &inverseBindMatrices[idx * 16 * 4], 16 * 4);
-          auto jointNode = getNode(jointIdx);
+          inverseBindMatrix.data = inverseBindMatrices.data + idx * inverseBindMatrices.stride;
+          readAccessor(inverseBindMatrix, &j.inverseBindMatrix.data[0].x, 16);
+          const auto& jointNode = getNode(jointIdx);
           j.node = jointIdx;
           j.name = jointNode.name;
           j.rotation = jointNode.rotation;
@@ -1000,7 +983,7 @@ namespace small3d {
 
         animationIdx = 0;
         while (existAnimation(animationIdx)) {
-          auto animation = getAnimation(animationIdx);
+          const auto& animation = getAnimation(animationIdx);
 
           if (model.animations.size() < animationIdx + 1) {
             model.animations.emplace_back(Model::Animation());
@@ -1025,13 +1008,33 @@ namespace small3d {
     }
   }
 
+  std::vector<Model> GlbFile::loadMeshes(const std::vector<std::string>& meshNames) {
+    std::vector<std::string> names = meshNames.empty() ? getMeshNames() : meshNames;
+    std::vector<Model> models(names.size());
+
+    // Meshes can differ a lot in size, so each one is a separate task and
+    // each thread takes the next mesh that has not been loaded yet, rather
+    // than a fixed share of them.
+    ThreadPool::getInstance().run(names.size(), [&](size_t idx) {
+      try {
+        models[idx] = Model(*this, names[idx]);
+      }
+      catch (const std::exception& e) {
+        throw std::runtime_error("Could not load mesh " + names[idx] + " from " + fullPath +
+          ": " + e.what());
+      }
+    });
+
+    return models;
+  }
+
   std::vector<std::string> GlbFile::getMeshNames() {
     std::vector<std::string> names;
 
-    for (const auto& meshToken : getChildTokens(getToken("meshes"))) {
-      auto nameToken = getChildToken(meshToken, "name");
-      if (nameToken != nullptr) {
-        names.emplace_back(nameToken->value);
+    for (uint32_t meshIdx = 0; meshIdx < getNumJsonElements("meshes"); ++meshIdx) {
+      auto nameValue = getChildJsonValue(getJsonElement("meshes", meshIdx), "name");
+      if (nameValue != nullptr) {
+        names.emplace_back(nameValue->value);
       }
     }
     return names;
@@ -1044,11 +1047,11 @@ namespace small3d {
     // sampler.interpolation ignored, just using everything
     // as STEP
 
-    auto input = getBufferByAccessor(sampler.input);
-    std::vector<float>times(input.size() / 4);
-    memcpy(&times[0], &input[0], input.size());
+    auto input = getAccessorView(sampler.input);
+    std::vector<float>times(input.count);
+    readAccessor(input, times.data(), 1);
 
-    auto output = getBufferByAccessor(sampler.output);
+    auto output = getAccessorView(sampler.output);
 
     if (animations.size() < animationIdx + 1) {
       animations.emplace_back(Model::Animation());
@@ -1074,22 +1077,31 @@ namespace small3d {
     }
 
     if (channel.target.path == "rotation") {
-      animations[animationIdx].animationComponents[animIndex].rotationAnimation.resize(output.size() / sizeof(Quat));
-      memcpy(&animations[animationIdx].animationComponents[animIndex].rotationAnimation[0], &output[0], output.size());
+      if (output.numComponents != 4) {
+        throw std::runtime_error("Unexpected rotation animation data in " + fullPath);
+      }
+      animations[animationIdx].animationComponents[animIndex].rotationAnimation.resize(output.count);
+      readAccessor(output, reinterpret_cast<float*>(animations[animationIdx].animationComponents[animIndex].rotationAnimation.data()), 4);
       if (model.numPoses[animationIdx] < animations[animationIdx].animationComponents[animIndex].rotationAnimation.size())
         model.numPoses[animationIdx] = animations[animationIdx].animationComponents[animIndex].rotationAnimation.size();
     }
 
     if (channel.target.path == "translation") {
-      animations[animationIdx].animationComponents[animIndex].translationAnimation.resize(output.size() / sizeof(Vec3));
-      memcpy(&animations[animationIdx].animationComponents[animIndex].translationAnimation[0], &output[0], output.size());
+      if (output.numComponents != 3) {
+        throw std::runtime_error("Unexpected translation animation data in " + fullPath);
+      }
+      animations[animationIdx].animationComponents[animIndex].translationAnimation.resize(output.count);
+      readAccessor(output, reinterpret_cast<float*>(animations[animationIdx].animationComponents[animIndex].translationAnimation.data()), 3);
       if (model.numPoses[animationIdx] < animations[animationIdx].animationComponents[animIndex].translationAnimation.size())
         model.numPoses[animationIdx] = animations[animationIdx].animationComponents[animIndex].translationAnimation.size();
     }
 
     if (channel.target.path == "scale") {      
-      animations[animationIdx].animationComponents[animIndex].scaleAnimation.resize(output.size() / sizeof(Vec3));
-      memcpy(&animations[animationIdx].animationComponents[animIndex].scaleAnimation[0], &output[0], output.size());
+      if (output.numComponents != 3) {
+        throw std::runtime_error("Unexpected scale animation data in " + fullPath);
+      }
+      animations[animationIdx].animationComponents[animIndex].scaleAnimation.resize(output.count);
+      readAccessor(output, reinterpret_cast<float*>(animations[animationIdx].animationComponents[animIndex].scaleAnimation.data()), 3);
       if (model.numPoses[animationIdx] < animations[animationIdx].animationComponents[animIndex].scaleAnimation.size())
         model.numPoses[animationIdx] = animations[animationIdx].animationComponents[animIndex].scaleAnimation.size();
     }
@@ -10,6 +10,7 @@
 #include <stdexcept>
 #include <cstring>
 #include "BasePath.hpp"
+#include "Pack.hpp"
 
 namespace small3d {
 
@@ -53,6 +54,11 @@ namespace small3d {
     }
   }
 
+  Image::Image(const Pack& pack, const std::string& entryName) {
+    std::vector<char> data = pack.read(entryName);
+    this->load("", data);
+  }
+
   void Image::toColour(Vec4 colour) {
     width = 10;
     height = 10;
@@ -10,9 +10,14 @@
 #include <sstream>
 #include <ctime>
 #include <iostream>
+#include <mutex>
 
 std::shared_ptr<small3d::Logger> logger;
 
+// Messages can be logged from several threads (e.g. while loading
+// meshes in parallel)
+static std::mutex loggerMutex;
+
 namespace small3d {
 
   Logger::Logger() {
@@ -27,6 +32,8 @@ namespace small3d {
       if (!logger) return;
 
 
+      std::lock_guard<std::mutex> lock(loggerMutex);
+
       std::ostringstream dateTimeOstringstream;
 
       time_t now;
@@ -0,0 +1,81 @@
+/**
+ *  MappedFile.cpp
+ *
+ *  Created on: 2026/10/18
+ *      Author: Dimitri Kourkoulis
+ *     License: BSD 3-Clause License (see LICENSE file)
+ */
+
+#include "MappedFile.hpp"
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace small3d {
+
+  MappedFile::MappedFile(const std::string& path, bool sequential) {
+#ifdef __linux__
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Could not open file " + path);
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+      close(fd);
+      throw std::runtime_error("Could not get the size of file " + path);
+    }
+
+    mappedSize = static_cast<size_t>(fileStat.st_size);
+
+    // Empty files cannot be mapped (and there is nothing to read)
+    if (mappedSize > 0) {
+      void* mapping = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Could not map file " + path);
+      }
+      // Only advice, so failing is not an error
+      madvise(mapping, mappedSize, sequential ? MADV_SEQUENTIAL : MADV_WILLNEED);
+      mappedData = static_cast<const char*>(mapping);
+    }
+
+    // The mapping remains valid after the file is closed
+    close(fd);
+#else
+    (void)sequential;
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+      throw std::runtime_error("Could not open file " + path);
+    }
+    readData.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(readData.data(), readData.size());
+    mappedData = readData.data();
+    mappedSize = readData.size();
+#endif
+  }
+
+  MappedFile::~MappedFile() {
+#ifdef __linux__
+    if (mappedData != nullptr) {
+      munmap(const_cast<char*>(mappedData), mappedSize);
+    }
+#endif
+  }
+
+  const char* MappedFile::data() const {
+    return mappedData;
+  }
+
+  size_t MappedFile::size() const {
+    return mappedSize;
+  }
+}
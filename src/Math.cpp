@@ -7,10 +7,130 @@
  */
 
 #include "Math.hpp"
+#include "ThreadPool.hpp"
 #include <cmath>
 #include <algorithm>
+#include <vector>
+
+// SIMD instructions are used for the matrix operations, unless
+// SMALL3D_NO_SIMD is defined, in which case the scalar implementations
+// are used on all platforms.
+#if !defined(SMALL3D_NO_SIMD) && (defined(__SSE__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define SMALL3D_SIMD_SSE
+#include <xmmintrin.h>
+#elif !defined(SMALL3D_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__) || \
+  defined(_M_ARM64))
+#define SMALL3D_SIMD_NEON
+#include <arm_neon.h>
+#endif
 
 namespace small3d {
+
+#if defined(SMALL3D_SIMD_SSE) || defined(SMALL3D_SIMD_NEON)
+
+  // Thin layer over the SSE and NEON intrinsics, so that the operations
+  // below are only written once. Only plain multiplications, additions
+  // and subtractions are used (no fused multiply-add), in the same order
+  // as in the scalar implementations, so that the results are the same.
+
+#ifdef SMALL3D_SIMD_SSE
+  typedef __m128 float4;
+
+  static inline float4 load4(const Vec4& vec) { return _mm_loadu_ps(&vec.x); }
+  static inline float4 load4(const float* values) { return _mm_loadu_ps(values); }
+  static inline void store4(Vec4& vec, float4 value) { _mm_storeu_ps(&vec.x, value); }
+  static inline void store4(float* values, float4 value) { _mm_storeu_ps(values, value); }
+  static inline float4 splat4(float value) { return _mm_set1_ps(value); }
+  static inline float4 set4(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+  static inline float4 add4(float4 a, float4 b) { return _mm_add_ps(a, b); }
+  static inline float4 sub4(float4 a, float4 b) { return _mm_sub_ps(a, b); }
+  static inline float4 mul4(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+
+  // (a[i0], a[i1], b[i2], b[i3])
+  template <int i0, int i1, int i2, int i3>
+  static inline float4 shuffle4(float4 a, float4 b) {
+    return _mm_shuffle_ps(a, b, _MM_SHUFFLE(i3, i2, i1, i0));
+  }
+
+  static inline float lane0(float4 value) { return _mm_cvtss_f32(value); }
+#else
+  typedef float32x4_t float4;
+
+  static inline float4 load4(const Vec4& vec) { return vld1q_f32(&vec.x); }
+  static inline float4 load4(const float* values) { return vld1q_f32(values); }
+  static inline void store4(Vec4& vec, float4 value) { vst1q_f32(&vec.x, value); }
+  static inline void store4(float* values, float4 value) { vst1q_f32(values, value); }
+  static inline float4 splat4(float value) { return vdupq_n_f32(value); }
+  static inline float4 set4(float x, float y, float z, float w) {
+    float values[4] = { x, y, z, w };
+    return vld1q_f32(values);
+  }
+  static inline float4 add4(float4 a, float4 b) { return vaddq_f32(a, b); }
+  static inline float4 sub4(float4 a, float4 b) { return vsubq_f32(a, b); }
+  static inline float4 mul4(float4 a, float4 b) { return vmulq_f32(a, b); }
+
+  // (a[i0], a[i1], b[i2], b[i3])
+  template <int i0, int i1, int i2, int i3>
+  static inline float4 shuffle4(float4 a, float4 b) {
+    float4 result = vdupq_n_f32(vgetq_lane_f32(a, i0));
+    result = vsetq_lane_f32(vgetq_lane_f32(a, i1), result, 1);
+    result = vsetq_lane_f32(vgetq_lane_f32(b, i2), result, 2);
+    return vsetq_lane_f32(vgetq_lane_f32(b, i3), result, 3);
+  }
+
+  static inline float lane0(float4 value) { return vgetq_lane_f32(value, 0); }
+#endif
+
+  // col0 * x + col1 * y + col2 * z + col3 * w
+  static inline float4 combine4(float4 col0, float4 col1, float4 col2, float4 col3,
+    const float* vec) {
+    return add4(add4(add4(mul4(col0, splat4(vec[0])), mul4(col1, splat4(vec[1]))),
+      mul4(col2, splat4(vec[2]))), mul4(col3, splat4(vec[3])));
+  }
+
+  static inline float4 combine4(float4 col0, float4 col1, float4 col2, float4 col3,
+    const Vec4& vec) {
+    return combine4(col0, col1, col2, col3, &vec.x);
+  }
+
+  // The factors used by inverse() for a pair of components (a, b):
+  // (m2.a * m3.b - m3.a * m2.b, (same), m1.a * m3.b - m3.a * m1.b,
+  //  m1.a * m2.b - m2.a * m1.b)
+  template <int a, int b>
+  static inline float4 inverseFactor(float4 m1, float4 m2, float4 m3) {
+    float4 left1 = shuffle4<a, a, a, a>(m2, m1);
+    float4 right1 = shuffle4<b, b, b, b>(m3, m2);
+    right1 = shuffle4<0, 0, 0, 2>(right1, right1);
+    float4 left2 = shuffle4<a, a, a, a>(m3, m2);
+    left2 = shuffle4<0, 0, 0, 2>(left2, left2);
+    float4 right2 = shuffle4<b, b, b, b>(m2, m1);
+    return sub4(mul4(left1, right1), mul4(left2, right2));
+  }
+
+  // (m1.c, m0.c, m0.c, m0.c)
+  template <int c>
+  static inline float4 inverseVector(float4 m0, float4 m1) {
+    float4 vec = shuffle4<c, c, c, c>(m1, m0);
+    return shuffle4<0, 2, 2, 2>(vec, vec);
+  }
+
+  const char* simdInstructionSet() {
+#ifdef SMALL3D_SIMD_SSE
+    return "SSE";
+#else
+    return "NEON";
+#endif
+  }
+
+#else
+
+  const char* simdInstructionSet() {
+    return "none";
+  }
+
+#endif
+
   Vec3::Vec3()
   {
     this->x = 0.0f;
@@ -236,11 +356,14 @@ namespace small3d {
 
   Vec4& Vec4::operator=(const Vec4& other)
   {
+#if defined(SMALL3D_SIMD_SSE) || defined(SMALL3D_SIMD_NEON)
+    store4(*this, load4(other));
+#else
     this->x = other.x;
     this->y = other.y;
     this->z = other.z;
     this->w = other.w;
-
+#endif
     return *this;
   }
 
@@ -327,15 +450,34 @@ namespace small3d {
 
   Mat4 Mat4::operator*(const Mat4& other) const
   {
-    Vec4 const srcA0 = this->data[0];
-    Vec4 const srcA1 = this->data[1];
-    Vec4 const srcA2 = this->data[2];
-    Vec4 const srcA3 = this->data[3];
+#if defined(SMALL3D_SIMD_SSE) || defined(SMALL3D_SIMD_NEON)
+    float4 const srcA0 = load4(this->data[0]);
+    float4 const srcA1 = load4(this->data[1]);
+    float4 const srcA2 = load4(this->data[2]);
+    float4 const srcA3 = load4(this->data[3]);
 
-    Vec4 const srcB0 = other.data[0];
-    Vec4 const srcB1 = other.data[1];
-    Vec4 const srcB2 = other.data[2];
-    Vec4 const srcB3 = other.data[3];
+    Mat4 result;
+    store4(result.data[0], combine4(srcA0, srcA1, srcA2, srcA3, other.data[0]));
+    store4(result.data[1], combine4(srcA0, srcA1, srcA2, srcA3, other.data[1]));
+    store4(result.data[2], combine4(srcA0, srcA1, srcA2, srcA3, other.data[2]));
+    store4(result.data[3], combine4(srcA0, srcA1, srcA2, srcA3, other.data[3]));
+    return result;
+#else
+    return scalar::multiply(*this, other);
+#endif
+  }
+
+  Mat4 scalar::multiply(const Mat4& mat1, const Mat4& mat2)
+  {
+    Vec4 const srcA0 = mat1.data[0];
+    Vec4 const srcA1 = mat1.data[1];
+    Vec4 const srcA2 = mat1.data[2];
+    Vec4 const srcA3 = mat1.data[3];
+
+    Vec4 const srcB0 = mat2.data[0];
+    Vec4 const srcB1 = mat2.data[1];
+    Vec4 const srcB2 = mat2.data[2];
+    Vec4 const srcB3 = mat2.data[3];
 
     Mat4 result;
     result[0] = srcA0 * srcB0.x + srcA1 * srcB0.y + srcA2 * srcB0.z + srcA3 * srcB0.w;
@@ -347,29 +489,41 @@ namespace small3d {
   }
 
   Vec4 Mat4::operator*(const Vec4& vec) const
+  {
+#if defined(SMALL3D_SIMD_SSE) || defined(SMALL3D_SIMD_NEON)
+    Vec4 result;
+    store4(result, combine4(load4(this->data[0]), load4(this->data[1]),
+      load4(this->data[2]), load4(this->data[3]), vec));
+    return result;
+#else
+    return scalar::multiply(*this, vec);
+#endif
+  }
+
+  Vec4 scalar::multiply(const Mat4& mat, const Vec4& vec)
   {
 
     Vec4 result;
 
-    result.x = this->data[0].x * vec.x +
-      this->data[1].x * vec.y +
-      this->data[2].x * vec.z +
-      this->data[3].x * vec.w;
+    result.x = mat.data[0].x * vec.x +
+      mat.data[1].x * vec.y +
+      mat.data[2].x * vec.z +
+      mat.data[3].x * vec.w;
 
-    result.y = this->data[0].y * vec.x +
-      this->data[1].y * vec.y +
-      this->data[2].y * vec.z +
-      this->data[3].y * vec.w;
+    result.y = mat.data[0].y * vec.x +
+      mat.data[1].y * vec.y +
+      mat.data[2].y * vec.z +
+      mat.data[3].y * vec.w;
 
-    result.z = this->data[0].z * vec.x +
-      this->data[1].z * vec.y +
-      this->data[2].z * vec.z +
-      this->data[3].z * vec.w;
+    result.z = mat.data[0].z * vec.x +
+      mat.data[1].z * vec.y +
+      mat.data[2].z * vec.z +
+      mat.data[3].z * vec.w;
 
-    result.w = this->data[0].w * vec.x +
-      this->data[1].w * vec.y +
-      this->data[2].w * vec.z +
-      this->data[3].w * vec.w;
+    result.w = mat.data[0].w * vec.x +
+      mat.data[1].w * vec.y +
+      mat.data[2].w * vec.z +
+      mat.data[3].w * vec.w;
 
     return result;
   }
@@ -408,15 +562,68 @@ namespace small3d {
 
   Mat4& Mat4::operator=(const Mat4& other)
   {
+#if defined(SMALL3D_SIMD_SSE) || defined(SMALL3D_SIMD_NEON)
+    // Copying whole columns also allows the SIMD operations to read them
+    // back directly after they have been written.
+    store4(this->data[0], load4(other.data[0]));
+    store4(this->data[1], load4(other.data[1]));
+    store4(this->data[2], load4(other.data[2]));
+    store4(this->data[3], load4(other.data[3]));
+#else
     this->data[0] = const_cast<Mat4&>(other)[0];
     this->data[1] = const_cast<Mat4&>(other)[1];
     this->data[2] = const_cast<Mat4&>(other)[2];
     this->data[3] = const_cast<Mat4&>(other)[3];
+#endif
     return *this;
   }
 
   Mat4 Quat::toMatrix() const
   {
+#if defined(SMALL3D_SIMD_SSE) || defined(SMALL3D_SIMD_NEON)
+    // Each column is the sum of a constant and two products of the
+    // quaternion's components (doubled on the left side), with their signs
+    float4 q = set4(x, y, z, w);
+    float4 q2 = add4(q, q);
+
+    float4 col0 = add4(add4(set4(1.0f, 0.0f, 0.0f, 0.0f),
+      mul4(mul4(shuffle4<1, 0, 0, 0>(q2, q2), shuffle4<1, 1, 2, 2>(q, q)),
+        set4(-1.0f, 1.0f, 1.0f, 0.0f))),
+      mul4(mul4(shuffle4<2, 3, 3, 3>(q2, q2), shuffle4<2, 2, 1, 1>(q, q)),
+        set4(-1.0f, 1.0f, -1.0f, 0.0f)));
+
+    float4 col1 = add4(add4(set4(0.0f, 1.0f, 0.0f, 0.0f),
+      mul4(mul4(shuffle4<0, 0, 1, 1>(q2, q2), shuffle4<1, 0, 2, 2>(q, q)),
+        set4(1.0f, -1.0f, 1.0f, 0.0f))),
+      mul4(mul4(shuffle4<3, 2, 3, 3>(q2, q2), shuffle4<2, 2, 0, 0>(q, q)),
+        set4(-1.0f, -1.0f, 1.0f, 0.0f)));
+
+    float4 col2 = add4(add4(set4(0.0f, 0.0f, 1.0f, 0.0f),
+      mul4(mul4(shuffle4<0, 1, 0, 0>(q2, q2), shuffle4<2, 2, 0, 0>(q, q)),
+        set4(1.0f, 1.0f, -1.0f, 0.0f))),
+      mul4(mul4(shuffle4<3, 3, 1, 1>(q2, q2), shuffle4<1, 0, 1, 1>(q, q)),
+        set4(1.0f, -1.0f, -1.0f, 0.0f)));
+
+    Mat4 matrix;
+    store4(matrix.data[0], col0);
+    store4(matrix.data[1], col1);
+    store4(matrix.data[2], col2);
+    matrix.data[0].w = 0.0f;
+    matrix.data[1].w = 0.0f;
+    matrix.data[2].w = 0.0f;
+    matrix.data[3] = Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    return matrix;
+#else
+    return scalar::toMatrix(*this);
+#endif
+  }
+
+  Mat4 scalar::toMatrix(const Quat& quat)
+  {
+    float x = quat.x;
+    float y = quat.y;
+    float z = quat.z;
+    float w = quat.w;
     Mat4 matrix(1.0f - 2 * y * y - 2 * z * z, 2 * x * y + 2 * w * z, 2 * x * z - 2 * w * y, 0.0f,
       2 * x * y - 2 * w * z, 1.0f - 2 * x * x - 2 * z * z, 2 * y * z + 2 * w * x, 0.0f,
       2 * x * z + 2 * w * y, 2 * y * z - 2 * w * x, 1.0f - 2 * x * x - 2 * y * y, 0.0f,
@@ -424,7 +631,7 @@ namespace small3d {
     return matrix;
   }
 
-  Quat Quat::operator*(const Quat& other)
+  Quat Quat::operator*(const Quat& other) const
   {
     Quat result;
     result.w = w * other.w;
@@ -448,21 +655,34 @@ namespace small3d {
   Mat4 translate(const Mat4& mat, const Vec3& vec)
   {
     Mat4 result = mat;
+#if defined(SMALL3D_SIMD_SSE) || defined(SMALL3D_SIMD_NEON)
+    store4(result.data[3], add4(add4(add4(mul4(load4(mat.data[0]), splat4(vec.x)),
+      mul4(load4(mat.data[1]), splat4(vec.y))), mul4(load4(mat.data[2]), splat4(vec.z))),
+      load4(mat.data[3])));
+#else
     result.data[3] = mat.data[0] * vec.x + mat.data[1] * vec.y + mat.data[2] * vec.z + mat.data[3];
+#endif
     return result;
   }
 
   Mat4 scale(const Mat4& mat, const Vec3& vec)
   {
     Mat4 result;
+#if defined(SMALL3D_SIMD_SSE) || defined(SMALL3D_SIMD_NEON)
+    store4(result.data[0], mul4(load4(mat.data[0]), splat4(vec.x)));
+    store4(result.data[1], mul4(load4(mat.data[1]), splat4(vec.y)));
+    store4(result.data[2], mul4(load4(mat.data[2]), splat4(vec.z)));
+#else
     result[0] = mat.data[0] * vec.x;
     result[1] = mat.data[1] * vec.y;
     result[2] = mat.data[2] * vec.z;
+#endif
     result[3] = mat.data[3];
     return result;
   }
 
-  Mat4 rotate(const Mat4& mat, const float angle, const Vec3& vec)
+  // The rotation by angle around vec (only the top left 3x3 part is set)
+  static Mat4 rotationMatrix(const float angle, const Vec3& vec)
   {
     float const a = angle;
     float const c = cos(a);
@@ -488,6 +708,34 @@ namespace small3d {
     rotate[2].y = temp.z * axis.y - s * axis.x;
     rotate[2].z = c + temp.z * axis.z;
 
+    return rotate;
+  }
+
+  Mat4 rotate(const Mat4& mat, const float angle, const Vec3& vec)
+  {
+#if defined(SMALL3D_SIMD_SSE) || defined(SMALL3D_SIMD_NEON)
+    Mat4 rotate = rotationMatrix(angle, vec);
+
+    float4 const col0 = load4(mat.data[0]);
+    float4 const col1 = load4(mat.data[1]);
+    float4 const col2 = load4(mat.data[2]);
+
+    Mat4 result;
+    for (int idx = 0; idx < 3; ++idx) {
+      store4(result.data[idx], add4(add4(mul4(col0, splat4(rotate.data[idx].x)),
+        mul4(col1, splat4(rotate.data[idx].y))), mul4(col2, splat4(rotate.data[idx].z))));
+    }
+    result[3] = mat.data[3];
+    return result;
+#else
+    return scalar::rotate(mat, angle, vec);
+#endif
+  }
+
+  Mat4 scalar::rotate(const Mat4& mat, const float angle, const Vec3& vec)
+  {
+    Mat4 rotate = rotationMatrix(angle, vec);
+
     Mat4 result;
     result[0] = mat.data[0] * rotate[0].x + mat.data[1] * rotate[0].y + mat.data[2] * rotate[0].z;
     result[1] = mat.data[0] * rotate[1].x + mat.data[1] * rotate[1].y + mat.data[2] * rotate[1].z;
@@ -526,6 +774,62 @@ namespace small3d {
   }
 
   Mat4 inverse(const Mat4& mat)
+  {
+#if defined(SMALL3D_SIMD_SSE) || defined(SMALL3D_SIMD_NEON)
+    // The same calculation as in the scalar implementation, four
+    // coefficients at a time
+    float4 const m0 = load4(mat.data[0]);
+    float4 const m1 = load4(mat.data[1]);
+    float4 const m2 = load4(mat.data[2]);
+    float4 const m3 = load4(mat.data[3]);
+
+    float4 fac0 = inverseFactor<2, 3>(m1, m2, m3);
+    float4 fac1 = inverseFactor<1, 3>(m1, m2, m3);
+    float4 fac2 = inverseFactor<1, 2>(m1, m2, m3);
+    float4 fac3 = inverseFactor<0, 3>(m1, m2, m3);
+    float4 fac4 = inverseFactor<0, 2>(m1, m2, m3);
+    float4 fac5 = inverseFactor<0, 1>(m1, m2, m3);
+
+    float4 vec0 = inverseVector<0>(m0, m1);
+    float4 vec1 = inverseVector<1>(m0, m1);
+    float4 vec2 = inverseVector<2>(m0, m1);
+    float4 vec3 = inverseVector<3>(m0, m1);
+
+    float4 inv0 = add4(sub4(mul4(vec1, fac0), mul4(vec2, fac1)), mul4(vec3, fac2));
+    float4 inv1 = add4(sub4(mul4(vec0, fac0), mul4(vec2, fac3)), mul4(vec3, fac4));
+    float4 inv2 = add4(sub4(mul4(vec0, fac1), mul4(vec1, fac3)), mul4(vec3, fac5));
+    float4 inv3 = add4(sub4(mul4(vec0, fac2), mul4(vec1, fac4)), mul4(vec2, fac5));
+
+    float4 signA = set4(+1.0f, -1.0f, +1.0f, -1.0f);
+    float4 signB = set4(-1.0f, +1.0f, -1.0f, +1.0f);
+    inv0 = mul4(inv0, signA);
+    inv1 = mul4(inv1, signB);
+    inv2 = mul4(inv2, signA);
+    inv3 = mul4(inv3, signB);
+
+    float4 row0 = shuffle4<0, 2, 0, 2>(shuffle4<0, 0, 0, 0>(inv0, inv1),
+      shuffle4<0, 0, 0, 0>(inv2, inv3));
+
+    float4 dot0 = mul4(m0, row0);
+    // (x + y, y + x, z + w, w + z)
+    float4 dot1 = add4(dot0, shuffle4<1, 0, 3, 2>(dot0, dot0));
+    // (x + y) + (z + w)
+    dot1 = add4(dot1, shuffle4<2, 3, 0, 1>(dot1, dot1));
+
+    float4 oneDivDeterminant = splat4(1.0f / lane0(dot1));
+
+    Mat4 result;
+    store4(result.data[0], mul4(inv0, oneDivDeterminant));
+    store4(result.data[1], mul4(inv1, oneDivDeterminant));
+    store4(result.data[2], mul4(inv2, oneDivDeterminant));
+    store4(result.data[3], mul4(inv3, oneDivDeterminant));
+    return result;
+#else
+    return scalar::inverse(mat);
+#endif
+  }
+
+  Mat4 scalar::inverse(const Mat4& mat)
   {
 
     float coef00 = mat.data[2].z * mat.data[3].w - mat.data[3].z * mat.data[2].w;
@@ -609,6 +913,146 @@ namespace small3d {
       return std::sqrt(vec.x * vec.x + vec.y * vec.y + vec.z * vec.z);
   }
 
+  Vec3 lerp(const Vec3& vec1, const Vec3& vec2, float t)
+  {
+    return vec1 + (vec2 - vec1) * t;
+  }
+
+  Quat slerp(const Quat& quat1, const Quat& quat2, float t)
+  {
+    Quat q2 = quat2;
+    float cosTheta = quat1.x * q2.x + quat1.y * q2.y + quat1.z * q2.z + quat1.w * q2.w;
+
+    // Take the shortest path
+    if (cosTheta < 0.0f) {
+      q2 = { -q2.x, -q2.y, -q2.z, -q2.w };
+      cosTheta = -cosTheta;
+    }
+
+    float factor1 = 1.0f - t;
+    float factor2 = t;
+
+    // Only use the spherical interpolation if the quaternions
+    // are not too close, otherwise sin(theta) approaches 0.
+    if (cosTheta < 0.9995f) {
+      float theta = std::acos(cosTheta);
+      float sinTheta = std::sin(theta);
+      factor1 = std::sin((1.0f - t) * theta) / sinTheta;
+      factor2 = std::sin(t * theta) / sinTheta;
+    }
+
+    Quat result = { factor1 * quat1.x + factor2 * q2.x,
+      factor1 * quat1.y + factor2 * q2.y,
+      factor1 * quat1.z + factor2 * q2.z,
+      factor1 * quat1.w + factor2 * q2.w };
+
+    float len = std::sqrt(result.x * result.x + result.y * result.y +
+      result.z * result.z + result.w * result.w);
+    if (len > 0.0f) {
+      result = { result.x / len, result.y / len, result.z / len, result.w / len };
+    }
+    return result;
+  }
+
+  // Batches processed with multiple threads are split among the threads of
+  // the ThreadPool, as long as each one gets at least this many elements.
+  static const size_t minBatchPerThread = 16384;
+
+  template <typename Process>
+  static void processBatch(size_t count, bool multithreaded, Process process) {
+    if (multithreaded) {
+      ThreadPool::getInstance().parallelFor(count, minBatchPerThread, process);
+    }
+    else {
+      process(0, count);
+    }
+  }
+
+  void transformPoints(const Mat4& mat, const float* inX, const float* inY,
+    const float* inZ, float* outX, float* outY, float* outZ, size_t count,
+    bool multithreaded) {
+
+    processBatch(count, multithreaded, [&](size_t begin, size_t end) {
+      size_t idx = begin;
+#if defined(SMALL3D_SIMD_SSE) || defined(SMALL3D_SIMD_NEON)
+      // Four points at a time, each lane holding one point
+      float4 m0[3] = { splat4(mat.data[0].x), splat4(mat.data[0].y), splat4(mat.data[0].z) };
+      float4 m1[3] = { splat4(mat.data[1].x), splat4(mat.data[1].y), splat4(mat.data[1].z) };
+      float4 m2[3] = { splat4(mat.data[2].x), splat4(mat.data[2].y), splat4(mat.data[2].z) };
+      float4 m3[3] = { splat4(mat.data[3].x), splat4(mat.data[3].y), splat4(mat.data[3].z) };
+      float* out[3] = { outX, outY, outZ };
+
+      for (; idx + 4 <= end; idx += 4) {
+        float4 x = load4(inX + idx);
+        float4 y = load4(inY + idx);
+        float4 z = load4(inZ + idx);
+        for (int component = 0; component < 3; ++component) {
+          store4(out[component] + idx, add4(add4(add4(mul4(m0[component], x),
+            mul4(m1[component], y)), mul4(m2[component], z)), m3[component]));
+        }
+      }
+#endif
+      for (; idx < end; ++idx) {
+        float x = inX[idx];
+        float y = inY[idx];
+        float z = inZ[idx];
+        outX[idx] = mat.data[0].x * x + mat.data[1].x * y + mat.data[2].x * z + mat.data[3].x;
+        outY[idx] = mat.data[0].y * x + mat.data[1].y * y + mat.data[2].y * z + mat.data[3].y;
+        outZ[idx] = mat.data[0].z * x + mat.data[1].z * y + mat.data[2].z * z + mat.data[3].z;
+      }
+      });
+  }
+
+  void transformPoints(const Mat4& mat, const float* in, float* out, size_t count,
+    bool multithreaded) {
+
+    processBatch(count, multithreaded, [&](size_t begin, size_t end) {
+#if defined(SMALL3D_SIMD_SSE) || defined(SMALL3D_SIMD_NEON)
+      float4 const col0 = load4(mat.data[0]);
+      float4 const col1 = load4(mat.data[1]);
+      float4 const col2 = load4(mat.data[2]);
+      float4 const col3 = load4(mat.data[3]);
+
+      for (size_t idx = 4 * begin; idx < 4 * end; idx += 4) {
+        store4(out + idx, combine4(col0, col1, col2, col3, in + idx));
+      }
+#else
+      for (size_t idx = 4 * begin; idx < 4 * end; idx += 4) {
+        Vec4 result = scalar::multiply(mat, Vec4(in[idx], in[idx + 1], in[idx + 2], in[idx + 3]));
+        out[idx] = result.x;
+        out[idx + 1] = result.y;
+        out[idx + 2] = result.z;
+        out[idx + 3] = result.w;
+      }
+#endif
+      });
+  }
+
+  void multiplyMatrices(const Mat4* mats1, const Mat4* mats2, Mat4* out, size_t count,
+    bool multithreaded) {
+
+    processBatch(count, multithreaded, [&](size_t begin, size_t end) {
+      for (size_t idx = begin; idx < end; ++idx) {
+        out[idx] = mats1[idx] * mats2[idx];
+      }
+      });
+  }
+
+  void composeTRS(const Vec3* translations, const Quat* rotations,
+    const Vec3* scales, Mat4* out, size_t count, bool multithreaded) {
+
+    processBatch(count, multithreaded, [&](size_t begin, size_t end) {
+      for (size_t idx = begin; idx < end; ++idx) {
+        Mat4 matrix = rotations[idx].toMatrix();
+        matrix.data[0] *= scales[idx].x;
+        matrix.data[1] *= scales[idx].y;
+        matrix.data[2] *= scales[idx].z;
+        matrix.data[3] = Vec4(translations[idx], 1.0f);
+        out[idx] = matrix;
+      }
+      });
+  }
+
   float* Value_ptr(Mat4& mat)
   {
     return &(mat.data[0].x);
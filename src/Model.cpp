@@ -11,6 +11,8 @@
 #include "Model.hpp"
 #include "Logger.hpp"
 #include "GlbFile.hpp"
+#include "BinaryFile.hpp"
+#include "BoundingBoxSet.hpp"
 #include <cereal/archives/binary.hpp>
 #include <sstream>
 #include <ostream>
@@ -19,6 +21,9 @@
 #include <cereal/types/memory.hpp>
 #include <zlib.h>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <atomic>
 
 namespace small3d {
 
@@ -31,12 +36,16 @@ namespace small3d {
     file.load(*this, meshName);
     numPoses.resize(1);
     numPoses[0] = 0;
+    resolveJointHierarchy();
+    calculateBounds();
   }
 
   Model::Model(File&& file, const std::string& meshName) {
     numPoses.resize(1);
     numPoses[0] = 0;
     file.load(*this, meshName);
+    resolveJointHierarchy();
+    calculateBounds();
   }
 
   uint64_t Model::getNumPoses() {
@@ -144,17 +153,55 @@ namespace small3d {
 
   }
 
-  Mat4 Model::getJointTransform(size_t joint, uint32_t animationIdx, uint64_t currentPose, float seconds) {
+  void Model::resolveJointHierarchy() {
+    jointParents.assign(joints.size(), -1);
+    jointOrder.clear();
 
-    float secondsUsed = seconds;
+    // Find the parent of each joint, if it exists
+    for (size_t joint = 0; joint < joints.size(); ++joint) {
+      auto jointnode = joints[joint].node;
+      size_t idx = 0;
+      for (const auto& j : joints) {
+        if (std::any_of(j.children.begin(), j.children.end(), [&jointnode](const auto& c) {
+          return c == jointnode;
+          })) {
+          jointParents[joint] = static_cast<int32_t>(idx);
+          break;
+        }
+        ++idx;
+      }
+    }
+
+    // Order the joints by depth, so that parents are always
+    // processed before their children
+    std::vector<size_t> depths(joints.size(), 0);
+    for (size_t joint = 0; joint < joints.size(); ++joint) {
+      auto parent = jointParents[joint];
+      while (parent >= 0 && depths[joint] <= joints.size()) {
+        ++depths[joint];
+        parent = jointParents[parent];
+      }
+      jointOrder.push_back(joint);
+    }
+    std::stable_sort(jointOrder.begin(), jointOrder.end(), [&depths](const auto& a, const auto& b) {
+      return depths[a] < depths[b];
+      });
+
+    inverseBindMatrices.resize(std::min(joints.size(), static_cast<size_t>(MAX_JOINTS_SUPPORTED)));
+    for (size_t joint = 0; joint < inverseBindMatrices.size(); ++joint) {
+      inverseBindMatrices[joint] = joints[joint].inverseBindMatrix;
+    }
+
+    jointPalettes.clear();
+  }
+
+  float Model::getJointSeconds(size_t joint, uint32_t animationIdx, uint64_t currentPose) {
+    float secondsUsed = 0.0f;
 
-    // If parameter seconds == 0, it looks like
-    // this function has been called for the 
-    // first time in the stack sequence.
     // Find in one of the animation sequences
-    // a seconds value that corresponds to 
+    // a seconds value that corresponds to
     // the current pose.
-    if (seconds == 0.0f && joints[joint].animations.size() > 0) {
+    if (joints[joint].animations.size() > 0) {
 
       if (auto animFound = std::find_if(joints[joint].animations[animationIdx].animationComponents.begin(),
         joints[joint].animations[animationIdx].animationComponents.end(),
@@ -163,31 +210,10 @@ namespace small3d {
         secondsUsed = (*animFound).times[currentPose];
       }
     }
+    return secondsUsed;
+  }
 
-    // Find the parent node, if it exists
-    size_t idx = 0;
-    bool parentFound = false;
-    for (const auto& j : joints) {
-
-      auto jointnode = joints[joint].node;
-
-      if (std::any_of(j.children.begin(), j.children.end(), [&jointnode](const auto& c) {
-        return c == jointnode;
-        })) {
-        parentFound = true;
-        break;
-      }
-
-      ++idx;
-    }
-
-    // If parent node exists, get the transform
-    // of the parent node that corresponds to the seconds
-    // value used
-    Mat4 parentTransform(1.0f);
-    if (parentFound) {
-      parentTransform = getJointTransform(idx, animationIdx, currentPose, secondsUsed);
-    }
+  Mat4 Model::getJointLocalTransform(size_t joint, uint32_t animationIdx, uint64_t currentPose, float secondsUsed) {
 
     // By default, the joint is in its initial state
     Mat4 translation = translate(Mat4(1.0f), joints[joint].translation);
@@ -256,21 +282,541 @@ namespace small3d {
         }
       }
     }
-    return  parentTransform * translation * rotation * scale * joints[joint].transformation;
+    return translation * rotation * scale * joints[joint].transformation;
+  }
+
+  Mat4 Model::getJointTransform(size_t joint, uint32_t animationIdx, uint64_t currentPose, float seconds) {
+
+    if (jointParents.size() != joints.size()) {
+      resolveJointHierarchy();
+    }
+
+    // If parameter seconds == 0, it looks like
+    // this function has been called for the 
+    // first time in the stack sequence.
+    float secondsUsed = seconds == 0.0f ? getJointSeconds(joint, animationIdx, currentPose) : seconds;
+
+    // If parent node exists, get the transform
+    // of the parent node that corresponds to the seconds
+    // value used
+    Mat4 parentTransform(1.0f);
+    if (jointParents[joint] >= 0) {
+      parentTransform = getJointTransform(jointParents[joint], animationIdx, currentPose, secondsUsed);
+    }
+
+    return parentTransform * getJointLocalTransform(joint, animationIdx, currentPose, secondsUsed);
+  }
+
+  const Mat4* Model::getJointPalette(uint32_t animationIdx, uint64_t currentPose) {
+
+    if (jointParents.size() != joints.size()) {
+      resolveJointHierarchy();
+    }
+
+    uint64_t key = (static_cast<uint64_t>(animationIdx) << 32) | (currentPose & 0xFFFFFFFF);
+
+    auto found = jointPalettes.find(key);
+    if (found != jointPalettes.end()) {
+      return found->second.data();
+    }
+
+    std::vector<Mat4> palette(MAX_JOINTS_SUPPORTED);
+    std::vector<Mat4> jointTransforms(joints.size());
+    std::vector<float> jointSeconds(joints.size());
+
+    // Parents are processed before their children, so each joint
+    // transform is built on top of the one already calculated for
+    // its parent, rather than recalculating the whole chain.
+    for (auto joint : jointOrder) {
+      float secondsUsed = getJointSeconds(joint, animationIdx, currentPose);
+      jointSeconds[joint] = secondsUsed;
+
+      Mat4 parentTransform(1.0f);
+      auto parent = jointParents[joint];
+      if (parent >= 0) {
+        if (secondsUsed == 0.0f || secondsUsed == jointSeconds[parent]) {
+          parentTransform = jointTransforms[parent];
+        }
+        else {
+          // The parent is animated on a different timeline. Calculate
+          // its transform at the moment of this joint.
+          parentTransform = getJointTransform(parent, animationIdx, currentPose, secondsUsed);
+        }
+      }
+
+      jointTransforms[joint] = parentTransform *
+        getJointLocalTransform(joint, animationIdx, currentPose, secondsUsed);
+    }
+
+    multiplyMatrices(jointTransforms.data(), inverseBindMatrices.data(), palette.data(),
+      inverseBindMatrices.size());
+
+    return jointPalettes.emplace(key, std::move(palette)).first->second.data();
+  }
+
+  void Model::sampleAnimation(const std::vector<AnimationComponent>& animationComponents,
+    float seconds, Mat4& translation, Mat4& rotation, Mat4& scale) {
+
+    // First time a translation, rotation or scale frame
+    // are being assigned?
+    bool firstT = true, firstR = true, firstS = true;
+
+    for (const auto& animationComponent : animationComponents) {
+      const auto& times = animationComponent.times;
+      if (times.empty()) continue;
+
+      // Find the keyframes before and after the given moment
+      size_t idx0 = 0, idx1 = 0;
+      float t = 0.0f;
+      if (seconds >= times.back()) {
+        idx0 = idx1 = times.size() - 1;
+      }
+      else if (seconds > times.front()) {
+        idx1 = std::upper_bound(times.begin(), times.end(), seconds) - times.begin();
+        idx0 = idx1 - 1;
+        float span = times[idx1] - times[idx0];
+        t = span > 0.0f ? (seconds - times[idx0]) / span : 0.0f;
+      }
+
+      if (animationComponent.translationAnimation.size() > idx1) {
+        auto sampled = translate(Mat4(1.0f), lerp(animationComponent.translationAnimation[idx0],
+          animationComponent.translationAnimation[idx1], t));
+        if (firstT) {
+          translation = sampled;
+          firstT = false;
+        }
+        else {
+          translation *= sampled;
+        }
+      }
+      if (animationComponent.rotationAnimation.size() > idx1) {
+        auto sampled = slerp(animationComponent.rotationAnimation[idx0],
+          animationComponent.rotationAnimation[idx1], t).toMatrix();
+        if (firstR) {
+          rotation = sampled;
+          firstR = false;
+        }
+        else {
+          rotation *= sampled;
+        }
+      }
+      if (animationComponent.scaleAnimation.size() > idx1) {
+        auto sampled = small3d::scale(Mat4(1.0f), lerp(animationComponent.scaleAnimation[idx0],
+          animationComponent.scaleAnimation[idx1], t));
+        if (firstS) {
+          scale = sampled;
+          firstS = false;
+        }
+        else {
+          scale *= sampled;
+        }
+      }
+    }
+  }
+
+  float Model::getAnimationDuration(uint32_t animationIdx) {
+    float duration = 0.0f;
+
+    auto checkComponents = [&duration, &animationIdx](const std::vector<Animation>& anims) {
+      if (anims.size() > animationIdx) {
+        for (const auto& animationComponent : anims[animationIdx].animationComponents) {
+          if (!animationComponent.times.empty() && animationComponent.times.back() > duration) {
+            duration = animationComponent.times.back();
+          }
+        }
+      }
+    };
+
+    checkComponents(animations);
+    for (const auto& joint : joints) {
+      checkComponents(joint.animations);
+    }
+    return duration;
+  }
+
+  Mat4 Model::getTransformAt(uint32_t animationIdx, float seconds) {
+    Mat4 translation(1.0f);
+    Mat4 rotation(1.0f);
+    Mat4 scale(1.0f);
+
+    if (animations.size() > animationIdx) {
+      sampleAnimation(animations[animationIdx].animationComponents, seconds,
+        translation, rotation, scale);
+    }
+    return translation * rotation * scale;
+  }
+
+  const Mat4* Model::getJointPaletteAt(uint32_t animationIdx, float seconds) {
+
+    if (jointParents.size() != joints.size()) {
+      resolveJointHierarchy();
+    }
+
+    sampledJointPalette.resize(MAX_JOINTS_SUPPORTED);
+    sampledJointTransforms.resize(joints.size());
+
+    for (auto joint : jointOrder) {
+      Mat4 translation = translate(Mat4(1.0f), joints[joint].translation);
+      Mat4 rotation = joints[joint].rotation.toMatrix();
+      Mat4 scale = small3d::scale(Mat4(1.0f), joints[joint].scale);
+
+      if (joints[joint].animations.size() > animationIdx) {
+        sampleAnimation(joints[joint].animations[animationIdx].animationComponents, seconds,
+          translation, rotation, scale);
+      }
+
+      auto parent = jointParents[joint];
+      sampledJointTransforms[joint] = (parent >= 0 ? sampledJointTransforms[parent] : Mat4(1.0f)) *
+        translation * rotation * scale * joints[joint].transformation;
+    }
+
+    multiplyMatrices(sampledJointTransforms.data(), inverseBindMatrices.data(),
+      sampledJointPalette.data(), inverseBindMatrices.size());
+
+    return sampledJointPalette.data();
+  }
+
+  void Model::clearJointPaletteCache() {
+    jointParents.clear();
+    jointOrder.clear();
+    inverseBindMatrices.clear();
+    jointPalettes.clear();
+  }
+
+  void Model::calculateBounds() {
+    size_t numVertices = vertexData.size() / 4;
+
+    if (numVertices == 0) {
+      boundsMin = Vec3(0.0f, 0.0f, 0.0f);
+      boundsMax = Vec3(0.0f, 0.0f, 0.0f);
+      boundsRadius = 0.0f;
+    }
+    else {
+      boundsMin = Vec3(vertexData[0], vertexData[1], vertexData[2]);
+      boundsMax = boundsMin;
+
+      for (size_t idx = 1; idx < numVertices; ++idx) {
+        const float* vertex = &vertexData[4 * idx];
+        boundsMin = Vec3(std::min(boundsMin.x, vertex[0]), std::min(boundsMin.y, vertex[1]),
+          std::min(boundsMin.z, vertex[2]));
+        boundsMax = Vec3(std::max(boundsMax.x, vertex[0]), std::max(boundsMax.y, vertex[1]),
+          std::max(boundsMax.z, vertex[2]));
+      }
+
+      Vec3 centre = (boundsMin + boundsMax) / 2.0f;
+      float maxDistanceSq = 0.0f;
+
+      for (size_t idx = 0; idx < numVertices; ++idx) {
+        const float* vertex = &vertexData[4 * idx];
+        Vec3 distance = Vec3(vertex[0], vertex[1], vertex[2]) - centre;
+        maxDistanceSq = std::max(maxDistanceSq, dot(distance, distance));
+      }
+
+      boundsRadius = std::sqrt(maxDistanceSq);
+    }
+
+    boundsGeneration = dataGeneration;
+  }
+
+  const Vec3& Model::getBoundsMin() {
+    if (boundsGeneration != dataGeneration) {
+      calculateBounds();
+    }
+    return boundsMin;
+  }
+
+  const Vec3& Model::getBoundsMax() {
+    if (boundsGeneration != dataGeneration) {
+      calculateBounds();
+    }
+    return boundsMax;
+  }
+
+  float Model::getBoundingRadius() {
+    if (boundsGeneration != dataGeneration) {
+      calculateBounds();
+    }
+    return boundsRadius;
+  }
+
+  void Model::markDataChanged() {
+    if (!packedVertexData.empty()) {
+      packVertexData();
+    }
+    clearJointPaletteCache();
+    dataGeneration = nextDataGeneration();
+  }
+
+  uint64_t Model::nextDataGeneration() {
+    static std::atomic<uint64_t> generation{ 1 };
+    return generation++;
+  }
+
+  void Model::setIndexData(const std::vector<uint32_t>& indices) {
+    uint32_t maxIndex = 0;
+    for (auto i : indices) if (i > maxIndex) maxIndex = i;
+
+    if (maxIndex <= UINT16_MAX) {
+      indexData.resize(indices.size());
+      for (size_t idx = 0; idx < indices.size(); ++idx) {
+        indexData[idx] = static_cast<uint16_t>(indices[idx]);
+      }
+      indexData32.clear();
+      indexDataByteSize = static_cast<uint32_t>(indexData.size() * sizeof(uint16_t));
+    }
+    else {
+      indexData32 = indices;
+      indexData.clear();
+      indexDataByteSize = static_cast<uint32_t>(indexData32.size() * sizeof(uint32_t));
+    }
+  }
+
+  size_t Model::getNumIndices() const {
+    return indexData32.empty() ? indexData.size() : indexData32.size();
+  }
+
+  std::vector<Model> Model::splitIntoMeshlets(uint32_t maxVertices) const {
+    if (maxVertices < 3 || maxVertices > 65536) {
+      throw std::runtime_error("The maximum number of vertices per meshlet must be between 3 and 65536.");
+    }
+
+    std::vector<uint32_t> indices(indexData32);
+    if (indices.empty()) {
+      indices.assign(indexData.begin(), indexData.end());
+    }
+
+    // The basis of each meshlet: a copy of the model, without its vertex
+    // data and not associated with any GPU buffers
+    Model shell(*this);
+    shell.vertexData.clear();
+    shell.normalsData.clear();
+    shell.textureCoordsData.clear();
+    shell.jointData.clear();
+    shell.weightData.clear();
+    shell.indexData.clear();
+    shell.indexData32.clear();
+    shell.packedVertexData.clear();
+    shell.loadedBoundingBoxSets.clear();
+    shell.positionBufferObjectId = 0;
+    shell.indexBufferObjectId = 0;
+    shell.normalsBufferObjectId = 0;
+    shell.uvBufferObjectId = 0;
+    shell.jointBufferObjectId = 0;
+    shell.weightBufferObjectId = 0;
+    shell.vertexArrayObjectId = 0;
+    shell.gpuGeneration = 0;
+
+    size_t numVertices = vertexData.size() / 4;
+    bool hasNormals = normalsData.size() >= numVertices * 3;
+    bool hasUVs = textureCoordsData.size() >= numVertices * 2;
+    bool hasJoints = jointData.size() >= numVertices * 4 && weightData.size() >= numVertices * 4;
+
+    std::vector<Model> meshlets;
+
+    // Position of each of the model's vertices in the current meshlet
+    std::vector<uint32_t> meshletIndex(numVertices, UINT32_MAX);
+    std::vector<uint32_t> meshletVertices;
+    std::vector<uint32_t> meshletIndices;
+
+    auto completeMeshlet = [&]() {
+      Model meshlet(shell);
+      meshlet.dataGeneration = nextDataGeneration();
+      for (auto v : meshletVertices) {
+        meshlet.vertexData.insert(meshlet.vertexData.end(), vertexData.begin() + v * 4,
+          vertexData.begin() + (v + 1) * 4);
+        if (hasNormals) {
+          meshlet.normalsData.insert(meshlet.normalsData.end(), normalsData.begin() + v * 3,
+            normalsData.begin() + (v + 1) * 3);
+        }
+        if (hasUVs) {
+          meshlet.textureCoordsData.insert(meshlet.textureCoordsData.end(), textureCoordsData.begin() + v * 2,
+            textureCoordsData.begin() + (v + 1) * 2);
+        }
+        if (hasJoints) {
+          meshlet.jointData.insert(meshlet.jointData.end(), jointData.begin() + v * 4,
+            jointData.begin() + (v + 1) * 4);
+          meshlet.weightData.insert(meshlet.weightData.end(), weightData.begin() + v * 4,
+            weightData.begin() + (v + 1) * 4);
+        }
+        meshletIndex[v] = UINT32_MAX;
+      }
+      meshlet.vertexDataByteSize = static_cast<uint32_t>(meshlet.vertexData.size() * sizeof(float));
+      meshlet.normalsDataByteSize = static_cast<uint32_t>(meshlet.normalsData.size() * sizeof(float));
+      meshlet.textureCoordsDataByteSize = static_cast<uint32_t>(meshlet.textureCoordsData.size() * sizeof(float));
+      meshlet.jointDataByteSize = static_cast<uint32_t>(meshlet.jointData.size());
+      meshlet.weightDataByteSize = static_cast<uint32_t>(meshlet.weightData.size() * sizeof(float));
+      meshlet.setIndexData(meshletIndices);
+      if (!packedVertexData.empty()) {
+        meshlet.packVertexData();
+      }
+      meshlets.push_back(std::move(meshlet));
+      meshletVertices.clear();
+      meshletIndices.clear();
+    };
+
+    for (size_t idx = 0; idx + 2 < indices.size(); idx += 3) {
+      const uint32_t* triangle = &indices[idx];
+
+      uint32_t newVertices = 0;
+      for (size_t c = 0; c < 3; ++c) {
+        if (meshletIndex[triangle[c]] == UINT32_MAX &&
+          (c == 0 || triangle[c] != triangle[0]) &&
+          (c < 2 || triangle[c] != triangle[1])) {
+          ++newVertices;
+        }
+      }
+
+      if (meshletVertices.size() + newVertices > maxVertices) {
+        completeMeshlet();
+      }
+
+      for (size_t c = 0; c < 3; ++c) {
+        if (meshletIndex[triangle[c]] == UINT32_MAX) {
+          meshletIndex[triangle[c]] = static_cast<uint32_t>(meshletVertices.size());
+          meshletVertices.push_back(triangle[c]);
+        }
+        meshletIndices.push_back(meshletIndex[triangle[c]]);
+      }
+    }
+
+    if (!meshletIndices.empty()) {
+      completeMeshlet();
+    }
+
+    return meshlets;
+  }
+
+  bool Model::packVertexData() {
+    packedVertexData.clear();
+    packedVertexStride = 0;
+    packedUVOffset = 0;
+    packedJointOffset = 0;
+    packedWeightOffset = 0;
+
+    size_t numVertices = vertexData.size() / 4;
+
+    for (size_t idx = 0; idx < numVertices; ++idx) {
+      // The w component is dropped (the GPU sets it to 1 when reading
+      // the packed data)
+      if (vertexData[idx * 4 + 3] != 1.0f) return false;
+    }
+
+    bool hasNormals = normalsData.size() >= numVertices * 3;
+    bool hasUVs = textureCoordsDataByteSize != 0;
+    bool hasJoints = jointDataByteSize != 0 || weightDataByteSize != 0;
+
+    if (hasUVs) {
+      if (textureCoordsData.size() < numVertices * 2) return false;
+      for (size_t idx = 0; idx < numVertices * 2; ++idx) {
+        if (textureCoordsData[idx] < 0.0f || textureCoordsData[idx] > 1.0f) return false;
+      }
+    }
+
+    if (hasJoints && (jointData.size() < numVertices * 4 ||
+      weightData.size() < numVertices * 4)) return false;
+
+    uint32_t stride = 20; // Position (12 bytes) and normal (8 bytes)
+    if (hasUVs) {
+      packedUVOffset = stride;
+      stride += 4;
+    }
+    if (hasJoints) {
+      packedJointOffset = stride;
+      packedWeightOffset = stride + 4;
+      stride += 8;
+    }
+    packedVertexStride = stride;
+
+    packedVertexData.resize(numVertices * stride);
+
+    for (size_t idx = 0; idx < numVertices; ++idx) {
+      uint8_t* vertex = &packedVertexData[idx * stride];
+
+      memcpy(vertex, &vertexData[idx * 4], 3 * sizeof(float));
+
+      int16_t normal[4] = { 0, 0, 0, 0 };
+      if (hasNormals) {
+        for (size_t c = 0; c < 3; ++c) {
+          float n = std::max(-1.0f, std::min(1.0f, normalsData[idx * 3 + c]));
+          normal[c] = static_cast<int16_t>(std::lround(n * 32767.0f));
+        }
+      }
+      memcpy(vertex + 12, normal, sizeof(normal));
+
+      if (hasUVs) {
+        uint16_t uv[2];
+        for (size_t c = 0; c < 2; ++c) {
+          uv[c] = static_cast<uint16_t>(std::lround(textureCoordsData[idx * 2 + c] * 65535.0f));
+        }
+        memcpy(vertex + packedUVOffset, uv, sizeof(uv));
+      }
+
+      if (hasJoints) {
+        memcpy(vertex + packedJointOffset, &jointData[idx * 4], 4);
+
+        // Quantise the weights, keeping their sum as it was (usually 1),
+        // by giving the rounding remainder to the largest one
+        uint8_t* weights = vertex + packedWeightOffset;
+        float sum = 0.0f;
+        int32_t quantisedSum = 0;
+        size_t largest = 0;
+        for (size_t c = 0; c < 4; ++c) {
+          float w = std::max(0.0f, std::min(1.0f, weightData[idx * 4 + c]));
+          sum += w;
+          weights[c] = static_cast<uint8_t>(std::lround(w * 255.0f));
+          quantisedSum += weights[c];
+          if (weightData[idx * 4 + c] > weightData[idx * 4 + largest]) largest = c;
+        }
+        int32_t adjusted = weights[largest] +
+          static_cast<int32_t>(std::lround(std::min(sum, 1.0f) * 255.0f)) - quantisedSum;
+        weights[largest] = static_cast<uint8_t>(std::max(0, std::min(255, adjusted)));
+      }
+    }
+
+    return true;
+  }
+
+  uint32_t Model::getPackedVertexStride() const {
+    return packedVertexStride;
+  }
+
+  bool Model::isInGPU() const {
+    return vertexArrayObjectId != 0 && gpuGeneration == dataGeneration;
   }
 
   Vec3 Model::getOriginalScale() {
     return origScale;
   }
 
-  void Model::saveBinary(const std::string& binaryFilePath) {
+  void Model::saveBinary(const std::string& binaryFilePath,
+    const std::vector<uint32_t>& boundingBoxSubdivisions, BinaryFormat format) {
 
     const uint32_t CHUNK = 16384;
 
+    std::vector<BoundingBoxSet> boxSets;
+    for (auto subdivisions : boundingBoxSubdivisions) {
+      boxSets.push_back(*BoundingBoxSet::getCached(*this, subdivisions));
+    }
+
+    if (format == BinaryFormat::mapped) {
+      BinaryFile::saveMapped(*this, binaryFilePath, boxSets);
+      return;
+    }
+
     std::stringstream ss(std::ios::out | std::ios::binary | std::ios::trunc);
 
     cereal::BinaryOutputArchive oarchive(ss);
+    ss.write(BinaryFile::COMPRESSED_MAGIC, sizeof(BinaryFile::COMPRESSED_MAGIC));
+    uint32_t version = BinaryFile::COMPRESSED_FORMAT_VERSION;
+    oarchive(version);
     oarchive(*this);
+    oarchive(indexData32);
+
+    // Bounding box sets are stored after the model, so files without
+    // them can be read the same way.
+    if (!boxSets.empty()) {
+      oarchive(boxSets);
+    }
 
     unsigned char out[CHUNK];
     z_stream strm;
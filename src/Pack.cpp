@@ -0,0 +1,306 @@
+/**
+ *  Pack.cpp
+ *
+ *  Created on: 2026/10/18
+ *      Author: Dimitri Kourkoulis
+ *     License: BSD 3-Clause License (see LICENSE file)
+ */
+
+#include "Pack.hpp"
+#include "BasePath.hpp"
+#include "Logger.hpp"
+#include <stdexcept>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <limits>
+#include <zlib.h>
+
+namespace small3d {
+
+  namespace {
+
+    // The layout of a pack is the header, followed by the entries, the
+    // hash table (an entry index per bucket, or EMPTY_BUCKET), the names
+    // of the entries and, finally, the contents of the entries, each
+    // aligned to DATA_ALIGNMENT bytes. The header and the tables are written
+    // as they are in memory and are read in place.
+    const char PACK_MAGIC[4] = { 'S', '3', 'D', 'P' };
+    const uint32_t BYTE_ORDER_MARK = 0x01020304;
+    const uint32_t EMPTY_BUCKET = std::numeric_limits<uint32_t>::max();
+    const uint64_t DATA_ALIGNMENT = 16;
+
+    struct PackHeader {
+      char magic[4] = { PACK_MAGIC[0], PACK_MAGIC[1], PACK_MAGIC[2], PACK_MAGIC[3] };
+      uint32_t version = Pack::FORMAT_VERSION;
+      uint32_t byteOrder = BYTE_ORDER_MARK;
+      uint32_t numEntries = 0;
+      uint32_t numBuckets = 0;
+      uint32_t namesSize = 0;
+      // CRC-32 of the header (with this set to 0) and the tables
+      uint32_t checksum = 0;
+      uint32_t reserved = 0;
+    };
+
+    static_assert(sizeof(PackHeader) == 32, "The layout of the pack header has changed.");
+
+    uint64_t alignOffset(uint64_t offset) {
+      return (offset + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+    }
+
+    uint32_t calculateChecksum(const char* data, size_t size) {
+      PackHeader header;
+      memcpy(&header, data, sizeof(PackHeader));
+      header.checksum = 0;
+      uLong crc = crc32(0L, Z_NULL, 0);
+      crc = crc32(crc, reinterpret_cast<const Bytef*>(&header), sizeof(PackHeader));
+      crc = crc32(crc, reinterpret_cast<const Bytef*>(data + sizeof(PackHeader)),
+        static_cast<uInt>(size - sizeof(PackHeader)));
+      return static_cast<uint32_t>(crc);
+    }
+  }
+
+  uint64_t Pack::hashName(std::string_view name) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (auto c : name) {
+      hash ^= static_cast<uint8_t>(c);
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  Pack::Pack(const std::string& fileLocation) {
+    fullPath = fileLocation[0] == '/' ? fileLocation : getBasePath() + fileLocation;
+
+    mappedFile = std::make_unique<MappedFile>(fullPath, false);
+
+    const char* data = mappedFile->data();
+    size_t size = mappedFile->size();
+
+    PackHeader header;
+    if (size < sizeof(PackHeader) || memcmp(data, PACK_MAGIC, 4) != 0) {
+      throw std::runtime_error("File " + fullPath + " is not a pack.");
+    }
+    memcpy(&header, data, sizeof(PackHeader));
+
+    if (header.byteOrder != BYTE_ORDER_MARK) {
+      throw std::runtime_error("Pack " + fullPath + " has been written on a machine with a different byte order.");
+    }
+
+    uint64_t tablesSize = sizeof(PackHeader) + static_cast<uint64_t>(header.numEntries) * sizeof(Entry) +
+      static_cast<uint64_t>(header.numBuckets) * sizeof(uint32_t) + header.namesSize;
+
+    if (tablesSize > size || header.numBuckets < header.numEntries ||
+      (header.numBuckets & (header.numBuckets - 1)) != 0) {
+      throw std::runtime_error("Pack " + fullPath + " is truncated or corrupted.");
+    }
+
+    if (calculateChecksum(data, static_cast<size_t>(tablesSize)) != header.checksum) {
+      throw std::runtime_error("The checksum of the table of contents of pack " + fullPath + " does not match.");
+    }
+
+    if (header.version > FORMAT_VERSION) {
+      throw std::runtime_error("Pack " + fullPath + " is of version " + std::to_string(header.version) +
+        ", which is not supported.");
+    }
+
+    numEntries = header.numEntries;
+    numBuckets = header.numBuckets;
+    entries = reinterpret_cast<const Entry*>(data + sizeof(PackHeader));
+    buckets = reinterpret_cast<const uint32_t*>(entries + numEntries);
+    names = reinterpret_cast<const char*>(buckets + numBuckets);
+
+    for (uint32_t idx = 0; idx < numEntries; ++idx) {
+      const Entry& entry = entries[idx];
+      if (static_cast<uint64_t>(entry.nameOffset) + entry.nameLength > header.namesSize ||
+        entry.offset < tablesSize || entry.offset > size || entry.storedSize > size - entry.offset ||
+        (!entry.compressed && entry.storedSize != entry.size)) {
+        throw std::runtime_error("Entry " + std::to_string(idx) + " of pack " + fullPath + " is corrupted.");
+      }
+    }
+    for (uint32_t idx = 0; idx < numBuckets; ++idx) {
+      if (buckets[idx] != EMPTY_BUCKET && buckets[idx] >= numEntries) {
+        throw std::runtime_error("The hash table of pack " + fullPath + " is corrupted.");
+      }
+    }
+
+    LOGDEBUG("Opened pack " + fullPath + " with " + std::to_string(numEntries) + " entries.");
+  }
+
+  const Pack::Entry* Pack::findEntry(std::string_view name) const {
+    if (numBuckets == 0) return nullptr;
+
+    uint64_t hash = hashName(name);
+
+    // Open addressing, with linear probing
+    for (uint32_t probe = 0; probe < numBuckets; ++probe) {
+      uint32_t index = buckets[(hash + probe) & (numBuckets - 1)];
+      if (index == EMPTY_BUCKET) return nullptr;
+      const Entry& entry = entries[index];
+      if (entry.hash == hash && name == std::string_view(names + entry.nameOffset, entry.nameLength)) {
+        return &entry;
+      }
+    }
+    return nullptr;
+  }
+
+  bool Pack::contains(const std::string& name) const {
+    return findEntry(name) != nullptr;
+  }
+
+  std::vector<std::string> Pack::getEntryNames() const {
+    std::vector<std::string> entryNames;
+    entryNames.reserve(numEntries);
+    for (uint32_t idx = 0; idx < numEntries; ++idx) {
+      entryNames.emplace_back(names + entries[idx].nameOffset, entries[idx].nameLength);
+    }
+    return entryNames;
+  }
+
+  std::string_view Pack::getEntry(const std::string& name, std::vector<char>& buffer) const {
+    const Entry* entry = findEntry(name);
+    if (entry == nullptr) {
+      throw std::runtime_error("Entry " + name + " not found in pack " + fullPath);
+    }
+
+    const char* data = mappedFile->data() + entry->offset;
+
+    if (!entry->compressed) {
+      return std::string_view(data, static_cast<size_t>(entry->size));
+    }
+
+    buffer.resize(static_cast<size_t>(entry->size));
+    uLongf uncompressedSize = static_cast<uLongf>(entry->size);
+    if (uncompress(reinterpret_cast<Bytef*>(buffer.data()), &uncompressedSize,
+      reinterpret_cast<const Bytef*>(data), static_cast<uLong>(entry->storedSize)) != Z_OK ||
+      uncompressedSize != entry->size) {
+      throw std::runtime_error("Could not decompress entry " + name + " of pack " + fullPath);
+    }
+    return std::string_view(buffer.data(), buffer.size());
+  }
+
+  std::vector<char> Pack::read(const std::string& name) const {
+    std::vector<char> buffer;
+    auto contents = getEntry(name, buffer);
+    if (contents.data() != buffer.data()) {
+      buffer.assign(contents.begin(), contents.end());
+    }
+    return buffer;
+  }
+
+  uint32_t Pack::create(const std::string& directory, const std::string& packPath) {
+
+    // Opened first, so that it is skipped if it is in the directory
+    std::ofstream pack(packPath, std::ios::out | std::ios::binary);
+    if (!pack) {
+      throw std::runtime_error("Could not open file " + packPath + " for writing.");
+    }
+
+    std::filesystem::path root(directory);
+    std::vector<std::filesystem::path> files;
+    for (auto& item : std::filesystem::recursive_directory_iterator(root)) {
+      if (item.is_regular_file() && !std::filesystem::equivalent(item.path(), packPath)) {
+        files.push_back(item.path());
+      }
+    }
+    std::sort(files.begin(), files.end());
+
+    if (files.size() >= EMPTY_BUCKET / 2) {
+      throw std::runtime_error("Too many files to pack in " + directory);
+    }
+
+    PackHeader header;
+    header.numEntries = static_cast<uint32_t>(files.size());
+    header.numBuckets = 1;
+    while (header.numBuckets < header.numEntries * 2) {
+      header.numBuckets *= 2;
+    }
+
+    std::vector<Entry> packEntries(files.size());
+    std::vector<uint32_t> packBuckets(header.numBuckets, EMPTY_BUCKET);
+    std::string packNames;
+
+    for (size_t idx = 0; idx < files.size(); ++idx) {
+      std::string name = files[idx].lexically_relative(root).generic_string();
+      packEntries[idx].hash = hashName(name);
+      packEntries[idx].nameOffset = static_cast<uint32_t>(packNames.size());
+      packEntries[idx].nameLength = static_cast<uint32_t>(name.size());
+      packNames += name;
+
+      uint64_t bucket = packEntries[idx].hash & (header.numBuckets - 1);
+      while (packBuckets[bucket] != EMPTY_BUCKET) {
+        bucket = (bucket + 1) & (header.numBuckets - 1);
+      }
+      packBuckets[bucket] = static_cast<uint32_t>(idx);
+    }
+    header.namesSize = static_cast<uint32_t>(packNames.size());
+
+    uint64_t tablesSize = sizeof(PackHeader) + packEntries.size() * sizeof(Entry) +
+      packBuckets.size() * sizeof(uint32_t) + packNames.size();
+
+    // The contents are written first, after the space left for the
+    // tables, which are only complete after that.
+    const char padding[DATA_ALIGNMENT] = {};
+    std::vector<char> tables(static_cast<size_t>(alignOffset(tablesSize)), 0);
+    pack.write(tables.data(), tables.size());
+    uint64_t offset = tables.size();
+
+    std::vector<char> contents;
+    std::vector<char> compressedContents;
+
+    for (size_t idx = 0; idx < files.size(); ++idx) {
+      std::ifstream file(files[idx], std::ios::in | std::ios::binary);
+      if (!file) {
+        throw std::runtime_error("Could not open file " + files[idx].string());
+      }
+      contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+      // Entries are only compressed if that saves at least an eighth
+      // of their size. Otherwise they are stored, to be read in place.
+      uLongf compressedSize = compressBound(static_cast<uLong>(contents.size()));
+      compressedContents.resize(compressedSize);
+      bool compressed = compress2(reinterpret_cast<Bytef*>(compressedContents.data()), &compressedSize,
+        reinterpret_cast<const Bytef*>(contents.data()), static_cast<uLong>(contents.size()),
+        Z_DEFAULT_COMPRESSION) == Z_OK && compressedSize < contents.size() - contents.size() / 8;
+
+      const std::vector<char>& stored = compressed ? compressedContents : contents;
+      size_t storedSize = compressed ? static_cast<size_t>(compressedSize) : contents.size();
+
+      packEntries[idx].offset = offset;
+      packEntries[idx].storedSize = storedSize;
+      packEntries[idx].size = contents.size();
+      packEntries[idx].compressed = compressed ? 1 : 0;
+
+      pack.write(stored.data(), static_cast<std::streamsize>(storedSize));
+      uint64_t next = alignOffset(offset + storedSize);
+      pack.write(padding, static_cast<std::streamsize>(next - offset - storedSize));
+      offset = next;
+    }
+
+    char* table = tables.data();
+    memcpy(table, &header, sizeof(PackHeader));
+    table += sizeof(PackHeader);
+    if (!packEntries.empty()) {
+      memcpy(table, packEntries.data(), packEntries.size() * sizeof(Entry));
+      table += packEntries.size() * sizeof(Entry);
+    }
+    memcpy(table, packBuckets.data(), packBuckets.size() * sizeof(uint32_t));
+    table += packBuckets.size() * sizeof(uint32_t);
+    memcpy(table, packNames.data(), packNames.size());
+
+    header.checksum = calculateChecksum(tables.data(), static_cast<size_t>(tablesSize));
+    memcpy(tables.data(), &header, sizeof(PackHeader));
+
+    pack.seekp(0);
+    pack.write(tables.data(), static_cast<std::streamsize>(tablesSize));
+    pack.close();
+
+    if (!pack) {
+      throw std::runtime_error("Could not write pack " + packPath);
+    }
+
+    return header.numEntries;
+  }
+}
@@ -0,0 +1,33 @@
+/**
+ *  PackFile.cpp
+ *
+ *  Created on: 2026/10/18
+ *      Author: Dimitri Kourkoulis
+ *     License: BSD 3-Clause License (see LICENSE file)
+ */
+
+#include "PackFile.hpp"
+#include "GlbFile.hpp"
+#include "BinaryFile.hpp"
+
+namespace small3d {
+
+  PackFile::PackFile(const Pack& pack, const std::string& entryName) : File(entryName) {
+    auto contents = pack.getEntry(entryName, buffer);
+
+    if (contents.substr(0, 4) == "glTF") {
+      file = std::make_unique<GlbFile>(entryName, contents.data(), contents.size());
+    }
+    else {
+      file = std::make_unique<BinaryFile>(entryName, contents.data(), contents.size());
+    }
+  }
+
+  void PackFile::load(Model& model, const std::string& meshName) {
+    file->load(model, meshName);
+  }
+
+  std::vector<std::string> PackFile::getMeshNames() {
+    return file->getMeshNames();
+  }
+}
@@ -14,6 +14,7 @@
 
 #include <stdexcept>
 #include <fstream>
+#include <chrono>
 #include "BasePath.hpp"
 
 unsigned const attrib_position = 0;
@@ -21,11 +22,67 @@ unsigned const attrib_normal = 1;
 unsigned const attrib_joint = 2;
 unsigned const attrib_weight = 3;
 unsigned const attrib_uv = 4;
+unsigned const attrib_instance_colour = 5;
+unsigned const attrib_instance_offset = 6;
+unsigned const attrib_instance_rotation = 7; // Occupies locations 7 - 10
+
+// Floats per instance: rotation (16), offset (3, padded to 4), colour (4)
+unsigned const instance_stride = 24;
 
 namespace small3d {
 
   static std::string openglErrorToString(GLenum error);
 
+  // Get the planes enclosing the space visible through the given projection
+  // and camera, in world space, with their normals normalised and facing
+  // inwards. The shader multiplies the position in camera space by the
+  // projection matrix from the left (cameraPos * perspectiveMatrix), so each
+  // clip space coordinate is the dot product of that position with a column
+  // of the projection matrix.
+  static void getFrustumPlanes(const Mat4& projection, const Mat4& camera,
+    const Vec3& cameraPosition, Vec4 planes[6]) {
+
+    Vec4 rows[4];
+
+    for (int row = 0; row < 4; ++row) {
+      const Vec4& column = projection.data[row];
+      float coefficients[4];
+      for (int idx = 0; idx < 4; ++idx) {
+        const Vec4& cameraColumn = camera.data[idx];
+        coefficients[idx] = cameraColumn.x * column.x + cameraColumn.y * column.y +
+          cameraColumn.z * column.z + cameraColumn.w * column.w;
+      }
+      rows[row] = Vec4(coefficients[0], coefficients[1], coefficients[2], coefficients[3]);
+    }
+
+    for (int idx = 0; idx < 6; ++idx) {
+      const Vec4& row = rows[idx / 2];
+      float sign = idx % 2 == 0 ? 1.0f : -1.0f;
+      Vec3 normal(rows[3].x + sign * row.x, rows[3].y + sign * row.y,
+        rows[3].z + sign * row.z);
+      // The camera position is subtracted from world positions before
+      // transforming them
+      float distance = rows[3].w + sign * row.w - dot(normal, cameraPosition);
+      float normalLength = length(normal);
+      if (normalLength > 0.0f) {
+        normal = normal / normalLength;
+        distance /= normalLength;
+      }
+      planes[idx] = Vec4(normal, distance);
+    }
+  }
+
+  static bool isSphereInFrustum(const Vec4 planes[6], const Vec3& centre,
+    const float radius) {
+    for (int idx = 0; idx < 6; ++idx) {
+      if (planes[idx].x * centre.x + planes[idx].y * centre.y +
+        planes[idx].z * centre.z + planes[idx].w < -radius) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   std::string Renderer::loadShaderFromFile(const std::string& fileLocation)
     const {
     std::string shaderSource = "";
@@ -114,6 +171,74 @@ namespace small3d {
     return infoLogStr;
   }
 
+  GLuint Renderer::createProgram(const std::string& vertexShaderFile,
+    const std::string& fragmentShaderFile,
+    UniformLocations& uniformLocations) const {
+
+    GLuint vertexShader = compileShader(vertexShaderFile, GL_VERTEX_SHADER);
+    GLuint fragmentShader = compileShader(fragmentShaderFile,
+      GL_FRAGMENT_SHADER);
+
+    GLuint program = glCreateProgram();
+
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+
+    glLinkProgram(program);
+
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE) {
+      throw std::runtime_error("Failed to link program:\n" +
+        this->getProgramInfoLog(program));
+    }
+    else {
+      LOGDEBUG("Linked program (" + vertexShaderFile + ", " +
+        fragmentShaderFile + ") successfully");
+    }
+    glDetachShader(program, vertexShader);
+    glDetachShader(program, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    uniformLocations.perspectiveMatrix =
+      glGetUniformLocation(program, "perspectiveMatrix");
+    uniformLocations.lightDirection =
+      glGetUniformLocation(program, "lightDirection");
+    uniformLocations.lightIntensity =
+      glGetUniformLocation(program, "lightIntensity");
+    uniformLocations.cameraTransformation =
+      glGetUniformLocation(program, "cameraTransformation");
+    uniformLocations.cameraOffset =
+      glGetUniformLocation(program, "cameraOffset");
+    uniformLocations.lightSpaceMatrix =
+      glGetUniformLocation(program, "lightSpaceMatrix");
+    uniformLocations.orthographicMatrix =
+      glGetUniformLocation(program, "orthographicMatrix");
+    uniformLocations.modelTransformation =
+      glGetUniformLocation(program, "modelTransformation");
+    uniformLocations.jointTransformations =
+      glGetUniformLocation(program, "jointTransformations");
+    uniformLocations.hasJoints =
+      glGetUniformLocation(program, "hasJoints");
+    uniformLocations.modelOffset =
+      glGetUniformLocation(program, "modelOffset");
+    uniformLocations.modelColour =
+      glGetUniformLocation(program, "modelColour");
+    uniformLocations.textureImage =
+      glGetUniformLocation(program, "textureImage");
+    uniformLocations.shadowMap =
+      glGetUniformLocation(program, "shadowMap");
+
+    // The samplers always read from the same texture units
+    glUseProgram(program);
+    glUniform1i(uniformLocations.textureImage, 0);
+    glUniform1i(uniformLocations.shadowMap, 1);
+    glUseProgram(0);
+
+    return program;
+  }
+
   void Renderer::initOpenGL() {
 
     glewExperimental = GL_TRUE;
@@ -163,42 +288,37 @@ namespace small3d {
     }
   }
 
-  void Renderer::transform(Model& model, Vec3& offset,
-    const Mat4& rotation, uint64_t currentPose) const {
-
-    GLint modelTransformationUniformLocation = glGetUniformLocation(shaderProgram,
-      "modelTransformation");
-
-    Mat4 modelTransformation =
-      rotation *
+  Mat4 Renderer::getModelTransformation(Model& model, const Mat4& rotation,
+    uint64_t currentPose, float animationSeconds) const {
+    return rotation *
       scale(Mat4(1.0f), model.scale) *
       translate(Mat4(1.0f), model.origTranslation) *
       model.origRotation.toMatrix() *
       scale(Mat4(1.0f), model.origScale) * model.origTransformation *
-      model.getTransform(model.currentAnimation, currentPose);
+      (animationSeconds < 0.0f ? model.getTransform(model.currentAnimation, currentPose) :
+        model.getTransformAt(model.currentAnimation, animationSeconds));
+  }
 
-    glUniformMatrix4fv(modelTransformationUniformLocation, 1, GL_FALSE,
-      Value_ptr(modelTransformation));
+  void Renderer::transform(Model& model, Vec3& offset,
+    const Mat4& rotation, uint64_t currentPose, float animationSeconds) const {
 
-    int32_t hasJoints = model.joints.size() > 0 ? 1 : 0;
-    GLint hasJointsUniform = glGetUniformLocation(shaderProgram, "hasJoints");
-    glUniform1i(hasJointsUniform, hasJoints);
+    Mat4 modelTransformation = getModelTransformation(model, rotation,
+      currentPose, animationSeconds);
 
-    Mat4 jointTransformations[Model::MAX_JOINTS_SUPPORTED];
+    glUniformMatrix4fv(activeUniforms->modelTransformation, 1, GL_FALSE,
+      Value_ptr(modelTransformation));
 
-    uint64_t idx = 0;
-    for (const auto& joint : model.joints) {
+    int32_t hasJoints = model.joints.size() > 0 ? 1 : 0;
+    glUniform1i(activeUniforms->hasJoints, hasJoints);
 
-      jointTransformations[idx] =
-        model.getJointTransform(idx, model.currentAnimation, currentPose) *
-        joint.inverseBindMatrix;
-      ++idx;
+    if (hasJoints) {
+      const Mat4* jointTransformations = animationSeconds < 0.0f ?
+        model.getJointPalette(model.currentAnimation, currentPose) :
+        model.getJointPaletteAt(model.currentAnimation, animationSeconds);
+      glUniformMatrix4fv(activeUniforms->jointTransformations, Model::MAX_JOINTS_SUPPORTED, GL_FALSE, &jointTransformations[0].data[0].x);
     }
-    auto jointTransformationsUniformLocation = glGetUniformLocation(shaderProgram, "jointTransformations");
-    glUniformMatrix4fv(jointTransformationsUniformLocation, Model::MAX_JOINTS_SUPPORTED, GL_FALSE, Value_ptr(jointTransformations[0]));
 
-    GLint offsetUniform = glGetUniformLocation(shaderProgram, "modelOffset");
-    glUniform3fv(offsetUniform, 1, Value_ptr(offset));
+    glUniform3fv(activeUniforms->modelOffset, 1, Value_ptr(offset));
   }
 
   GLuint Renderer::getTextureHandle(const std::string& name) const {
@@ -210,6 +330,18 @@ namespace small3d {
     return handle;
   }
 
+  uint32_t Renderer::getTextureHandleChecked(const std::string& textureName) const {
+    uint32_t textureHandle = 0;
+    if (textureName != "") {
+      textureHandle = getTextureHandle(textureName);
+      if (textureHandle == 0) {
+        throw std::runtime_error("Texture " + textureName +
+          " has not been generated");
+      }
+    }
+    return textureHandle;
+  }
+
   GLuint Renderer::generateTexture(const std::string& name, const uint8_t* data,
     const unsigned long width,
     const unsigned long height,
@@ -246,6 +378,13 @@ namespace small3d {
 
     textures.insert(make_pair(name, textureHandle));
 
+    for (size_t idx = 3; idx < width * height * 4; idx += 4) {
+      if (data[idx] != 255) {
+        translucentTextures.insert(textureHandle);
+        break;
+      }
+    }
+
     glBindTexture(GL_TEXTURE_2D, 0);
 
     return textureHandle;
@@ -275,39 +414,13 @@ namespace small3d {
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    GLuint vertexShader = compileShader(shadersPath +
+    shaderProgram = createProgram(shadersPath +
       "perspectiveMatrixLightedShader.vert",
-      GL_VERTEX_SHADER);
-    GLuint fragmentShader = compileShader(shadersPath + "textureShader.frag",
-      GL_FRAGMENT_SHADER);
-
-    shaderProgram = glCreateProgram();
+      shadersPath + "textureShader.frag", shaderUniforms);
 
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-
-    glLinkProgram(shaderProgram);
-
-    GLint status;
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-    if (status == GL_FALSE) {
-      throw std::runtime_error("Failed to link program:\n" +
-        this->getProgramInfoLog(shaderProgram));
-    }
-    else {
-      LOGDEBUG("Linked main rendering program successfully");
-    }
-    glDetachShader(shaderProgram, vertexShader);
-    glDetachShader(shaderProgram, fragmentShader);
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-
-    GLint colourTextureLocation = glGetUniformLocation(shaderProgram, "textureImage");
-    GLint depthMapTextureLocation = glGetUniformLocation(shaderProgram, "shadowMap");
-
-    glProgramUniform1i(shaderProgram, colourTextureLocation, 0);
-    glProgramUniform1i(shaderProgram, depthMapTextureLocation, 1);
+    instancedShaderProgram = createProgram(shadersPath +
+      "perspectiveMatrixLightedShaderInstanced.vert",
+      shadersPath + "textureShaderInstanced.frag", instancedShaderUniforms);
 
     glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
@@ -320,6 +433,7 @@ namespace small3d {
     Image blankImage("");
     blankImage.toColour(Vec4(0.0f, 0.0f, 0.0f, 0.0f));
     generateTexture("blank", blankImage);
+    blankTextureHandle = getTextureHandle("blank");
     LOGDEBUG("Blank image generated");
 
 
@@ -349,78 +463,54 @@ namespace small3d {
   }
 
   
-  void Renderer::setWorldDetails(bool perspective) {
-
-    auto orthographicMatrix = ortho(-shadowSpaceSize, shadowSpaceSize, -shadowSpaceSize, shadowSpaceSize, -shadowSpaceSize, shadowSpaceSize);
+  Mat4 Renderer::getProjectionMatrix(bool perspective, bool depthMap) const {
+    return perspective && windowing.realWindowHeight != 0 ?
+      small3d::perspective(fieldOfView, static_cast<float>(windowing.realWindowWidth / windowing.realWindowHeight), zNear, zFar) :
+      depthMap ? ortho(-shadowSpaceSize, shadowSpaceSize, -shadowSpaceSize, shadowSpaceSize, -shadowSpaceSize, shadowSpaceSize) :
+      Mat4(1.0f);
+  }
 
+  void Renderer::setWorldDetails(bool perspective) {
 
-    GLint perspectiveMatrixUniform =
-      glGetUniformLocation(shaderProgram, "perspectiveMatrix");
+    auto orthographicMatrix = getProjectionMatrix(false, true);
 
-    Mat4 perspectiveMatrix = perspective && windowing.realWindowHeight != 0 ?
-      small3d::perspective(fieldOfView, static_cast<float>(windowing.realWindowWidth / windowing.realWindowHeight), zNear, zFar) :
-      renderingDepthMap ? orthographicMatrix : Mat4(1.0f);
+    Mat4 perspectiveMatrix = getProjectionMatrix(perspective, renderingDepthMap);
 
-    glUniformMatrix4fv(perspectiveMatrixUniform, 1, GL_FALSE,
+    glUniformMatrix4fv(activeUniforms->perspectiveMatrix, 1, GL_FALSE,
       Value_ptr(perspectiveMatrix));
 
-    GLint lightDirectionUniform = glGetUniformLocation(shaderProgram,
-      "lightDirection");
     Vec3 lightDirectionOut = perspective ?
       lightDirection : Vec3(0.0f, 0.0f, 0.0f);
-    glUniform3fv(lightDirectionUniform, 1,
+    glUniform3fv(activeUniforms->lightDirection, 1,
       Value_ptr(lightDirectionOut));
 
-    GLint lightIntensityUniform = glGetUniformLocation(shaderProgram,
-      "lightIntensity");
-
-    glUniform1f(lightIntensityUniform, lightIntensity);
-
-    GLint cameraTransformationUniform = glGetUniformLocation(shaderProgram,
-      "cameraTransformation");
+    glUniform1f(activeUniforms->lightIntensity, lightIntensity);
 
     Mat4 usedCameraTransformation = perspective || renderingDepthMap ?
       this->cameraTransformation :
       Mat4(1);
 
-    glUniformMatrix4fv(cameraTransformationUniform, 1, GL_FALSE,
+    glUniformMatrix4fv(activeUniforms->cameraTransformation, 1, GL_FALSE,
       Value_ptr(usedCameraTransformation));
 
-    GLint cameraOffsetUniform = glGetUniformLocation(shaderProgram,
-      "cameraOffset");
-
     Vec3 cameraPositionOut = perspective || renderingDepthMap ?
       cameraPosition : Vec3(0.0f, 0.0f, 0.0f);
-    glUniform3fv(cameraOffsetUniform, 1, Value_ptr(cameraPositionOut));
+    glUniform3fv(activeUniforms->cameraOffset, 1, Value_ptr(cameraPositionOut));
 
-    GLint lightSpaceMatrixUniform = glGetUniformLocation(shaderProgram,
-      "lightSpaceMatrix");
-
-    glUniformMatrix4fv(lightSpaceMatrixUniform, 1, GL_FALSE,
+    glUniformMatrix4fv(activeUniforms->lightSpaceMatrix, 1, GL_FALSE,
       Value_ptr(lightSpaceMatrix));
 
-    GLint orthographicMatrixUniform = glGetUniformLocation(shaderProgram,
-      "orthographicMatrix");
-    glUniformMatrix4fv(orthographicMatrixUniform, 1, GL_FALSE,
+    glUniformMatrix4fv(activeUniforms->orthographicMatrix, 1, GL_FALSE,
       Value_ptr(orthographicMatrix));
 
   }
 
-  void Renderer::bindTexture(const std::string& name) {
-    GLuint textureHandle = getTextureHandle(name);
-
-    if (textureHandle == 0) {
-      throw std::runtime_error("Texture " + name +
-        " has not been generated");
+  void Renderer::bindTexture(const uint32_t textureHandle) {
+    if (drawState.textureHandle != textureHandle) {
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D, textureHandle);
+      drawState.textureHandle = textureHandle;
     }
-
-    glActiveTexture(GL_TEXTURE0);
-
-    glBindTexture(GL_TEXTURE_2D, textureHandle);
-    GLint loc = glGetUniformLocation(shaderProgram, "textureImage");
-
-    glUniform1i(loc, 0);
-
   }
 
   void Renderer::clearScreen() const {
@@ -458,6 +548,7 @@ namespace small3d {
     const uint32_t objectsPerFrameInc) {
 
     shaderProgram = 0;
+    instancedShaderProgram = 0;
 
     noShaders = false;
 
@@ -465,6 +556,9 @@ namespace small3d {
     this->zFar = zFar;
     this->fieldOfView = fieldOfView;
 
+    renderList.resize(objectsPerFrame);
+    this->objectsPerFrameInc = std::max(objectsPerFrameInc, 1U);
+
     init(width, height, windowTitle, shadersPath);
 
     FT_Error ftError = FT_Init_FreeType(&library);
@@ -478,6 +572,8 @@ namespace small3d {
     glGenVertexArrays(1, &vao);
     glBindVertexArray(vao);
 
+    glGenBuffers(1, &instanceBufferObjectId);
+
     LOGDEBUG("start done");
 
   }
@@ -570,12 +666,18 @@ namespace small3d {
 
     glDeleteTextures(0, &depthMapTexture);
 
+    {
+      std::lock_guard<std::mutex> lock(uploadMutex);
+      uploadQueue.clear();
+    }
+
     for (auto it = textures.begin();
       it != textures.end(); ++it) {
       LOGDEBUG("Deleting texture " + it->first);
       glDeleteTextures(1, &it->second);
     }
     textures.clear();
+    translucentTextures.clear();
 
     if (!noShaders) {
       glUseProgram(0);
@@ -585,20 +687,33 @@ namespace small3d {
 
     }
 
+    if (instanceBufferObjectId != 0) {
+      glDeleteBuffers(1, &instanceBufferObjectId);
+      instanceBufferObjectId = 0;
+    }
+
     if (shaderProgram != 0) {
       glDeleteProgram(shaderProgram);
     }
 
+    if (instancedShaderProgram != 0) {
+      glDeleteProgram(instancedShaderProgram);
+    }
+
+    // Uniform locations are only valid for the programs they were found in
+    shaderUniforms = UniformLocations();
+    instancedShaderUniforms = UniformLocations();
+
   }
 
-  void Renderer::generateTexture(const std::string& name, const Image& image) {
+  uint32_t Renderer::generateTexture(const std::string& name, const Image& image) {
     LOGDEBUG("Sending image to GPU, dimensions " + std::to_string(image.getWidth()) +
       ", " + std::to_string(image.getHeight()));
-    this->generateTexture(name, image.getData(), image.getWidth(),
+    return this->generateTexture(name, image.getData(), image.getWidth(),
       image.getHeight(), true);
   }
 
-  void Renderer::generateTexture(const std::string& name, const std::string& text,
+  uint32_t Renderer::generateTexture(const std::string& name, const std::string& text,
     const Vec3& colour, const int fontSize,
     const std::string& fontPath,
     const bool replace) {
@@ -691,7 +806,7 @@ namespace small3d {
       }
       totalAdvance += 4 * static_cast<unsigned long>(slot->advance.x / 64);
     }
-    generateTexture(name, &textMemory[0], static_cast<unsigned long>(width), static_cast<unsigned long>(height), replace);
+    return generateTexture(name, &textMemory[0], static_cast<unsigned long>(width), static_cast<unsigned long>(height), replace);
   }
 
   void Renderer::deleteTexture(const std::string& name) {
@@ -700,6 +815,7 @@ namespace small3d {
     if (nameTexturePair != textures.end()) {
       glBindTexture(GL_TEXTURE_2D, 0);
       glDeleteTextures(1, &(nameTexturePair->second));
+      translucentTextures.erase(nameTexturePair->second);
       textures.erase(name);
     }
   }
@@ -734,6 +850,9 @@ namespace small3d {
         0.0f, 1.0f
     };
     rect.textureCoordsDataByteSize = 8 * sizeof(float);
+
+    // In case the model has been rendered before, with other data
+    rect.markDataChanged();
   }
 
   void Renderer::render(Model& model, const Vec3& position, const Vec3& rotation,
@@ -757,192 +876,521 @@ namespace small3d {
 
   }
 
-  void Renderer::renderTuple(std::tuple< Model*, Vec3, Mat4, Vec4, std::string, bool, uint64_t> tuple) {
+  void Renderer::sendToGPU(Model& model) {
 
-    Model* model = std::get<0>(tuple);
-    Vec3 offset = std::get<1>(tuple);
-    Mat4 rotation = std::get<2>(tuple);
-    Vec4 colour = std::get<3>(tuple);
-    std::string textureName = std::get<4>(tuple);
-    bool perspective = std::get<5>(tuple);
-    uint64_t currentPose = std::get<6>(tuple);
-
-    if (!perspective && !renderingDepthMap) {
-      glClear(GL_DEPTH_BUFFER_BIT);
+    if (model.vertexArrayObjectId == 0) {
+      glGenVertexArrays(1, &model.vertexArrayObjectId);
+      glGenBuffers(1, &model.indexBufferObjectId);
+      glGenBuffers(1, &model.positionBufferObjectId);
+      glGenBuffers(1, &model.normalsBufferObjectId);
+      glGenBuffers(1, &model.uvBufferObjectId);
+      glGenBuffers(1, &model.jointBufferObjectId);
+      glGenBuffers(1, &model.weightBufferObjectId);
     }
 
-    glUseProgram(shaderProgram);
+    // The attribute setup and the index buffer binding below are recorded
+    // in the model's VAO, so that drawing only requires binding it.
+    glBindVertexArray(model.vertexArrayObjectId);
 
-    GLint bufSize = 0;
-    glBindBuffer(GL_ARRAY_BUFFER, model->positionBufferObjectId);
-    glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &bufSize);
-    // Flush invalid operation error (this is normal when the model has not
-    // been loaded into the GPU).
-    while (glGetError() == GL_INVALID_OPERATION);
+    // Vertex indices
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model.indexBufferObjectId);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+      model.indexDataByteSize,
+      model.indexData32.empty() ?
+      static_cast<const void*>(model.indexData.data()) :
+      static_cast<const void*>(model.indexData32.data()),
+      GL_STATIC_DRAW);
+
+    if (!model.packedVertexData.empty()) {
+      // All attributes, interleaved in a single buffer
+      GLsizei stride = static_cast<GLsizei>(model.packedVertexStride);
+
+      glBindBuffer(GL_ARRAY_BUFFER, model.positionBufferObjectId);
+      glBufferData(GL_ARRAY_BUFFER,
+        model.packedVertexData.size(),
+        model.packedVertexData.data(),
+        GL_STATIC_DRAW);
 
-    bool alreadyInGPU = bufSize > 0;
+      // The position w component is set to 1 by the GPU
+      glEnableVertexAttribArray(attrib_position);
+      glVertexAttribPointer(attrib_position, 3, GL_FLOAT, GL_FALSE, stride, 0);
 
-    if (!alreadyInGPU) {
-      glGenBuffers(1, &model->indexBufferObjectId);
-      glGenBuffers(1, &model->positionBufferObjectId);
-      glGenBuffers(1, &model->normalsBufferObjectId);
-      glGenBuffers(1, &model->uvBufferObjectId);
-      glGenBuffers(1, &model->jointBufferObjectId);
-      glGenBuffers(1, &model->weightBufferObjectId);
-    }
+      glEnableVertexAttribArray(attrib_normal);
+      glVertexAttribPointer(attrib_normal, 3, GL_SHORT, GL_TRUE, stride,
+        (void*)(3 * sizeof(float)));
 
-    // Vertices
-    glBindBuffer(GL_ARRAY_BUFFER, model->positionBufferObjectId);
-    if (!alreadyInGPU) {
-      glBufferData(GL_ARRAY_BUFFER,
-        model->vertexDataByteSize,
-        model->vertexData.data(),
-        GL_STATIC_DRAW);
-    }
+      if (model.packedUVOffset != 0) {
+        glEnableVertexAttribArray(attrib_uv);
+        glVertexAttribPointer(attrib_uv, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+          (void*)static_cast<size_t>(model.packedUVOffset));
+      }
+      else {
+        glDisableVertexAttribArray(attrib_uv);
+      }
 
-    // Vertex indices
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model->indexBufferObjectId);
-    if (!alreadyInGPU) {
-      glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-        model->indexDataByteSize,
-        model->indexData.data(),
-        GL_STATIC_DRAW);
-    }
+      if (model.packedJointOffset != 0) {
+        glEnableVertexAttribArray(attrib_joint);
+        glVertexAttribIPointer(attrib_joint, 4, GL_UNSIGNED_BYTE, stride,
+          (void*)static_cast<size_t>(model.packedJointOffset));
 
-    glEnableVertexAttribArray(attrib_position);
-    glVertexAttribPointer(attrib_position, 4, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(attrib_weight);
+        glVertexAttribPointer(attrib_weight, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+          (void*)static_cast<size_t>(model.packedWeightOffset));
+      }
+      else {
+        glDisableVertexAttribArray(attrib_joint);
+        glDisableVertexAttribArray(attrib_weight);
+      }
+    }
+    else {
+      // Vertices
+      glBindBuffer(GL_ARRAY_BUFFER, model.positionBufferObjectId);
+      glBufferData(GL_ARRAY_BUFFER,
+        model.vertexDataByteSize,
+        model.vertexData.data(),
+        GL_STATIC_DRAW);
 
-    // Normals
+      glEnableVertexAttribArray(attrib_position);
+      glVertexAttribPointer(attrib_position, 4, GL_FLOAT, GL_FALSE, 0, 0);
 
-    glBindBuffer(GL_ARRAY_BUFFER, model->normalsBufferObjectId);
+      // Normals
+      glBindBuffer(GL_ARRAY_BUFFER, model.normalsBufferObjectId);
 
-    if (!alreadyInGPU) {
-      if (model->normalsDataByteSize > 0) {
+      if (model.normalsDataByteSize > 0) {
         glBufferData(GL_ARRAY_BUFFER,
-          model->normalsDataByteSize,
-          model->normalsData.data(),
+          model.normalsDataByteSize,
+          model.normalsData.data(),
           GL_STATIC_DRAW);
       }
       else {
         // The normals buffer is created with 0 values if the corresponding
         // data does not exist, when MacOS was supported this helped avoid
         // EXC_BAD_ACCESS errors.
-        size_t ns = (model->vertexDataByteSize / 4) * 3;
+        size_t ns = (model.vertexDataByteSize / 4) * 3;
         std::unique_ptr<char[]> data = std::make_unique<char[]>(ns);
         glBufferData(GL_ARRAY_BUFFER,
           ns,
           &data[0],
           GL_STATIC_DRAW);
       }
-    }
 
-    glEnableVertexAttribArray(attrib_normal);
-    glVertexAttribPointer(attrib_normal, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+      glEnableVertexAttribArray(attrib_normal);
+      glVertexAttribPointer(attrib_normal, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
-    if (model->jointDataByteSize != 0) {
-      glBindBuffer(GL_ARRAY_BUFFER, model->jointBufferObjectId);
-      if (!alreadyInGPU) {
+      if (model.jointDataByteSize != 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, model.jointBufferObjectId);
         glBufferData(GL_ARRAY_BUFFER,
-          model->jointDataByteSize,
-          model->jointData.data(),
+          model.jointDataByteSize,
+          model.jointData.data(),
           GL_STATIC_DRAW);
+
+        glEnableVertexAttribArray(attrib_joint);
+        glVertexAttribIPointer(attrib_joint, 4, GL_UNSIGNED_BYTE, 0, 0);
+      }
+      else {
+        glDisableVertexAttribArray(attrib_joint);
       }
 
-      glEnableVertexAttribArray(attrib_joint);
-      glVertexAttribIPointer(attrib_joint, 4, GL_UNSIGNED_BYTE, 0, 0);
+      if (model.weightDataByteSize != 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, model.weightBufferObjectId);
+        glBufferData(GL_ARRAY_BUFFER,
+          model.weightDataByteSize,
+          model.weightData.data(),
+          GL_STATIC_DRAW);
 
-    }
+        glEnableVertexAttribArray(attrib_weight);
+        glVertexAttribPointer(attrib_weight, 4, GL_FLOAT, GL_FALSE, 0, 0);
+      }
+      else {
+        glDisableVertexAttribArray(attrib_weight);
+      }
 
-    if (model->weightDataByteSize != 0) {
-      glBindBuffer(GL_ARRAY_BUFFER, model->weightBufferObjectId);
-      if (!alreadyInGPU) {
+      // UV Coordinates (only used if the model is rendered with a texture)
+      if (model.textureCoordsDataByteSize != 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, model.uvBufferObjectId);
         glBufferData(GL_ARRAY_BUFFER,
-          model->weightDataByteSize,
-          model->weightData.data(),
+          model.textureCoordsDataByteSize,
+          model.textureCoordsData.data(),
           GL_STATIC_DRAW);
+
+        glEnableVertexAttribArray(attrib_uv);
+        glVertexAttribPointer(attrib_uv, 2, GL_FLOAT, GL_FALSE, 0, 0);
+      }
+      else {
+        glDisableVertexAttribArray(attrib_uv);
       }
+    }
 
-      glEnableVertexAttribArray(attrib_weight);
-      glVertexAttribPointer(attrib_weight, 4, GL_FLOAT, GL_FALSE, 0, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(vao);
+
+    model.gpuGeneration = model.dataGeneration;
+  }
 
+  void Renderer::renderRecord(const RenderRecord& record, const uint32_t instanceCount) {
+
+    Model* model = record.model;
+
+    if (!record.perspective && !renderingDepthMap) {
+      glClear(GL_DEPTH_BUFFER_BIT);
     }
 
-    // Find the colour uniform
-    GLint colourUniform = glGetUniformLocation(shaderProgram, "modelColour");
+    const UniformLocations* uniforms = instanceCount > 0 ?
+      &instancedShaderUniforms : &shaderUniforms;
 
-    if (textureName != "") {
+    if (drawState.uniforms != uniforms) {
+      glUseProgram(instanceCount > 0 ? instancedShaderProgram : shaderProgram);
+      activeUniforms = uniforms;
+      drawState.uniforms = uniforms;
+      drawState.worldDetailsSet = false;
+    }
+
+    if (!model->isInGPU()) {
+      sendToGPU(*model);
+      drawState.vao = 0;
+    }
+
+    if (drawState.vao != model->vertexArrayObjectId) {
+      glBindVertexArray(model->vertexArrayObjectId);
+      drawState.vao = model->vertexArrayObjectId;
+    }
+
+    // The colour uniform is not found in the instanced program, which
+    // receives colours per instance.
+    if (record.textureHandle != 0) {
 
       // "Disable" colour since there is a texture
-       Vec4 col0; // (initialised with all 0s by default)
-      glUniform4fv(colourUniform, 1,
+      Vec4 col0; // (initialised with all 0s by default)
+      glUniform4fv(activeUniforms->modelColour, 1,
         Value_ptr(col0));
 
-      bindTexture(textureName);
+      bindTexture(record.textureHandle);
+    }
+    else {
+      // If there is no texture, use the given colour
+      Vec4 colour = record.colour;
+      glUniform4fv(activeUniforms->modelColour, 1, Value_ptr(colour));
+      bindTexture(blankTextureHandle);
+    }
+
+    if (!drawState.worldDetailsSet || drawState.perspective != record.perspective) {
+      setWorldDetails(record.perspective);
+      drawState.worldDetailsSet = true;
+      drawState.perspective = record.perspective;
+    }
 
-      // UV Coordinates
+    GLenum indexType = model->indexData32.empty() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
 
-      glBindBuffer(GL_ARRAY_BUFFER, model->uvBufferObjectId);
+    if (instanceCount > 0) {
+      // Offsets, rotations and colours come from the instance buffer
+      Vec3 noOffset(0.0f);
+      transform(*model, noOffset, Mat4(1.0f), record.currentPose, record.animationSeconds);
 
-      if (!alreadyInGPU) {
-        glBufferData(GL_ARRAY_BUFFER,
-          model->textureCoordsDataByteSize,
-          model->textureCoordsData.data(),
-          GL_STATIC_DRAW);
+      glBindBuffer(GL_ARRAY_BUFFER, instanceBufferObjectId);
+      glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(float),
+        instanceData.data(), GL_STREAM_DRAW);
+
+      GLsizei stride = instance_stride * sizeof(float);
+
+      for (unsigned column = 0; column < 4; ++column) {
+        glEnableVertexAttribArray(attrib_instance_rotation + column);
+        glVertexAttribPointer(attrib_instance_rotation + column, 4, GL_FLOAT,
+          GL_FALSE, stride, (void*)(4 * column * sizeof(float)));
+        glVertexAttribDivisor(attrib_instance_rotation + column, 1);
       }
 
-      glEnableVertexAttribArray(attrib_uv);
-      glVertexAttribPointer(attrib_uv, 2, GL_FLOAT, GL_FALSE, 0, 0);
+      glEnableVertexAttribArray(attrib_instance_offset);
+      glVertexAttribPointer(attrib_instance_offset, 3, GL_FLOAT, GL_FALSE,
+        stride, (void*)(16 * sizeof(float)));
+      glVertexAttribDivisor(attrib_instance_offset, 1);
+
+      glEnableVertexAttribArray(attrib_instance_colour);
+      glVertexAttribPointer(attrib_instance_colour, 4, GL_FLOAT, GL_FALSE,
+        stride, (void*)(20 * sizeof(float)));
+      glVertexAttribDivisor(attrib_instance_colour, 1);
+
+      // Draw
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+      glDrawElementsInstanced(GL_TRIANGLES,
+        static_cast<GLsizei>(model->getNumIndices()),
+        indexType, 0, static_cast<GLsizei>(instanceCount));
+
+      for (unsigned column = 0; column < 4; ++column) {
+        glDisableVertexAttribArray(attrib_instance_rotation + column);
+      }
+      glDisableVertexAttribArray(attrib_instance_offset);
+      glDisableVertexAttribArray(attrib_instance_colour);
     }
     else {
-      // If there is no texture, use the given colour
-      glUniform4fv(colourUniform, 1, Value_ptr(colour));
-      bindTexture("blank");
+      Vec3 offset = record.offset;
+      transform(*model, offset, record.rotation, record.currentPose, record.animationSeconds);
+
+      // Draw
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+      glDrawElements(GL_TRIANGLES,
+        static_cast<GLsizei>(model->getNumIndices()),
+        indexType, 0);
     }
+  }
 
+  void Renderer::cullRenderList() {
 
-    glActiveTexture(GL_TEXTURE0 + 1);
+    renderStatistics = RenderStatistics();
+
+    Vec4 viewPlanes[6];
+    Vec4 shadowPlanes[6];
+
+    if (culling) {
+      getFrustumPlanes(getProjectionMatrix(true, false), cameraTransformation,
+        cameraPosition, viewPlanes);
+      // The shadow map is rendered from the shadow camera, placed at 0
+      getFrustumPlanes(getProjectionMatrix(false, true), shadowCamTransformation,
+        Vec3(0.0f, 0.0f, 0.0f), shadowPlanes);
+    }
+
+    for (size_t idx = 0; idx < renderListSize; ++idx) {
+      RenderRecord& record = renderList[idx];
 
-    if (!renderingDepthMap) {
+      // Only models rendered in perspective produce shadows
+      record.inView = true;
+      record.inShadowView = shadowsActive && record.perspective &&
+        !record.model->noShadow;
 
-      glBindTexture(GL_TEXTURE_2D, depthMapTexture);
+      if (culling && record.perspective && record.model->joints.empty()) {
+        Mat4 modelTransformation = getModelTransformation(*record.model,
+          record.rotation, record.currentPose, record.animationSeconds);
 
+        Vec3 centre = (record.model->getBoundsMin() + record.model->getBoundsMax()) / 2.0f;
+        Vec4 transformedCentre = modelTransformation * Vec4(centre, 1.0f);
+        Vec3 worldCentre = Vec3(transformedCentre.x, transformedCentre.y,
+          transformedCentre.z) + record.offset;
+
+        float maxScale = 0.0f;
+        for (int column = 0; column < 3; ++column) {
+          const Vec4& axis = modelTransformation.data[column];
+          maxScale = std::max(maxScale, length(Vec3(axis.x, axis.y, axis.z)));
+        }
+        float worldRadius = record.model->getBoundingRadius() * maxScale;
+
+        record.inView = isSphereInFrustum(viewPlanes, worldCentre, worldRadius);
+
+        if (record.inShadowView && !isSphereInFrustum(shadowPlanes, worldCentre, worldRadius)) {
+          record.inShadowView = false;
+          ++renderStatistics.shadowCulled;
+        }
+      }
+
+      if (!record.inView) {
+        ++renderStatistics.culled;
+      }
     }
-    else {
-      glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  const Renderer::RenderStatistics& Renderer::getRenderStatistics() const {
+    return renderStatistics;
+  }
+
+  void Renderer::sortRenderList() {
+
+    size_t numRecords = renderListSize;
+
+    renderKeys.resize(numRecords);
+    renderOrder.resize(numRecords);
+    renderKeysTmp.resize(numRecords);
+    renderOrderTmp.resize(numRecords);
+
+    // Key layout, from the most significant bit:
+    // orthographic (1 bit), blended (1 bit), texture (15 bits),
+    // model (16 bits), animation pose (8 bits), distance from the camera
+    // (23 bits).
+    // Orthographic entries (usually interface elements drawn over each
+    // other) only carry their submission order after the first bit, so
+    // that they are drawn last and in the order they were submitted.
+    // Blended perspective entries do the same after the second bit, so
+    // that they are drawn over the opaque ones, in the order they were
+    // submitted.
+    for (size_t idx = 0; idx < numRecords; ++idx) {
+      const RenderRecord& record = renderList[idx];
+      uint64_t key = 0;
+
+      if (!record.perspective) {
+        key = (1ULL << 63) | idx;
+      }
+      else if (record.blended) {
+        key = (1ULL << 62) | idx;
+      }
+      else {
+        uint64_t modelBits = (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(record.model) >> 4) *
+          0x9E3779B97F4A7C15ULL) >> 48;
+
+        uint32_t secondsBits = 0;
+        memcpy(&secondsBits, &record.animationSeconds, sizeof(float));
+        uint64_t poseBits = (record.currentPose ^ secondsBits ^ (secondsBits >> 8) ^
+          (secondsBits >> 16)) & 0xFF;
+
+        Vec4 inCamera = cameraTransformation * Vec4(record.offset - cameraPosition, 1.0f);
+        float depth = zFar > 0.0f ? -inCamera.z / zFar : 0.0f;
+        depth = std::max(0.0f, std::min(1.0f, depth));
+        uint64_t depthBits = static_cast<uint64_t>(depth * 0x7FFFFF);
+
+        key = (static_cast<uint64_t>(record.textureHandle & 0x7FFF) << 47) |
+          (modelBits << 31) | (poseBits << 23) | depthBits;
+      }
+
+      renderKeys[idx] = key;
+      renderOrder[idx] = static_cast<uint32_t>(idx);
+    }
+
+    // LSD radix sort, 8 bits at a time (stable, so entries with equal keys
+    // keep their submission order)
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+      size_t counts[256] = { 0 };
+      for (size_t idx = 0; idx < numRecords; ++idx) {
+        ++counts[(renderKeys[idx] >> shift) & 0xFF];
+      }
+
+      // Skip the digits that are the same for all keys
+      if (numRecords == 0 || counts[(renderKeys[0] >> shift) & 0xFF] == numRecords) {
+        continue;
+      }
+
+      size_t position = 0;
+      for (auto& count : counts) {
+        size_t c = count;
+        count = position;
+        position += c;
+      }
+
+      for (size_t idx = 0; idx < numRecords; ++idx) {
+        size_t dest = counts[(renderKeys[idx] >> shift) & 0xFF]++;
+        renderKeysTmp[dest] = renderKeys[idx];
+        renderOrderTmp[dest] = renderOrder[idx];
+      }
+
+      renderKeys.swap(renderKeysTmp);
+      renderOrder.swap(renderOrderTmp);
     }
+  }
 
-    setWorldDetails(perspective);
+  void Renderer::drawRenderList() {
 
-    transform(*model, offset, rotation, currentPose);
+    drawState = DrawState();
 
+    glActiveTexture(GL_TEXTURE0 + 1);
+    glBindTexture(GL_TEXTURE_2D, renderingDepthMap ? 0 : depthMapTexture);
 
+    auto isVisible = [this](const RenderRecord& record) {
+      return renderingDepthMap ? record.inShadowView : record.inView;
+    };
 
-    // Draw
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glDrawElements(GL_TRIANGLES,
-      static_cast<GLsizei>(model->indexData.size()),
-      GL_UNSIGNED_SHORT, 0);
+    size_t idx = 0;
 
-    glDisableVertexAttribArray(attrib_position);
-    glDisableVertexAttribArray(attrib_normal);
-    if (model->jointDataByteSize != 0) glDisableVertexAttribArray(attrib_joint);
-    if (model->weightDataByteSize != 0) glDisableVertexAttribArray(attrib_weight);
-    if (textureName != "") glDisableVertexAttribArray(attrib_uv);
+    while (idx < renderOrder.size()) {
+      const RenderRecord& record = renderList[renderOrder[idx]];
+
+      if (!isVisible(record)) {
+        ++idx;
+        continue;
+      }
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+      // Opaque perspective render calls for the same model, texture and
+      // animation pose end up next to each other after sorting and are
+      // drawn together, with a single instanced draw call. Culled ones
+      // among them are left out.
+      size_t batchEnd = idx + 1;
+      uint32_t batchSize = 1;
+      if (instancing && record.perspective && !record.blended) {
+        while (batchEnd < renderOrder.size()) {
+          const RenderRecord& next = renderList[renderOrder[batchEnd]];
+          if (!next.perspective || next.blended || next.model != record.model ||
+            next.textureHandle != record.textureHandle ||
+            next.currentPose != record.currentPose ||
+            next.animationSeconds != record.animationSeconds) {
+            break;
+          }
+          if (isVisible(next)) {
+            ++batchSize;
+          }
+          ++batchEnd;
+        }
+      }
 
+      if (renderingDepthMap) {
+        renderStatistics.shadowDrawn += batchSize;
+      }
+      else {
+        renderStatistics.drawn += batchSize;
+      }
+
+      RenderRecord toDraw = record;
+      if (renderingDepthMap) {
+        toDraw.perspective = false;
+      }
+
+      if (batchSize < 2) {
+        renderRecord(toDraw);
+      }
+      else {
+        instanceData.resize(batchSize * instance_stride);
+        float* instance = instanceData.data();
+
+        for (size_t batchIdx = idx; batchIdx < batchEnd; ++batchIdx) {
+          RenderRecord& instanceRecord = renderList[renderOrder[batchIdx]];
+          if (!isVisible(instanceRecord)) {
+            continue;
+          }
+          memcpy(instance, Value_ptr(instanceRecord.rotation), 16 * sizeof(float));
+          memcpy(instance + 16, Value_ptr(instanceRecord.offset), 3 * sizeof(float));
+          instance[19] = 0.0f;
+          // As with single draws, the colour is "disabled" if there is a texture
+          Vec4 colour = instanceRecord.textureHandle != 0 ?
+            Vec4(0.0f, 0.0f, 0.0f, 0.0f) : instanceRecord.colour;
+          memcpy(instance + 20, Value_ptr(colour), 4 * sizeof(float));
+          instance += instance_stride;
+        }
+
+        renderRecord(toDraw, batchSize);
+      }
+
+      idx = batchEnd;
+    }
+
+    glBindVertexArray(vao);
     glUseProgram(0);
   }
 
+  void Renderer::addRenderRecord(Model& model, const Vec3& position,
+    const Mat4& rotation, const Vec4& colour, const uint32_t textureHandle,
+    const uint64_t currentPose, const bool perspective,
+    const float animationSeconds) {
+
+    if (renderListSize == renderList.size()) {
+      renderList.resize(renderList.size() + objectsPerFrameInc);
+    }
+
+    RenderRecord& record = renderList[renderListSize];
+    record.model = &model;
+    record.offset = position;
+    record.rotation = rotation;
+    record.colour = colour;
+    record.textureHandle = textureHandle;
+    record.perspective = perspective;
+    record.currentPose = currentPose;
+    record.animationSeconds = animationSeconds;
+    record.blended = textureHandle != 0 ? translucentTextures.count(textureHandle) != 0 :
+      colour.w < 1.0f;
+
+    ++renderListSize;
+  }
+
   void Renderer::render(Model& model, const Vec3& position,
     const Mat4& rotation,
     const Vec4& colour,
     const std::string& textureName,
     const uint64_t currentPose,
     const bool perspective) {
-
-    renderList.push_back(std::tuple<Model*, Vec3, Mat4, Vec4, std::string, bool, uint64_t>{&model, position, rotation, colour, textureName, perspective, currentPose});
-
+    addRenderRecord(model, position, rotation, colour,
+      getTextureHandleChecked(textureName), currentPose, perspective);
   }
 
   void Renderer::render(Model& model, const Vec3& position,
@@ -953,6 +1401,18 @@ namespace small3d {
       textureName, currentPose);
   }
 
+  void Renderer::render(Model& model, const Vec3& position,
+    const Mat4& rotation,
+    const uint32_t textureHandle,
+    const uint64_t currentPose,
+    const bool perspective) {
+    if (textureHandle == 0) {
+      throw std::runtime_error("Cannot render with texture handle 0.");
+    }
+    addRenderRecord(model, position, rotation, Vec4(0.0f, 0.0f, 0.0f, 0.0f),
+      textureHandle, currentPose, perspective);
+  }
+
   void Renderer::render(Model& model, const std::string& textureName, const uint64_t currentPose,
     const bool perspective) {
     this->render(model, Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 0.0f, 0.0f), Vec4(0.0f, 0.0f, 0.0f, 0.0f),
@@ -967,15 +1427,28 @@ namespace small3d {
 
   void Renderer::render(SceneObject& sceneObject,
     const Vec4& colour) {
-    this->render(sceneObject.getModel(), sceneObject.position,
-      sceneObject.transformation, colour, "", sceneObject.getCurrentPose());
+    addRenderRecord(sceneObject.getModel(), sceneObject.position,
+      sceneObject.transformation, colour, 0, sceneObject.getCurrentPose(), true,
+      sceneObject.timeBasedAnimation ? sceneObject.animationTime : -1.0f);
   }
 
   void Renderer::render(SceneObject& sceneObject,
     const std::string& textureName) {
-    this->render(sceneObject.getModel(), sceneObject.position,
+    addRenderRecord(sceneObject.getModel(), sceneObject.position,
       sceneObject.transformation, Vec4(0.0f, 0.0f, 0.0f, 0.0f),
-      textureName, sceneObject.getCurrentPose());
+      getTextureHandleChecked(textureName), sceneObject.getCurrentPose(), true,
+      sceneObject.timeBasedAnimation ? sceneObject.animationTime : -1.0f);
+  }
+
+  void Renderer::render(SceneObject& sceneObject,
+    const uint32_t textureHandle) {
+    if (textureHandle == 0) {
+      throw std::runtime_error("Cannot render with texture handle 0.");
+    }
+    addRenderRecord(sceneObject.getModel(), sceneObject.position,
+      sceneObject.transformation, Vec4(0.0f, 0.0f, 0.0f, 0.0f), textureHandle,
+      sceneObject.getCurrentPose(), true,
+      sceneObject.timeBasedAnimation ? sceneObject.animationTime : -1.0f);
   }
 
   void Renderer::clearBuffers(Model& model) const {
@@ -997,6 +1470,23 @@ namespace small3d {
       glDeleteBuffers(1, &model.uvBufferObjectId);
       model.uvBufferObjectId = 0;
     }
+
+    if (model.jointBufferObjectId != 0) {
+      glDeleteBuffers(1, &model.jointBufferObjectId);
+      model.jointBufferObjectId = 0;
+    }
+
+    if (model.weightBufferObjectId != 0) {
+      glDeleteBuffers(1, &model.weightBufferObjectId);
+      model.weightBufferObjectId = 0;
+    }
+
+    if (model.vertexArrayObjectId != 0) {
+      glDeleteVertexArrays(1, &model.vertexArrayObjectId);
+      model.vertexArrayObjectId = 0;
+    }
+
+    model.gpuGeneration = 0;
   }
 
   void Renderer::clearBuffers(SceneObject& sceneObject) const {
@@ -1011,10 +1501,61 @@ namespace small3d {
 
   }
 
+  void Renderer::queueUpload(const std::shared_ptr<Model>& model) {
+    std::lock_guard<std::mutex> lock(uploadMutex);
+    uploadQueue.push_back({ model, "", nullptr });
+  }
+
+  void Renderer::queueUpload(const std::string& textureName, const std::shared_ptr<Image>& image) {
+    std::lock_guard<std::mutex> lock(uploadMutex);
+    uploadQueue.push_back({ nullptr, textureName, image });
+  }
+
+  size_t Renderer::getNumQueuedUploads() const {
+    std::lock_guard<std::mutex> lock(uploadMutex);
+    return uploadQueue.size();
+  }
+
+  void Renderer::processUploads() {
+    auto startTime = std::chrono::steady_clock::now();
+
+    while (true) {
+      Upload upload;
+      {
+        std::lock_guard<std::mutex> lock(uploadMutex);
+        if (uploadQueue.empty()) break;
+        upload = std::move(uploadQueue.front());
+        uploadQueue.pop_front();
+      }
+
+      if (upload.model) {
+        // If the queue holds the only reference to the model, it has been
+        // discarded, and nothing would clear its buffers if it were sent.
+        if (upload.model.use_count() > 1 && !upload.model->isInGPU()) {
+          sendToGPU(*upload.model);
+        }
+      }
+      else if (upload.image) {
+        generateTexture(upload.textureName, *upload.image);
+      }
+
+      if (std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() >=
+        uploadTimeBudget) break;
+    }
+  }
+
   void Renderer::swapBuffers() {
 
+    // Queued models and images are sent to the GPU before drawing, so that
+    // the ones that are rendered in this frame do not need to be sent while
+    // drawing.
+    processUploads();
+
     lightSpaceMatrix = Mat4(0);
 
+    cullRenderList();
+    sortRenderList();
+
     if (shadowsActive) {
       glViewport(0, 0, depthMapTextureWidth, depthMapTextureHeight);
       glBindFramebuffer(GL_FRAMEBUFFER, depthMapFramebuffer);
@@ -1035,16 +1576,7 @@ namespace small3d {
       renderingDepthMap = true;
       //glCullFace(GL_FRONT); // Avoid peter panning (but creates worse quality shadows)
 
-      for (auto& tuple : renderList) {
-        if (std::get<5>(tuple)) {
-          auto tmpt = tuple;
-          if (std::get<0>(tuple)->noShadow) {
-            continue;
-          }
-          std::get<5>(tmpt) = false;
-          renderTuple(tmpt);
-        }
-      }
+      drawRenderList();
       renderingDepthMap = false;
       glCullFace(GL_BACK); // Back to normal culling (after avoiding peter panning)
 
@@ -1061,10 +1593,8 @@ namespace small3d {
 		 static_cast<GLsizei>(windowing.realWindowHeight));
     }
 
-    for (const auto& tuple : renderList) {
-      renderTuple(tuple);
-    }
-    renderList.clear();
+    drawRenderList();
+    renderListSize = 0;
 
 #ifdef _WIN32
     if (screenCapture) {
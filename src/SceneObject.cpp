@@ -8,6 +8,7 @@
 
 #include "SceneObject.hpp"
 #include <exception>
+#include <cmath>
 
 namespace small3d {
 
@@ -22,14 +23,14 @@ namespace small3d {
 
   }
 
-  void SceneObject::init(const std::string& name, const uint32_t boundingBoxSubdivisions) {
+  void SceneObject::init(const std::string& name, const Model& model, const uint32_t boundingBoxSubdivisions) {
 
     this->name = name;
     animating = false;
     framesWaited = 0;
     frameDelay = 1;
 
-    boundingBoxSet = std::make_shared<BoundingBoxSet>(this->models[0]->vertexData, this->models[0]->getOriginalScale(), boundingBoxSubdivisions);
+    boundingBoxSet = BoundingBoxSet::getCached(model, boundingBoxSubdivisions);
 
     currentPose = 0;
   }
@@ -37,15 +38,15 @@ namespace small3d {
   SceneObject::SceneObject(const std::string& name, const Model& model, const uint32_t boundingBoxSubdivisions) {
     initLogger();
     skeletal = true;
+    init(name, model, boundingBoxSubdivisions);
     this->models.push_back(std::make_shared<Model>(model));
-    init(name, boundingBoxSubdivisions);
   }
 
   SceneObject::SceneObject(const std::string& name, const Model&& model, const uint32_t boundingBoxSubdivisions) {
     initLogger();
     skeletal = true;
+    init(name, model, boundingBoxSubdivisions);
     this->models.push_back(std::make_shared<Model>(model));
-    init(name, boundingBoxSubdivisions);
   }
 
   SceneObject::SceneObject(const std::string& name, const std::vector<std::shared_ptr<Model>>& models,
@@ -53,7 +54,7 @@ namespace small3d {
     initLogger();
     skeletal = false;
     this->models = models;
-    init(name, boundingBoxSubdivisions);
+    init(name, *this->models[0], boundingBoxSubdivisions);
   }
 
   Model& SceneObject::getModel() {
@@ -85,6 +86,7 @@ namespace small3d {
 
     models[0]->setAnimation(animationIdx);
     currentPose = 0;
+    animationTime = 0.0f;
 
   }
 
@@ -93,6 +95,16 @@ namespace small3d {
   }
 
   std::vector<BoundingBoxSet::extremes>& SceneObject::getBoundingBoxSetExtremes() {
+    // The box set may be shared with other objects (see
+    // BoundingBoxSet::getCached), so the object gets its own copy before
+    // it is modified.
+    if (boundingBoxSet.use_count() > 1) {
+      boundingBoxSet = std::make_shared<BoundingBoxSet>(*boundingBoxSet);
+    }
+    return boundingBoxSet->boxExtremes;
+  }
+
+  const std::vector<BoundingBoxSet::extremes>& SceneObject::getBoundingBoxSetExtremes() const {
     return boundingBoxSet->boxExtremes;
   }
 
@@ -155,6 +167,8 @@ namespace small3d {
 
   void SceneObject::resetAnimation() {
     currentPose = 0;
+    animationTime = 0.0f;
+    timeBasedAnimation = false;
   }
 
   void SceneObject::setFrameDelay(const int delay) {
@@ -162,6 +176,11 @@ namespace small3d {
   }
 
   void SceneObject::animate() {
+    // The object is animated based on frames from now on, so the time
+    // accumulated by animate(float) is dropped.
+    timeBasedAnimation = false;
+    animationTime = 0.0f;
+
     if (animating) {
       ++framesWaited;
       if (framesWaited == frameDelay) {
@@ -177,6 +196,34 @@ namespace small3d {
     }
   }
 
+  void SceneObject::animate(float elapsedSeconds) {
+    if (!skeletal) {
+      throw std::runtime_error("Time based animation is not supported for non-skeletal object " + name + ".");
+    }
+
+    timeBasedAnimation = true;
+
+    if (animating) {
+      animationTime += elapsedSeconds;
+      auto duration = models[0]->getAnimationDuration(models[0]->currentAnimation);
+      if (animationTime > duration) {
+        if (repeatAnimation && duration > 0.0f) {
+          animationTime = std::fmod(animationTime, duration);
+        }
+        else {
+          animationTime = 0.0f;
+          if (!repeatAnimation) {
+            stopAnimating();
+          }
+        }
+      }
+    }
+  }
+
+  float SceneObject::getAnimationTime() const {
+    return animationTime;
+  }
+
   bool SceneObject::contains(const Vec3& point) const {
     if (boundingBoxSet->vertices.size() == 0) {
       throw std::runtime_error("No bounding boxes have been provided for " +
@@ -204,4 +251,53 @@ namespace small3d {
       otherObject.transformation);
   }
 
+  bool SceneObject::intersects(const SceneObject& otherObject) const {
+    if (boundingBoxSet->vertices.size() == 0) {
+      throw std::runtime_error("No bounding boxes have been provided for " +
+        name +
+        ", so collision detection is not enabled.");
+    }
+
+    if (otherObject.boundingBoxSet->vertices.size() == 0) {
+      throw std::runtime_error("No bounding boxes have been provided for " +
+        otherObject.name +
+        ", so collision detection is not enabled.");
+    }
+
+    return boundingBoxSet->intersects(*otherObject.boundingBoxSet, this->position,
+      this->transformation, otherObject.position,
+      otherObject.transformation);
+  }
+
+  bool SceneObject::sweep(const Vec3& previousPosition, const SceneObject& otherObject,
+    float& timeOfImpact) const {
+    if (boundingBoxSet->vertices.size() == 0) {
+      throw std::runtime_error("No bounding boxes have been provided for " +
+        name +
+        ", so collision detection is not enabled.");
+    }
+
+    if (otherObject.boundingBoxSet->vertices.size() == 0) {
+      throw std::runtime_error("No bounding boxes have been provided for " +
+        otherObject.name +
+        ", so collision detection is not enabled.");
+    }
+
+    return otherObject.boundingBoxSet->sweep(*boundingBoxSet, otherObject.position,
+      otherObject.transformation, previousPosition, this->position,
+      this->transformation, timeOfImpact);
+  }
+
+  bool SceneObject::raycast(const Vec3& origin, const Vec3& direction, float maxDistance,
+    float& distance) const {
+    if (boundingBoxSet->vertices.size() == 0) {
+      throw std::runtime_error("No bounding boxes have been provided for " +
+        name +
+        ", so collision detection is not enabled.");
+    }
+
+    return boundingBoxSet->raycast(origin, direction, maxDistance, this->position,
+      this->transformation, distance);
+  }
+
 }
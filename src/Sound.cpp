@@ -18,10 +18,16 @@
 #include <cereal/types/vector.hpp>
 #include <zlib.h>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
 
 
 #include "Time.hpp"
 #include "BasePath.hpp"
+#include "MappedFile.hpp"
+#include "Pack.hpp"
 
 #define PORTAUDIO_SAMPLE_FORMAT paInt16
 
@@ -30,6 +36,47 @@
 
 namespace small3d {
 
+  namespace {
+
+    // Lets vorbisfile read ogg data from memory (a mapped file or a pack)
+    struct OggMemory {
+      const char* data;
+      size_t size;
+      size_t pos;
+    };
+
+    size_t readOggMemory(void* ptr, size_t size, size_t nmemb, void* datasource) {
+      OggMemory& source = *static_cast<OggMemory*>(datasource);
+      if (size == 0) return 0;
+      size_t count = std::min(nmemb, (source.size - source.pos) / size);
+      memcpy(ptr, source.data + source.pos, count * size);
+      source.pos += count * size;
+      return count;
+    }
+
+    int seekOggMemory(void* datasource, ogg_int64_t offset, int whence) {
+      OggMemory& source = *static_cast<OggMemory*>(datasource);
+      ogg_int64_t base = whence == SEEK_SET ? 0 :
+        whence == SEEK_CUR ? static_cast<ogg_int64_t>(source.pos) : static_cast<ogg_int64_t>(source.size);
+      if (base + offset < 0 || base + offset > static_cast<ogg_int64_t>(source.size)) return -1;
+      source.pos = static_cast<size_t>(base + offset);
+      return 0;
+    }
+
+    long tellOggMemory(void* datasource) {
+      return static_cast<long>(static_cast<OggMemory*>(datasource)->pos);
+    }
+
+    const ov_callbacks OGG_MEMORY_CALLBACKS = { readOggMemory, seekOggMemory, nullptr, tellOggMemory };
+
+    // Sounds can be loaded on background threads (see AssetManager), but
+    // PortAudio is not thread safe, so all calls to it, as well as the
+    // instance count on which its initialisation depends, are locked.
+    // The lock is recursive because functions calling PortAudio also
+    // call each other (e.g. the destructor calls stop).
+    std::recursive_mutex portAudioMutex;
+  }
+
   bool Sound::noOutputDevice;
   unsigned int Sound::numInstances = 0;
 
@@ -93,6 +140,8 @@ namespace small3d {
 
     this->stream = nullptr;
 
+    std::lock_guard<std::recursive_mutex> lock(portAudioMutex);
+
     if (numInstances == 0) {
       LOGDEBUG("No Sound instances exist. Initialising PortAudio");
 
@@ -136,6 +185,7 @@ namespace small3d {
 
   Sound::~Sound() {
 
+    std::lock_guard<std::recursive_mutex> lock(portAudioMutex);
 
     if (stream != nullptr) {
 
@@ -145,6 +195,7 @@ namespace small3d {
       Pa_CloseStream(stream);
 
     }
+
     --numInstances;
     if (numInstances == 0) {
 
@@ -153,154 +204,137 @@ namespace small3d {
     }
   }
 
-  void Sound::load(const std::string& soundFilePath) {
+  Sound::Sound(const Pack& pack, const std::string& entryName) : Sound() {
 
     if (!noOutputDevice) {
+      std::vector<char> buffer;
+      auto contents = pack.getEntry(entryName, buffer);
+      decode(contents.data(), contents.size(), entryName);
+    }
 
-      try {
-
-        OggVorbis_File vorbisFile;
-
-
-        FILE* fp = fopen((soundFilePath).c_str(), "rb");
-        if (!fp) {
-          throw std::runtime_error("Could not open file " + soundFilePath);
-        }
+    this->openStream();
 
-        if (ov_open_callbacks(reinterpret_cast<void*>(fp), &vorbisFile, NULL, 0,
-          OV_CALLBACKS_NOCLOSE) < 0) {
-          fclose(fp);
-          throw std::runtime_error("Could not read file " +
-            soundFilePath + " as ogg.");
-        }
-        else {
-          LOGDEBUG("Opened OV callbacks for " + soundFilePath + ".");
-        }
+  }
 
+  void Sound::load(const std::string& soundFilePath) {
 
-        const vorbis_info* vi = ov_info(&vorbisFile, -1);
+    if (!noOutputDevice) {
+      MappedFile file(soundFilePath, false);
+      decode(file.data(), file.size(), soundFilePath);
+    }
 
-        this->soundData.channels = vi->channels;
-        this->soundData.rate = (int)vi->rate;
-        this->soundData.samples =
-          static_cast<long>(ov_pcm_total(&vorbisFile, -1));
-        this->soundData.size = soundData.channels * soundData.samples * WORD_SIZE;
-        this->soundData.duration = static_cast<double>(soundData.samples) /
-          static_cast<double>(soundData.rate);
+    this->openStream();
 
-        char pcmout[4096];
-        int current_section;
-        long ret = 0;
-        long pos = 0;
+  }
 
-        do {
-          ret = ov_read(&vorbisFile, pcmout, sizeof(pcmout), 0, WORD_SIZE, 1,
-            &current_section);
-          if (ret < 0) {
+  void Sound::decode(const char* data, size_t size, const std::string& name) {
 
-            fclose(fp);
+    try {
 
-            throw std::runtime_error("Error in sound stream.");
+      OggVorbis_File vorbisFile;
 
-          }
-          else if (ret > 0) {
+      OggMemory source = { data, size, 0 };
 
-            this->soundData.data.insert(soundData.data.end(), &pcmout[0],
-              &pcmout[ret]);
+      if (ov_open_callbacks(&source, &vorbisFile, NULL, 0, OGG_MEMORY_CALLBACKS) < 0) {
+        throw std::runtime_error("Could not read " + name + " as ogg.");
+      }
+      else {
+        LOGDEBUG("Opened OV callbacks for " + name + ".");
+      }
 
-            pos += ret;
 
-          }
-        } while (ret != 0);
+      const vorbis_info* vi = ov_info(&vorbisFile, -1);
 
-        ov_clear(&vorbisFile);
+      this->soundData.channels = vi->channels;
+      this->soundData.rate = (int)vi->rate;
+      this->soundData.samples =
+        static_cast<long>(ov_pcm_total(&vorbisFile, -1));
+      this->soundData.size = soundData.channels * soundData.samples * WORD_SIZE;
+      this->soundData.duration = static_cast<double>(soundData.samples) /
+        static_cast<double>(soundData.rate);
 
+      char pcmout[4096];
+      int current_section;
+      long ret = 0;
+      long pos = 0;
 
-        fclose(fp);
+      do {
+        ret = ov_read(&vorbisFile, pcmout, sizeof(pcmout), 0, WORD_SIZE, 1,
+          &current_section);
+        if (ret < 0) {
 
-      }
-      catch (std::exception& ex) {
-        LOGDEBUG(ex.what());
-        LOGDEBUG("Opening as binary...");
+          ov_clear(&vorbisFile);
 
+          throw std::runtime_error("Error in sound stream.");
 
-        std::ifstream is;
-        is.open(soundFilePath, std::ios::in | std::ios::binary);
-        if (!is.is_open()) {
-          throw std::runtime_error("Could not open file " + soundFilePath);
         }
+        else if (ret > 0) {
 
+          this->soundData.data.insert(soundData.data.end(), &pcmout[0],
+            &pcmout[ret]);
 
-        std::string readData = "";
-        const uint32_t CHUNK = 16384;
+          pos += ret;
 
-        char rd[CHUNK];
-        while (!is.eof()) {
-          memset(rd, 0, CHUNK);
-          is.read(rd, CHUNK);
-          for (uint32_t idx = 0; idx < is.gcount(); ++idx) {
-            readData += rd[idx];
-          }
         }
+      } while (ret != 0);
 
-        is.close();
-        unsigned char out[CHUNK];
-        z_stream strm;
+      ov_clear(&vorbisFile);
 
-        strm.zalloc = Z_NULL;
-        strm.zfree = Z_NULL;
-        strm.opaque = Z_NULL;
-
-        if (inflateInit(&strm) != Z_OK) {
-          throw std::runtime_error("Failed to initialise inflate stream.");
-        }
+    }
+    catch (std::exception& ex) {
+      LOGDEBUG(ex.what());
+      LOGDEBUG("Opening as binary...");
 
-        strm.avail_in = readData.length();
-        strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(readData.c_str()));
-        std::string uncompressedData = "";
+      const uint32_t CHUNK = 16384;
 
-        do {
-          strm.avail_out = CHUNK;
-          strm.next_out = out;
-          if (inflate(&strm, Z_NO_FLUSH) == Z_STREAM_ERROR) {
-            LOGERROR("Stream error");
-          }
-          uint32_t have = CHUNK - strm.avail_out;
-          for (uint32_t idx = 0; idx < have; ++idx) {
-            uncompressedData += out[idx];
-          }
-        } while (strm.avail_out == 0);
-        deflateEnd(&strm);
+      unsigned char out[CHUNK];
+      z_stream strm;
 
-        std::istringstream iss(uncompressedData, std::ios::binary | std::ios::in);
+      strm.zalloc = Z_NULL;
+      strm.zfree = Z_NULL;
+      strm.opaque = Z_NULL;
 
-        cereal::BinaryInputArchive iarchive(iss);
-        iarchive(this->soundData);
-        iss.clear();
-        uncompressedData.clear();
+      if (inflateInit(&strm) != Z_OK) {
+        throw std::runtime_error("Failed to initialise inflate stream.");
+      }
 
+      strm.avail_in = static_cast<uInt>(size);
+      strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+      std::string uncompressedData = "";
 
-        is.close();
+      do {
+        strm.avail_out = CHUNK;
+        strm.next_out = out;
+        if (inflate(&strm, Z_NO_FLUSH) == Z_STREAM_ERROR) {
+          LOGERROR("Stream error");
+        }
+        uint32_t have = CHUNK - strm.avail_out;
+        uncompressedData.append(reinterpret_cast<const char*>(out), have);
+      } while (strm.avail_out == 0);
+      inflateEnd(&strm);
 
-        LOGDEBUG("Loaded sound from binary file " + soundFilePath);
+      std::istringstream iss(uncompressedData, std::ios::binary | std::ios::in);
 
-      }
+      cereal::BinaryInputArchive iarchive(iss);
+      iarchive(this->soundData);
+      iss.clear();
+      uncompressedData.clear();
 
-      LOGDEBUG("Loaded sound - channels " + std::to_string(this->soundData.channels) +
-        " - rate " + std::to_string(this->soundData.rate) + " - samples " +
-        std::to_string(this->soundData.samples) + " - size in bytes " +
-        std::to_string(this->soundData.size) + " - duration " +
-        std::to_string(this->soundData.duration) +
-        +" - start time " + std::to_string(this->soundData.startTime) +
-        +" - repeat? " + std::to_string(this->soundData.repeat) +
-        +" - current frame " + std::to_string(this->soundData.currentFrame) +
-        +" - data vector size " + std::to_string(this->soundData.data.size()) +
-        +" - playing repeat? " + std::to_string(this->soundData.playingRepeat)
-      );
+      LOGDEBUG("Loaded sound from binary " + name);
 
     }
 
-    this->openStream();
+    LOGDEBUG("Loaded sound - channels " + std::to_string(this->soundData.channels) +
+      " - rate " + std::to_string(this->soundData.rate) + " - samples " +
+      std::to_string(this->soundData.samples) + " - size in bytes " +
+      std::to_string(this->soundData.size) + " - duration " +
+      std::to_string(this->soundData.duration) +
+      +" - start time " + std::to_string(this->soundData.startTime) +
+      +" - repeat? " + std::to_string(this->soundData.repeat) +
+      +" - current frame " + std::to_string(this->soundData.currentFrame) +
+      +" - data vector size " + std::to_string(this->soundData.data.size()) +
+      +" - playing repeat? " + std::to_string(this->soundData.playingRepeat)
+    );
 
   }
 
@@ -325,6 +359,7 @@ namespace small3d {
 
     PaError error;
 
+    std::lock_guard<std::recursive_mutex> lock(portAudioMutex);
     error = Pa_OpenStream(&stream, NULL, &outputParams, this->soundData.rate,
       1024, paNoFlag,
       Sound::audioCallback, &this->soundData);
@@ -355,6 +390,7 @@ namespace small3d {
 
     if (!noOutputDevice && this->soundData.size > 0) {
 
+      std::lock_guard<std::recursive_mutex> lock(portAudioMutex);
 
       if (Pa_IsStreamActive(stream)) return;
 
@@ -388,6 +424,8 @@ namespace small3d {
       soundData.playingRepeat = false;
     }
 
+    std::lock_guard<std::recursive_mutex> lock(portAudioMutex);
+
     if (Pa_IsStreamStopped(stream)) return;
 
 
@@ -409,6 +447,7 @@ namespace small3d {
     this->stream = nullptr;
 
     this->openStream();
+    std::lock_guard<std::recursive_mutex> lock(portAudioMutex);
     ++numInstances;
   }
 
@@ -418,11 +457,14 @@ namespace small3d {
     this->stream = nullptr;
 
     this->openStream();
+    std::lock_guard<std::recursive_mutex> lock(portAudioMutex);
     ++numInstances;
   }
 
   Sound& Sound::operator=(const Sound& other) {
 
+    std::lock_guard<std::recursive_mutex> lock(portAudioMutex);
+
     if (this->stream != nullptr) {
 
       Pa_AbortStream(this->stream);
@@ -442,6 +484,8 @@ namespace small3d {
 
   Sound& Sound::operator=(const Sound&& other) {
 
+    std::lock_guard<std::recursive_mutex> lock(portAudioMutex);
+
     if (this->stream != nullptr) {
 
 
@@ -0,0 +1,157 @@
+/**
+ *  ThreadPool.cpp
+ *
+ *  Created on: 2026/10/18
+ *      Author: Dimitri Kourkoulis
+ *     License: BSD 3-Clause License (see LICENSE file)
+ */
+
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+namespace small3d {
+
+  // The tasks of a call to run. The workers that take a batch from the
+  // queue and the calling thread all take tasks from it until none are
+  // left, so a batch can remain in the queue after it has been finished.
+  // Workers taking it then find nothing to do.
+  struct ThreadPool::Batch {
+    const std::function<void(size_t)>* task = nullptr;
+    size_t numTasks = 0;
+    std::atomic<size_t> nextTask{ 0 };
+    size_t numFinished = 0;
+    std::exception_ptr error;
+    size_t errorTask = 0;
+    std::mutex mutex;
+    std::condition_variable finished;
+  };
+
+  ThreadPool::ThreadPool() {
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    uint32_t numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    workers.reserve(numWorkers);
+    for (uint32_t i = 0; i < numWorkers; ++i) {
+      workers.emplace_back(&ThreadPool::work, this);
+    }
+  }
+
+  ThreadPool& ThreadPool::getInstance() {
+    static ThreadPool instance;
+    return instance;
+  }
+
+  ThreadPool::~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      stopping = true;
+    }
+    queueCondition.notify_all();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  uint32_t ThreadPool::getNumThreads() const {
+    return static_cast<uint32_t>(workers.size()) + 1;
+  }
+
+  void ThreadPool::work() {
+    while (true) {
+      std::shared_ptr<Batch> batch;
+      {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueCondition.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) return;
+        batch = std::move(queue.front());
+        queue.pop_front();
+      }
+      runTasks(*batch);
+    }
+  }
+
+  void ThreadPool::runTasks(Batch& batch) {
+    for (size_t idx = batch.nextTask++; idx < batch.numTasks; idx = batch.nextTask++) {
+      std::exception_ptr error;
+      try {
+        (*batch.task)(idx);
+      }
+      catch (...) {
+        error = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lock(batch.mutex);
+      if (error && (!batch.error || idx < batch.errorTask)) {
+        batch.error = error;
+        batch.errorTask = idx;
+      }
+      if (++batch.numFinished == batch.numTasks) {
+        batch.finished.notify_all();
+      }
+    }
+  }
+
+  void ThreadPool::run(size_t numTasks, const std::function<void(size_t)>& task) {
+    if (numTasks == 0) return;
+
+    if (numTasks == 1 || workers.empty()) {
+      for (size_t idx = 0; idx < numTasks; ++idx) {
+        task(idx);
+      }
+      return;
+    }
+
+    auto batch = std::make_shared<Batch>();
+    batch->task = &task;
+    batch->numTasks = numTasks;
+
+    size_t numHelpers = std::min(workers.size(), numTasks - 1);
+    {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      for (size_t helper = 0; helper < numHelpers; ++helper) {
+        queue.push_back(batch);
+      }
+    }
+    if (numHelpers == workers.size()) {
+      queueCondition.notify_all();
+    }
+    else {
+      for (size_t helper = 0; helper < numHelpers; ++helper) {
+        queueCondition.notify_one();
+      }
+    }
+
+    runTasks(*batch);
+
+    std::exception_ptr error;
+    {
+      std::unique_lock<std::mutex> lock(batch->mutex);
+      batch->finished.wait(lock, [&batch] { return batch->numFinished == batch->numTasks; });
+      // Taken out of the batch, so that the exception is not destroyed by
+      // a worker that releases the batch later.
+      error = std::move(batch->error);
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  void ThreadPool::parallelFor(size_t count, size_t minPerThread,
+    const std::function<void(size_t, size_t)>& process) {
+    size_t numParts = std::min(static_cast<size_t>(getNumThreads()),
+      count / std::max(minPerThread, static_cast<size_t>(1)));
+
+    if (numParts < 2) {
+      if (count > 0) process(0, count);
+      return;
+    }
+
+    size_t chunk = (count + numParts - 1) / numParts;
+    run(numParts, [&](size_t part) {
+      size_t begin = part * chunk;
+      size_t end = std::min(count, begin + chunk);
+      if (begin < end) process(begin, end);
+    });
+  }
+}
@@ -59,7 +59,7 @@ namespace small3d {
     }
   }
 
-  void WavefrontFile::loadIndexData(std::vector<uint16_t>& indexData) {
+  void WavefrontFile::loadIndexData(std::vector<uint32_t>& indexData) {
 
     if (!onlyTriangles) {
       throw std::runtime_error("Cannot load indices from " + fullPath + " because"
@@ -431,8 +431,10 @@ namespace small3d {
 
   void WavefrontFile::load(Model& model, const std::string& meshName) {
 
+    std::vector<uint32_t> indices;
+
     loadVertexData(model.vertexData);
-    loadIndexData(model.indexData);
+    loadIndexData(indices);
     loadNormalsData(model.normalsData, model.vertexData);
     loadTextureCoordsData(model.textureCoordsData, model.vertexData);
 
@@ -458,14 +460,14 @@ namespace small3d {
         numFaces = objectStartFaceIdx.find(objectNames[1])->second;
       }
 
-      model.indexData = std::vector<uint16_t>(model.indexData.begin() + startFaceIdx * 3,
-        model.indexData.begin() + numFaces * 3);
+      indices = std::vector<uint32_t>(indices.begin() + startFaceIdx * 3,
+        indices.begin() + numFaces * 3);
 
-      size_t minIndex = model.indexData[0];
-      for (auto i : model.indexData) if (i < minIndex) minIndex = i;
+      size_t minIndex = indices[0];
+      for (auto i : indices) if (i < minIndex) minIndex = i;
 
-      size_t maxIndex = model.indexData[0];
-      for (auto i : model.indexData) if (i > maxIndex) maxIndex = i;
+      size_t maxIndex = indices[0];
+      for (auto i : indices) if (i > maxIndex) maxIndex = i;
 
       model.vertexData = std::vector<float>(model.vertexData.begin() + minIndex * 4,
         model.vertexData.begin() + (maxIndex + 1) * 4);
@@ -476,16 +478,17 @@ namespace small3d {
       model.textureCoordsData = std::vector<float>(model.textureCoordsData.begin() + minIndex * 2,
         model.textureCoordsData.begin() + (maxIndex + 1) * 2);
 
-      for (size_t idx = 0; idx < model.indexData.size(); ++idx) {
-        model.indexData[idx] -= static_cast<uint32_t>(minIndex);
+      for (size_t idx = 0; idx < indices.size(); ++idx) {
+        indices[idx] -= static_cast<uint32_t>(minIndex);
       }
     }
 
     model.vertexDataByteSize = static_cast<uint32_t>(model.vertexData.size() * sizeof(float));
-    model.indexDataByteSize = static_cast<uint32_t>(model.indexData.size() * sizeof(uint16_t));
+    model.setIndexData(indices);
     model.normalsDataByteSize = static_cast<uint32_t>(model.normalsData.size() * sizeof(float));
     model.textureCoordsDataByteSize = static_cast<uint32_t>(model.textureCoordsData.size() * sizeof(float));
     model.material = material;
+    model.packVertexData();
     LOGDEBUG("Loaded mesh " + meshName + " from " + fullPath);
 
   }
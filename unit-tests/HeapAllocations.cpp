@@ -0,0 +1,142 @@
+/*
+ *  HeapAllocations.cpp
+ *
+ *  Created on: 2026/10/18
+ *      Author: Dimitri Kourkoulis
+ *     License: BSD 3-Clause License (see LICENSE file)
+ */
+
+#include "UnitTests.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+// Every form of new and delete is replaced, so that memory is always
+// released by the same allocator that provided it. This is done apart
+// from the tests, so that the compiler does not inline the releases into
+// code allocating with new and report the calls to free as mismatched.
+// Aligned memory is taken from a larger block, with the address of the
+// block stored right before the aligned memory.
+static std::atomic<uint64_t> heapAllocations(0);
+
+uint64_t getHeapAllocations() {
+  return heapAllocations;
+}
+
+static void* countedAllocate(std::size_t size) noexcept {
+  ++heapAllocations;
+  return std::malloc(size > 0 ? size : 1);
+}
+
+static void* countedAllocate(std::size_t size, std::align_val_t alignment) noexcept {
+  std::size_t align = std::max(static_cast<std::size_t>(alignment), sizeof(void*));
+  void* block = countedAllocate(size + align + sizeof(void*));
+  if (block == nullptr) {
+    return nullptr;
+  }
+  std::uintptr_t address = reinterpret_cast<std::uintptr_t>(block) + sizeof(void*);
+  address = (address + align - 1) & ~(static_cast<std::uintptr_t>(align) - 1);
+  void* ptr = reinterpret_cast<void*>(address);
+  static_cast<void**>(ptr)[-1] = block;
+  return ptr;
+}
+
+static void countedRelease(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+static void countedRelease(void* ptr, std::align_val_t) noexcept {
+  if (ptr != nullptr) {
+    std::free(static_cast<void**>(ptr)[-1]);
+  }
+}
+
+void* operator new(std::size_t size) {
+  void* ptr = countedAllocate(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return countedAllocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  void* ptr = countedAllocate(size, alignment);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return countedAllocate(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return countedAllocate(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept {
+  countedRelease(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  countedRelease(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+  countedRelease(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+  countedRelease(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  countedRelease(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  countedRelease(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t alignment) noexcept {
+  countedRelease(ptr, alignment);
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept {
+  countedRelease(ptr, alignment);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept {
+  countedRelease(ptr, alignment);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept {
+  countedRelease(ptr, alignment);
+}
+
+void operator delete(void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  countedRelease(ptr, alignment);
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  countedRelease(ptr, alignment);
+}
@@ -19,7 +19,26 @@
 #include "GlbFile.hpp"
 #include "WavefrontFile.hpp"
 #include "BinaryFile.hpp"
+#include "CollisionWorld.hpp"
+#include "MappedFile.hpp"
+#include "Pack.hpp"
+#include "PackFile.hpp"
+#include "AssetManager.hpp"
+#include "ThreadPool.hpp"
 #include <thread>
+#include <cmath>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <set>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <utility>
 
 using namespace small3d;
 using namespace std;
@@ -85,6 +104,323 @@ int MathTest() {
   return 1;
 }
 
+int SimdMathTest() {
+
+  std::mt19937 generator(12345);
+  std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+
+  auto randomVec4 = [&]() {
+    return Vec4(distribution(generator), distribution(generator),
+      distribution(generator), distribution(generator));
+  };
+
+  auto randomMat4 = [&]() {
+    return Mat4(randomVec4(), randomVec4(), randomVec4(), randomVec4());
+  };
+
+  float maxDifference = 0.0f;
+
+  // The results are compared with a tolerance, because some compilers fuse
+  // multiplications and additions in the scalar implementations.
+  auto same = [&maxDifference](const Vec4& vec1, const Vec4& vec2) {
+    const float* values1 = &vec1.x;
+    const float* values2 = &vec2.x;
+    for (int idx = 0; idx < 4; ++idx) {
+      float difference = std::abs(values1[idx] - values2[idx]);
+      if (std::isfinite(values2[idx])) {
+        maxDifference = std::max(maxDifference, difference /
+          std::max(1.0f, std::abs(values2[idx])));
+        if (difference > 1e-5f * std::max(1.0f, std::abs(values2[idx]))) {
+          return false;
+        }
+      }
+    }
+    return true;
+  };
+
+  auto sameMat4 = [&same](const Mat4& mat1, const Mat4& mat2) {
+    return same(mat1.data[0], mat2.data[0]) && same(mat1.data[1], mat2.data[1]) &&
+      same(mat1.data[2], mat2.data[2]) && same(mat1.data[3], mat2.data[3]);
+  };
+
+  for (int iteration = 0; iteration < 10000; ++iteration) {
+    Mat4 mat1 = randomMat4();
+    Mat4 mat2 = randomMat4();
+    Vec4 vec = randomVec4();
+
+    if (!sameMat4(mat1 * mat2, scalar::multiply(mat1, mat2))) {
+      LOGINFO("Matrix multiplication differs from the scalar implementation.");
+      return 0;
+    }
+
+    if (!same(mat1 * vec, scalar::multiply(mat1, vec))) {
+      LOGINFO("Matrix - vector multiplication differs from the scalar implementation.");
+      return 0;
+    }
+
+    if (!sameMat4(inverse(mat1), scalar::inverse(mat1))) {
+      LOGINFO("Matrix inversion differs from the scalar implementation.");
+      return 0;
+    }
+
+    Quat quat = { vec.x, vec.y, vec.z, vec.w };
+    if (!sameMat4(quat.toMatrix(), scalar::toMatrix(quat))) {
+      LOGINFO("Quaternion conversion differs from the scalar implementation.");
+      return 0;
+    }
+
+    float angle = distribution(generator);
+    Vec3 axis(vec.x, vec.y, vec.z);
+    if (!sameMat4(rotate(mat1, angle, axis), scalar::rotate(mat1, angle, axis))) {
+      LOGINFO("Rotation differs from the scalar implementation.");
+      return 0;
+    }
+  }
+
+  LOGINFO("SIMD instruction set: " + std::string(simdInstructionSet()) +
+    ", maximum relative difference from the scalar implementations: " +
+    std::to_string(maxDifference));
+
+  return 1;
+}
+
+int MathBenchmark() {
+
+  // Each operation is applied to a batch of independent inputs, as it
+  // would be for the models rendered in a frame or the joints of a model.
+  const int batchSize = 256;
+  const int repetitions = 4000;
+
+  std::mt19937 generator(12345);
+  std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+  std::vector<Mat4> mats(batchSize);
+  std::vector<Mat4> mats2(batchSize);
+  std::vector<Vec4> vecs(batchSize);
+  std::vector<Quat> quats(batchSize);
+  std::vector<Mat4> matResults(batchSize);
+  std::vector<Vec4> vecResults(batchSize);
+
+  for (int idx = 0; idx < batchSize; ++idx) {
+    for (int column = 0; column < 4; ++column) {
+      mats[idx].data[column] = Vec4(distribution(generator), distribution(generator),
+        distribution(generator), distribution(generator));
+      mats2[idx].data[column] = Vec4(distribution(generator), distribution(generator),
+        distribution(generator), distribution(generator));
+    }
+    vecs[idx] = Vec4(distribution(generator), distribution(generator),
+      distribution(generator), distribution(generator));
+    quats[idx] = { vecs[idx].x, vecs[idx].y, vecs[idx].z, vecs[idx].w };
+  }
+
+  float checksum = 0.0f;
+
+  auto benchmark = [&](const std::string& name, auto operation) {
+    auto startTime = std::chrono::steady_clock::now();
+    for (int repetition = 0; repetition < repetitions; ++repetition) {
+      for (int idx = 0; idx < batchSize; ++idx) {
+        operation(idx);
+      }
+      checksum += matResults[repetition % batchSize].data[0].x +
+        vecResults[repetition % batchSize].x;
+    }
+    auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - startTime).count();
+    LOGINFO(name + ": " + std::to_string(static_cast<double>(nanoseconds) /
+      (static_cast<double>(repetitions) * batchSize)) + " ns per op");
+  };
+
+  LOGINFO(std::string("SIMD instruction set: ") + simdInstructionSet());
+
+  benchmark("Mat4 * Mat4", [&](int idx) { matResults[idx] = mats[idx] * mats2[idx]; });
+  benchmark("Mat4 * Mat4 (scalar)", [&](int idx) { matResults[idx] = scalar::multiply(mats[idx], mats2[idx]); });
+  benchmark("Mat4 * Vec4", [&](int idx) { vecResults[idx] = mats[idx] * vecs[idx]; });
+  benchmark("Mat4 * Vec4 (scalar)", [&](int idx) { vecResults[idx] = scalar::multiply(mats[idx], vecs[idx]); });
+  benchmark("inverse", [&](int idx) { matResults[idx] = inverse(mats[idx]); });
+  benchmark("inverse (scalar)", [&](int idx) { matResults[idx] = scalar::inverse(mats[idx]); });
+  benchmark("Quat::toMatrix", [&](int idx) { matResults[idx] = quats[idx].toMatrix(); });
+  benchmark("Quat::toMatrix (scalar)", [&](int idx) { matResults[idx] = scalar::toMatrix(quats[idx]); });
+  benchmark("rotate", [&](int idx) { matResults[idx] = rotate(mats[idx], vecs[idx].w, Vec3(0.0f, 1.0f, 0.0f)); });
+  benchmark("rotate (scalar)", [&](int idx) { matResults[idx] = scalar::rotate(mats[idx], vecs[idx].w, Vec3(0.0f, 1.0f, 0.0f)); });
+
+  // Use the results, so that the operations are not optimised away
+  LOGINFO("Checksum: " + std::to_string(checksum));
+
+  return 1;
+}
+
+int BatchMathTest() {
+
+  // Large enough for the batch to be split among threads, and not
+  // a multiple of 4, so that the remainder is processed too.
+  const size_t count = 100003;
+
+  std::mt19937 generator(12345);
+  std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+
+  Mat4 mat;
+  for (int column = 0; column < 4; ++column) {
+    mat.data[column] = Vec4(distribution(generator), distribution(generator),
+      distribution(generator), distribution(generator));
+  }
+
+  std::vector<float> x(count), y(count), z(count), vertexData(4 * count);
+  for (size_t idx = 0; idx < count; ++idx) {
+    x[idx] = distribution(generator);
+    y[idx] = distribution(generator);
+    z[idx] = distribution(generator);
+    vertexData[4 * idx] = x[idx];
+    vertexData[4 * idx + 1] = y[idx];
+    vertexData[4 * idx + 2] = z[idx];
+    vertexData[4 * idx + 3] = 1.0f;
+  }
+
+  std::vector<Vec4> expected(count);
+  auto startTime = std::chrono::steady_clock::now();
+  for (size_t idx = 0; idx < count; ++idx) {
+    expected[idx] = mat * Vec4(x[idx], y[idx], z[idx], 1.0f);
+  }
+  auto oneByOneTime = std::chrono::steady_clock::now() - startTime;
+
+  // The results are compared with a tolerance, because some compilers fuse
+  // multiplications and additions in the scalar implementations.
+  auto sameFloat = [](float value1, float value2) {
+    return std::abs(value1 - value2) <= 1e-5f * std::max(1.0f, std::abs(value2));
+  };
+
+  auto sameVec4 = [&sameFloat](const Vec4& vec1, const Vec4& vec2) {
+    return sameFloat(vec1.x, vec2.x) && sameFloat(vec1.y, vec2.y) &&
+      sameFloat(vec1.z, vec2.z) && sameFloat(vec1.w, vec2.w);
+  };
+
+  std::vector<float> outX(count), outY(count), outZ(count);
+  std::vector<float> transformedVertexData(4 * count);
+  std::chrono::steady_clock::duration batchTime[2];
+
+  // Once on the calling thread only and once split among the threads
+  // of the ThreadPool
+  for (bool multithreaded : { false, true }) {
+    std::fill(outX.begin(), outX.end(), 0.0f);
+    std::fill(transformedVertexData.begin(), transformedVertexData.end(), 0.0f);
+
+    startTime = std::chrono::steady_clock::now();
+    transformPoints(mat, x.data(), y.data(), z.data(), outX.data(), outY.data(),
+      outZ.data(), count, multithreaded);
+    batchTime[multithreaded] = std::chrono::steady_clock::now() - startTime;
+
+    transformPoints(mat, vertexData.data(), transformedVertexData.data(), count, multithreaded);
+
+    for (size_t idx = 0; idx < count; ++idx) {
+      if (!sameVec4(Vec4(outX[idx], outY[idx], outZ[idx], 1.0f),
+        Vec4(expected[idx].x, expected[idx].y, expected[idx].z, 1.0f))) {
+        LOGINFO("Batch point transformation differs from Mat4 * Vec4.");
+        return 0;
+      }
+      if (!sameVec4(Vec4(transformedVertexData[4 * idx], transformedVertexData[4 * idx + 1],
+        transformedVertexData[4 * idx + 2], transformedVertexData[4 * idx + 3]), expected[idx])) {
+        LOGINFO("Batch vector transformation differs from Mat4 * Vec4.");
+        return 0;
+      }
+    }
+  }
+
+  LOGINFO("Transforming " + std::to_string(count) + " points: " +
+    std::to_string(std::chrono::duration<double, std::micro>(oneByOneTime).count()) +
+    " microseconds one by one, " +
+    std::to_string(std::chrono::duration<double, std::micro>(batchTime[0]).count()) +
+    " microseconds in one call, " +
+    std::to_string(std::chrono::duration<double, std::micro>(batchTime[1]).count()) +
+    " microseconds in one call with " + std::to_string(ThreadPool::getInstance().getNumThreads()) +
+    " threads");
+
+  const size_t numMats = 1001;
+  std::vector<Mat4> mats1(numMats), mats2(numMats), products(numMats), composed(numMats);
+  std::vector<Vec3> translations(numMats), scales(numMats);
+  std::vector<Quat> rotations(numMats);
+
+  for (size_t idx = 0; idx < numMats; ++idx) {
+    for (int column = 0; column < 4; ++column) {
+      mats1[idx].data[column] = Vec4(distribution(generator), distribution(generator),
+        distribution(generator), distribution(generator));
+      mats2[idx].data[column] = Vec4(distribution(generator), distribution(generator),
+        distribution(generator), distribution(generator));
+    }
+    translations[idx] = Vec3(distribution(generator), distribution(generator),
+      distribution(generator));
+    scales[idx] = Vec3(distribution(generator), distribution(generator),
+      distribution(generator));
+    rotations[idx] = { distribution(generator), distribution(generator),
+      distribution(generator), distribution(generator) };
+  }
+
+  multiplyMatrices(mats1.data(), mats2.data(), products.data(), numMats);
+  composeTRS(translations.data(), rotations.data(), scales.data(), composed.data(), numMats);
+
+  auto sameMat4 = [&sameVec4](const Mat4& mat1, const Mat4& mat2) {
+    return sameVec4(mat1.data[0], mat2.data[0]) && sameVec4(mat1.data[1], mat2.data[1]) &&
+      sameVec4(mat1.data[2], mat2.data[2]) && sameVec4(mat1.data[3], mat2.data[3]);
+  };
+
+  for (size_t idx = 0; idx < numMats; ++idx) {
+    if (!sameMat4(products[idx], mats1[idx] * mats2[idx])) {
+      LOGINFO("Batch matrix multiplication differs from Mat4 * Mat4.");
+      return 0;
+    }
+    if (!sameMat4(composed[idx], translate(Mat4(1.0f), translations[idx]) *
+      rotations[idx].toMatrix() * scale(Mat4(1.0f), scales[idx]))) {
+      LOGINFO("Composed transformation differs from translate * rotate * scale.");
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+int ThreadPoolTest() {
+
+  ThreadPool& pool = ThreadPool::getInstance();
+
+  // Every task is run exactly once, also when tasks are run from within
+  // tasks
+  const size_t numTasks = 1000;
+  std::vector<std::atomic<uint32_t>> runs(numTasks);
+  std::vector<std::atomic<uint32_t>> nestedRuns(numTasks);
+  pool.run(numTasks, [&](size_t task) {
+    ++runs[task];
+    if (task % 100 == 0) {
+      pool.parallelFor(numTasks, 1, [&](size_t begin, size_t end) {
+        for (size_t idx = begin; idx < end; ++idx) {
+          ++nestedRuns[idx];
+        }
+      });
+    }
+  });
+
+  for (size_t task = 0; task < numTasks; ++task) {
+    if (runs[task] != 1 || nestedRuns[task] != numTasks / 100) {
+      LOGINFO("A task has not been run the right number of times.");
+      return 0;
+    }
+  }
+
+  // The exception of the first task that has thrown is rethrown
+  std::string message;
+  try {
+    pool.run(numTasks, [](size_t task) {
+      if (task % 300 == 7) throw std::runtime_error("Task " + std::to_string(task));
+    });
+  }
+  catch (const std::runtime_error& e) {
+    message = e.what();
+  }
+  if (message != "Task 7") {
+    LOGINFO("The exception of the first failing task has not been rethrown.");
+    return 0;
+  }
+
+  return 1;
+}
+
 int ImageTest() {
 
   Image image(resourceDir + "/images/testImage.png");
@@ -305,13 +641,13 @@ int BoundingBoxesTest() {
   }
 
   SceneObject goat2("goat2", goat.getModel());
-  if (goat2.getBoundingBoxSetExtremes().size() == 0) {
+  if (std::as_const(goat2).getBoundingBoxSetExtremes().size() == 0) {
     LOGERROR("Bounding boxes not created for goat2");
     return 0;
   }
 
   SceneObject goat3("goat3", goat.getModel(), 2);
-  if (goat3.getBoundingBoxSetExtremes().size() == 0) {
+  if (std::as_const(goat3).getBoundingBoxSetExtremes().size() == 0) {
     LOGERROR("Bounding boxes not created for goat3");
     return 0;
   }
@@ -391,220 +727,1991 @@ int GenericSceneObjectConstructorTest() {
   return 1;
 }
 
-int RendererTest() {
-  initRenderer();
+int BoxIntersectionTest() {
 
-  r->setCameraRotation(Vec3(0.4f, 0.1f, 0.1f));
+  Model cubeModel(WavefrontFile(resourceDir + "/models/Cube/CubeNoTexture.obj"));
 
-  // Here loading the mesh without providing a name is also tested.
-  Model modelFromGlb(GlbFile(resourceDir + "/models/goatUnscaled.glb"), "");
+  // Two bars crossing each other. No corner of either one is
+  // inside the other.
+  BoundingBoxSet bar(cubeModel.vertexData, Vec3(5.0f, 0.5f, 0.5f), 0);
+  Mat4 crossRotation = rotate(Mat4(1.0f), 1.5708f, Vec3(0.0f, 1.0f, 0.0f));
 
-  SceneObject object("cube", Model(WavefrontFile(resourceDir + "/models/Cube/CubeNoTexture.obj")));
-  object.position = Vec3(0.0f, -1.0f, -8.0f);
-  r->render(object, Vec4(1.0f, 1.0f, 1.0f, 1.0f));
+  if (bar.containsCorners(bar, Vec3(0.0f), Mat4(1.0f), Vec3(0.0f), crossRotation) ||
+    bar.containsCorners(bar, Vec3(0.0f), crossRotation, Vec3(0.0f), Mat4(1.0f))) {
+    LOGINFO("The corners of the crossing bars should not be inside each other.");
+    return 0;
+  }
 
-  SceneObject object2("texutredCube", Model(WavefrontFile(resourceDir + "/models/Cube/Cube.obj")));
-  object2.position = Vec3(-2.0f, -1.0f, -7.0f);
-  object2.setRotation(Vec3(0.3f, 1.3f, 0.0f));
+  if (!bar.intersects(bar, Vec3(0.0f), Mat4(1.0f), Vec3(0.0f), crossRotation)) {
+    LOGINFO("The crossing bars have not been found to intersect.");
+    return 0;
+  }
 
-  Image cubeTexture(resourceDir + "/models/Cube/cubeTexture.png");
-  r->generateTexture("cubeTexture", cubeTexture);
+  // A cube rotated next to another one, so that the axis aligned boxes
+  // enclosing them overlap, first not touching and then touching it.
+  BoundingBoxSet cube(cubeModel.vertexData, Vec3(1.0f), 0);
+  Mat4 diamondRotation = rotate(Mat4(1.0f), 0.7854f, Vec3(0.0f, 0.0f, 1.0f));
 
-  Model singleColourRect;
-  r->createRectangle(singleColourRect, Vec3(-1.0f, 0.0f, 0.0f),
-    Vec3(-0.5f, -0.5f, 0.0f));
+  if (cube.intersects(cube, Vec3(0.0f), Mat4(1.0f), Vec3(2.3f, 2.3f, 0.0f), diamondRotation)) {
+    LOGINFO("The rotated cube has been found to intersect the other one, without touching it.");
+    return 0;
+  }
 
-  Model texturedRect;
+  if (!cube.intersects(cube, Vec3(0.0f), Mat4(1.0f), Vec3(1.6f, 1.6f, 0.0f), diamondRotation)) {
+    LOGINFO("The rotated cube has not been found to intersect the other one.");
+    return 0;
+  }
 
-  r->createRectangle(texturedRect, Vec3(0.0f, 0.5f, 0.0f),
-    Vec3(1.0f, -1.0f, 0.0f));
+  // Objects with many boxes, at random positions and rotations. The test
+  // must be symmetric and detect every case containsCorners detects.
+  SceneObject goat1("goat1", Model(WavefrontFile(resourceDir + "/models/goat.obj")), 3);
+  SceneObject goat2("goat2", Model(WavefrontFile(resourceDir + "/models/goat.obj")), 3);
 
-  r->generateTexture("small3dTexture", "small3d :)",
-    Vec3(0.0f, 1.0f, 0.0f));
+  std::mt19937 generator(54321);
+  std::uniform_real_distribution<float> angle(-3.14f, 3.14f);
+  std::uniform_real_distribution<float> place(-1.0f, 1.0f);
 
-  Model textRect;
+  size_t numIntersections = 0, numContainingCorners = 0;
+  double cornersMicroseconds = 0.0, intersectsMicroseconds = 0.0;
 
-  r->createRectangle(textRect, Vec3(-1.0f, 0.0f, 0.0f), Vec3(0.5f, -0.5f, 0.0f));
+  for (int idx = 0; idx < 500; ++idx) {
+    goat2.position = Vec3(place(generator), place(generator), place(generator));
+    goat2.setRotation(Vec3(angle(generator), angle(generator), angle(generator)));
 
-  double startSeconds = getTimeInSeconds();
-  double seconds = getTimeInSeconds();
-  double prevSeconds = seconds;
-  const uint32_t framerate = 30;
+    auto startTime = std::chrono::steady_clock::now();
+    bool containingCorners = goat1.containsCorners(goat2) || goat2.containsCorners(goat1);
+    auto midTime = std::chrono::steady_clock::now();
+    bool intersecting = goat1.intersects(goat2);
+    auto endTime = std::chrono::steady_clock::now();
 
-  constexpr double secondsInterval = 1.0 / framerate;
+    cornersMicroseconds += std::chrono::duration<double, std::micro>(midTime - startTime).count();
+    intersectsMicroseconds += std::chrono::duration<double, std::micro>(endTime - midTime).count();
 
-  Vec3 rotation(0.0f, 0.0f, 0.0f);
+    if (intersecting != goat2.intersects(goat1)) {
+      LOGINFO("The intersection test is not symmetric.");
+      return 0;
+    }
 
-  std::vector<std::shared_ptr<Model>> bugwfanim;
+    if (containingCorners && !intersecting) {
+      LOGINFO("An intersection has been missed.");
+      return 0;
+    }
 
-  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000001.obj")));
-  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000002.obj")));
-  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000003.obj")));
-  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000004.obj")));
-  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000005.obj")));
-  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000006.obj")));
-  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000007.obj")));
-  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000008.obj")));
-  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000009.obj")));
+    if (intersecting) ++numIntersections;
+    if (containingCorners) ++numContainingCorners;
+  }
 
-  SceneObject bug("bug", bugwfanim);
+  LOGINFO(std::to_string(std::as_const(goat1).getBoundingBoxSetExtremes().size()) + " boxes per object, " +
+    std::to_string(numIntersections) + " intersections, " +
+    std::to_string(numContainingCorners) + " found by containsCorners. containsCorners: " +
+    std::to_string(cornersMicroseconds / 500) + " microseconds, intersects: " +
+    std::to_string(intersectsMicroseconds / 500) + " microseconds per check");
 
-  bug.position = Vec3(0.0f, 3.0f, -6.0f);
-  bug.startAnimating();
+  return 1;
+}
 
-  while (seconds - startSeconds < 5.0) {
-    pollEvents();
-    seconds = getTimeInSeconds();
-    if (seconds - prevSeconds > secondsInterval) {
-      prevSeconds = seconds;
+int BoundingBoxTreeTest() {
 
-      r->render(singleColourRect,
-        Vec3(0.0f, 0.0f, 0.0f),
-        Vec3(0.0f, 0.0f, 0.0f), Vec4(0.0f, 0.0f, 1.0f, 1.0f), "", 0, false);
+  Model goat(WavefrontFile(resourceDir + "/models/goat.obj"));
 
-      r->render(texturedRect,
-        Vec3(0.0f, 0.0f, -2.0f),
-        Vec3(0.0f, 0.0f, 0.0f), Vec4(0.0f, 0.0f, 0.0f, 0.0f), "cubeTexture", true);
+  // A set with the same boxes, set directly, is checked without
+  // the tree, box by box.
+  BoundingBoxSet boxes(goat.vertexData, goat.getOriginalScale(), 4);
+  BoundingBoxSet flatBoxes;
+  flatBoxes.boxExtremes = boxes.boxExtremes;
 
-      r->render(object2, "cubeTexture");
+  float minCoord = boxes.boxExtremes[0].minX, maxCoord = boxes.boxExtremes[0].maxX;
+  for (const auto& ex : boxes.boxExtremes) {
+    minCoord = std::min({ minCoord, ex.minX, ex.minY, ex.minZ });
+    maxCoord = std::max({ maxCoord, ex.maxX, ex.maxY, ex.maxZ });
+  }
 
+  std::mt19937 generator(2468);
+  std::uniform_real_distribution<float> coord(minCoord, maxCoord);
+  std::uniform_real_distribution<float> angle(-3.14f, 3.14f);
+  std::uniform_real_distribution<float> place(-1.0f, 1.0f);
 
-      rotation.y += 0.1f;
+  size_t numContained = 0;
+  double treeMicroseconds = 0.0, flatMicroseconds = 0.0;
+  const int numPoints = 20000;
 
-      r->render(modelFromGlb, Vec3(0.0f, 1.0f, -6.0f),
-        rotation, Vec4(0.3f, 1.0f, 1.0f, 1.0f));
+  for (int idx = 0; idx < numPoints; ++idx) {
+    Vec3 point(coord(generator), coord(generator), coord(generator));
 
+    auto startTime = std::chrono::steady_clock::now();
+    bool contained = boxes.contains(point, Vec3(0.0f), Mat4(1.0f));
+    auto midTime = std::chrono::steady_clock::now();
+    bool flatContained = flatBoxes.contains(point, Vec3(0.0f), Mat4(1.0f));
+    auto endTime = std::chrono::steady_clock::now();
 
-      r->render(textRect, Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 0.0f, 0.0f),
-        Vec4(0.0f, 0.0f, 0.0f, 0.0f), "small3dTexture", 0, false);
+    treeMicroseconds += std::chrono::duration<double, std::micro>(midTime - startTime).count();
+    flatMicroseconds += std::chrono::duration<double, std::micro>(endTime - midTime).count();
 
-      r->render(bug, Vec4(1.0f, 0.0f, 0.0f, 1.0f));
+    if (contained != flatContained) {
+      LOGINFO("The tree and the flat boxes do not agree on a point.");
+      return 0;
+    }
+    if (contained) ++numContained;
+  }
 
-      bug.animate();
+  LOGINFO(std::to_string(boxes.getNumBoxes()) + " boxes, " + std::to_string(numContained) +
+    " of " + std::to_string(numPoints) + " points contained. Tree: " +
+    std::to_string(treeMicroseconds / numPoints) + " microseconds, flat: " +
+    std::to_string(flatMicroseconds / numPoints) + " microseconds per point");
+
+  size_t numIntersections = 0;
+  const int numPoses = 500;
+  treeMicroseconds = 0.0;
+  flatMicroseconds = 0.0;
+
+  for (int idx = 0; idx < numPoses; ++idx) {
+    Vec3 offset(place(generator), place(generator), place(generator));
+    Mat4 rotation = rotate(Mat4(1.0f), angle(generator), Vec3(0.0f, 1.0f, 0.0f)) *
+      rotate(Mat4(1.0f), angle(generator), Vec3(1.0f, 0.0f, 0.0f));
+
+    auto startTime = std::chrono::steady_clock::now();
+    bool intersecting = boxes.intersects(boxes, Vec3(0.0f), Mat4(1.0f), offset, rotation);
+    auto midTime = std::chrono::steady_clock::now();
+    bool flatIntersecting = flatBoxes.intersects(flatBoxes, Vec3(0.0f), Mat4(1.0f), offset, rotation);
+    auto endTime = std::chrono::steady_clock::now();
+
+    treeMicroseconds += std::chrono::duration<double, std::micro>(midTime - startTime).count();
+    flatMicroseconds += std::chrono::duration<double, std::micro>(endTime - midTime).count();
+
+    if (intersecting != flatIntersecting) {
+      LOGINFO("The tree and the flat boxes do not agree on an intersection.");
+      return 0;
+    }
+    if (intersecting) ++numIntersections;
+  }
 
-      r->swapBuffers();
+  LOGINFO(std::to_string(numIntersections) + " of " + std::to_string(numPoses) +
+    " poses intersecting. Tree: " + std::to_string(treeMicroseconds / numPoses) +
+    " microseconds, flat: " + std::to_string(flatMicroseconds / numPoses) +
+    " microseconds per check");
+
+  // A box moved in place, away from all the others, is found both before
+  // and after the tree is built again.
+  Vec3 farPoint(maxCoord + 10.0f, 0.0f, 0.0f);
+  BoundingBoxSet probe;
+  probe.boxExtremes.assign(1, BoundingBoxSet::extremes());
+  probe.boxExtremes[0] = { -0.05f, 0.05f, -0.05f, 0.05f, -0.05f, 0.05f, true };
+
+  if (boxes.contains(farPoint, Vec3(0.0f), Mat4(1.0f))) {
+    LOGINFO("A point away from all the boxes is contained.");
+    return 0;
+  }
 
+  auto& editedExtremes = boxes.boxExtremes;
+  editedExtremes[editedExtremes.size() / 2] = { farPoint.z - 0.1f, farPoint.z + 0.1f,
+    farPoint.x - 0.1f, farPoint.x + 0.1f, farPoint.y - 0.1f, farPoint.y + 0.1f, true };
+
+  for (int refreshed = 0; refreshed < 2; ++refreshed) {
+    float distance = 0.0f;
+    if (!boxes.contains(farPoint, Vec3(0.0f), Mat4(1.0f)) ||
+      !boxes.intersects(probe, Vec3(0.0f), Mat4(1.0f), farPoint, Mat4(1.0f)) ||
+      !boxes.raycast(farPoint + Vec3(0.0f, 0.0f, 5.0f), Vec3(0.0f, 0.0f, -1.0f), 10.0f,
+        Vec3(0.0f), Mat4(1.0f), distance) || std::abs(distance - 4.9f) > 1e-4f) {
+      LOGINFO(std::string("A box moved in place has not been found ") +
+        (refreshed ? "after the tree has been built again." : "before the tree has been built again."));
+      return 0;
     }
+    boxes.refreshTree();
   }
-  r->clearBuffers(object);
-  r->clearBuffers(object2);
-  r->clearBuffers(texturedRect);
-  r->clearBuffers(textRect);
-  r->deleteTexture("cubeTexture");
 
   return 1;
 }
 
-int BinaryModelTest() {
+int BoundingBoxCacheTest() {
 
-  initRenderer();
+  BoundingBoxSet::clearCache();
 
-  r->setCameraRotation(Vec3(0.4f, 0.1f, 0.1f));
-  const std::string textureName = "goatbintexture";
+  Model goat(WavefrontFile(resourceDir + "/models/goat.obj"));
 
-  Model modelFromGlb(GlbFile(resourceDir + "/models/goatWithTexture.glb"), "");
+  auto startTime = std::chrono::steady_clock::now();
+  SceneObject goat1("goat1", goat, 5);
+  auto midTime = std::chrono::steady_clock::now();
+  SceneObject goat2("goat2", goat, 5);
+  auto endTime = std::chrono::steady_clock::now();
 
-  modelFromGlb.saveBinary("testGoatWithTexture.bin");
-  Model modelFromBin(BinaryFile("testGoatWithTexture.bin"), "");
+  LOGINFO("Bounding boxes for the first goat: " +
+    std::to_string(std::chrono::duration<double, std::micro>(midTime - startTime).count()) +
+    " microseconds, the second goat: " +
+    std::to_string(std::chrono::duration<double, std::micro>(endTime - midTime).count()) +
+    " microseconds (" + std::to_string(std::as_const(goat1).getBoundingBoxSetExtremes().size()) + " boxes)");
 
-  r->generateTexture(textureName, *modelFromBin.defaultTextureImage);
-  double startSeconds = getTimeInSeconds();
-  double seconds = getTimeInSeconds();
-  double prevSeconds = seconds;
-  const uint32_t framerate = 30;
+  if (&std::as_const(goat1).getBoundingBoxSetExtremes() != &std::as_const(goat2).getBoundingBoxSetExtremes()) {
+    LOGINFO("The bounding boxes of the second goat have not been taken from the cache.");
+    return 0;
+  }
 
-  constexpr double secondsInterval = 1.0 / framerate;
+  SceneObject goat3("goat3", goat, 4);
+  if (&std::as_const(goat1).getBoundingBoxSetExtremes() == &std::as_const(goat3).getBoundingBoxSetExtremes()) {
+    LOGINFO("The same bounding boxes have been used for different subdivisions.");
+    return 0;
+  }
 
-  SceneObject so("goat", modelFromBin);
+  // Every box must contain a vertex and every vertex must be in a box
+  const auto& extremes = std::as_const(goat1).getBoundingBoxSetExtremes();
+  std::vector<bool> boxUsed(extremes.size(), false);
+  Vec3 scale = goat.getOriginalScale();
+  for (size_t idx = 0; idx < goat.vertexData.size(); idx += 4) {
+    float x = goat.vertexData[idx] * scale.x;
+    float y = goat.vertexData[idx + 1] * scale.y;
+    float z = goat.vertexData[idx + 2] * scale.z;
+    bool inBox = false;
+    for (size_t boxIdx = 0; boxIdx < extremes.size(); ++boxIdx) {
+      const auto& ex = extremes[boxIdx];
+      if (x >= ex.minX && x <= ex.maxX && y >= ex.minY && y <= ex.maxY &&
+        z >= ex.minZ && z <= ex.maxZ) {
+        boxUsed[boxIdx] = true;
+        inBox = true;
+      }
+    }
+    if (!inBox) {
+      LOGINFO("A vertex is not in any box.");
+      return 0;
+    }
+  }
+  if (std::find(boxUsed.begin(), boxUsed.end(), false) != boxUsed.end()) {
+    LOGINFO("A box does not contain any vertex.");
+    return 0;
+  }
 
-  so.position = Vec3(0.0f, 1.0f, -6.0f);
-  so.startAnimating();
+  // Modifying the boxes of an object does not modify the boxes of the
+  // other objects, or the ones in the cache
+  float originalMinX = extremes[0].minX;
+  goat2.getBoundingBoxSetExtremes()[0].minX -= 1.0f;
+  SceneObject goat5("goat5", goat, 5);
+  if (extremes[0].minX != originalMinX ||
+    &std::as_const(goat5).getBoundingBoxSetExtremes() != &extremes ||
+    std::as_const(goat2).getBoundingBoxSetExtremes()[0].minX != originalMinX - 1.0f) {
+    LOGINFO("Modifying the boxes of an object has affected other objects.");
+    return 0;
+  }
 
-  Vec3 rotation(0.0f, 0.0f, 0.0f);
-  while (seconds - startSeconds < 5.0) {
-    pollEvents();
-    seconds = getTimeInSeconds();
-    if (seconds - prevSeconds > secondsInterval) {
-      prevSeconds = seconds;
+  // Copies of a model share its boxes, until their data is changed
+  Model changedGoat = goat;
+  SceneObject goat6("goat6", changedGoat, 5);
+  if (&std::as_const(goat6).getBoundingBoxSetExtremes() != &extremes) {
+    LOGINFO("The bounding boxes of a copied model have not been taken from the cache.");
+    return 0;
+  }
+  changedGoat.vertexData[0] += 100.0f;
+  changedGoat.markDataChanged();
+  SceneObject goat7("goat7", changedGoat, 5);
+  SceneObject goat7Again("goat7Again", changedGoat, 5);
+  if (&std::as_const(goat7).getBoundingBoxSetExtremes() == &extremes ||
+    &std::as_const(goat7).getBoundingBoxSetExtremes() != &std::as_const(goat7Again).getBoundingBoxSetExtremes()) {
+    LOGINFO("The bounding boxes of changed vertex data have not been taken from the cache.");
+    return 0;
+  }
 
-      so.rotate(Vec3(0.0f, 0.1f, 0.0f));
-      so.animate();
-      r->render(so, textureName);
-      r->swapBuffers();
+  // The cache does not keep box sets that no object uses any more
+  size_t cacheSize = BoundingBoxSet::getCacheSize();
+  {
+    SceneObject temporaryGoat("temporaryGoat", goat, 2);
+    if (BoundingBoxSet::getCacheSize() != cacheSize + 1) {
+      LOGINFO("The bounding boxes have not been added to the cache.");
+      return 0;
     }
   }
+  if (BoundingBoxSet::getCacheSize() != cacheSize) {
+    LOGINFO("Unused bounding boxes have been kept in the cache.");
+    return 0;
+  }
+  SceneObject goat8("goat8", goat, 5);
+  if (&std::as_const(goat8).getBoundingBoxSetExtremes() != &extremes) {
+    LOGINFO("Bounding boxes in use have been removed from the cache.");
+    return 0;
+  }
 
-  return 1;
-}
-
-int SoundTest() {
-  Sound snd(resourceDir + "/sounds/bah.ogg");
-  snd.play();
-  double startSeconds = getTimeInSeconds();
-  while (getTimeInSeconds() - startSeconds < 0.5);
-  snd.stop();
+  // A single box is not cached
+  SceneObject goat9("goat9", goat, 0);
+  SceneObject goat10("goat10", goat, 0);
+  if (BoundingBoxSet::getCacheSize() != cacheSize ||
+    &std::as_const(goat9).getBoundingBoxSetExtremes() == &std::as_const(goat10).getBoundingBoxSetExtremes()) {
+    LOGINFO("A single bounding box has been cached.");
+    return 0;
+  }
 
-  snd.divideVolume(4);
-  snd.play();
-  startSeconds = getTimeInSeconds();
-  while (getTimeInSeconds() - startSeconds < 0.5);
-  snd.stop();
+  // The bounding boxes saved with a model are used when it is loaded.
+  // The cached ones are changed before saving, to tell them apart from
+  // bounding boxes created after loading.
+  auto cachedBoxes = BoundingBoxSet::getCached(goat, 5);
+  float changedMinX = originalMinX - 1.0f;
+  cachedBoxes->boxExtremes[0].minX = changedMinX;
+  goat.saveBinary("testGoatWithBoxes.bin", { 5 });
+  cachedBoxes->boxExtremes[0].minX = originalMinX;
+
+  BoundingBoxSet::clearCache();
+  Model goatFromBin(BinaryFile("testGoatWithBoxes.bin"), "");
+  SceneObject goat4("goat4", goatFromBin, 5);
+
+  if (std::as_const(goat4).getBoundingBoxSetExtremes().size() != extremes.size() ||
+    std::as_const(goat4).getBoundingBoxSetExtremes()[0].minX != changedMinX) {
+    LOGINFO("The bounding boxes saved with the model have not been used.");
+    return 0;
+  }
 
-  startSeconds = getTimeInSeconds();
-  while (getTimeInSeconds() - startSeconds < 0.5);
-  snd.play();
-  // Make sure the sound is stopped by the stop function and not the destructor.
-  startSeconds = getTimeInSeconds();
-  while (getTimeInSeconds() - startSeconds < 2.0);
+  BoundingBoxSet::clearCache();
   return 1;
 }
 
-int BinSoundTest() {
+int CollisionWorldTest() {
 
-  Sound srcsnd(resourceDir + "/sounds/bah.ogg");
-  
-  srcsnd.saveBinary("testBah.bin");
-  Sound snd("testBah.bin");
+  SceneObject cube("cube", Model(WavefrontFile(resourceDir + "/models/Cube/CubeNoTexture.obj")));
 
-  snd.play();
-  double startSeconds = getTimeInSeconds();
-  while (getTimeInSeconds() - startSeconds < 0.2);
-  snd.stop();
+  std::mt19937 generator(12345);
+  std::uniform_real_distribution<float> angle(-3.14f, 3.14f);
+  std::uniform_real_distribution<float> step(-0.2f, 0.2f);
 
-  return 1;
-}
+  // The collisions found must be the same as the ones found
+  // by testing every pair of objects.
+  std::uniform_real_distribution<float> place(-12.0f, 12.0f);
+  std::vector<SceneObject> objects(600, cube);
+  std::vector<uint32_t> ids;
+  CollisionWorld world;
 
-int SoundTest2() {
-  Sound snd1(resourceDir + "/sounds/bah.ogg");
-  Sound snd2(snd1);
-  Sound snd3 = snd2;
-  snd1.play();
-  double startSeconds = getTimeInSeconds();
-  while (getTimeInSeconds() - startSeconds < 0.3);
-  snd2.play();
-  startSeconds = getTimeInSeconds();
-  while (getTimeInSeconds() - startSeconds < 0.3);
-  snd3.play();
-  startSeconds = getTimeInSeconds();
-  while (getTimeInSeconds() - startSeconds < 1.0);
-  return 1;
-}
+  for (auto& object : objects) {
+    object.position = Vec3(place(generator), place(generator), place(generator));
+    object.setRotation(Vec3(angle(generator), angle(generator), angle(generator)));
+    ids.push_back(world.add(object));
+  }
 
-int SoundTest3() {
-  Sound snd(resourceDir + "/sounds/bah.ogg");
-  snd.play(true);
-  double startSeconds = getTimeInSeconds();
+  for (int frame = 0; frame < 5; ++frame) {
+    for (auto& object : objects) {
+      object.position += Vec3(step(generator), step(generator), step(generator));
+      object.rotate(Vec3(step(generator), step(generator), 0.0f));
+    }
+
+    if (frame == 2) {
+      for (size_t idx = 0; idx < objects.size(); idx += 3) {
+        world.remove(ids[idx]);
+      }
+      for (size_t idx = 0; idx < objects.size(); idx += 3) {
+        ids[idx] = world.add(objects[idx]);
+      }
+    }
+
+    if (frame == 3) {
+      world.rebuild();
+    }
+
+    auto& collisions = world.findCollisions();
+
+    std::set<std::pair<SceneObject*, SceneObject*>> found;
+    for (const auto& pair : collisions) {
+      found.insert(std::minmax(pair.first, pair.second));
+    }
+
+    if (found.size() != collisions.size()) {
+      LOGINFO("The same collision has been reported more than once.");
+      return 0;
+    }
+
+    size_t numCollisions = 0;
+    for (size_t idx1 = 0; idx1 < objects.size(); ++idx1) {
+      for (size_t idx2 = idx1 + 1; idx2 < objects.size(); ++idx2) {
+        if (objects[idx1].intersects(objects[idx2])) {
+          ++numCollisions;
+          if (found.find(std::minmax(&objects[idx1], &objects[idx2])) == found.end()) {
+            LOGINFO("A collision has been missed by the collision world.");
+            return 0;
+          }
+        }
+      }
+    }
+
+    if (numCollisions != found.size()) {
+      LOGINFO("The collision world has reported collisions that do not exist.");
+      return 0;
+    }
+
+    LOGINFO("Frame " + std::to_string(frame) + ": " + std::to_string(numCollisions) +
+      " collisions");
+  }
+
+  // Broad phase time for a larger number of moving objects
+  std::uniform_real_distribution<float> widePlace(-50.0f, 50.0f);
+  std::vector<SceneObject> manyObjects(5000, cube);
+  CollisionWorld largeWorld;
+
+  for (auto& object : manyObjects) {
+    object.position = Vec3(widePlace(generator), widePlace(generator), widePlace(generator));
+    object.setRotation(Vec3(angle(generator), angle(generator), angle(generator)));
+    largeWorld.add(object);
+  }
+  largeWorld.rebuild();
+
+  const int numFrames = 30;
+  double totalMicroseconds = 0.0;
+  size_t numCandidatePairs = 0;
+  for (int frame = 0; frame < numFrames; ++frame) {
+    for (auto& object : manyObjects) {
+      object.position += Vec3(step(generator), step(generator), step(generator));
+    }
+    auto startTime = std::chrono::steady_clock::now();
+    numCandidatePairs = largeWorld.findCandidatePairs().size();
+    totalMicroseconds += std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - startTime).count();
+  }
+
+  LOGINFO("Broad phase for " + std::to_string(manyObjects.size()) + " moving objects: " +
+    std::to_string(totalMicroseconds / numFrames) + " microseconds per frame, " +
+    std::to_string(numCandidatePairs) + " candidate pairs, tree height " +
+    std::to_string(largeWorld.getTreeHeight()));
+
+  return 1;
+}
+
+int RaycastTest() {
+
+  Model cubeModel(WavefrontFile(resourceDir + "/models/Cube/CubeNoTexture.obj"));
+  BoundingBoxSet cube(cubeModel.vertexData, Vec3(1.0f), 0);
+  float distance = 0.0f;
+
+  if (!cube.raycast(Vec3(-5.0f, 0.0f, 0.0f), Vec3(2.0f, 0.0f, 0.0f), 10.0f,
+    Vec3(0.0f), Mat4(1.0f), distance) || std::abs(distance - 4.0f) > 0.0001f) {
+    LOGINFO("The ray has not hit the cube at the right distance.");
+    return 0;
+  }
+
+  Mat4 rotation = rotate(Mat4(1.0f), 0.7854f, Vec3(0.0f, 1.0f, 0.0f));
+  if (!cube.raycast(Vec3(-5.0f, 0.0f, 0.0f), Vec3(1.0f, 0.0f, 0.0f), 10.0f,
+    Vec3(0.0f), rotation, distance) || std::abs(distance - (5.0f - std::sqrt(2.0f))) > 0.0001f) {
+    LOGINFO("The ray has not hit the rotated cube at the right distance.");
+    return 0;
+  }
+
+  if (cube.raycast(Vec3(-5.0f, 3.0f, 0.0f), Vec3(1.0f, 0.0f, 0.0f), 10.0f, Vec3(0.0f), Mat4(1.0f), distance) ||
+    cube.raycast(Vec3(-5.0f, 0.0f, 0.0f), Vec3(1.0f, 0.0f, 0.0f), 3.0f, Vec3(0.0f), Mat4(1.0f), distance) ||
+    cube.raycast(Vec3(-5.0f, 0.0f, 0.0f), Vec3(-1.0f, 0.0f, 0.0f), 10.0f, Vec3(0.0f), Mat4(1.0f), distance)) {
+    LOGINFO("A ray that should have missed the cube has hit it.");
+    return 0;
+  }
+
+  if (!cube.raycast(Vec3(0.5f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f), 10.0f,
+    Vec3(0.0f), Mat4(1.0f), distance) || distance != 0.0f) {
+    LOGINFO("A ray starting inside the cube has not hit it at its origin.");
+    return 0;
+  }
+
+  // The closest hits in a world full of objects must be the ones found
+  // by casting each ray against every object.
+  SceneObject cubeObject("cube", cubeModel);
+  std::mt19937 generator(13579);
+  std::uniform_real_distribution<float> place(-12.0f, 12.0f);
+  std::uniform_real_distribution<float> angle(-3.14f, 3.14f);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+  std::vector<SceneObject> objects(600, cubeObject);
+  CollisionWorld world;
+  for (auto& object : objects) {
+    object.position = Vec3(place(generator), place(generator), place(generator));
+    object.setRotation(Vec3(angle(generator), angle(generator), angle(generator)));
+    world.add(object);
+  }
+  world.rebuild();
+
+  std::vector<CollisionWorld::Ray> rays(5000);
+  for (auto& ray : rays) {
+    ray.origin = Vec3(place(generator), place(generator), place(generator));
+    ray.direction = Vec3(unit(generator), unit(generator), unit(generator));
+    ray.maxDistance = 30.0f;
+  }
+
+  std::vector<CollisionWorld::RaycastHit> hits;
+  auto startTime = std::chrono::steady_clock::now();
+  world.raycast(rays, hits);
+  double worldMicroseconds = std::chrono::duration<double, std::micro>(
+    std::chrono::steady_clock::now() - startTime).count();
+
+  size_t numHits = 0;
+  startTime = std::chrono::steady_clock::now();
+  for (size_t idx = 0; idx < rays.size(); ++idx) {
+    SceneObject* closestObject = nullptr;
+    float closest = rays[idx].maxDistance;
+    for (auto& object : objects) {
+      if (object.raycast(rays[idx].origin, rays[idx].direction, closest, distance)) {
+        closest = distance;
+        closestObject = &object;
+      }
+    }
+
+    if ((closestObject == nullptr) != (hits[idx].object == nullptr) ||
+      (closestObject != nullptr && std::abs(closest - hits[idx].distance) > 0.0001f)) {
+      LOGINFO("The closest hit of a ray has not been found.");
+      return 0;
+    }
+    if (closestObject != nullptr) ++numHits;
+  }
+  double bruteForceMicroseconds = std::chrono::duration<double, std::micro>(
+    std::chrono::steady_clock::now() - startTime).count();
+
+  auto hit = world.raycast(rays[0].origin, rays[0].direction, rays[0].maxDistance);
+  if (hit.object != hits[0].object || hit.distance != hits[0].distance) {
+    LOGINFO("Casting a single ray has not given the same result as casting it with others.");
+    return 0;
+  }
+
+  LOGINFO(std::to_string(numHits) + " of " + std::to_string(rays.size()) + " rays hit an object. " +
+    std::to_string(worldMicroseconds / rays.size()) + " microseconds per ray (" +
+    std::to_string(bruteForceMicroseconds / rays.size()) + " checking every object)");
+
+  return 1;
+}
+
+int SweptCollisionTest() {
+
+  Model cubeModel(WavefrontFile(resourceDir + "/models/Cube/CubeNoTexture.obj"));
+  BoundingBoxSet cube(cubeModel.vertexData, Vec3(1.0f), 0);
+  float timeOfImpact = 0.0f;
+
+  // A cube moving so fast that it is past the other one after a single
+  // step. Checking where it starts and ends does not find the collision.
+  Vec3 start(-10.0f, 0.0f, 0.0f);
+  Vec3 end(10.0f, 0.0f, 0.0f);
+  if (cube.intersects(cube, Vec3(0.0f), Mat4(1.0f), start, Mat4(1.0f)) ||
+    cube.intersects(cube, Vec3(0.0f), Mat4(1.0f), end, Mat4(1.0f))) {
+    LOGINFO("The cubes should not be intersecting where the motion starts and ends.");
+    return 0;
+  }
+
+  if (!cube.sweep(cube, Vec3(0.0f), Mat4(1.0f), start, end, Mat4(1.0f), timeOfImpact) ||
+    std::abs(timeOfImpact - 0.4f) > 0.0001f) {
+    LOGINFO("The moving cube has not touched the other one at the right time.");
+    return 0;
+  }
+
+  Mat4 rotation = rotate(Mat4(1.0f), 0.7854f, Vec3(0.0f, 1.0f, 0.0f));
+  if (!cube.sweep(cube, Vec3(0.0f), rotation, start, end, Mat4(1.0f), timeOfImpact) ||
+    std::abs(timeOfImpact - (9.0f - std::sqrt(2.0f)) / 20.0f) > 0.0001f) {
+    LOGINFO("The moving cube has not touched the rotated one at the right time.");
+    return 0;
+  }
+
+  if (cube.sweep(cube, Vec3(0.0f), Mat4(1.0f), Vec3(-10.0f, 2.5f, 0.0f), Vec3(10.0f, 2.5f, 0.0f),
+    Mat4(1.0f), timeOfImpact) ||
+    cube.sweep(cube, Vec3(0.0f), Mat4(1.0f), start, Vec3(-4.0f, 0.0f, 0.0f), Mat4(1.0f), timeOfImpact)) {
+    LOGINFO("A moving cube that should have missed the other one has touched it.");
+    return 0;
+  }
+
+  if (!cube.sweep(cube, Vec3(0.0f), Mat4(1.0f), Vec3(1.5f, 0.0f, 0.0f), Vec3(20.0f, 0.0f, 0.0f),
+    Mat4(1.0f), timeOfImpact) || timeOfImpact != 0.0f) {
+    LOGINFO("Cubes intersecting where the motion starts have not touched at its start.");
+    return 0;
+  }
+
+  // Projectiles flying through a world of obstacles. The collisions found
+  // by the world must be the ones found by sweeping each projectile against
+  // every obstacle. The projectiles move together, so they never touch
+  // each other.
+  SceneObject cubeObject("cube", cubeModel);
+  std::mt19937 generator(24680);
+  std::uniform_real_distribution<float> place(-30.0f, 30.0f);
+  std::uniform_real_distribution<float> angle(-3.14f, 3.14f);
+
+  std::vector<SceneObject> obstacles(60, cubeObject);
+  std::vector<SceneObject> projectiles;
+  CollisionWorld world;
+
+  for (auto& obstacle : obstacles) {
+    obstacle.position = Vec3(place(generator), place(generator), place(generator));
+    obstacle.setRotation(Vec3(angle(generator), angle(generator), angle(generator)));
+  }
+
+  for (int y = -40; y <= 40; y += 4) {
+    for (int z = -40; z <= 40; z += 4) {
+      projectiles.push_back(cubeObject);
+      projectiles.back().position = Vec3(-40.0f, static_cast<float>(y), static_cast<float>(z));
+      projectiles.back().setRotation(Vec3(0.3f, 0.2f, 0.1f));
+    }
+  }
+
+  std::set<SceneObject*> obstacleSet;
+  for (auto& obstacle : obstacles) {
+    world.add(obstacle);
+    obstacleSet.insert(&obstacle);
+  }
+  for (auto& projectile : projectiles) {
+    world.add(projectile);
+  }
+  world.rebuild();
+
+  double worldMicroseconds = 0.0;
+  double bruteForceMicroseconds = 0.0;
+  size_t numCollisions = 0;
+  const int numSteps = 10;
+
+  for (int step = 0; step < numSteps; ++step) {
+    std::vector<Vec3> previousPositions;
+    for (auto& projectile : projectiles) {
+      previousPositions.push_back(projectile.position);
+      projectile.position.x += 8.0f;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    auto& collisions = world.findSweptCollisions();
+    worldMicroseconds += std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - startTime).count();
+
+    std::vector<std::pair<SceneObject*, float>> found;
+    for (auto& collision : collisions) {
+      bool firstIsObstacle = obstacleSet.count(collision.first) > 0;
+      bool secondIsObstacle = obstacleSet.count(collision.second) > 0;
+      if (firstIsObstacle && secondIsObstacle) continue;
+      if (!firstIsObstacle && !secondIsObstacle) {
+        LOGINFO("Projectiles moving together have been found to touch each other.");
+        return 0;
+      }
+      found.emplace_back(firstIsObstacle ? collision.second : collision.first, collision.timeOfImpact);
+    }
+
+    size_t numExpected = 0;
+    startTime = std::chrono::steady_clock::now();
+    for (size_t idx = 0; idx < projectiles.size(); ++idx) {
+      for (auto& obstacle : obstacles) {
+        if (projectiles[idx].sweep(previousPositions[idx], obstacle, timeOfImpact)) {
+          ++numExpected;
+          bool matched = false;
+          for (auto& collision : found) {
+            if (collision.first == &projectiles[idx] &&
+              std::abs(collision.second - timeOfImpact) < 0.0001f) {
+              matched = true;
+              break;
+            }
+          }
+          if (!matched) {
+            LOGINFO("A projectile touching an obstacle has not been found by the world.");
+            return 0;
+          }
+        }
+      }
+    }
+    bruteForceMicroseconds += std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - startTime).count();
+
+    if (numExpected != found.size()) {
+      LOGINFO("The world has found collisions that sweeping every pair has not.");
+      return 0;
+    }
+    numCollisions += numExpected;
+  }
+
+  if (numCollisions == 0) {
+    LOGINFO("No projectile has hit an obstacle.");
+    return 0;
+  }
+
+  LOGINFO(std::to_string(numCollisions) + " projectile hits. " +
+    std::to_string(worldMicroseconds / numSteps) + " microseconds per step for " +
+    std::to_string(projectiles.size()) + " projectiles (" +
+    std::to_string(bruteForceMicroseconds / numSteps) + " checking every obstacle)");
+
+  return 1;
+}
+
+int RendererTest() {
+  initRenderer();
+
+  r->setCameraRotation(Vec3(0.4f, 0.1f, 0.1f));
+
+  // Here loading the mesh without providing a name is also tested.
+  Model modelFromGlb(GlbFile(resourceDir + "/models/goatUnscaled.glb"), "");
+
+  SceneObject object("cube", Model(WavefrontFile(resourceDir + "/models/Cube/CubeNoTexture.obj")));
+  object.position = Vec3(0.0f, -1.0f, -8.0f);
+  r->render(object, Vec4(1.0f, 1.0f, 1.0f, 1.0f));
+
+  SceneObject object2("texutredCube", Model(WavefrontFile(resourceDir + "/models/Cube/Cube.obj")));
+  object2.position = Vec3(-2.0f, -1.0f, -7.0f);
+  object2.setRotation(Vec3(0.3f, 1.3f, 0.0f));
+
+  Image cubeTexture(resourceDir + "/models/Cube/cubeTexture.png");
+  r->generateTexture("cubeTexture", cubeTexture);
+
+  Model singleColourRect;
+  r->createRectangle(singleColourRect, Vec3(-1.0f, 0.0f, 0.0f),
+    Vec3(-0.5f, -0.5f, 0.0f));
+
+  Model texturedRect;
+
+  r->createRectangle(texturedRect, Vec3(0.0f, 0.5f, 0.0f),
+    Vec3(1.0f, -1.0f, 0.0f));
+
+  r->generateTexture("small3dTexture", "small3d :)",
+    Vec3(0.0f, 1.0f, 0.0f));
+
+  Model textRect;
+
+  r->createRectangle(textRect, Vec3(-1.0f, 0.0f, 0.0f), Vec3(0.5f, -0.5f, 0.0f));
+
+  double startSeconds = getTimeInSeconds();
+  double seconds = getTimeInSeconds();
+  double prevSeconds = seconds;
+  const uint32_t framerate = 30;
+
+  constexpr double secondsInterval = 1.0 / framerate;
+
+  Vec3 rotation(0.0f, 0.0f, 0.0f);
+
+  std::vector<std::shared_ptr<Model>> bugwfanim;
+
+  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000001.obj")));
+  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000002.obj")));
+  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000003.obj")));
+  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000004.obj")));
+  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000005.obj")));
+  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000006.obj")));
+  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000007.obj")));
+  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000008.obj")));
+  bugwfanim.push_back(std::make_shared<Model>(WavefrontFile(resourceDir + "/models/Bug/bugAnim_000009.obj")));
+
+  SceneObject bug("bug", bugwfanim);
+
+  bug.position = Vec3(0.0f, 3.0f, -6.0f);
+  bug.startAnimating();
+
+  while (seconds - startSeconds < 5.0) {
+    pollEvents();
+    seconds = getTimeInSeconds();
+    if (seconds - prevSeconds > secondsInterval) {
+      prevSeconds = seconds;
+
+      r->render(singleColourRect,
+        Vec3(0.0f, 0.0f, 0.0f),
+        Vec3(0.0f, 0.0f, 0.0f), Vec4(0.0f, 0.0f, 1.0f, 1.0f), "", 0, false);
+
+      r->render(texturedRect,
+        Vec3(0.0f, 0.0f, -2.0f),
+        Vec3(0.0f, 0.0f, 0.0f), Vec4(0.0f, 0.0f, 0.0f, 0.0f), "cubeTexture", true);
+
+      r->render(object2, "cubeTexture");
+
+
+      rotation.y += 0.1f;
+
+      r->render(modelFromGlb, Vec3(0.0f, 1.0f, -6.0f),
+        rotation, Vec4(0.3f, 1.0f, 1.0f, 1.0f));
+
+
+      r->render(textRect, Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 0.0f, 0.0f),
+        Vec4(0.0f, 0.0f, 0.0f, 0.0f), "small3dTexture", 0, false);
+
+      r->render(bug, Vec4(1.0f, 0.0f, 0.0f, 1.0f));
+
+      bug.animate();
+
+      r->swapBuffers();
+
+    }
+  }
+  r->clearBuffers(object);
+  r->clearBuffers(object2);
+  r->clearBuffers(texturedRect);
+  r->clearBuffers(textRect);
+  r->deleteTexture("cubeTexture");
+
+  return 1;
+}
+
+int InstancingTest() {
+  initRenderer();
+
+  r->setCameraRotation(Vec3(0.4f, 0.0f, 0.0f));
+
+  Model goat(GlbFile(resourceDir + "/models/goatUnscaled.glb"), "");
+
+  double startSeconds = getTimeInSeconds();
+  double seconds = getTimeInSeconds();
+  double prevSeconds = seconds;
+  const uint32_t framerate = 30;
+
+  constexpr double secondsInterval = 1.0 / framerate;
+
+  float rotationY = 0.0f;
+
+  while (seconds - startSeconds < 5.0) {
+    pollEvents();
+    seconds = getTimeInSeconds();
+    if (seconds - prevSeconds > secondsInterval) {
+      prevSeconds = seconds;
+
+      // A crowd of 100 goats, drawn with a single instanced draw call
+      for (int row = 0; row < 10; ++row) {
+        for (int col = 0; col < 10; ++col) {
+          r->render(goat, Vec3(-9.0f + 2.0f * col, -2.0f, -6.0f - 2.0f * row),
+            Vec3(0.0f, rotationY + 0.3f * col, 0.0f),
+            Vec4(0.1f * col, 1.0f - 0.1f * row, 0.5f, 1.0f));
+        }
+      }
+
+      write("100 goats", 0.0f);
+
+      r->swapBuffers();
+      rotationY += 0.05f;
+    }
+  }
+
+  r->setCameraRotation(Vec3(0.0f, 0.0f, 0.0f));
+
+  return 1;
+}
+
+int ModelResidencyTest() {
+  initRenderer();
+
+  Model cube(WavefrontFile(resourceDir + "/models/Cube/Cube.obj"));
+
+  if (cube.isInGPU()) {
+    LOGINFO("A model that has not been rendered is reported to be in the GPU.");
+    return 0;
+  }
+
+  r->render(cube, Vec3(0.0f, -1.0f, -3.0f), Vec3(0.0f, 0.0f, 0.0f), Vec4(0.0f, 1.0f, 0.0f, 1.0f));
+  r->swapBuffers();
+
+  if (!cube.isInGPU()) {
+    LOGINFO("A rendered model is not reported to be in the GPU.");
+    return 0;
+  }
+
+  // Once modified, the data needs to be sent to the GPU again
+  for (size_t idx = 0; idx < cube.vertexData.size(); idx += 4) {
+    cube.vertexData[idx] *= 0.5f;
+  }
+  cube.markDataChanged();
+
+  if (cube.isInGPU()) {
+    LOGINFO("A model marked as changed is still reported to be in the GPU.");
+    return 0;
+  }
+
+  r->render(cube, Vec3(0.0f, -1.0f, -3.0f), Vec3(0.0f, 0.0f, 0.0f), Vec4(0.0f, 1.0f, 0.0f, 1.0f));
+  r->swapBuffers();
+
+  if (!cube.isInGPU()) {
+    LOGINFO("A model marked as changed has not been sent to the GPU again when rendered.");
+    return 0;
+  }
+
+  r->clearBuffers(cube);
+
+  if (cube.isInGPU()) {
+    LOGINFO("A model whose buffers have been cleared is still reported to be in the GPU.");
+    return 0;
+  }
+
+  return 1;
+}
+
+int BinaryModelTest() {
+
+  initRenderer();
+
+  r->setCameraRotation(Vec3(0.4f, 0.1f, 0.1f));
+  const std::string textureName = "goatbintexture";
+
+  Model modelFromGlb(GlbFile(resourceDir + "/models/goatWithTexture.glb"), "");
+
+  modelFromGlb.saveBinary("testGoatWithTexture.bin");
+  Model modelFromBin(BinaryFile("testGoatWithTexture.bin"), "");
+
+  r->generateTexture(textureName, *modelFromBin.defaultTextureImage);
+  double startSeconds = getTimeInSeconds();
+  double seconds = getTimeInSeconds();
+  double prevSeconds = seconds;
+  const uint32_t framerate = 30;
+
+  constexpr double secondsInterval = 1.0 / framerate;
+
+  SceneObject so("goat", modelFromBin);
+
+  so.position = Vec3(0.0f, 1.0f, -6.0f);
+  so.startAnimating();
+
+  Vec3 rotation(0.0f, 0.0f, 0.0f);
+  while (seconds - startSeconds < 5.0) {
+    pollEvents();
+    seconds = getTimeInSeconds();
+    if (seconds - prevSeconds > secondsInterval) {
+      prevSeconds = seconds;
+
+      so.rotate(Vec3(0.0f, 0.1f, 0.0f));
+      so.animate();
+      r->render(so, textureName);
+      r->swapBuffers();
+    }
+  }
+
+  return 1;
+}
+
+int BinaryFormatTest() {
+
+  Model modelFromGlb(GlbFile(resourceDir + "/models/goatWithTexture.glb"), "");
+
+  modelFromGlb.saveBinary("testGoatCompressed.bin");
+  modelFromGlb.saveBinary("testGoatMapped.bin", std::vector<uint32_t>(), Model::BinaryFormat::mapped);
+
+  Model compressed(BinaryFile("testGoatCompressed.bin"), "");
+  Model mapped(BinaryFile("testGoatMapped.bin"), "");
+
+  std::remove("testGoatCompressed.bin");
+
+  if (mapped.vertexData != compressed.vertexData || mapped.indexData != compressed.indexData ||
+    mapped.indexData32 != compressed.indexData32 || mapped.normalsData != compressed.normalsData ||
+    mapped.textureCoordsData != compressed.textureCoordsData || mapped.jointData != compressed.jointData ||
+    mapped.weightData != compressed.weightData || mapped.packedVertexData != compressed.packedVertexData ||
+    mapped.getPackedVertexStride() != compressed.getPackedVertexStride() ||
+    mapped.vertexDataByteSize != compressed.vertexDataByteSize ||
+    mapped.indexDataByteSize != compressed.indexDataByteSize) {
+    LOGINFO("The vertex data of the mapped binary model do not match the compressed one.");
+    std::remove("testGoatMapped.bin");
+    return 0;
+  }
+
+  if (mapped.joints.size() != compressed.joints.size() || mapped.joints.empty() ||
+    mapped.getNumAnimations() != compressed.getNumAnimations() ||
+    mapped.defaultTextureImage->getByteSize() != compressed.defaultTextureImage->getByteSize() ||
+    memcmp(mapped.defaultTextureImage->getData(), compressed.defaultTextureImage->getData(),
+      compressed.defaultTextureImage->getByteSize()) != 0) {
+    LOGINFO("The joints, animations or texture of the mapped binary model do not match the compressed one.");
+    std::remove("testGoatMapped.bin");
+    return 0;
+  }
+
+  for (size_t idx = 0; idx < mapped.joints.size(); ++idx) {
+    if (mapped.joints[idx].name != compressed.joints[idx].name) {
+      LOGINFO("Joint " + std::to_string(idx) + " of the mapped binary model has the wrong name.");
+      std::remove("testGoatMapped.bin");
+      return 0;
+    }
+  }
+
+  auto mappedPalette = mapped.getJointPalette(0, 5);
+  auto compressedPalette = compressed.getJointPalette(0, 5);
+  if (memcmp(mappedPalette, compressedPalette, Model::MAX_JOINTS_SUPPORTED * sizeof(Mat4)) != 0) {
+    LOGINFO("The joint palette of the mapped binary model does not match the compressed one.");
+    std::remove("testGoatMapped.bin");
+    return 0;
+  }
+
+  // Damaged headers and truncated files are detected
+  std::vector<char> contents;
+  {
+    std::ifstream file("testGoatMapped.bin", std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  std::remove("testGoatMapped.bin");
+
+  std::vector<std::vector<char>> damagedFiles = { contents, contents,
+    std::vector<char>(contents.begin(), contents.end() - 100) };
+  damagedFiles[0][4] = 2; // Version
+  damagedFiles[1][40] ^= 1; // Section table
+
+  // Sections with sizes that do not match the data they are supposed to
+  // contain, with the checksum of the header and section table updated,
+  // so that only the sizes are wrong. Each section takes 24 bytes in the
+  // table, after the 32 byte header, starting with its type (2 for the
+  // vertices) and ending with its size.
+  auto crc32 = [](const std::vector<char>& data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t idx = 0; idx < size; ++idx) {
+      crc ^= static_cast<uint8_t>(data[idx]);
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+      }
+    }
+    return ~crc;
+  };
+  uint32_t numSections = 0;
+  memcpy(&numSections, contents.data() + 12, sizeof(uint32_t));
+  size_t tableEnd = 32 + numSections * 24;
+  for (uint64_t sizeReduction : { 2, 4 }) {
+    auto damaged = contents;
+    for (size_t entry = 32; entry < tableEnd; entry += 24) {
+      uint32_t type = 0;
+      memcpy(&type, damaged.data() + entry, sizeof(uint32_t));
+      if (type == 2) {
+        uint64_t size = 0;
+        memcpy(&size, damaged.data() + entry + 16, sizeof(uint64_t));
+        size -= sizeReduction;
+        memcpy(damaged.data() + entry + 16, &size, sizeof(uint64_t));
+      }
+    }
+    memset(damaged.data() + 24, 0, sizeof(uint32_t));
+    uint32_t checksum = crc32(damaged, tableEnd);
+    memcpy(damaged.data() + 24, &checksum, sizeof(uint32_t));
+    damagedFiles.push_back(damaged);
+  }
+
+  for (auto& damaged : damagedFiles) {
+    {
+      std::ofstream file("testGoatDamaged.bin", std::ios::binary);
+      file.write(damaged.data(), damaged.size());
+    }
+    bool thrown = false;
+    try {
+      Model damagedModel(BinaryFile("testGoatDamaged.bin"), "");
+    }
+    catch (const std::runtime_error&) {
+      thrown = true;
+    }
+    std::remove("testGoatDamaged.bin");
+    if (!thrown) {
+      LOGINFO("A damaged mapped binary model file has been loaded.");
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+int LegacyBinaryModelTest() {
+
+  // Saved from goat.glb by small3d before the format of the compressed
+  // binary files was versioned, on 64-bit Linux.
+  Model legacy(BinaryFile(resourceDir + "/models/goatLegacy.bin"), "");
+  Model modelFromGlb(GlbFile(resourceDir + "/models/goat.glb"), "");
+
+  if (legacy.vertexData != modelFromGlb.vertexData || legacy.indexData != modelFromGlb.indexData ||
+    !legacy.indexData32.empty() || legacy.normalsData != modelFromGlb.normalsData ||
+    legacy.textureCoordsData != modelFromGlb.textureCoordsData ||
+    legacy.jointData != modelFromGlb.jointData || legacy.weightData != modelFromGlb.weightData ||
+    legacy.packedVertexData != modelFromGlb.packedVertexData ||
+    legacy.indexDataByteSize != modelFromGlb.indexDataByteSize) {
+    LOGINFO("The data of the binary model saved before the format was versioned have not been read.");
+    return 0;
+  }
+
+  if (legacy.joints.size() != modelFromGlb.joints.size() || legacy.joints.empty() ||
+    legacy.getNumAnimations() != modelFromGlb.getNumAnimations()) {
+    LOGINFO("The joints and animations of the binary model saved before the format was versioned have not been read.");
+    return 0;
+  }
+
+  return 1;
+}
+
+int PackTest() {
+
+  // A directory with a model in each supported format, an image and a sound
+  std::filesystem::remove_all("testPackDir");
+  std::filesystem::create_directories("testPackDir/models");
+  std::filesystem::copy_file(resourceDir + "/models/goatAndTree.glb", "testPackDir/models/goatAndTree.glb");
+  std::filesystem::copy_file(resourceDir + "/images/testImage.png", "testPackDir/testImage.png");
+  std::filesystem::copy_file(resourceDir + "/sounds/bah.ogg", "testPackDir/bah.ogg");
+
+  Model goat(GlbFile(resourceDir + "/models/goatAndTree.glb"), "Cube");
+  goat.saveBinary("testPackDir/models/goat.bin");
+  goat.saveBinary("testPackDir/models/goatMapped.bin", std::vector<uint32_t>(), Model::BinaryFormat::mapped);
+
+  uint32_t numFiles = Pack::create("testPackDir", "testPack.pak");
+  std::filesystem::remove_all("testPackDir");
+
+  if (numFiles != 5) {
+    LOGINFO("Packed " + std::to_string(numFiles) + " files instead of 5.");
+    std::remove("testPack.pak");
+    return 0;
+  }
+
+  {
+    Pack pack("testPack.pak");
+
+    auto names = pack.getEntryNames();
+    for (auto& name : names) {
+      if (!pack.contains(name)) {
+        LOGINFO("Entry " + name + " has not been found in the pack.");
+        return 0;
+      }
+    }
+    if (names.size() != 5 || !pack.contains("models/goatAndTree.glb") || pack.contains("goatAndTree.glb")) {
+      LOGINFO("The pack does not contain the right entries.");
+      return 0;
+    }
+
+    Model packedGlb(PackFile(pack, "models/goatAndTree.glb"), "Cube");
+    Model packedBin(PackFile(pack, "models/goat.bin"), "");
+    Model packedMapped(PackFile(pack, "models/goatMapped.bin"), "");
+
+    for (auto model : { &packedGlb, &packedBin, &packedMapped }) {
+      if (model->vertexData != goat.vertexData || model->indexData != goat.indexData ||
+        model->normalsData != goat.normalsData || model->packedVertexData != goat.packedVertexData) {
+        LOGINFO("A model loaded from the pack does not match the original.");
+        return 0;
+      }
+    }
+
+    PackFile packedFile(pack, "models/goatAndTree.glb");
+    GlbFile glbFile(resourceDir + "/models/goatAndTree.glb");
+    auto meshNames = packedFile.getMeshNames();
+    if (meshNames.size() < 2 || meshNames != glbFile.getMeshNames()) {
+      LOGINFO("The meshes of a packed gltf file have not been found.");
+      return 0;
+    }
+
+    Image image(resourceDir + "/images/testImage.png");
+    Image packedImage(pack, "testImage.png");
+    if (packedImage.getWidth() != image.getWidth() || packedImage.getHeight() != image.getHeight() ||
+      packedImage.getByteSize() != image.getByteSize() ||
+      memcmp(packedImage.getData(), image.getData(), image.getByteSize()) != 0) {
+      LOGINFO("The image loaded from the pack does not match the original.");
+      return 0;
+    }
+
+    Sound packedSound(pack, "bah.ogg");
+
+    bool thrown = false;
+    try {
+      Model missing(PackFile(pack, "models/missing.glb"), "");
+    }
+    catch (const std::runtime_error&) {
+      thrown = true;
+    }
+    if (!thrown) {
+      LOGINFO("Loading a missing entry from the pack has not thrown.");
+      return 0;
+    }
+  }
+
+  // A damaged table of contents is detected
+  std::vector<char> contents;
+  {
+    std::ifstream file("testPack.pak", std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  contents[40] ^= 1;
+  {
+    std::ofstream file("testPack.pak", std::ios::binary);
+    file.write(contents.data(), contents.size());
+  }
+
+  bool thrown = false;
+  try {
+    Pack damaged("testPack.pak");
+  }
+  catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  std::remove("testPack.pak");
+  if (!thrown) {
+    LOGINFO("A damaged pack has been opened.");
+    return 0;
+  }
+
+  return 1;
+}
+
+int AssetManagerTest() {
+  initRenderer();
+
+  Model goat(GlbFile(resourceDir + "/models/goatAndTree.glb"), "Cube");
+  Model cube(WavefrontFile(resourceDir + "/models/Cube/Cube.obj"));
+  goat.saveBinary("testAssetGoat.bin", std::vector<uint32_t>(), Model::BinaryFormat::mapped);
+  Image cubeTexture(resourceDir + "/models/Cube/cubeTexture.png");
+
+  // The longest time taken by a frame in which a single model is sent to
+  // the GPU, to compare the frames rendered while loading with
+  double singleUploadFrameSeconds = 0;
+  for (int i = 0; i < 3; ++i) {
+    auto goatCopy = std::make_shared<Model>(goat);
+    r->queueUpload(goatCopy);
+    auto frameStart = std::chrono::steady_clock::now();
+    r->swapBuffers();
+    singleUploadFrameSeconds = std::max(singleUploadFrameSeconds,
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count());
+    if (!goatCopy->isInGPU()) {
+      LOGINFO("A queued model has not been sent to the GPU.");
+      std::remove("testAssetGoat.bin");
+      return 0;
+    }
+    r->clearBuffers(*goatCopy);
+  }
+
+  // Without any time budget, a single queued model is sent per frame
+  double uploadTimeBudget = r->uploadTimeBudget;
+  r->uploadTimeBudget = 0;
+  std::vector<std::shared_ptr<Model>> queuedGoats;
+  for (int i = 0; i < 8; ++i) {
+    queuedGoats.push_back(std::make_shared<Model>(goat));
+    r->queueUpload(queuedGoats.back());
+  }
+  for (size_t numQueued = queuedGoats.size(); numQueued > 0; --numQueued) {
+    if (r->getNumQueuedUploads() != numQueued) {
+      LOGINFO("More than one queued model has been sent to the GPU in a frame without a time budget.");
+      std::remove("testAssetGoat.bin");
+      return 0;
+    }
+    r->swapBuffers();
+  }
+  r->uploadTimeBudget = uploadTimeBudget;
+  for (auto& queuedGoat : queuedGoats) {
+    if (!queuedGoat->isInGPU()) {
+      LOGINFO("A queued model has not been sent to the GPU.");
+      std::remove("testAssetGoat.bin");
+      return 0;
+    }
+    r->clearBuffers(*queuedGoat);
+  }
+
+  std::vector<std::shared_future<std::shared_ptr<Model>>> models;
+  std::shared_future<std::shared_ptr<Image>> image;
+  std::shared_future<std::shared_ptr<Sound>> sound;
+  std::shared_future<std::shared_ptr<Model>> missing;
+
+  uint32_t numFrames = 0;
+  double maxFrameSeconds = 0;
+
+  {
+    AssetManager assetManager(r, 2);
+
+    for (int i = 0; i < 4; ++i) {
+      models.push_back(assetManager.loadModel(resourceDir + "/models/goatAndTree.glb", "Cube"));
+      models.push_back(assetManager.loadModel(resourceDir + "/models/Cube/Cube.obj"));
+      models.push_back(assetManager.loadModel("testAssetGoat.bin"));
+    }
+    image = assetManager.loadImage(resourceDir + "/models/Cube/cubeTexture.png", "assetManagerTexture");
+    sound = assetManager.loadSound(resourceDir + "/sounds/bah.ogg");
+    missing = assetManager.loadModel(resourceDir + "/models/missing.glb");
+
+    // Keep rendering frames while the assets are being loaded and sent to the GPU
+    auto allReady = [&] {
+      for (auto& model : models) {
+        if (model.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+      }
+      return image.wait_for(std::chrono::seconds(0)) == std::future_status::ready &&
+        sound.wait_for(std::chrono::seconds(0)) == std::future_status::ready &&
+        missing.wait_for(std::chrono::seconds(0)) == std::future_status::ready &&
+        r->getNumQueuedUploads() == 0;
+    };
+
+    auto startTime = std::chrono::steady_clock::now();
+    while (!allReady()) {
+      auto frameStart = std::chrono::steady_clock::now();
+      r->swapBuffers();
+      maxFrameSeconds = std::max(maxFrameSeconds,
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count());
+      ++numFrames;
+      if (std::chrono::steady_clock::now() - startTime > std::chrono::seconds(60)) {
+        LOGINFO("The assets have not been loaded in time.");
+        std::remove("testAssetGoat.bin");
+        return 0;
+      }
+    }
+  }
+  std::remove("testAssetGoat.bin");
+
+  LOGINFO("Loaded " + std::to_string(models.size()) + " models in the background during " +
+    std::to_string(numFrames) + " frames, the longest of which took " +
+    std::to_string(maxFrameSeconds * 1000) + " ms (" + std::to_string(singleUploadFrameSeconds * 1000) +
+    " ms with a single upload).");
+
+  // Only the uploads fitting in uploadTimeBudget (and at least one) are sent
+  // in each frame, so no frame should take much longer than one with a single
+  // upload plus the budget. The frames can also be slowed down by the two
+  // loading threads, when there are not enough processor cores for all three
+  // threads.
+  double maxExpectedFrameSeconds = 2 * (singleUploadFrameSeconds + r->uploadTimeBudget);
+  double sharedCoreFactor = std::max(1.0, 3.0 / std::max(std::thread::hardware_concurrency(), 1u));
+  if (maxFrameSeconds > maxExpectedFrameSeconds * sharedCoreFactor) {
+    LOGINFO("A frame has taken longer than " + std::to_string(maxExpectedFrameSeconds * sharedCoreFactor * 1000) +
+      " ms while loading in the background.");
+    return 0;
+  }
+
+  for (size_t i = 0; i < models.size(); ++i) {
+    auto model = models[i].get();
+    auto& original = i % 3 == 1 ? cube : goat;
+    if (model->vertexData != original.vertexData || model->indexData != original.indexData ||
+      model->normalsData != original.normalsData) {
+      LOGINFO("A model loaded in the background does not match the original.");
+      return 0;
+    }
+    if (!model->isInGPU()) {
+      LOGINFO("A model loaded in the background has not been sent to the GPU.");
+      return 0;
+    }
+    r->clearBuffers(*model);
+  }
+
+  auto loadedImage = image.get();
+  if (loadedImage->getByteSize() != cubeTexture.getByteSize() ||
+    memcmp(loadedImage->getData(), cubeTexture.getData(), cubeTexture.getByteSize()) != 0) {
+    LOGINFO("The image loaded in the background does not match the original.");
+    return 0;
+  }
+
+  if (r->getTextureHandle("assetManagerTexture") == 0) {
+    LOGINFO("No texture has been generated from the image loaded in the background.");
+    return 0;
+  }
+  r->deleteTexture("assetManagerTexture");
+
+  if (sound.get() == nullptr) {
+    LOGINFO("The sound has not been loaded in the background.");
+    return 0;
+  }
+
+  bool thrown = false;
+  try {
+    missing.get();
+  }
+  catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  if (!thrown) {
+    LOGINFO("Loading a missing file in the background has not thrown.");
+    return 0;
+  }
+
+  return 1;
+}
+
+int SoundTest() {
+  Sound snd(resourceDir + "/sounds/bah.ogg");
+  snd.play();
+  double startSeconds = getTimeInSeconds();
+  while (getTimeInSeconds() - startSeconds < 0.5);
+  snd.stop();
+
+  snd.divideVolume(4);
+  snd.play();
+  startSeconds = getTimeInSeconds();
+  while (getTimeInSeconds() - startSeconds < 0.5);
+  snd.stop();
+
+  startSeconds = getTimeInSeconds();
+  while (getTimeInSeconds() - startSeconds < 0.5);
+  snd.play();
+  // Make sure the sound is stopped by the stop function and not the destructor.
+  startSeconds = getTimeInSeconds();
+  while (getTimeInSeconds() - startSeconds < 2.0);
+  return 1;
+}
+
+int BinSoundTest() {
+
+  Sound srcsnd(resourceDir + "/sounds/bah.ogg");
+  
+  srcsnd.saveBinary("testBah.bin");
+  Sound snd("testBah.bin");
+
+  snd.play();
+  double startSeconds = getTimeInSeconds();
+  while (getTimeInSeconds() - startSeconds < 0.2);
+  snd.stop();
+
+  return 1;
+}
+
+int SoundTest2() {
+  Sound snd1(resourceDir + "/sounds/bah.ogg");
+  Sound snd2(snd1);
+  Sound snd3 = snd2;
+  snd1.play();
+  double startSeconds = getTimeInSeconds();
+  while (getTimeInSeconds() - startSeconds < 0.3);
+  snd2.play();
+  startSeconds = getTimeInSeconds();
+  while (getTimeInSeconds() - startSeconds < 0.3);
+  snd3.play();
+  startSeconds = getTimeInSeconds();
+  while (getTimeInSeconds() - startSeconds < 1.0);
+  return 1;
+}
+
+int SoundTest3() {
+  Sound snd(resourceDir + "/sounds/bah.ogg");
+  snd.play(true);
+  double startSeconds = getTimeInSeconds();
   while (getTimeInSeconds() - startSeconds < 6.0);
   return 1;
 }
 
-int GlbTest() {
+int GlbTest() {
+
+  GlbFile glb(resourceDir + "/models/goat.glb");
+
+  glb.printTokensRecursive();
+
+  glb.printTokensSerial();
+
+  return 1;
+}
+
+// Write a .glb file, padding the json with spaces
+static void writeGlb(const std::string& path, std::string json, const std::vector<char>& bin) {
+  while (json.size() % 4 != 0) json += " ";
+  uint32_t header[3] = { 0x46546C67, 2, static_cast<uint32_t>(12 + 8 + json.size() + 8 + bin.size()) };
+  uint32_t jsonChunk[2] = { static_cast<uint32_t>(json.size()), 0x4E4F534A };
+  uint32_t binChunk[2] = { static_cast<uint32_t>(bin.size()), 0x004E4942 };
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<char*>(header), sizeof(header));
+  file.write(reinterpret_cast<char*>(jsonChunk), sizeof(jsonChunk));
+  file.write(json.data(), json.size());
+  file.write(reinterpret_cast<char*>(binChunk), sizeof(binChunk));
+  file.write(bin.data(), bin.size());
+}
+
+int GlbAccessorTest() {
+
+  // A triangle with its positions and normals interleaved in the same
+  // buffer view, joints in shorts and indices in bytes
+  std::string json = "{\"asset\":{\"version\":\"2.0\"},"
+    "\"meshes\":[{\"name\":\"Triangle\",\"primitives\":[{\"attributes\":"
+    "{\"POSITION\":0,\"NORMAL\":1,\"JOINTS_0\":2},\"indices\":3}]}],"
+    "\"nodes\":[{\"name\":\"Triangle\",\"mesh\":0}],"
+    "\"accessors\":["
+    "{\"bufferView\":0,\"byteOffset\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"},"
+    "{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"},"
+    "{\"bufferView\":1,\"componentType\":5123,\"count\":3,\"type\":\"VEC4\"},"
+    "{\"bufferView\":2,\"componentType\":5121,\"count\":3,\"type\":\"SCALAR\"}],"
+    "\"bufferViews\":["
+    "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":72,\"byteStride\":24},"
+    "{\"buffer\":0,\"byteOffset\":72,\"byteLength\":24},"
+    "{\"buffer\":0,\"byteOffset\":96,\"byteLength\":3}],"
+    "\"buffers\":[{\"byteLength\":100}]}";
+
+  std::vector<char> bin(100, 0);
+  for (uint32_t vertex = 0; vertex < 3; ++vertex) {
+    float positionAndNormal[6] = { static_cast<float>(vertex), 10.0f + vertex, 20.0f + vertex,
+      0.0f, 0.0f, 1.0f + vertex };
+    memcpy(&bin[vertex * 24], positionAndNormal, 24);
+    uint16_t joints[4] = { static_cast<uint16_t>(vertex), 1, 2, 3 };
+    memcpy(&bin[72 + vertex * 8], joints, 8);
+    bin[96 + vertex] = static_cast<char>(2 - vertex);
+  }
+
+  writeGlb("testTriangle.glb", json, bin);
+
+  Model triangle(GlbFile("testTriangle.glb"), "Triangle");
+  std::remove("testTriangle.glb");
+
+  if (triangle.vertexData.size() != 12 || triangle.normalsData.size() != 9 ||
+    triangle.jointData.size() != 12 || triangle.getNumIndices() != 3) {
+    LOGINFO("The triangle has not been loaded with the right amount of data.");
+    return 0;
+  }
+
+  for (uint32_t vertex = 0; vertex < 3; ++vertex) {
+    if (triangle.vertexData[vertex * 4] != vertex ||
+      triangle.vertexData[vertex * 4 + 1] != 10.0f + vertex ||
+      triangle.vertexData[vertex * 4 + 2] != 20.0f + vertex ||
+      triangle.vertexData[vertex * 4 + 3] != 1.0f) {
+      LOGINFO("Wrong position read for vertex " + std::to_string(vertex));
+      return 0;
+    }
+    if (triangle.normalsData[vertex * 3 + 2] != 1.0f + vertex || triangle.normalsData[vertex * 3] != 0.0f) {
+      LOGINFO("Wrong normal read for vertex " + std::to_string(vertex));
+      return 0;
+    }
+    if (triangle.jointData[vertex * 4] != vertex || triangle.jointData[vertex * 4 + 3] != 3) {
+      LOGINFO("Wrong joints read for vertex " + std::to_string(vertex));
+      return 0;
+    }
+    if (triangle.indexData[vertex] != 2 - vertex) {
+      LOGINFO("Wrong index read at position " + std::to_string(vertex));
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+int GlbSceneTest() {
+
+  // A chain of 2000 nodes, each one with its own mesh (all meshes sharing
+  // the same triangle) and scaled a little along x relative to its parent
+  const uint32_t numNodes = 2000;
+  std::string json = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"a \\\"quoted\\\" name\"},"
+    "\"nodes\":[";
+  for (uint32_t idx = 0; idx < numNodes; ++idx) {
+    json += std::string(idx > 0 ? "," : "") + "{\"name\":\"node" + std::to_string(idx) +
+      "\",\"mesh\":" + std::to_string(idx) + ",\"scale\":[1.001,1,1]" +
+      (idx + 1 < numNodes ? ",\"children\":[" + std::to_string(idx + 1) + "]" : "") + "}";
+  }
+  json += "],\"meshes\":[";
+  for (uint32_t idx = 0; idx < numNodes; ++idx) {
+    json += std::string(idx > 0 ? "," : "") + "{\"name\":\"mesh" + std::to_string(idx) +
+      "\",\"primitives\":[{\"attributes\":{\"POSITION\":0}}]}";
+  }
+  json += "],\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"}],"
+    "\"bufferViews\":[{\"buffer\":0,\"byteLength\":36}],\"buffers\":[{\"byteLength\":36}]}";
+
+  std::vector<char> bin(36, 0);
+  float triangle[9] = { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+  memcpy(bin.data(), triangle, sizeof(triangle));
+  writeGlb("testScene.glb", json, bin);
+
+  auto startTime = std::chrono::steady_clock::now();
+  GlbFile scene("testScene.glb");
+  double parseMilliseconds = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - startTime).count();
+  std::remove("testScene.glb");
+
+  if (scene.getMeshNames().size() != numNodes) {
+    LOGINFO("Not all meshes of the scene have been found.");
+    return 0;
+  }
 
-  GlbFile glb(resourceDir + "/models/goat.glb");
+  startTime = std::chrono::steady_clock::now();
+  for (uint32_t idx = 0; idx < numNodes; idx += 100) {
+    Model model(scene, "mesh" + std::to_string(idx));
+    float expected = std::pow(1.001f, static_cast<float>(idx + 1));
+    if (std::abs(model.getOriginalScale().x - expected) > 0.001f || model.vertexData.size() != 12) {
+      LOGINFO("Mesh " + std::to_string(idx) + " has not been loaded with the scale of all its parents.");
+      return 0;
+    }
+  }
+  double loadMilliseconds = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - startTime).count();
 
-  glb.printTokensRecursive();
+  LOGINFO("Scene of " + std::to_string(numNodes) + " nodes parsed in " + std::to_string(parseMilliseconds) +
+    " ms. 20 meshes loaded in " + std::to_string(loadMilliseconds) + " ms.");
 
-  glb.printTokensSerial();
+  return 1;
+}
+
+int GlbMeshesTest() {
+
+  GlbFile goatAndTree(resourceDir + "/models/goatAndTree.glb");
+  auto meshNames = goatAndTree.getMeshNames();
+  auto models = goatAndTree.loadMeshes();
+
+  if (models.size() != meshNames.size() || models.size() < 2) {
+    LOGINFO("Not all meshes have been loaded.");
+    return 0;
+  }
+
+  for (size_t idx = 0; idx < models.size(); ++idx) {
+    Model model(GlbFile(resourceDir + "/models/goatAndTree.glb"), meshNames[idx]);
+    if (models[idx].vertexData != model.vertexData || models[idx].indexData != model.indexData ||
+      models[idx].normalsData != model.normalsData || models[idx].joints.size() != model.joints.size() ||
+      models[idx].animations.size() != model.animations.size() ||
+      models[idx].getOriginalScale().x != model.getOriginalScale().x) {
+      LOGINFO("Mesh " + meshNames[idx] + " has not been loaded the same way as when loading it alone.");
+      return 0;
+    }
+  }
+
+  auto someModels = goatAndTree.loadMeshes({ meshNames[1] });
+  if (someModels.size() != 1 || someModels[0].vertexData != models[1].vertexData) {
+    LOGINFO("The chosen mesh has not been loaded.");
+    return 0;
+  }
+
+  std::string message;
+  try {
+    goatAndTree.loadMeshes({ meshNames[0], "NoSuchMesh" });
+  }
+  catch (std::runtime_error& e) {
+    message = e.what();
+  }
+  if (message.find("NoSuchMesh") == std::string::npos) {
+    LOGINFO("Loading a mesh that does not exist has not failed, naming the mesh.");
+    return 0;
+  }
+
+  // Many large meshes, loaded one after another and all at once
+  const uint32_t numMeshes = 64;
+  const uint32_t numVertices = 30000;
+  std::string json = "{\"asset\":{\"version\":\"2.0\"},\"meshes\":[";
+  for (uint32_t idx = 0; idx < numMeshes; ++idx) {
+    json += std::string(idx > 0 ? "," : "") + "{\"name\":\"mesh" + std::to_string(idx) +
+      "\",\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":0}}]}";
+  }
+  json += "],\"nodes\":[],\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":" +
+    std::to_string(numVertices) + ",\"type\":\"VEC3\"}],\"bufferViews\":[{\"buffer\":0,\"byteLength\":" +
+    std::to_string(numVertices * 12) + "}],\"buffers\":[{\"byteLength\":" + std::to_string(numVertices * 12) + "}]}";
+
+  std::vector<char> bin(numVertices * 12);
+  std::vector<float> positions(numVertices * 3);
+  for (size_t idx = 0; idx < positions.size(); ++idx) {
+    positions[idx] = static_cast<float>(idx % 101) / 100.0f;
+  }
+  memcpy(bin.data(), positions.data(), bin.size());
+  writeGlb("testMeshes.glb", json, bin);
+
+  GlbFile meshes("testMeshes.glb");
+  std::remove("testMeshes.glb");
+
+  auto startTime = std::chrono::steady_clock::now();
+  std::vector<Model> serialModels;
+  for (const auto& meshName : meshes.getMeshNames()) {
+    serialModels.emplace_back(meshes, meshName);
+  }
+  double serialMilliseconds = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - startTime).count();
+
+  startTime = std::chrono::steady_clock::now();
+  auto parallelModels = meshes.loadMeshes();
+  double parallelMilliseconds = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - startTime).count();
+
+  for (size_t idx = 0; idx < numMeshes; ++idx) {
+    if (parallelModels[idx].vertexData != serialModels[idx].vertexData ||
+      parallelModels[idx].getNumIndices() != numVertices) {
+      LOGINFO("Mesh " + std::to_string(idx) + " has not been loaded correctly in parallel.");
+      return 0;
+    }
+  }
+
+  LOGINFO(std::to_string(numMeshes) + " meshes loaded in " + std::to_string(serialMilliseconds) +
+    " ms one by one and in " + std::to_string(parallelMilliseconds) + " ms in parallel (" +
+    std::to_string(std::thread::hardware_concurrency()) + " hardware threads).");
+
+  return 1;
+}
+
+int MappedFileTest() {
+
+  std::vector<char> contents(100000);
+  for (size_t idx = 0; idx < contents.size(); ++idx) {
+    contents[idx] = static_cast<char>(idx * 7);
+  }
+
+  {
+    std::ofstream file("testMapped.bin", std::ios::binary);
+    file.write(contents.data(), contents.size());
+  }
+
+  {
+    MappedFile mapped("testMapped.bin", true);
+    if (mapped.size() != contents.size() ||
+      memcmp(mapped.data(), contents.data(), contents.size()) != 0) {
+      LOGINFO("The mapped file does not have the contents written to it.");
+      std::remove("testMapped.bin");
+      return 0;
+    }
+  }
+
+  std::remove("testMapped.bin");
+
+  {
+    std::ofstream file("testMappedEmpty.bin", std::ios::binary);
+  }
+
+  {
+    MappedFile mapped("testMappedEmpty.bin", false);
+    if (mapped.size() != 0) {
+      LOGINFO("The mapped empty file has a size.");
+      std::remove("testMappedEmpty.bin");
+      return 0;
+    }
+  }
+
+  std::remove("testMappedEmpty.bin");
+
+  bool thrown = false;
+  try {
+    MappedFile mapped("notThere.bin", false);
+  }
+  catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  if (!thrown) {
+    LOGINFO("Mapping a missing file has not thrown.");
+    return 0;
+  }
+
+  return 1;
+}
+
+int JointPaletteTest() {
+
+  Model goat(GlbFile(resourceDir + "/models/goatUnscaled.glb"), "Cube");
+
+  if (goat.joints.size() == 0) {
+    LOGERROR("No joints loaded for goat");
+    return 0;
+  }
+
+  for (uint64_t pose = 0; pose < 10; ++pose) {
+    // Request twice, so that the cached palette gets checked too
+    for (int pass = 0; pass < 2; ++pass) {
+      const Mat4* palette = goat.getJointPalette(0, pose);
+      for (size_t jointIdx = 0; jointIdx < goat.joints.size(); ++jointIdx) {
+        auto expected = goat.getJointTransform(jointIdx, 0, pose) *
+          goat.joints[jointIdx].inverseBindMatrix;
+        auto found = palette[jointIdx];
+        for (int row = 0; row < 4; ++row) {
+          for (int col = 0; col < 4; ++col) {
+            if (std::abs(expected[row][col] - found[row][col]) > 0.0001f) {
+              LOGERROR("Joint palette mismatch for joint " + std::to_string(jointIdx) +
+                ", pose " + std::to_string(pose));
+              return 0;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Once the model is marked as changed, the cached palettes are not used
+  goat.joints[0].inverseBindMatrix = translate(Mat4(1.0f), Vec3(1.0f, 2.0f, 3.0f)) *
+    goat.joints[0].inverseBindMatrix;
+  goat.markDataChanged();
+  auto expected = goat.getJointTransform(0, 0, 5) * goat.joints[0].inverseBindMatrix;
+  auto found = goat.getJointPalette(0, 5)[0];
+  for (int row = 0; row < 4; ++row) {
+    for (int col = 0; col < 4; ++col) {
+      if (std::abs(expected[row][col] - found[row][col]) > 0.0001f) {
+        LOGERROR("Cached joint palette used after the model was marked as changed");
+        return 0;
+      }
+    }
+  }
+
+  return 1;
+}
+
+int AnimationSamplingTest() {
+
+  auto sameMat4 = [](Mat4 mat1, Mat4 mat2) {
+    for (int col = 0; col < 4; ++col) {
+      for (int row = 0; row < 4; ++row) {
+        if (std::abs(mat1[col][row] - mat2[col][row]) > 0.0001f) return false;
+      }
+    }
+    return true;
+  };
+
+  Vec3 interpolated = lerp(Vec3(0.0f, 2.0f, -4.0f), Vec3(4.0f, 2.0f, 4.0f), 0.25f);
+  if (std::abs(interpolated.x - 1.0f) > 0.0001f || std::abs(interpolated.y - 2.0f) > 0.0001f ||
+    std::abs(interpolated.z + 2.0f) > 0.0001f) {
+    LOGERROR("Wrong linear interpolation");
+    return 0;
+  }
+
+  const float halfPi = 1.5707963f;
+  Quat noRotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+  Quat quarterTurn = { 0.0f, std::sin(halfPi / 2), 0.0f, std::cos(halfPi / 2) };
+  Quat eighthTurn = slerp(noRotation, quarterTurn, 0.5f);
+  if (std::abs(eighthTurn.x) > 0.0001f || std::abs(eighthTurn.y - std::sin(halfPi / 4)) > 0.0001f ||
+    std::abs(eighthTurn.z) > 0.0001f || std::abs(eighthTurn.w - std::cos(halfPi / 4)) > 0.0001f) {
+    LOGERROR("Wrong spherical interpolation");
+    return 0;
+  }
+
+  // A model moving and turning a quarter around the y axis from the first
+  // to the second keyframe, then only moving until the third one
+  Model model;
+  Model::AnimationComponent component;
+  component.times = { 1.0f, 3.0f, 5.0f };
+  component.translationAnimation = { Vec3(0.0f, 0.0f, 0.0f), Vec3(4.0f, 2.0f, 0.0f), Vec3(4.0f, 2.0f, 8.0f) };
+  component.rotationAnimation = { noRotation, quarterTurn, quarterTurn };
+  model.animations.push_back({ "move", { component } });
+
+  if (model.getAnimationDuration(0) != 5.0f) {
+    LOGERROR("Wrong animation duration");
+    return 0;
+  }
+
+  struct Sample {
+    float seconds;
+    Vec3 translation;
+    float angle;
+  };
+
+  // Before the first and after the last keyframe, the model stays at them
+  std::vector<Sample> samples = {
+    { 0.0f, Vec3(0.0f, 0.0f, 0.0f), 0.0f },
+    { 1.0f, Vec3(0.0f, 0.0f, 0.0f), 0.0f },
+    { 2.0f, Vec3(2.0f, 1.0f, 0.0f), halfPi / 2 },
+    { 2.5f, Vec3(3.0f, 1.5f, 0.0f), halfPi * 3 / 4 },
+    { 3.0f, Vec3(4.0f, 2.0f, 0.0f), halfPi },
+    { 4.0f, Vec3(4.0f, 2.0f, 4.0f), halfPi },
+    { 6.0f, Vec3(4.0f, 2.0f, 8.0f), halfPi }
+  };
+
+  for (auto& sample : samples) {
+    Mat4 expected = translate(Mat4(1.0f), sample.translation) *
+      rotate(Mat4(1.0f), sample.angle, Vec3(0.0f, 1.0f, 0.0f));
+    if (!sameMat4(model.getTransformAt(0, sample.seconds), expected)) {
+      LOGERROR("Wrong transform sampled at " + std::to_string(sample.seconds) + " seconds");
+      return 0;
+    }
+  }
+
+  // Switching between time and frame based animation
+  SceneObject goat("goat", Model(GlbFile(resourceDir + "/models/goatUnscaled.glb"), "Cube"));
+  goat.setFrameDelay(1);
+  goat.startAnimating();
+  goat.animate(0.25f);
+  goat.animate(0.25f);
+  if (std::abs(goat.getAnimationTime() - 0.5f) > 0.0001f) {
+    LOGERROR("Wrong time accumulated by time based animation");
+    return 0;
+  }
+
+  goat.animate();
+  goat.animate();
+  if (goat.getAnimationTime() != 0.0f || goat.getCurrentPose() != 2) {
+    LOGERROR("The animation time has been kept after switching to frame based animation");
+    return 0;
+  }
+
+  goat.animate(0.25f);
+  if (std::abs(goat.getAnimationTime() - 0.25f) > 0.0001f) {
+    LOGERROR("Time based animation has not restarted after frame based animation");
+    return 0;
+  }
+
+  goat.resetAnimation();
+  if (goat.getAnimationTime() != 0.0f || goat.getCurrentPose() != 0) {
+    LOGERROR("The animation has not been reset");
+    return 0;
+  }
+
+  return 1;
+}
+
+int PackedVertexDataTest() {
+
+  Model goat(GlbFile(resourceDir + "/models/goatUnscaled.glb"), "Cube");
+
+  // Position, normal, texture coordinates, joints and weights
+  if (goat.getPackedVertexStride() != 32) {
+    LOGERROR("Unexpected packed vertex stride " + std::to_string(goat.getPackedVertexStride()));
+    return 0;
+  }
+
+  size_t numVertices = goat.vertexData.size() / 4;
+
+  if (goat.packedVertexData.size() != numVertices * 32) {
+    LOGERROR("Unexpected packed vertex data size");
+    return 0;
+  }
+
+  for (size_t idx = 0; idx < numVertices; ++idx) {
+    const uint8_t* vertex = &goat.packedVertexData[idx * 32];
+
+    float position[3];
+    memcpy(position, vertex, sizeof(position));
+    int16_t normal[3];
+    memcpy(normal, vertex + 12, sizeof(normal));
+    uint16_t uv[2];
+    memcpy(uv, vertex + 20, sizeof(uv));
+
+    for (size_t c = 0; c < 3; ++c) {
+      if (position[c] != goat.vertexData[idx * 4 + c] ||
+        std::abs(normal[c] / 32767.0f - goat.normalsData[idx * 3 + c]) > 0.0001f) {
+        LOGERROR("Packed position or normal mismatch for vertex " + std::to_string(idx));
+        return 0;
+      }
+    }
+
+    for (size_t c = 0; c < 2; ++c) {
+      if (std::abs(uv[c] / 65535.0f - goat.textureCoordsData[idx * 2 + c]) > 0.00001f) {
+        LOGERROR("Packed texture coordinates mismatch for vertex " + std::to_string(idx));
+        return 0;
+      }
+    }
+
+    uint32_t weightSum = 0;
+    for (size_t c = 0; c < 4; ++c) {
+      if (vertex[24 + c] != goat.jointData[idx * 4 + c] ||
+        std::abs(vertex[28 + c] / 255.0f - goat.weightData[idx * 4 + c]) > 0.01f) {
+        LOGERROR("Packed joint or weight mismatch for vertex " + std::to_string(idx));
+        return 0;
+      }
+      weightSum += vertex[28 + c];
+    }
+
+    if (weightSum != 255) {
+      LOGERROR("Packed weights do not add up to 1 for vertex " + std::to_string(idx));
+      return 0;
+    }
+  }
+
+  // Texture coordinates outside [0, 1] cannot be packed
+  Model rect;
+  rect.vertexData = { 0.0f, 0.0f, 0.0f, 1.0f };
+  rect.vertexDataByteSize = 4 * sizeof(float);
+  rect.textureCoordsData = { 2.0f, 0.0f };
+  rect.textureCoordsDataByteSize = 2 * sizeof(float);
+
+  if (rect.packVertexData() || !rect.packedVertexData.empty()) {
+    LOGERROR("Packed texture coordinates outside [0, 1]");
+    return 0;
+  }
+
+  return 1;
+}
+
+int LargeModelTest() {
+
+  // A grid with more vertices than can be indexed in 16 bits
+  const uint32_t side = 300;
+  Model grid;
+  std::vector<uint32_t> indices;
+
+  for (uint32_t row = 0; row < side; ++row) {
+    for (uint32_t col = 0; col < side; ++col) {
+      grid.vertexData.insert(grid.vertexData.end(),
+        { static_cast<float>(col), 0.0f, static_cast<float>(row), 1.0f });
+      if (row > 0 && col > 0) {
+        uint32_t v = row * side + col;
+        indices.insert(indices.end(), { v - side - 1, v - 1, v, v, v - side, v - side - 1 });
+      }
+    }
+  }
+  grid.vertexDataByteSize = static_cast<uint32_t>(grid.vertexData.size() * sizeof(float));
+  grid.setIndexData(indices);
+
+  if (!grid.indexData.empty() || grid.indexData32 != indices ||
+    grid.indexDataByteSize != indices.size() * sizeof(uint32_t)) {
+    LOGERROR("Indices not stored in 32 bits");
+    return 0;
+  }
+
+  grid.saveBinary("testGrid.bin");
+  Model gridFromBin(BinaryFile("testGrid.bin"), "");
+  std::remove("testGrid.bin");
+  if (gridFromBin.indexData32 != indices || gridFromBin.indexDataByteSize != grid.indexDataByteSize) {
+    LOGERROR("32-bit indices not saved in binary format");
+    return 0;
+  }
+
+  auto meshlets = grid.splitIntoMeshlets();
+
+  if (meshlets.size() < 2) {
+    LOGERROR("Grid not split into meshlets");
+    return 0;
+  }
+
+  size_t triangle = 0;
+  for (auto& meshlet : meshlets) {
+    if (meshlet.vertexData.size() / 4 > 65536 || !meshlet.indexData32.empty()) {
+      LOGERROR("Meshlet cannot be indexed in 16 bits");
+      return 0;
+    }
+    for (size_t idx = 0; idx < meshlet.indexData.size(); ++idx) {
+      auto original = &grid.vertexData[indices[triangle * 3 + idx % 3] * 4];
+      auto found = &meshlet.vertexData[meshlet.indexData[idx] * 4];
+      if (memcmp(original, found, 4 * sizeof(float)) != 0) {
+        LOGERROR("Meshlet triangle " + std::to_string(triangle) + " does not match the original");
+        return 0;
+      }
+      if (idx % 3 == 2) ++triangle;
+    }
+  }
+
+  if (triangle * 3 != indices.size()) {
+    LOGERROR("Triangles lost while splitting into meshlets");
+    return 0;
+  }
+
+  // Small index values are stored in 16 bits
+  grid.setIndexData({ 0, 1, 2 });
+  if (grid.indexData.size() != 3 || !grid.indexData32.empty() ||
+    grid.getNumIndices() != 3) {
+    LOGERROR("Indices not stored in 16 bits");
+    return 0;
+  }
 
   return 1;
 }
@@ -619,6 +2726,194 @@ int ModelsTimeToLoad() {
   Model wf(WavefrontFile(resourceDir + "/models/goat.obj"), "");
   LOGINFO("Read Wavefront model in " + std::to_string(getTimeInSeconds() - startTime) + " seconds.");
 
+  // A large model, in both binary formats
+  const uint32_t side = 500;
+  Model grid;
+  for (uint32_t row = 0; row < side; ++row) {
+    for (uint32_t col = 0; col < side; ++col) {
+      grid.vertexData.insert(grid.vertexData.end(),
+        { static_cast<float>(col), 0.0f, static_cast<float>(row), 1.0f });
+      grid.normalsData.insert(grid.normalsData.end(), { 0.0f, 1.0f, 0.0f });
+      grid.textureCoordsData.insert(grid.textureCoordsData.end(),
+        { static_cast<float>(col) / side, static_cast<float>(row) / side });
+    }
+  }
+  std::vector<uint32_t> indices;
+  for (uint32_t row = 1; row < side; ++row) {
+    for (uint32_t col = 1; col < side; ++col) {
+      uint32_t v = row * side + col;
+      indices.insert(indices.end(), { v - side - 1, v - 1, v, v, v - side, v - side - 1 });
+    }
+  }
+  grid.setIndexData(indices);
+  grid.vertexDataByteSize = static_cast<uint32_t>(grid.vertexData.size() * sizeof(float));
+  grid.normalsDataByteSize = static_cast<uint32_t>(grid.normalsData.size() * sizeof(float));
+  grid.textureCoordsDataByteSize = static_cast<uint32_t>(grid.textureCoordsData.size() * sizeof(float));
+  grid.packVertexData();
+
+  grid.saveBinary("testGridCompressed.bin");
+  grid.saveBinary("testGridMapped.bin", std::vector<uint32_t>(), Model::BinaryFormat::mapped);
+
+  startTime = getTimeInSeconds();
+  Model compressedGrid(BinaryFile("testGridCompressed.bin"), "");
+  LOGINFO("Read large compressed binary model in " + std::to_string(getTimeInSeconds() - startTime) + " seconds.");
+
+  startTime = getTimeInSeconds();
+  Model mappedGrid(BinaryFile("testGridMapped.bin"), "");
+  LOGINFO("Read large mapped binary model in " + std::to_string(getTimeInSeconds() - startTime) + " seconds.");
+
+  std::remove("testGridCompressed.bin");
+  std::remove("testGridMapped.bin");
+
+  return 1;
+}
+
+int DrawCallTime() {
+  initRenderer();
+
+  // A small rectangle, placed behind the camera, so that rasterisation
+  // costs next to nothing and what is measured is mostly the CPU time spent
+  // per draw call, setting up buffers and uniforms.
+  Model rect;
+  r->createRectangle(rect, Vec3(-0.1f, 0.1f, 0.0f), Vec3(0.1f, -0.1f, 0.0f));
+
+  const uint32_t drawsPerFrame = 1000;
+  const uint32_t numFrames = 20;
+
+  // Draw each call separately (and do not cull the rectangle)
+  bool instancing = r->instancing;
+  r->instancing = false;
+  r->culling = false;
+
+  r->render(rect, Vec3(0.0f, 0.0f, 10.0f), Vec3(0.0f, 0.0f, 0.0f), Vec4(1.0f, 1.0f, 1.0f, 1.0f));
+  r->swapBuffers();
+
+  auto startTime = getTimeInSeconds();
+
+  for (uint32_t frame = 0; frame < numFrames; ++frame) {
+    for (uint32_t draw = 0; draw < drawsPerFrame; ++draw) {
+      r->render(rect, Vec3(0.0f, 0.0f, 10.0f), Vec3(0.0f, 0.0f, 0.0f), Vec4(1.0f, 1.0f, 1.0f, 1.0f));
+    }
+    r->swapBuffers();
+  }
+
+  auto microsecondsPerDraw = (getTimeInSeconds() - startTime) * 1000000.0 /
+    (static_cast<double>(drawsPerFrame) * numFrames);
+
+  LOGINFO("Draw call time: " + std::to_string(microsecondsPerDraw) + " microseconds.");
+
+  r->instancing = instancing;
+  r->culling = true;
+  r->clearBuffers(rect);
+
+  return 1;
+}
+
+int RenderAllocationsTest() {
+  initRenderer();
+
+  SceneObject cube("cube", Model(WavefrontFile(resourceDir + "/models/Cube/Cube.obj")));
+  cube.position = Vec3(0.0f, -1.0f, -8.0f);
+
+  Image cubeTexture(resourceDir + "/models/Cube/cubeTexture.png");
+  uint32_t cubeTextureHandle = r->generateTexture("cubeTexture", cubeTexture);
+
+  if (cubeTextureHandle == 0 || r->getTextureHandle("cubeTexture") != cubeTextureHandle) return 0;
+
+  Model rect;
+  r->createRectangle(rect, Vec3(-0.1f, 0.1f, 0.0f), Vec3(0.1f, -0.1f, 0.0f));
+
+  // More render calls per frame than the space reserved at startup
+  const uint32_t drawsPerFrame = 2000;
+
+  uint64_t submissionAllocations = 0;
+
+  auto renderFrame = [&]() {
+    uint64_t allocationsBefore = getHeapAllocations();
+    for (uint32_t draw = 0; draw < drawsPerFrame; ++draw) {
+      if (draw % 2 == 0) {
+        r->render(cube, cubeTextureHandle);
+      }
+      else {
+        r->render(rect, Vec3(0.0f, 0.0f, -2.0f - 0.001f * draw), Mat4(1.0f),
+          cubeTextureHandle);
+      }
+    }
+    r->render(rect, Vec4(1.0f, 0.0f, 0.0f, 1.0f), 0, false);
+    submissionAllocations += getHeapAllocations() - allocationsBefore;
+
+    // Only submission is counted, because the OpenGL driver may allocate
+    // memory itself while drawing.
+    r->swapBuffers();
+  };
+
+  // The first frames grow the render list and other buffers
+  for (uint32_t frame = 0; frame < 3; ++frame) {
+    renderFrame();
+  }
+
+  uint64_t growthAllocations = submissionAllocations;
+  submissionAllocations = 0;
+
+  for (uint32_t frame = 0; frame < 10; ++frame) {
+    renderFrame();
+  }
+
+  LOGINFO("Heap allocations while submitting the first 3 frames: " +
+    std::to_string(growthAllocations) + ", the next 10 frames: " +
+    std::to_string(submissionAllocations));
+
+  r->clearBuffers(cube.getModel());
+  r->clearBuffers(rect);
+  r->deleteTexture("cubeTexture");
+
+  return submissionAllocations == 0 ? 1 : 0;
+}
+
+int CullingTest() {
+  initRenderer();
+
+  Model cube(WavefrontFile(resourceDir + "/models/Cube/CubeNoTexture.obj"));
+
+  if (cube.getBoundsMin().x > -0.9f || cube.getBoundsMax().x < 0.9f ||
+    cube.getBoundingRadius() < 1.7f || cube.getBoundingRadius() > 1.8f) return 0;
+
+  r->cameraPosition = Vec3(0.0f, 0.0f, 0.0f);
+  r->setCameraRotation(Vec3(0.0f, 0.0f, 0.0f));
+
+  auto renderCubes = [&]() {
+    // In view
+    r->render(cube, Vec3(0.0f, 0.0f, -8.0f), Vec3(0.0f, 0.0f, 0.0f), Vec4(1.0f, 1.0f, 1.0f, 1.0f));
+    // Behind the camera
+    r->render(cube, Vec3(0.0f, 0.0f, 8.0f), Vec3(0.0f, 0.0f, 0.0f), Vec4(1.0f, 1.0f, 1.0f, 1.0f));
+    // Far to the right
+    r->render(cube, Vec3(100.0f, 0.0f, -8.0f), Vec3(0.0f, 0.0f, 0.0f), Vec4(1.0f, 1.0f, 1.0f, 1.0f));
+    // Partly in view, on the left
+    r->render(cube, Vec3(-9.0f, 0.0f, -8.0f), Vec3(0.0f, 0.0f, 0.0f), Vec4(1.0f, 1.0f, 1.0f, 1.0f));
+    // Orthographic rendering is never culled
+    r->render(cube, Vec4(1.0f, 1.0f, 1.0f, 1.0f), 0, false);
+    r->swapBuffers();
+  };
+
+  renderCubes();
+
+  auto statistics = r->getRenderStatistics();
+
+  LOGINFO("Drawn: " + std::to_string(statistics.drawn) + ", culled: " +
+    std::to_string(statistics.culled));
+
+  if (statistics.drawn != 3 || statistics.culled != 2) return 0;
+
+  r->culling = false;
+  renderCubes();
+  r->culling = true;
+
+  statistics = r->getRenderStatistics();
+
+  if (statistics.drawn != 5 || statistics.culled != 0) return 0;
+
+  r->clearBuffers(cube);
+
   return 1;
 }
 
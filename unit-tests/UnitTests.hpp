@@ -12,8 +12,17 @@ extern small3d::Renderer *r;
 void pollEvents();
 void initRenderer(uint32_t width = 854, uint32_t height = 480);
 
+// All the heap allocations made through new in the test executable are
+// counted (see HeapAllocations.cpp), so that tests can check that some
+// code does not allocate.
+uint64_t getHeapAllocations();
+
 int LoggerTest();
 int MathTest();
+int SimdMathTest();
+int MathBenchmark();
+int BatchMathTest();
+int ThreadPoolTest();
 int ImageTest();
 int WavefrontFailTest();
 int WavefrontModelTest();
@@ -22,14 +31,37 @@ int GlbTextureTestDefaultShadows();
 int BoundingBoxesTest();
 int FPStest();
 int GenericSceneObjectConstructorTest();
+int BoxIntersectionTest();
+int BoundingBoxTreeTest();
+int BoundingBoxCacheTest();
+int CollisionWorldTest();
+int RaycastTest();
+int SweptCollisionTest();
 int RendererTest();
+int InstancingTest();
+int ModelResidencyTest();
 int BinaryModelTest();
+int BinaryFormatTest();
+int LegacyBinaryModelTest();
+int PackTest();
+int AssetManagerTest();
 int SoundTest();
 int BinSoundTest();
 int SoundTest2();
 int SoundTest3();
 int GlbTest();
+int GlbAccessorTest();
+int GlbSceneTest();
+int GlbMeshesTest();
+int MappedFileTest();
+int JointPaletteTest();
+int AnimationSamplingTest();
+int PackedVertexDataTest();
+int LargeModelTest();
 int ModelsTimeToLoad();
+int DrawCallTime();
+int RenderAllocationsTest();
+int CullingTest();
 #ifdef _WIN32
 int ScreenCaptureTest();
 int ControllerTest();
@@ -28,6 +28,30 @@ int main(int argc, char** argv) {
       return EXIT_FAILURE;
     }
     LOGINFO("MathTest OK");
+
+    if (!SimdMathTest()) {
+      LOGINFO("*** Failing SimdMathTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("SimdMathTest OK");
+
+    if (!MathBenchmark()) {
+      LOGINFO("*** Failing MathBenchmark.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("MathBenchmark OK");
+
+    if (!BatchMathTest()) {
+      LOGINFO("*** Failing BatchMathTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("BatchMathTest OK");
+
+    if (!ThreadPoolTest()) {
+      LOGINFO("*** Failing ThreadPoolTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("ThreadPoolTest OK");
     
 #ifdef _WIN32
     if (!ScreenCaptureTest()) {
@@ -90,6 +114,42 @@ int main(int argc, char** argv) {
       return EXIT_FAILURE;
     }
     LOGINFO("GenericSceneObjectConstructorTest OK");
+
+    if (!BoxIntersectionTest()) {
+      LOGINFO("*** Failing BoxIntersectionTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("BoxIntersectionTest OK");
+
+    if (!BoundingBoxTreeTest()) {
+      LOGINFO("*** Failing BoundingBoxTreeTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("BoundingBoxTreeTest OK");
+
+    if (!BoundingBoxCacheTest()) {
+      LOGINFO("*** Failing BoundingBoxCacheTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("BoundingBoxCacheTest OK");
+
+    if (!CollisionWorldTest()) {
+      LOGINFO("*** Failing CollisionWorldTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("CollisionWorldTest OK");
+
+    if (!RaycastTest()) {
+      LOGINFO("*** Failing RaycastTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("RaycastTest OK");
+
+    if (!SweptCollisionTest()) {
+      LOGINFO("*** Failing SweptCollisionTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("SweptCollisionTest OK");
     
     if (!RendererTest()) {
       LOGINFO("*** Failing RendererTest.");
@@ -97,12 +157,48 @@ int main(int argc, char** argv) {
     }
     LOGINFO("RendererTest OK");
 
+    if (!InstancingTest()) {
+      LOGINFO("*** Failing InstancingTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("InstancingTest OK");
+
+    if (!ModelResidencyTest()) {
+      LOGINFO("*** Failing ModelResidencyTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("ModelResidencyTest OK");
+
     if (!BinaryModelTest()) {
       LOGINFO("*** Failing BinaryModelTest.");
       return EXIT_FAILURE;
     }
     LOGINFO("BinaryModelTest OK");
 
+    if (!BinaryFormatTest()) {
+      LOGINFO("*** Failing BinaryFormatTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("BinaryFormatTest OK");
+
+    if (!LegacyBinaryModelTest()) {
+      LOGINFO("*** Failing LegacyBinaryModelTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("LegacyBinaryModelTest OK");
+
+    if (!PackTest()) {
+      LOGINFO("*** Failing PackTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("PackTest OK");
+
+    if (!AssetManagerTest()) {
+      LOGINFO("*** Failing AssetManagerTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("AssetManagerTest OK");
+
     if (!SoundTest()) {
       LOGINFO("*** Failing SoundTest.");
       return EXIT_FAILURE;
@@ -133,12 +229,78 @@ int main(int argc, char** argv) {
     }
     LOGINFO("GlbTest OK");
 
+    if (!GlbAccessorTest()) {
+      LOGINFO("*** Failing GlbAccessorTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("GlbAccessorTest OK");
+
+    if (!GlbSceneTest()) {
+      LOGINFO("*** Failing GlbSceneTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("GlbSceneTest OK");
+
+    if (!GlbMeshesTest()) {
+      LOGINFO("*** Failing GlbMeshesTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("GlbMeshesTest OK");
+
+    if (!MappedFileTest()) {
+      LOGINFO("*** Failing MappedFileTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("MappedFileTest OK");
+
+    if (!JointPaletteTest()) {
+      LOGINFO("*** Failing JointPaletteTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("JointPaletteTest OK");
+
+    if (!AnimationSamplingTest()) {
+      LOGINFO("*** Failing AnimationSamplingTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("AnimationSamplingTest OK");
+
+    if (!PackedVertexDataTest()) {
+      LOGINFO("*** Failing PackedVertexDataTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("PackedVertexDataTest OK");
+
+    if (!LargeModelTest()) {
+      LOGINFO("*** Failing LargeModelTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("LargeModelTest OK");
+
     if (!ModelsTimeToLoad()) {
       LOGINFO("*** Failing ModelsTimeToLoad.");
       return EXIT_FAILURE;
     }
     LOGINFO("ModelsTimeToLoad OK");
 
+    if (!DrawCallTime()) {
+      LOGINFO("*** Failing DrawCallTime.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("DrawCallTime OK");
+
+    if (!RenderAllocationsTest()) {
+      LOGINFO("*** Failing RenderAllocationsTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("RenderAllocationsTest OK");
+
+    if (!CullingTest()) {
+      LOGINFO("*** Failing CullingTest.");
+      return EXIT_FAILURE;
+    }
+    LOGINFO("CullingTest OK");
+
     LOGINFO("###################################################");
     LOGINFO("###### All tests have executed successfully. ######");
     LOGINFO("###################################################");